@@ -279,6 +279,12 @@ struct platform_device exynos_drm_ipp_device = {
 };
 #endif
 
+#ifdef CONFIG_DRM_EXYNOS_IPP_SW
+static struct platform_device exynos_drm_ipp_sw_device = {
+	.name	= "exynos-drm-ipp-sw",
+};
+#endif
+
 #ifdef CONFIG_DRM_EXYNOS_GSC
 static u64 exynos_gsc_dma_mask = DMA_BIT_MASK(32);
 
@@ -367,6 +373,9 @@ static struct platform_device *display_devices[] __initdata = {
 #ifdef CONFIG_DRM_EXYNOS_IPP
 	&exynos_drm_ipp_device,
 #endif
+#ifdef CONFIG_DRM_EXYNOS_IPP_SW
+	&exynos_drm_ipp_sw_device,
+#endif
 #ifdef CONFIG_DRM_EXYNOS_GSC
 	&exynos3_device_gsc0,
 	&exynos3_device_gsc1,
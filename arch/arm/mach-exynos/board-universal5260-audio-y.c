@@ -77,6 +77,9 @@ static struct platform_device ymu831_snd_card_device = {
 
 static struct platform_device *universal5260_audio_devices[] __initdata = {
 	&exynos5_device_lpass,
+#ifdef CONFIG_SND_SAMSUNG_COMPR
+	&exynos5_device_compr,
+#endif
 	&s3c64xx_device_spi0,
 	&ymu831_snd_card_device,
 };
@@ -55,6 +55,11 @@ struct platform_device exynos5_device_lpass = {
        .id = 0,
 };
 
+struct platform_device exynos5_device_compr = {
+	.name = "samsung-compr",
+	.id = -1,
+};
+
 static int exynos_cfg_i2s_gpio(struct platform_device *pdev)
 {
 	/* configure GPIO for i2s port */
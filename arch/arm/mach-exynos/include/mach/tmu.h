@@ -140,6 +140,8 @@
 #define PASSIVE_INTERVAL 		100
 #define ACTIVE_INTERVAL 		300
 #define IDLE_INTERVAL			1000
+/*Power the TMU zone dissipates at its control temperature, in mW*/
+#define IPA_SUSTAINABLE_POWER		2500
 /*Definitions for notification*/
 #define HOT_NORMAL_TEMP			95
 #define HOT_CRITICAL_TEMP		110
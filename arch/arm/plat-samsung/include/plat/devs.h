@@ -168,6 +168,7 @@ extern struct platform_device exynos5_device_pcm1;
 extern struct platform_device exynos5_device_pcm2;
 extern struct platform_device exynos5_device_srp;
 extern struct platform_device exynos5_device_lpass;
+extern struct platform_device exynos5_device_compr;
 extern struct platform_device exynos5_device_i2s0;
 extern struct platform_device exynos5_device_i2s1;
 extern struct platform_device exynos5_device_i2s2;
@@ -46,6 +46,7 @@ static int dma_buf_release(struct inode *inode, struct file *file)
 	dmabuf->ops->release(dmabuf);
 
 	dmabuf_sync_reservation_fini(dmabuf);
+	reservation_object_fini(&dmabuf->resv);
 	kfree(dmabuf);
 	return 0;
 }
@@ -366,6 +367,7 @@ struct dma_buf *dma_buf_export(void *priv, const struct dma_buf_ops *ops,
 	file = anon_inode_getfile("dmabuf", &dma_buf_fops, dmabuf, flags);
 
 	dmabuf_sync_reservation_init(dmabuf);
+	reservation_object_init(&dmabuf->resv);
 	dmabuf->file = file;
 
 	mutex_init(&dmabuf->lock);
@@ -784,3 +786,117 @@ void dma_buf_vunmap(struct dma_buf *dmabuf, void *vaddr)
 	mutex_unlock(&dmabuf->lock);
 }
 EXPORT_SYMBOL_GPL(dma_buf_vunmap);
+
+/**
+ * dma_buf_set_excl_fence - Publish the fence of a job writing the buffer.
+ * @dmabuf:	[in]	buffer the job writes to
+ * @fence:	[in]	fence signaled once the job is done
+ *
+ * Producers call this when they submit a job that writes @dmabuf, so that
+ * consumers can wait for the job in the kernel instead of userspace waiting
+ * for the producer and then submitting to the consumer.
+ */
+void dma_buf_set_excl_fence(struct dma_buf *dmabuf, struct fence *fence)
+{
+	if (WARN_ON(!dmabuf))
+		return;
+
+	ww_mutex_lock(&dmabuf->resv.lock, NULL);
+	reservation_object_add_excl_fence(&dmabuf->resv, fence);
+	ww_mutex_unlock(&dmabuf->resv.lock);
+}
+EXPORT_SYMBOL_GPL(dma_buf_set_excl_fence);
+
+/**
+ * dma_buf_get_excl_fence - Get the fence of the last job writing the buffer.
+ * @dmabuf:	[in]	buffer to look up
+ *
+ * Returns the exclusive fence with a reference held, or NULL if there is
+ * none or it has signaled already.
+ */
+struct fence *dma_buf_get_excl_fence(struct dma_buf *dmabuf)
+{
+	struct fence *fence;
+
+	if (WARN_ON(!dmabuf))
+		return NULL;
+
+	ww_mutex_lock(&dmabuf->resv.lock, NULL);
+	fence = reservation_object_get_excl(&dmabuf->resv);
+	ww_mutex_unlock(&dmabuf->resv.lock);
+
+	if (fence && fence_is_signaled(fence)) {
+		fence_put(fence);
+		fence = NULL;
+	}
+
+	return fence;
+}
+EXPORT_SYMBOL_GPL(dma_buf_get_excl_fence);
+
+/**
+ * dma_buf_wait_excl_fence - Wait for the last job writing the buffer.
+ * @dmabuf:	[in]	buffer to wait for
+ * @intr:	[in]	if true, do an interruptible wait
+ * @timeout:	[in]	timeout value in jiffies, or MAX_SCHEDULE_TIMEOUT
+ *
+ * Returns -ERESTARTSYS if interrupted, 0 if the wait timed out, or the
+ * remaining timeout in jiffies on success.
+ */
+long dma_buf_wait_excl_fence(struct dma_buf *dmabuf, bool intr,
+			     signed long timeout)
+{
+	struct fence *fence;
+	long ret;
+
+	fence = dma_buf_get_excl_fence(dmabuf);
+	if (!fence)
+		return timeout;
+
+	ret = fence_wait_timeout(fence, intr, timeout);
+	fence_put(fence);
+
+	return ret;
+}
+EXPORT_SYMBOL_GPL(dma_buf_wait_excl_fence);
+
+static void dma_buf_fence_waiter_cb(struct fence *fence, struct fence_cb *cb,
+				    void *priv)
+{
+	struct dma_buf_fence_waiter *waiter = priv;
+
+	waiter->func(waiter);
+	fence_put(fence);
+}
+
+/**
+ * dma_buf_wait_excl_fence_async - Call back once the buffer was written.
+ * @dmabuf:	[in]	buffer to wait for
+ * @waiter:	[in]	waiter with @func set, kept alive until it is called
+ *
+ * Returns 0 if @waiter->func will be called once the exclusive fence of
+ * @dmabuf signals, or -ENOENT if there is nothing to wait for, in which case
+ * @waiter->func is not called and the caller can go ahead right away.
+ */
+int dma_buf_wait_excl_fence_async(struct dma_buf *dmabuf,
+				  struct dma_buf_fence_waiter *waiter)
+{
+	struct fence *fence;
+	int ret;
+
+	if (WARN_ON(!waiter->func))
+		return -EINVAL;
+
+	fence = dma_buf_get_excl_fence(dmabuf);
+	if (!fence)
+		return -ENOENT;
+
+	/* The reference is dropped by dma_buf_fence_waiter_cb(). */
+	ret = fence_add_callback(fence, &waiter->cb, dma_buf_fence_waiter_cb,
+				 waiter);
+	if (ret)
+		fence_put(fence);
+
+	return ret;
+}
+EXPORT_SYMBOL_GPL(dma_buf_wait_excl_fence_async);
@@ -26,6 +26,9 @@
 #define PROFILE_STOP	0x2
 #define PROFILE_CLEAR	0x3
 
+/* Wait time histogram buckets, bucket n counts waits below 2^n usecs. */
+#define PROFILE_WAIT_BUCKETS	16
+
 struct dmabuf_sync_profile {
 	struct list_head	list;
 	unsigned long long	time;
@@ -38,6 +41,20 @@ struct dmabuf_sync_profile {
 	char			process_name[TASK_COMM_LEN];
 };
 
+/*
+ * Per-buffer lock wait times, from DMABUF_SYNC_PROFILE_TRY_LOCK to the
+ * following DMABUF_SYNC_PROFILE_LOCK of the same task.
+ */
+struct dmabuf_sync_profile_wait {
+	struct list_head	list;
+	unsigned long		dmabuf;
+	size_t			size;
+	unsigned long		count;
+	unsigned long long	total;
+	unsigned long long	max;
+	unsigned long		buckets[PROFILE_WAIT_BUCKETS];
+};
+
 struct dmabuf_sync_profile_debugfs {
 	const char		*name;
 	bool			is_writable;
@@ -46,11 +63,67 @@ struct dmabuf_sync_profile_debugfs {
 };
 
 static struct list_head profile_node_head;
+static struct list_head profile_wait_head;
 static struct mutex profile_lock;
 static unsigned int profile_debugfs_enabled;
 
 static struct dentry *profile_debugfs_dir;
 
+static void profile_account_wait(struct dmabuf_sync_profile *lock_node)
+{
+	struct dmabuf_sync_profile *node;
+	struct dmabuf_sync_profile_wait *wait;
+	unsigned long long us;
+	int bucket;
+
+	/* The matching try_lock is normally close to the tail. */
+	list_for_each_entry_reverse(node, &profile_node_head, list) {
+		if (node->type == DMABUF_SYNC_PROFILE_TRY_LOCK &&
+		    node->dmabuf == lock_node->dmabuf &&
+		    node->task == lock_node->task)
+			goto found;
+	}
+
+	return;
+
+found:
+	us = lock_node->time - node->time;
+
+	list_for_each_entry(wait, &profile_wait_head, list) {
+		if (wait->dmabuf == lock_node->dmabuf)
+			goto account;
+	}
+
+	wait = kzalloc(sizeof(*wait), GFP_KERNEL);
+	if (!wait)
+		return;
+
+	wait->dmabuf = lock_node->dmabuf;
+	wait->size = lock_node->size;
+	list_add_tail(&wait->list, &profile_wait_head);
+
+account:
+	bucket = min_t(int, fls_long((unsigned long)us),
+			PROFILE_WAIT_BUCKETS - 1);
+	wait->buckets[bucket]++;
+	wait->count++;
+	wait->total += us;
+	if (us > wait->max)
+		wait->max = us;
+}
+
+static void profile_add_node(struct dmabuf_sync_profile *node)
+{
+	mutex_lock(&profile_lock);
+
+	if (node->type == DMABUF_SYNC_PROFILE_LOCK)
+		profile_account_wait(node);
+
+	list_add_tail(&node->list, &profile_node_head);
+
+	mutex_unlock(&profile_lock);
+}
+
 void dmabuf_sync_profile_collect(struct dmabuf_sync *sync, unsigned int type)
 {
 	struct dmabuf_sync_profile *node;
@@ -86,9 +159,7 @@ void dmabuf_sync_profile_collect(struct dmabuf_sync *sync, unsigned int type)
 		strncpy(node->dma_name, sync->name,
 			ARRAY_SIZE(node->dma_name) - 1);
 
-		mutex_lock(&profile_lock);
-		list_add_tail(&node->list, &profile_node_head);
-		mutex_unlock(&profile_lock);
+		profile_add_node(node);
 	}
 }
 
@@ -123,9 +194,7 @@ void dmabuf_sync_profile_collect_single(struct dma_buf *dmabuf, unsigned int typ
 	strncpy(node->process_name, current->comm,
 			ARRAY_SIZE(node->process_name) - 1);
 
-	mutex_lock(&profile_lock);
-	list_add_tail(&node->list, &profile_node_head);
-	mutex_unlock(&profile_lock);
+	profile_add_node(node);
 }
 
 #if defined(CONFIG_DEBUG_FS)
@@ -184,6 +253,41 @@ static int profile_debugfs_show(struct seq_file *s, void *data)
 	return 0;
 }
 
+static int profile_debugfs_wait_show(struct seq_file *s, void *data)
+{
+	struct dmabuf_sync_profile_wait *wait;
+	int i;
+
+	mutex_lock(&profile_lock);
+
+	list_for_each_entry(wait, &profile_wait_head, list) {
+		unsigned long long avg = wait->total;
+
+		do_div(avg, wait->count);
+
+		seq_printf(s, "0x%08x\t0x%08x\tcount %lu\tavg %lluus\tmax %lluus\n",
+				(unsigned int)wait->dmabuf,
+				(unsigned int)wait->size, wait->count,
+				avg, wait->max);
+
+		for (i = 0; i < PROFILE_WAIT_BUCKETS; i++) {
+			if (!wait->buckets[i])
+				continue;
+
+			if (i == PROFILE_WAIT_BUCKETS - 1)
+				seq_printf(s, "\t>= %6luus\t%lu\n",
+						1UL << (i - 1), wait->buckets[i]);
+			else
+				seq_printf(s, "\t<  %6luus\t%lu\n",
+						1UL << i, wait->buckets[i]);
+		}
+	}
+
+	mutex_unlock(&profile_lock);
+
+	return 0;
+}
+
 static ssize_t profile_debugfs_write(struct file *file,
 						const char __user *buf,
 						size_t size, loff_t *ppos)
@@ -222,6 +326,7 @@ static ssize_t profile_debugfs_write(struct file *file,
 
 	if (value == PROFILE_CLEAR) {
 		struct dmabuf_sync_profile *node, *node_next;
+		struct dmabuf_sync_profile_wait *wait, *wait_next;
 
 		mutex_lock(&profile_lock);
 
@@ -231,6 +336,12 @@ static ssize_t profile_debugfs_write(struct file *file,
 			kfree(node);
 		}
 
+		list_for_each_entry_safe(wait, wait_next, &profile_wait_head,
+					 list) {
+			list_del_init(&wait->list);
+			kfree(wait);
+		}
+
 		mutex_unlock(&profile_lock);
 
 		printk(KERN_INFO "cleared all profile data.\n");
@@ -245,6 +356,7 @@ err_free:
 static struct dmabuf_sync_profile_debugfs profile_debugfs_tbl[] = {
 	{"profile", true, profile_debugfs_show,
 				profile_debugfs_write},
+	{"wait_histogram", false, profile_debugfs_wait_show, NULL},
 };
 
 static int dmabuf_sync_profile_debugfs_open(struct inode *inode, struct file *file)
@@ -314,6 +426,7 @@ err:
 static int __init dmabuf_sync_profile_module_init(void)
 {
 	INIT_LIST_HEAD(&profile_node_head);
+	INIT_LIST_HEAD(&profile_wait_head);
 
 	mutex_init(&profile_lock);
 
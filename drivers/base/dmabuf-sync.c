@@ -18,19 +18,35 @@
 
 #include <linux/dmabuf-sync.h>
 
+#include <asm/cacheflush.h>
+#include <asm/sizes.h>
+
 #include "dmabuf-sync-profile.h"
 
 #define MAX_SYNC_TIMEOUT	1000	/* Millisecond. */
 #define MAX_WAIT_TIMEOUT	500	/* Millisecond. */
 
+/*
+ * Above this many bytes of cache maintenance in one dmabuf_sync_lock() call
+ * flushing the whole CPU cache is cheaper than walking every buffer by range.
+ */
+#define CACHE_FLUSH_ALL_SIZE	SZ_8M
+
 #define NEED_BEGIN_CPU_ACCESS(old, new_type)	\
-			((old->accessed_type & DMA_BUF_ACCESS_DMA_W) == \
-			  DMA_BUF_ACCESS_DMA_W && new_type == DMA_BUF_ACCESS_R)
+			(!(new_type & DMA_BUF_ACCESS_DMA) && \
+			 (old->cache_state & DMABUF_SYNC_DEV_DIRTY))
 
 #define NEED_END_CPU_ACCESS(old, new_type)	\
-			(((old->accessed_type == DMA_BUF_ACCESS_W) || \
-			 (old->accessed_type == DMA_BUF_ACCESS_RW)) && \
-			 new_type & DMA_BUF_ACCESS_DMA)
+			((new_type & DMA_BUF_ACCESS_DMA) && \
+			 (old->cache_state & DMABUF_SYNC_CPU_DIRTY))
+
+/*
+ * A reader can share the lock with the current holder if the holder is
+ * a reader as well and no writer is queued behind it.
+ */
+#define CAN_SHARE_LOCK(rsv, type)				\
+			(!(type & DMA_BUF_ACCESS_W) && rsv->locked && \
+			 rsv->shared && !rsv->write_waiters)
 
 #define WAKE_UP_SYNC_OBJ(obj) {						\
 		if (obj->waiting) {					\
@@ -65,6 +81,8 @@ static unsigned int sync_debugfs_trace_enabled, sync_debugfs_log_cnt;
 static unsigned long sync_debugfs_timeout_cnt,
 			sync_debugfs_max_log_cnt = MAX_DEBUG_LOG_COUNT,
 			sync_debugfs_level = DEFAULT_DEBUG_LEVEL;
+static unsigned long sync_debugfs_clean_cnt, sync_debugfs_inv_cnt,
+			sync_debugfs_flush_all_cnt, sync_debugfs_shared_cnt;
 
 DEFINE_WW_CLASS(dmabuf_sync_ww_class);
 EXPORT_SYMBOL_GPL(dmabuf_sync_ww_class);
@@ -135,14 +153,32 @@ static void add_log(struct dmabuf_sync *sync, unsigned int level,
 
 	mutex_unlock(&sync_debugfs_log_lock);
 }
+
+#define inc_stat(cnt)	(cnt++)
 #else
 static void add_log(struct dmabuf_sync *sync, unsigned int level,
 				const char *func_name, struct dma_buf *dmabuf,
 				const char *desc, unsigned int type)
 {
 }
+
+#define inc_stat(cnt)	do { } while (0)
 #endif
 
+/*
+ * Leave a shared lock to the readers still holding it. The ww_mutex stays
+ * locked, but it must not point at the acquire context of a sync that is
+ * going away, or a later ww_mutex_lock() would compare against freed memory.
+ */
+static void dmabuf_sync_detach_ctx(struct dmabuf_sync_reservation *rsvp,
+					struct ww_acquire_ctx *ctx)
+{
+	if (ctx && rsvp->sync_lock.ctx == ctx) {
+		rsvp->sync_lock.ctx = NULL;
+		ctx->acquired--;
+	}
+}
+
 static void dmabuf_sync_timeout_worker(struct work_struct *work)
 {
 	struct dmabuf_sync *sync = container_of(work, struct dmabuf_sync, work);
@@ -182,6 +218,7 @@ static void dmabuf_sync_timeout_worker(struct work_struct *work)
 		DEL_OBJ_FROM_RSV(sobj, rsvp);
 
 		if (atomic_add_unless(&rsvp->shared_cnt, -1, 1)) {
+			dmabuf_sync_detach_ctx(rsvp, &sync->ctx);
 			mutex_unlock(&rsvp->lock);
 			continue;
 		}
@@ -192,11 +229,12 @@ static void dmabuf_sync_timeout_worker(struct work_struct *work)
 			continue;
 		}
 
+		rsvp->locked = false;
+		rsvp->shared = false;
 		mutex_unlock(&rsvp->lock);
 		ww_mutex_unlock(&rsvp->sync_lock);
 
 		mutex_lock(&rsvp->lock);
-		rsvp->locked = false;
 
 		if (sobj->access_type & DMA_BUF_ACCESS_R)
 			pr_warn("%s: r-unlocked = 0x%p\n",
@@ -218,69 +256,116 @@ static void dmabuf_sync_timeout_worker(struct work_struct *work)
 	dmabuf_sync_fini(sync);
 }
 
+/*
+ * Track which side may hold data the other side can't see yet.
+ *
+ * Only a transition between CPU and DMA access needs cache maintenance, so
+ * a run of device accesses - display and encoder reading the same buffer,
+ * or a device writing it frame after frame - costs nothing until the CPU
+ * touches the buffer again, and vice versa.
+ */
+static void dmabuf_sync_update_cache_state(struct dmabuf_sync_reservation *rsvp,
+					unsigned int access_type)
+{
+	if (access_type & DMA_BUF_ACCESS_DMA) {
+		rsvp->cache_state &= ~DMABUF_SYNC_CPU_DIRTY;
+		if (access_type & DMA_BUF_ACCESS_W)
+			rsvp->cache_state |= DMABUF_SYNC_DEV_DIRTY;
+	} else {
+		rsvp->cache_state &= ~DMABUF_SYNC_DEV_DIRTY;
+		if (access_type & DMA_BUF_ACCESS_W)
+			rsvp->cache_state |= DMABUF_SYNC_CPU_DIRTY;
+	}
+
+	/* Update access type to new one. */
+	rsvp->accessed_type = access_type;
+}
+
+static void dmabuf_sync_single_cache_ops(struct dma_buf *dmabuf,
+						unsigned int access_type)
+{
+	struct dmabuf_sync_reservation *robj;
+
+	robj = dmabuf->sync;
+
+	if (NEED_END_CPU_ACCESS(robj, access_type)) {
+		/* cache clean */
+		dma_buf_end_cpu_access(dmabuf, 0, dmabuf->size,
+						DMA_TO_DEVICE);
+		inc_stat(sync_debugfs_clean_cnt);
+	} else if (NEED_BEGIN_CPU_ACCESS(robj, access_type)) {
+		/* cache invalidate */
+		dma_buf_begin_cpu_access(dmabuf, 0, dmabuf->size,
+						DMA_FROM_DEVICE);
+		inc_stat(sync_debugfs_inv_cnt);
+	}
+
+	dmabuf_sync_update_cache_state(robj, access_type);
+}
+
 static void dmabuf_sync_cache_ops(struct dmabuf_sync *sync)
 {
 	struct dmabuf_sync_object *sobj;
+	size_t size = 0;
+	bool flush_all;
 
 	mutex_lock(&sync->lock);
 
+	/*
+	 * Sum up the buffers that need cache maintenance first. Past
+	 * CACHE_FLUSH_ALL_SIZE, one clean and invalidate of the whole cache
+	 * covers every buffer of this sync at once.
+	 */
 	list_for_each_entry(sobj, &sync->syncs, head) {
-		struct dma_buf *dmabuf;
-
-		dmabuf = sobj->dmabuf;
-		if (WARN_ON(!dmabuf || !sobj->robj))
+		if (WARN_ON(!sobj->dmabuf || !sobj->robj))
 			continue;
 
 		mutex_lock(&sobj->robj->lock);
 
-		/* first time access. */
-		if (!sobj->robj->accessed_type)
-			goto out;
+		if (NEED_END_CPU_ACCESS(sobj->robj, sobj->access_type) ||
+		    NEED_BEGIN_CPU_ACCESS(sobj->robj, sobj->access_type))
+			size += sobj->dmabuf->size;
 
-		add_log(sync, 1, __func__, sobj->dmabuf, "cache control",
-				sobj->access_type);
+		mutex_unlock(&sobj->robj->lock);
+	}
 
-		if (NEED_END_CPU_ACCESS(sobj->robj, sobj->access_type))
-			/* cache clean */
-			dma_buf_end_cpu_access(dmabuf, 0, dmabuf->size,
-							DMA_TO_DEVICE);
-		else if (NEED_BEGIN_CPU_ACCESS(sobj->robj, sobj->access_type))
-			/* cache invalidate */
-			dma_buf_begin_cpu_access(dmabuf, 0, dmabuf->size,
-							DMA_FROM_DEVICE);
+#ifdef CONFIG_ARM
+	flush_all = size >= CACHE_FLUSH_ALL_SIZE;
+#else
+	flush_all = false;
+#endif
+	if (flush_all) {
+		add_log(sync, 1, __func__, NULL, "cache flush all", 0);
 
-out:
-		/* Update access type to new one. */
-		sobj->robj->accessed_type = sobj->access_type;
-		mutex_unlock(&sobj->robj->lock);
+		flush_all_cpu_caches();
+#ifdef CONFIG_OUTER_CACHE
+		outer_flush_all();
+#endif
+		inc_stat(sync_debugfs_flush_all_cnt);
 	}
 
-	mutex_unlock(&sync->lock);
-}
+	list_for_each_entry(sobj, &sync->syncs, head) {
+		struct dma_buf *dmabuf;
 
-static void dmabuf_sync_single_cache_ops(struct dma_buf *dmabuf,
-						unsigned int access_type)
-{
-	struct dmabuf_sync_reservation *robj;
+		dmabuf = sobj->dmabuf;
+		if (!dmabuf || !sobj->robj)
+			continue;
 
-	robj = dmabuf->sync;
+		mutex_lock(&sobj->robj->lock);
 
-	/* first time access. */
-	if (!robj->accessed_type)
-		goto out;
+		if (flush_all) {
+			dmabuf_sync_update_cache_state(sobj->robj,
+							sobj->access_type);
+		} else {
+			add_log(sync, 1, __func__, sobj->dmabuf,
+					"cache control", sobj->access_type);
+			dmabuf_sync_single_cache_ops(dmabuf, sobj->access_type);
+		}
 
-	if (NEED_END_CPU_ACCESS(robj, access_type))
-		/* cache clean */
-		dma_buf_end_cpu_access(dmabuf, 0, dmabuf->size,
-						DMA_TO_DEVICE);
-	else if (NEED_BEGIN_CPU_ACCESS(robj, access_type))
-		/* cache invalidate */
-		dma_buf_begin_cpu_access(dmabuf, 0, dmabuf->size,
-						DMA_FROM_DEVICE);
+		mutex_unlock(&sobj->robj->lock);
+	}
 
-out:
-		/* Update access type to new one. */
-		robj->accessed_type = access_type;
+	mutex_unlock(&sync->lock);
 }
 
 static void dmabuf_sync_lock_timeout(unsigned long arg)
@@ -338,6 +423,7 @@ static void dmabuf_sync_wait_prev_objs(struct dmabuf_sync_object *sobj,
 			if (rsvp->locked) {
 				ww_mutex_unlock(&rsvp->sync_lock);
 				rsvp->locked = false;
+				rsvp->shared = false;
 			}
 
 			r_sobj->waiting = true;
@@ -377,6 +463,7 @@ static void dmabuf_sync_wait_prev_objs(struct dmabuf_sync_object *sobj,
 
 			mutex_lock(&rsvp->lock);
 			rsvp->locked = true;
+			rsvp->shared = !(sobj->access_type & DMA_BUF_ACCESS_W);
 		}
 	}
 
@@ -397,6 +484,7 @@ static int dmabuf_sync_lock_objs(struct dmabuf_sync *sync,
 retry:
 	list_for_each_entry(sobj, &sync->syncs, head) {
 		struct dmabuf_sync_reservation *rsvp = sobj->robj;
+		bool writer = sobj->access_type & DMA_BUF_ACCESS_W;
 
 		if (WARN_ON(!rsvp))
 			continue;
@@ -411,16 +499,21 @@ retry:
 		 */
 		list_add_tail(&sobj->r_head, &rsvp->syncs);
 
-		/* Don't lock in case of read and read. */
-		if (rsvp->accessed_type & DMA_BUF_ACCESS_R &&
-		    sobj->access_type & DMA_BUF_ACCESS_R) {
-			atomic_inc(&rsvp->shared_cnt);
+		/* Already locked by ww_mutex_lock_slow(). */
+		if (sobj == res_sobj) {
+			res_sobj = NULL;
+			rsvp->locked = true;
+			rsvp->shared = !writer;
 			mutex_unlock(&rsvp->lock);
 			continue;
 		}
 
-		if (sobj == res_sobj) {
-			res_sobj = NULL;
+		/* Don't lock in case of read and read. */
+		if (CAN_SHARE_LOCK(rsvp, sobj->access_type)) {
+			atomic_inc(&rsvp->shared_cnt);
+			add_log(sync, 1, __func__, sobj->dmabuf, "shared",
+					sobj->access_type);
+			inc_stat(sync_debugfs_shared_cnt);
 			mutex_unlock(&rsvp->lock);
 			continue;
 		}
@@ -428,10 +521,24 @@ retry:
 		add_log(sync, 1, __func__, sobj->dmabuf, "try to lock",
 				sobj->access_type);
 
+		/* Keep new readers from joining until this writer got in. */
+		if (writer)
+			rsvp->write_waiters++;
+
 		mutex_unlock(&rsvp->lock);
 
 		ret = ww_mutex_lock(&rsvp->sync_lock, ctx);
+
+		mutex_lock(&rsvp->lock);
+
+		if (writer)
+			rsvp->write_waiters--;
+
 		if (ret < 0) {
+			/* Added again on retry. */
+			DEL_OBJ_FROM_RSV(sobj, rsvp);
+			mutex_unlock(&rsvp->lock);
+
 			contended_sobj = sobj;
 
 			if (ret == -EDEADLK)
@@ -440,8 +547,8 @@ retry:
 			goto err;
 		}
 
-		mutex_lock(&rsvp->lock);
 		rsvp->locked = true;
+		rsvp->shared = !writer;
 
 		add_log(sync, 1, __func__, sobj->dmabuf, "locked",
 				sobj->access_type);
@@ -476,12 +583,6 @@ err:
 
 		mutex_lock(&rsvp->lock);
 
-		/* Don't need to unlock in case of read and read. */
-		if (atomic_add_unless(&rsvp->shared_cnt, -1, 1)) {
-			mutex_unlock(&rsvp->lock);
-			continue;
-		}
-
 		/*
 		 * Delete a sync object from reservation object of dmabuf.
 		 *
@@ -489,37 +590,28 @@ err:
 		 * just before ww_mutex_lock() is called.
 		 */
 		DEL_OBJ_FROM_RSV(sobj, rsvp);
-		mutex_unlock(&rsvp->lock);
-
-		ww_mutex_unlock(&rsvp->sync_lock);
-
-		mutex_lock(&rsvp->lock);
-		rsvp->locked = false;
-		mutex_unlock(&rsvp->lock);
-	}
-
-	if (res_sobj) {
-		struct dmabuf_sync_reservation *rsvp = res_sobj->robj;
 
-		mutex_lock(&rsvp->lock);
-
-		if (!atomic_add_unless(&rsvp->shared_cnt, -1, 1)) {
-			/*
-			 * Delete a sync object from reservation object
-			 * of dmabuf.
-			 */
-			DEL_OBJ_FROM_RSV(sobj, rsvp);
+		/* Don't need to unlock if other readers still share it. */
+		if (atomic_add_unless(&rsvp->shared_cnt, -1, 1)) {
+			dmabuf_sync_detach_ctx(rsvp, ctx);
 			mutex_unlock(&rsvp->lock);
-
-			ww_mutex_unlock(&rsvp->sync_lock);
-
-			mutex_lock(&rsvp->lock);
-			rsvp->locked = false;
+			continue;
 		}
 
+		rsvp->locked = false;
+		rsvp->shared = false;
 		mutex_unlock(&rsvp->lock);
+
+		ww_mutex_unlock(&rsvp->sync_lock);
 	}
 
+	/*
+	 * A slowpath lock that the retry didn't reach yet is held
+	 * exclusively, and not on rsvp->syncs.
+	 */
+	if (res_sobj)
+		ww_mutex_unlock(&res_sobj->robj->sync_lock);
+
 	if (ret == -EDEADLK) {
 		ww_mutex_lock_slow(&contended_sobj->robj->sync_lock, ctx);
 		res_sobj = contended_sobj;
@@ -576,22 +668,26 @@ static void dmabuf_sync_unlock_objs(struct dmabuf_sync *sync,
 		/* Delete a sync object from reservation object of dmabuf. */
 		DEL_OBJ_FROM_RSV(sobj, rsvp);
 
+		/* The last reader sharing the lock unlocks it. */
 		if (atomic_add_unless(&rsvp->shared_cnt, -1, 1)) {
+			dmabuf_sync_detach_ctx(rsvp, ctx);
 			mutex_unlock(&rsvp->lock);
 			continue;
 		}
 
-		mutex_unlock(&rsvp->lock);
-
-		ww_mutex_unlock(&rsvp->sync_lock);
-
-		mutex_lock(&rsvp->lock);
-
 		add_log(sync, 1, __func__, sobj->dmabuf, "unlocked sync object",
 			sobj->access_type);
+
+		/*
+		 * Clear the lock state before unlocking so that no reader
+		 * joins a lock which is about to be released.
+		 */
 		rsvp->locked = false;
+		rsvp->shared = false;
 
 		mutex_unlock(&rsvp->lock);
+
+		ww_mutex_unlock(&rsvp->sync_lock);
 	}
 
 	mutex_unlock(&sync->lock);
@@ -686,11 +782,12 @@ void dmabuf_sync_fini(struct dmabuf_sync *sync)
 		mutex_lock(&rsvp->lock);
 
 		if (rsvp->locked) {
+			rsvp->locked = false;
+			rsvp->shared = false;
 			mutex_unlock(&rsvp->lock);
 			ww_mutex_unlock(&rsvp->sync_lock);
 
 			mutex_lock(&rsvp->lock);
-			rsvp->locked = false;
 		}
 
 		mutex_unlock(&rsvp->lock);
@@ -943,6 +1040,7 @@ int dmabuf_sync_single_lock(struct dma_buf *dmabuf, unsigned int type,
 
 	sobj->dmabuf = dmabuf;
 	sobj->task = (unsigned long)current;
+	sobj->access_type = type;
 	atomic_set(&sobj->refcnt, 1);
 	init_waitqueue_head(&sobj->wq);
 
@@ -956,8 +1054,11 @@ int dmabuf_sync_single_lock(struct dma_buf *dmabuf, unsigned int type,
 	add_log(NULL, 0, __func__, dmabuf, NULL, type);
 
 	/* Don't lock in case of read and read. */
-	if (robj->accessed_type & DMA_BUF_ACCESS_R && type & DMA_BUF_ACCESS_R) {
+	if (CAN_SHARE_LOCK(robj, type)) {
 		atomic_inc(&robj->shared_cnt);
+		add_log(NULL, 0, __func__, dmabuf, "shared", type);
+		inc_stat(sync_debugfs_shared_cnt);
+		dmabuf_sync_single_cache_ops(dmabuf, type);
 		mutex_unlock(&robj->lock);
 		return 0;
 	}
@@ -975,6 +1076,10 @@ int dmabuf_sync_single_lock(struct dma_buf *dmabuf, unsigned int type,
 	}
 
 	add_log(NULL, 0, __func__, dmabuf, "try to lock", type);
+
+	if (type & DMA_BUF_ACCESS_W)
+		robj->write_waiters++;
+
 	mutex_unlock(&robj->lock);
 
 	dmabuf_sync_profile_collect_single(dmabuf, DMABUF_SYNC_PROFILE_TRY_LOCK,
@@ -988,7 +1093,10 @@ int dmabuf_sync_single_lock(struct dma_buf *dmabuf, unsigned int type,
 
 	mutex_lock(&robj->lock);
 	add_log(NULL, 0, __func__, dmabuf, "locked", type);
+	if (type & DMA_BUF_ACCESS_W)
+		robj->write_waiters--;
 	robj->locked = true;
+	robj->shared = !(type & DMA_BUF_ACCESS_W);
 	mutex_unlock(&robj->lock);
 
 	/*
@@ -1102,6 +1210,14 @@ out:
 	}
 
 	add_log(NULL, 0, __func__, dmabuf, "try to unlock", 0);
+
+#ifdef CONFIG_DMABUF_SYNC_PROFILE
+	if (robj->locked)
+		dmabuf->ops->munmap(dmabuf);
+#endif
+	/* No reader may join a lock which is about to be released. */
+	robj->locked = false;
+	robj->shared = false;
 	mutex_unlock(&robj->lock);
 
 	mutex_unlock(&robj->sync_lock.base);
@@ -1113,12 +1229,6 @@ out:
 
 	mutex_lock(&robj->lock);
 	add_log(NULL, 0, __func__, dmabuf, "unlocked", 0);
-
-#ifdef CONFIG_DMABUF_SYNC_PROFILE
-	if (robj->locked)
-		dmabuf->ops->munmap(dmabuf);
-#endif
-	robj->locked = false;
 	mutex_unlock(&robj->lock);
 
 	dma_buf_put(dmabuf);
@@ -1476,6 +1586,16 @@ err_free:
 	return size;
 }
 
+static int dmabuf_sync_debugfs_stats_show(struct seq_file *s, void *data)
+{
+	seq_printf(s, "shared locks = %lu\n", sync_debugfs_shared_cnt);
+	seq_printf(s, "cache clean = %lu\n", sync_debugfs_clean_cnt);
+	seq_printf(s, "cache invalidate = %lu\n", sync_debugfs_inv_cnt);
+	seq_printf(s, "cache flush all = %lu\n", sync_debugfs_flush_all_cnt);
+
+	return 0;
+}
+
 static struct dmabuf_sync_debugfs_node sync_debugfs_tbl[] = {
 	{"trace", true, dmabuf_sync_debugfs_trace_show,
 					dmabuf_sync_debugfs_trace_write},
@@ -1485,6 +1605,7 @@ static struct dmabuf_sync_debugfs_node sync_debugfs_tbl[] = {
 					dmabuf_sync_debugfs_max_log_write},
 	{"level", true, dmabuf_sync_debugfs_level_show,
 					dmabuf_sync_debugfs_level_write},
+	{"stats", false, dmabuf_sync_debugfs_stats_show, NULL},
 };
 
 static int dmabuf_sync_debugfs_open(struct inode *inode, struct file *file)
@@ -217,7 +217,7 @@ EXPORT_SYMBOL(fence_remove_callback);
 static void
 fence_default_wait_cb(struct fence *fence, struct fence_cb *cb, void *priv)
 {
-	try_to_wake_up(priv, TASK_NORMAL, 0);
+	wake_up_state(priv, TASK_NORMAL);
 }
 
 /**
@@ -286,6 +286,50 @@ out:
 }
 EXPORT_SYMBOL(fence_default_wait);
 
+/*
+ * A fence signaled by the CPU with fence_signal(), for drivers that notice
+ * job completion in their interrupt handler or done callback and have no
+ * hardware seqno to poll.
+ */
+struct sw_fence {
+	struct fence base;
+	spinlock_t lock;
+};
+
+static bool sw_fence_enable_signaling(struct fence *fence)
+{
+	return true;
+}
+
+static const struct fence_ops sw_fence_ops = {
+	.enable_signaling = sw_fence_enable_signaling,
+	.wait = fence_default_wait,
+};
+
+/**
+ * fence_create_sw - allocate a fence signaled by software
+ * @context:	[in]	the execution context, from fence_context_alloc()
+ * @seqno:	[in]	sequence number of this fence inside @context
+ *
+ * Returns the new fence with one reference held by the caller, or NULL if
+ * out of memory. The creator calls fence_signal() once the operation the
+ * fence stands for has completed, and then drops its reference.
+ */
+struct fence *fence_create_sw(unsigned context, unsigned seqno)
+{
+	struct sw_fence *f;
+
+	f = kzalloc(sizeof(*f), GFP_KERNEL);
+	if (!f)
+		return NULL;
+
+	spin_lock_init(&f->lock);
+	__fence_init(&f->base, &sw_fence_ops, &f->lock, context, seqno);
+
+	return &f->base;
+}
+EXPORT_SYMBOL(fence_create_sw);
+
 static bool seqno_enable_signaling(struct fence *fence)
 {
 	struct seqno_fence *seqno_fence = to_seqno_fence(fence);
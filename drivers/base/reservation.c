@@ -36,4 +36,40 @@
 #include <linux/export.h>
 
 DEFINE_WW_CLASS(reservation_ww_class);
-EXPORT_SYMBOL(reservation_ww_class);
\ No newline at end of file
+EXPORT_SYMBOL(reservation_ww_class);
+
+/**
+ * reservation_object_add_excl_fence - replace the exclusive fence
+ * @obj:	[in]	the reservation object, locked by the caller
+ * @fence:	[in]	the new exclusive fence, or NULL to clear it
+ *
+ * The exclusive fence is signaled once the last writer of the buffer is
+ * done. It orders after all shared fences, so those are dropped here.
+ */
+void reservation_object_add_excl_fence(struct reservation_object *obj,
+				       struct fence *fence)
+{
+	struct fence *old = obj->fence_excl;
+	u32 i;
+
+	obj->fence_excl = fence_get(fence);
+
+	for (i = 0; i < obj->fence_shared_count; i++)
+		fence_put(obj->fence_shared[i]);
+	obj->fence_shared_count = 0;
+
+	fence_put(old);
+}
+EXPORT_SYMBOL(reservation_object_add_excl_fence);
+
+/**
+ * reservation_object_get_excl - get the exclusive fence
+ * @obj:	[in]	the reservation object, locked by the caller
+ *
+ * Returns the exclusive fence with a reference taken, or NULL.
+ */
+struct fence *reservation_object_get_excl(struct reservation_object *obj)
+{
+	return fence_get(obj->fence_excl);
+}
+EXPORT_SYMBOL(reservation_object_get_excl);
@@ -60,7 +60,14 @@ static int sw_sync_pt_has_signaled(struct sync_pt *sync_pt)
 	struct sw_sync_timeline *obj =
 		(struct sw_sync_timeline *)sync_pt->parent;
 
-	return sw_sync_cmp(obj->value, pt->value) >= 0;
+	if (sw_sync_cmp(obj->value, pt->value) < 0)
+		return 0;
+
+	if (obj->error && sw_sync_cmp(pt->value, obj->error_from) > 0 &&
+	    sw_sync_cmp(pt->value, obj->error_to) <= 0)
+		return obj->error;
+
+	return 1;
 }
 
 static int sw_sync_pt_compare(struct sync_pt *a, struct sync_pt *b)
@@ -107,6 +114,7 @@ struct sync_timeline_ops sw_sync_timeline_ops = {
 	.fill_driver_data = sw_sync_fill_driver_data,
 	.timeline_value_str = sw_sync_timeline_value_str,
 	.pt_value_str = sw_sync_pt_value_str,
+	.ordered = true,
 };
 
 
@@ -129,6 +137,21 @@ void sw_sync_timeline_inc(struct sw_sync_timeline *obj, u32 inc)
 }
 EXPORT_SYMBOL(sw_sync_timeline_inc);
 
+/*
+ * like sw_sync_timeline_inc(), but the sync_pts signaled by this increment
+ * get @error as their status.  only the last failed range is remembered.
+ */
+void sw_sync_timeline_fail(struct sw_sync_timeline *obj, u32 inc, int error)
+{
+	obj->error_from = obj->value;
+	obj->error_to = obj->value + inc;
+	obj->error = error;
+	obj->value += inc;
+
+	sync_timeline_signal(&obj->obj);
+}
+EXPORT_SYMBOL(sw_sync_timeline_fail);
+
 #ifdef CONFIG_SW_SYNC_USER
 /* *WARNING*
  *
@@ -36,17 +36,70 @@ static int _sync_pt_has_signaled(struct sync_pt *pt);
 static void sync_fence_free(struct kref *kref);
 static void sync_dump(void);
 
+#ifdef CONFIG_SYNC_DEBUG
 static LIST_HEAD(sync_timeline_list_head);
 static DEFINE_SPINLOCK(sync_timeline_list_lock);
 
 static LIST_HEAD(sync_fence_list_head);
 static DEFINE_SPINLOCK(sync_fence_list_lock);
 
+static void sync_timeline_debug_add(struct sync_timeline *obj)
+{
+	unsigned long flags;
+
+	spin_lock_irqsave(&sync_timeline_list_lock, flags);
+	list_add_tail(&obj->sync_timeline_list, &sync_timeline_list_head);
+	spin_unlock_irqrestore(&sync_timeline_list_lock, flags);
+}
+
+static void sync_timeline_debug_remove(struct sync_timeline *obj)
+{
+	unsigned long flags;
+
+	spin_lock_irqsave(&sync_timeline_list_lock, flags);
+	list_del(&obj->sync_timeline_list);
+	spin_unlock_irqrestore(&sync_timeline_list_lock, flags);
+}
+
+static void sync_fence_debug_add(struct sync_fence *fence)
+{
+	unsigned long flags;
+
+	spin_lock_irqsave(&sync_fence_list_lock, flags);
+	list_add_tail(&fence->sync_fence_list, &sync_fence_list_head);
+	spin_unlock_irqrestore(&sync_fence_list_lock, flags);
+}
+
+static void sync_fence_debug_remove(struct sync_fence *fence)
+{
+	unsigned long flags;
+
+	spin_lock_irqsave(&sync_fence_list_lock, flags);
+	list_del(&fence->sync_fence_list);
+	spin_unlock_irqrestore(&sync_fence_list_lock, flags);
+}
+#else
+static inline void sync_timeline_debug_add(struct sync_timeline *obj)
+{
+}
+
+static inline void sync_timeline_debug_remove(struct sync_timeline *obj)
+{
+}
+
+static inline void sync_fence_debug_add(struct sync_fence *fence)
+{
+}
+
+static inline void sync_fence_debug_remove(struct sync_fence *fence)
+{
+}
+#endif
+
 struct sync_timeline *sync_timeline_create(const struct sync_timeline_ops *ops,
 					   int size, const char *name)
 {
 	struct sync_timeline *obj;
-	unsigned long flags;
 
 	if (size < sizeof(struct sync_timeline))
 		return NULL;
@@ -65,9 +118,7 @@ struct sync_timeline *sync_timeline_create(const struct sync_timeline_ops *ops,
 	INIT_LIST_HEAD(&obj->active_list_head);
 	spin_lock_init(&obj->active_list_lock);
 
-	spin_lock_irqsave(&sync_timeline_list_lock, flags);
-	list_add_tail(&obj->sync_timeline_list, &sync_timeline_list_head);
-	spin_unlock_irqrestore(&sync_timeline_list_lock, flags);
+	sync_timeline_debug_add(obj);
 
 	return obj;
 }
@@ -77,14 +128,11 @@ static void sync_timeline_free(struct kref *kref)
 {
 	struct sync_timeline *obj =
 		container_of(kref, struct sync_timeline, kref);
-	unsigned long flags;
 
 	if (obj->ops->release_obj)
 		obj->ops->release_obj(obj);
 
-	spin_lock_irqsave(&sync_timeline_list_lock, flags);
-	list_del(&obj->sync_timeline_list);
-	spin_unlock_irqrestore(&sync_timeline_list_lock, flags);
+	sync_timeline_debug_remove(obj);
 
 	kfree(obj);
 }
@@ -149,6 +197,9 @@ void sync_timeline_signal(struct sync_timeline *obj)
 			list_del_init(pos);
 			list_add(&pt->signaled_list, &signaled_pts);
 			kref_get(&pt->fence->kref);
+		} else if (obj->ops->ordered) {
+			/* the rest of the list will signal after this one */
+			break;
 		}
 	}
 
@@ -223,6 +274,7 @@ static struct sync_pt *sync_pt_dup(struct sync_pt *pt)
 static void sync_pt_activate(struct sync_pt *pt)
 {
 	struct sync_timeline *obj = pt->parent;
+	struct sync_pt *pos;
 	unsigned long flags;
 	int err;
 
@@ -232,7 +284,20 @@ static void sync_pt_activate(struct sync_pt *pt)
 	if (err != 0)
 		goto out;
 
-	list_add_tail(&pt->active_list, &obj->active_list_head);
+	if (!obj->ops->ordered) {
+		list_add_tail(&pt->active_list, &obj->active_list_head);
+		goto out;
+	}
+
+	/*
+	 * Keep the active list in signaling order.  sync_pts are usually
+	 * created in that order, so this stops at the tail.
+	 */
+	list_for_each_entry_reverse(pos, &obj->active_list_head, active_list) {
+		if (obj->ops->compare(pos, pt) <= 0)
+			break;
+	}
+	list_add(&pt->active_list, &pos->active_list);
 
 out:
 	spin_unlock_irqrestore(&obj->active_list_lock, flags);
@@ -253,7 +318,6 @@ static const struct file_operations sync_fence_fops = {
 static struct sync_fence *sync_fence_alloc(const char *name)
 {
 	struct sync_fence *fence;
-	unsigned long flags;
 
 	fence = kzalloc(sizeof(struct sync_fence), GFP_KERNEL);
 	if (fence == NULL)
@@ -273,9 +337,7 @@ static struct sync_fence *sync_fence_alloc(const char *name)
 
 	init_waitqueue_head(&fence->wq);
 
-	spin_lock_irqsave(&sync_fence_list_lock, flags);
-	list_add_tail(&fence->sync_fence_list, &sync_fence_list_head);
-	spin_unlock_irqrestore(&sync_fence_list_lock, flags);
+	sync_fence_debug_add(fence);
 
 	return fence;
 
@@ -310,42 +372,75 @@ struct sync_fence *sync_fence_create(const char *name, struct sync_pt *pt)
 }
 EXPORT_SYMBOL(sync_fence_create);
 
-static int sync_fence_copy_pts(struct sync_fence *dst, struct sync_fence *src)
+/*
+ * A fence keeps its sync_pts sorted by parent timeline, so that two fences
+ * can be merged in a single pass over both, collapsing the sync_pts they
+ * have on a common timeline into the one which will signal last.
+ */
+static int sync_pt_cmp_timeline(struct sync_pt *a, struct sync_pt *b)
 {
-	struct list_head *pos, *test_pos;
+	unsigned long pa = (unsigned long)a->parent;
+	unsigned long pb = (unsigned long)b->parent;
 
-	list_for_each(pos, &src->pt_list_head) {
-		struct sync_pt *orig_pt =
-			container_of(pos, struct sync_pt, pt_list);
-		struct sync_pt *new_pt;
+	if (pa == pb)
+		return 0;
+	return pa < pb ? -1 : 1;
+}
 
-		/* Skip already signaled points */
-		if (1 == orig_pt->status)
-			continue;
+static int sync_fence_add_pt_copy(struct sync_fence *dst, struct sync_pt *pt)
+{
+	struct sync_pt *new_pt = sync_pt_dup(pt);
 
-		list_for_each(test_pos, &src->pt_list_head) {
-			struct sync_pt *test_pt =
-				container_of(pos, struct sync_pt, pt_list);
-			if (orig_pt->parent == test_pt->parent) {
-				int diff;
-				diff = orig_pt->parent->ops->compare(orig_pt,
-								     test_pt);
-				if (diff == -1) {
-					/* Skip orig_pt; another point will
-					 * signal after it */
-					continue;
-				}
-				break;
-			}
-		}
+	if (new_pt == NULL)
+		return -ENOMEM;
+
+	new_pt->fence = dst;
+	list_add_tail(&new_pt->pt_list, &dst->pt_list_head);
+
+	return 0;
+}
 
-		new_pt = sync_pt_dup(orig_pt);
+static int sync_fence_merge_pts(struct sync_fence *dst,
+				struct sync_fence *a, struct sync_fence *b)
+{
+	struct list_head *pos_a = a->pt_list_head.next;
+	struct list_head *pos_b = b->pt_list_head.next;
+
+	while (pos_a != &a->pt_list_head || pos_b != &b->pt_list_head) {
+		struct sync_pt *pt_a = NULL;
+		struct sync_pt *pt_b = NULL;
+		struct sync_pt *pt;
+		int cmp;
+		int err;
+
+		if (pos_a != &a->pt_list_head)
+			pt_a = container_of(pos_a, struct sync_pt, pt_list);
+		if (pos_b != &b->pt_list_head)
+			pt_b = container_of(pos_b, struct sync_pt, pt_list);
+
+		cmp = (pt_a && pt_b) ? sync_pt_cmp_timeline(pt_a, pt_b) : 0;
+		if (!pt_b || (pt_a && cmp < 0)) {
+			pt = pt_a;
+			pos_a = pos_a->next;
+		} else if (!pt_a || cmp > 0) {
+			pt = pt_b;
+			pos_b = pos_b->next;
+		} else {
+			if (pt_a->parent->ops->compare(pt_a, pt_b) == -1)
+				pt = pt_b;
+			else
+				pt = pt_a;
+			pos_a = pos_a->next;
+			pos_b = pos_b->next;
+		}
 
-		if (new_pt == NULL)
-			return -ENOMEM;
+		/* Skip already signaled points */
+		if (1 == pt->status)
+			continue;
 
-		new_pt->fence = dst;
-		list_add(&new_pt->pt_list, &dst->pt_list_head);
+		err = sync_fence_add_pt_copy(dst, pt);
+		if (err < 0)
+			return err;
 	}
 
 	return 0;
@@ -432,11 +527,7 @@ struct sync_fence *sync_fence_merge(const char *name,
 	if (fence == NULL)
 		return NULL;
 
-	err = sync_fence_copy_pts(fence, a);
-	if (err < 0)
-		goto err;
-
-	err = sync_fence_copy_pts(fence, b);
+	err = sync_fence_merge_pts(fence, a, b);
 	if (err < 0)
 		goto err;
 
@@ -466,6 +557,7 @@ struct sync_fence *sync_fence_merge(const char *name,
 
 	return fence;
 err:
+	sync_fence_debug_remove(fence);
 	sync_fence_free_pts(fence);
 	kfree(fence);
 	return NULL;
@@ -625,7 +717,6 @@ static void sync_fence_free(struct kref *kref)
 static int sync_fence_release(struct inode *inode, struct file *file)
 {
 	struct sync_fence *fence = file->private_data;
-	unsigned long flags;
 
 	/*
 	 * We need to remove all ways to access this fence before droping
@@ -633,9 +724,7 @@ static int sync_fence_release(struct inode *inode, struct file *file)
 	 *
 	 * start with its membership in the global fence list
 	 */
-	spin_lock_irqsave(&sync_fence_list_lock, flags);
-	list_del(&fence->sync_fence_list);
-	spin_unlock_irqrestore(&sync_fence_list_lock, flags);
+	sync_fence_debug_remove(fence);
 
 	/*
 	 * remove its pts from their parents so that sync_timeline_signal()
@@ -825,7 +914,7 @@ static long sync_fence_ioctl(struct file *file, unsigned int cmd,
 	}
 }
 
-#ifdef CONFIG_DEBUG_FS
+#ifdef CONFIG_SYNC_DEBUG
 static const char *sync_status_str(int status)
 {
 	if (status > 0)
@@ -30,6 +30,8 @@
 #include <linux/kobject.h>
 #include <linux/sysfs.h>
 #include <linux/cpumask.h>
+#include <linux/tick.h>
+#include <linux/thermal_ipa.h>
 
 #include <asm/smp_plat.h>
 #include <asm/cputype.h>
@@ -1509,6 +1511,150 @@ static struct notifier_block exynos_kfc_max_qos_notifier = {
 	.notifier_call = exynos_kfc_max_qos_handler,
 };
 
+#ifdef CONFIG_CPU_THERMAL_IPA
+/*
+ * Power actors of the two clusters for the thermal power allocator.  A core
+ * draws C.V^2.f at the operating point of its cluster, and a cluster asks
+ * for that times the load summed over its online cores.  The cap goes
+ * through the same PM QoS maximum as cpufreq_max_limit.
+ */
+#define IPA_CA7_POWER_COEFF	160	/* uW/(MHz.V^2) per core */
+#define IPA_CA15_POWER_COEFF	610
+
+struct exynos_ipa_actor {
+	struct ipa_actor actor;
+	cluster_type cluster;
+	u32 coeff;
+	struct pm_qos_request max_qos;
+	unsigned int load;		/* summed over the online cores, in % */
+	u64 prev_idle[NR_CPUS];
+	u64 prev_wall[NR_CPUS];
+};
+
+static struct exynos_ipa_actor exynos_ipa_actors[CA_END];
+
+#define to_exynos_ipa_actor(a) container_of(a, struct exynos_ipa_actor, actor)
+
+static u32 exynos_ipa_core_power(struct exynos_ipa_actor *ea,
+		unsigned int freq)
+{
+	return ipa_dynamic_power(ea->coeff, freq,
+				 get_freq_volt(ea->cluster, freq));
+}
+
+/* Load of the cluster since the last call, a core without NO_HZ is busy */
+static unsigned int exynos_ipa_get_load(struct exynos_ipa_actor *ea)
+{
+	unsigned int cpu, load = 0;
+	u64 idle, wall, delta_idle, delta_wall;
+
+	for_each_cpu_and(cpu, &cluster_cpus[ea->cluster], cpu_online_mask) {
+		idle = get_cpu_idle_time_us(cpu, &wall);
+		if (idle == -1ULL) {
+			load += 100;
+			continue;
+		}
+
+		delta_wall = wall - ea->prev_wall[cpu];
+		delta_idle = idle - ea->prev_idle[cpu];
+		ea->prev_wall[cpu] = wall;
+		ea->prev_idle[cpu] = idle;
+
+		if (delta_wall && delta_idle < delta_wall)
+			load += div64_u64(100 * (delta_wall - delta_idle),
+					  delta_wall);
+	}
+
+	return load;
+}
+
+static u32 exynos_ipa_get_requested_power(struct ipa_actor *actor)
+{
+	struct exynos_ipa_actor *ea = to_exynos_ipa_actor(actor);
+	unsigned int freq = exynos_getspeed_cluster(ea->cluster);
+
+	ea->load = exynos_ipa_get_load(ea);
+
+	return exynos_ipa_core_power(ea, freq) * ea->load / 100;
+}
+
+static u32 exynos_ipa_get_max_power(struct ipa_actor *actor)
+{
+	struct exynos_ipa_actor *ea = to_exynos_ipa_actor(actor);
+	unsigned int cpus;
+
+	cpus = cpumask_weight(&cluster_cpus[ea->cluster]);
+
+	return exynos_ipa_core_power(ea, freq_max[ea->cluster]) * cpus;
+}
+
+/* Highest frequency whose power at the last load fits, freq_min at worst */
+static int exynos_ipa_set_power(struct ipa_actor *actor, u32 power)
+{
+	struct exynos_ipa_actor *ea = to_exynos_ipa_actor(actor);
+	struct cpufreq_frequency_table *table;
+	unsigned int freq = freq_max[ea->cluster];
+	u32 core_power;
+	int i;
+
+	if (power < exynos_ipa_get_max_power(actor) && ea->load) {
+		core_power = div_u64((u64)power * 100, ea->load);
+		table = exynos_info[ea->cluster]->freq_table;
+		freq = freq_min[ea->cluster];
+
+		for (i = 0; table[i].frequency != CPUFREQ_TABLE_END; i++) {
+			if (table[i].frequency == CPUFREQ_ENTRY_INVALID)
+				continue;
+
+			if (exynos_ipa_core_power(ea, table[i].frequency) <=
+			    core_power) {
+				freq = table[i].frequency;
+				break;
+			}
+		}
+	}
+
+	pm_qos_update_request(&ea->max_qos, freq);
+
+	return 0;
+}
+
+static const struct ipa_actor_ops exynos_ipa_actor_ops = {
+	.get_requested_power	= exynos_ipa_get_requested_power,
+	.get_max_power		= exynos_ipa_get_max_power,
+	.set_power		= exynos_ipa_set_power,
+};
+
+static void __init exynos_ipa_init(void)
+{
+	struct exynos_ipa_actor *ea;
+
+	ea = &exynos_ipa_actors[CA7];
+	ea->actor.name = "cpu-kfc";
+	ea->cluster = CA7;
+	ea->coeff = IPA_CA7_POWER_COEFF;
+	pm_qos_add_request(&ea->max_qos, PM_QOS_KFC_FREQ_MAX, freq_max[CA7]);
+
+	ea = &exynos_ipa_actors[CA15];
+	ea->actor.name = "cpu-eagle";
+	ea->cluster = CA15;
+	ea->coeff = IPA_CA15_POWER_COEFF;
+	pm_qos_add_request(&ea->max_qos, PM_QOS_CPU_FREQ_MAX, freq_max[CA15]);
+
+	for (ea = exynos_ipa_actors; ea < exynos_ipa_actors + CA_END; ea++) {
+		ea->actor.ops = &exynos_ipa_actor_ops;
+		ea->actor.weight = IPA_WEIGHT_ONE;
+		if (ipa_register_actor(&ea->actor))
+			pr_err("%s: failed to register %s power actor\n",
+					__func__, ea->actor.name);
+	}
+}
+#else
+static inline void exynos_ipa_init(void)
+{
+}
+#endif
+
 static int __init exynos_cpufreq_init(void)
 {
 	int i, ret = -EINVAL;
@@ -1730,6 +1876,8 @@ static int __init exynos_cpufreq_init(void)
 						msecs_to_jiffies(1000));
 	}
 
+	exynos_ipa_init();
+
 	exynos_cpufreq_init_done = true;
 	exynos_cpufreq_init_notify_call_chain(CPUFREQ_INIT_COMPLETE);
 
@@ -19,6 +19,7 @@
 #include <linux/regulator/consumer.h>
 #include <linux/platform_device.h>
 #include <linux/sched.h>
+#include <linux/thermal_ipa.h>
 
 #include <mach/devfreq.h>
 #include <mach/asv-exynos.h>
@@ -98,6 +99,11 @@ struct devfreq_data_mif {
 	bool use_dvfs;
 
 	struct notifier_block tmu_notifier;
+#ifdef CONFIG_CPU_THERMAL_IPA
+	struct ipa_actor ipa_actor;
+	unsigned long ipa_max_freq;
+	unsigned int ipa_load;
+#endif
 
 	struct mutex lock;
 };
@@ -828,6 +834,9 @@ static int exynos5_devfreq_mif_target(struct device *dev,
 	*target_freq = min3(*target_freq,
 			devfreq_mif_ch0_work.max_freq,
 			devfreq_mif_ch1_work.max_freq);
+#ifdef CONFIG_CPU_THERMAL_IPA
+	*target_freq = min(*target_freq, mif_data->ipa_max_freq);
+#endif
 
 	rcu_read_lock();
 	target_opp = devfreq_recommended_opp(dev, target_freq, flags);
@@ -964,6 +973,90 @@ static struct notifier_block exynos5_mif_reboot_notifier = {
 	.notifier_call = exynos5_devfreq_mif_reboot_notifier,
 };
 
+#ifdef CONFIG_CPU_THERMAL_IPA
+/*
+ * Power actor of the memory interface for the thermal power allocator,
+ * C.V^2.f of the current level scaled by the busy ratio PPMU saw over the
+ * last devfreq period.  The cap is one more ceiling in the target.
+ */
+#define IPA_MIF_POWER_COEFF	600	/* uW/(MHz.V^2) */
+
+static u32 exynos5_devfreq_mif_ipa_power(int idx)
+{
+	return ipa_dynamic_power(IPA_MIF_POWER_COEFF,
+				 devfreq_mif_opp_list[idx].freq,
+				 devfreq_mif_opp_list[idx].volt);
+}
+
+static u32 exynos5_devfreq_mif_get_requested_power(struct ipa_actor *actor)
+{
+	struct devfreq_data_mif *data = container_of(actor,
+			struct devfreq_data_mif, ipa_actor);
+	unsigned long long busy = devfreq_mif_exynos.val_pmcnt;
+	unsigned long long total = devfreq_mif_exynos.val_ccnt;
+	int idx;
+
+	idx = exynos5_devfreq_mif_get_idx(devfreq_mif_opp_list,
+					ARRAY_SIZE(devfreq_mif_opp_list),
+					data->devfreq->previous_freq);
+	if (idx < 0)
+		return 0;
+
+	data->ipa_load = total ? div64_u64(busy * 100, total) : 100;
+	if (data->ipa_load > 100)
+		data->ipa_load = 100;
+
+	return exynos5_devfreq_mif_ipa_power(idx) * data->ipa_load / 100;
+}
+
+static u32 exynos5_devfreq_mif_get_max_power(struct ipa_actor *actor)
+{
+	int idx;
+
+	idx = exynos5_devfreq_mif_get_idx(devfreq_mif_opp_list,
+				ARRAY_SIZE(devfreq_mif_opp_list),
+				exynos5_devfreq_mif_governor_data.cal_qos_max);
+
+	return exynos5_devfreq_mif_ipa_power(idx < 0 ? LV0 : idx);
+}
+
+static int exynos5_devfreq_mif_set_power(struct ipa_actor *actor, u32 power)
+{
+	struct devfreq_data_mif *data = container_of(actor,
+			struct devfreq_data_mif, ipa_actor);
+	unsigned long max_freq = exynos5_devfreq_mif_governor_data.cal_qos_max;
+	u32 level_power;
+	int idx;
+
+	if (power < exynos5_devfreq_mif_get_max_power(actor) && data->ipa_load) {
+		level_power = power * 100 / data->ipa_load;
+
+		for (idx = LV0; idx < ARRAY_SIZE(devfreq_mif_opp_list) - 1; idx++)
+			if (devfreq_mif_opp_list[idx].freq <= max_freq &&
+			    exynos5_devfreq_mif_ipa_power(idx) <= level_power)
+				break;
+
+		max_freq = min(max_freq, devfreq_mif_opp_list[idx].freq);
+	}
+
+	if (data->ipa_max_freq == max_freq)
+		return 0;
+
+	data->ipa_max_freq = max_freq;
+	mutex_lock(&data->devfreq->lock);
+	update_devfreq(data->devfreq);
+	mutex_unlock(&data->devfreq->lock);
+
+	return 0;
+}
+
+static const struct ipa_actor_ops exynos5_devfreq_mif_ipa_ops = {
+	.get_requested_power	= exynos5_devfreq_mif_get_requested_power,
+	.get_max_power		= exynos5_devfreq_mif_get_max_power,
+	.set_power		= exynos5_devfreq_mif_set_power,
+};
+#endif
+
 #ifdef CONFIG_EXYNOS_THERMAL
 static int exynos5_devfreq_mif_tmu_notifier(struct notifier_block *nb, unsigned long event,
 						void *v)
@@ -1188,6 +1281,9 @@ static int exynos5_devfreq_mif_probe(struct platform_device *pdev)
 
 	devfreq_mif_ch0_work.max_freq = exynos5_devfreq_mif_governor_data.cal_qos_max;
 	devfreq_mif_ch1_work.max_freq = exynos5_devfreq_mif_governor_data.cal_qos_max;
+#ifdef CONFIG_CPU_THERMAL_IPA
+	data->ipa_max_freq = exynos5_devfreq_mif_governor_data.cal_qos_max;
+#endif
 
 	data->last_jiffies = get_jiffies_64();
 	/* For low temperature compensation when boot time */
@@ -1242,6 +1338,13 @@ static int exynos5_devfreq_mif_probe(struct platform_device *pdev)
 #ifdef CONFIG_EXYNOS_THERMAL
 	data->tmu_notifier.notifier_call = exynos5_devfreq_mif_tmu_notifier;
 	exynos_tmu_add_notifier(&data->tmu_notifier);
+#endif
+#ifdef CONFIG_CPU_THERMAL_IPA
+	data->ipa_actor.name = "mif";
+	data->ipa_actor.ops = &exynos5_devfreq_mif_ipa_ops;
+	data->ipa_actor.weight = IPA_WEIGHT_ONE;
+	if (ipa_register_actor(&data->ipa_actor))
+		pr_err("DEVFREQ(MIF) : Failed to register power actor\n");
 #endif
 	data->use_dvfs = true;
 
@@ -1258,6 +1361,9 @@ static int exynos5_devfreq_mif_remove(struct platform_device *pdev)
 {
 	struct devfreq_data_mif *data = platform_get_drvdata(pdev);
 
+#ifdef CONFIG_CPU_THERMAL_IPA
+	ipa_unregister_actor(&data->ipa_actor);
+#endif
 	devfreq_remove_device(data->devfreq);
 
 	pm_qos_remove_request(&min_mif_thermal_qos);
@@ -0,0 +1,172 @@
+/*
+ * Copyright (C) 2012 ARM Limited. All rights reserved.
+ *
+ * This program is free software and is provided to you under the terms of the GNU General Public License version 2
+ * as published by the Free Software Foundation, and any use by you of this program is subject to the terms of such GNU licence.
+ *
+ * A copy of the licence is included with the program, and can also be obtained from Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ */
+
+#ifndef __MALI_KERNEL_FRAME_POLICY_H__
+#define __MALI_KERNEL_FRAME_POLICY_H__
+
+/*
+ * Frame based DVFS policy.
+ *
+ * Fed once per frame with the GPU busy time of that frame and the frame
+ * period the GPU has to fit in, it returns the clock needed for the next
+ * frame relative to the current one (MALI_FRAME_POLICY_SCALE_ONE = keep).
+ *
+ * - The prediction is a running average of the per-frame GPU time plus
+ *   twice its rising trend, and never less than the frame just seen, so a
+ *   spike or a ramp asks for a higher clock on the very next frame.
+ * - A lower clock is only asked for after MALI_FRAME_POLICY_DOWN_FRAMES
+ *   frames in a row came in under the down threshold, and is sized for
+ *   the worst of those frames rather than the average, so one spike does
+ *   not keep the clock high for long after it.
+ * - Both directions aim the prediction at MALI_FRAME_POLICY_FIT_PERCENT of
+ *   the period, which may skip several steps at once.
+ *
+ * The caller reports back the scale it actually applied (steps are
+ * discrete) with mali_frame_policy_rescale() so the history is kept in
+ * units of the current clock.
+ *
+ * Only plain integer arithmetic on u32/s32 is used, so that the replay
+ * harness in tools/mali can build this file unchanged.
+ */
+
+#define MALI_FRAME_POLICY_SCALE_ONE     256
+#define MALI_FRAME_POLICY_UP_PERCENT    85
+#define MALI_FRAME_POLICY_FIT_PERCENT   75
+#define MALI_FRAME_POLICY_DOWN_PERCENT  55
+#define MALI_FRAME_POLICY_DOWN_FRAMES   3
+/* A frame this many periods long is an idle gap, not a frame */
+#define MALI_FRAME_POLICY_IDLE_PERIODS  4
+
+struct mali_frame_policy {
+	u32 frames;        /* frames seen since the last reset */
+	u32 avg_us;        /* running average of the per-frame GPU time */
+	s32 trend_us;      /* running average of its frame to frame change */
+	u32 last_us;       /* GPU time of the previous frame */
+	u32 calm_frames;   /* frames in a row under the down threshold */
+	u32 calm_max_us;   /* largest GPU time among those */
+	u32 predicted_us;  /* expected GPU time of the next frame */
+};
+
+MALI_STATIC_INLINE void mali_frame_policy_reset(struct mali_frame_policy *policy)
+{
+	policy->frames = 0;
+	policy->avg_us = 0;
+	policy->trend_us = 0;
+	policy->last_us = 0;
+	policy->calm_frames = 0;
+	policy->calm_max_us = 0;
+	policy->predicted_us = 0;
+}
+
+MALI_STATIC_INLINE u32 mali_frame_policy_scale(u32 time_us, u32 fit_us)
+{
+	u32 scale = (time_us * MALI_FRAME_POLICY_SCALE_ONE + fit_us - 1) / fit_us;
+
+	return (0 == scale) ? 1 : scale;
+}
+
+/**
+ * Account one frame and decide the clock for the next one.
+ *
+ * @param frame_us Time since the previous frame boundary
+ * @param gpu_us GPU busy time during that frame
+ * @param target_us Frame period the GPU should fit in
+ * @return Needed clock relative to the current one, in 1/256 units
+ */
+MALI_STATIC_INLINE u32 mali_frame_policy_update(struct mali_frame_policy *policy,
+                                                u32 frame_us, u32 gpu_us, u32 target_us)
+{
+	u32 up_us = target_us * MALI_FRAME_POLICY_UP_PERCENT / 100;
+	u32 fit_us = target_us * MALI_FRAME_POLICY_FIT_PERCENT / 100;
+	u32 down_us = target_us * MALI_FRAME_POLICY_DOWN_PERCENT / 100;
+	u32 predicted;
+
+	if (0 == fit_us || frame_us > MALI_FRAME_POLICY_IDLE_PERIODS * target_us) {
+		/* Resumed after an idle gap, start over with this frame */
+		mali_frame_policy_reset(policy);
+		return MALI_FRAME_POLICY_SCALE_ONE;
+	}
+
+	/* Keep the products below in range whatever the frame looked like */
+	if (gpu_us > MALI_FRAME_POLICY_IDLE_PERIODS * target_us) {
+		gpu_us = MALI_FRAME_POLICY_IDLE_PERIODS * target_us;
+	}
+
+	if (0 == policy->frames) {
+		policy->avg_us = gpu_us;
+		policy->trend_us = 0;
+	} else {
+		s32 delta = (s32)gpu_us - (s32)policy->last_us;
+
+		policy->avg_us = (u32)((s32)policy->avg_us + ((s32)gpu_us - (s32)policy->avg_us) / 4);
+		policy->trend_us += (delta - policy->trend_us) / 4;
+	}
+	policy->last_us = gpu_us;
+	policy->frames++;
+
+	predicted = policy->avg_us;
+	if (0 < policy->trend_us) {
+		predicted += 2 * (u32)policy->trend_us;
+	}
+	if (gpu_us > predicted) {
+		predicted = gpu_us;
+	}
+	policy->predicted_us = predicted;
+
+	if (predicted > up_us) {
+		policy->calm_frames = 0;
+		policy->calm_max_us = 0;
+		return mali_frame_policy_scale(predicted, fit_us);
+	}
+
+	if (gpu_us >= down_us) {
+		policy->calm_frames = 0;
+		policy->calm_max_us = 0;
+		return MALI_FRAME_POLICY_SCALE_ONE;
+	}
+
+	policy->calm_frames++;
+	if (gpu_us > policy->calm_max_us) {
+		policy->calm_max_us = gpu_us;
+	}
+	if (MALI_FRAME_POLICY_DOWN_FRAMES > policy->calm_frames) {
+		return MALI_FRAME_POLICY_SCALE_ONE;
+	}
+
+	predicted = policy->calm_max_us;
+	if (0 < policy->trend_us) {
+		predicted += 2 * (u32)policy->trend_us;
+	}
+	policy->predicted_us = predicted;
+	policy->calm_frames = 0;
+	policy->calm_max_us = 0;
+
+	return mali_frame_policy_scale(predicted, fit_us);
+}
+
+/**
+ * Rescale the history after the clock changed.
+ *
+ * @param applied New clock relative to the old one, in 1/256 units
+ */
+MALI_STATIC_INLINE void mali_frame_policy_rescale(struct mali_frame_policy *policy, u32 applied)
+{
+	if (MALI_FRAME_POLICY_SCALE_ONE == applied || 0 == applied) {
+		return;
+	}
+
+	policy->avg_us = policy->avg_us * MALI_FRAME_POLICY_SCALE_ONE / applied;
+	policy->trend_us = policy->trend_us * MALI_FRAME_POLICY_SCALE_ONE / (s32)applied;
+	policy->last_us = policy->last_us * MALI_FRAME_POLICY_SCALE_ONE / applied;
+	policy->calm_max_us = policy->calm_max_us * MALI_FRAME_POLICY_SCALE_ONE / applied;
+	policy->predicted_us = policy->predicted_us * MALI_FRAME_POLICY_SCALE_ONE / applied;
+}
+
+#endif /* __MALI_KERNEL_FRAME_POLICY_H__ */
@@ -14,6 +14,10 @@
 #include "mali_kernel_common.h"
 #include "mali_session.h"
 #include "mali_scheduler.h"
+#include "mali_kernel_frame_policy.h"
+#if defined(CONFIG_MALI400_PROFILING)
+#include "mali_osk_profiling.h"
+#endif
 
 /* Thresholds for GP bound detection. */
 #define MALI_GP_BOUND_GP_UTILIZATION_THRESHOLD 240
@@ -31,6 +35,8 @@ static u64 work_start_time_pp = 0;
 static u64 accumulated_work_time_gpu = 0;
 static u64 accumulated_work_time_gp = 0;
 static u64 accumulated_work_time_pp = 0;
+/* GPU busy time since init, never reset; frames are measured as deltas of it */
+static u64 total_work_time_gpu = 0;
 
 static u64 period_start_time = 0;
 static _mali_osk_timer_t *utilization_timer = NULL;
@@ -42,6 +48,16 @@ static u32 last_utilization_pp = 0 ;
 
 static u32 mali_utilization_timeout = 100;
 void (*mali_utilization_callback)(struct mali_gpu_utilization_data *data) = NULL;
+
+/* Frame based DVFS: frame boundaries come from vsync reports */
+static u64 frame_start_time = 0;
+static u64 frame_start_work_gpu = 0;
+static _mali_osk_mutex_t *frame_lock = NULL;
+static struct mali_frame_policy frame_policy;
+unsigned int (*mali_frame_callback)(struct mali_gpu_frame_data *data) = NULL;
+
+/* Target frame rate of the frame based policy, 0 turns it off */
+int mali_frame_dvfs_fps = 60;
 #if defined(CONFIG_MALI400_POWER_PERFORMANCE_POLICY)
 extern void mali_power_performance_policy_callback(struct mali_gpu_utilization_data *data);
 #define NUMBER_OF_NANOSECONDS_PER_SECOND  1000000000ULL
@@ -131,6 +147,7 @@ static void calculate_gpu_utilization(void* arg)
 	/* If we are currently busy, update working period up to now */
 	if (work_start_time_gpu != 0) {
 		accumulated_work_time_gpu += (time_now - work_start_time_gpu);
+		total_work_time_gpu += (time_now - work_start_time_gpu);
 		work_start_time_gpu = time_now;
 
 		/* GP and/or PP will also be busy if the GPU is busy at this point */
@@ -234,6 +251,10 @@ _mali_osk_errcode_t mali_utilization_init(void)
 			MALI_DEBUG_PRINT(2, ("Mali GPU Utilization: Platform has it's own policy \n"));
 			MALI_DEBUG_PRINT(2, ("Mali GPU Utilization: Utilization handler installed with interval %u\n", mali_utilization_timeout));
 		}
+		if (NULL != data.frame_callback) {
+			mali_frame_callback = data.frame_callback;
+			MALI_DEBUG_PRINT(2, ("Mali GPU Utilization: Frame handler installed\n"));
+		}
 	}
 #endif
 
@@ -254,11 +275,19 @@ _mali_osk_errcode_t mali_utilization_init(void)
 		return _MALI_OSK_ERR_FAULT;
 	}
 
+	frame_lock = _mali_osk_mutex_init(_MALI_OSK_LOCKFLAG_ORDERED, _MALI_OSK_LOCK_ORDER_FRAME_DVFS);
+	if (NULL == frame_lock) {
+		_mali_osk_spinlock_irq_term(time_data_lock);
+		return _MALI_OSK_ERR_FAULT;
+	}
+	mali_frame_policy_reset(&frame_policy);
+
 	num_running_gp_cores = 0;
 	num_running_pp_cores = 0;
 
 	utilization_timer = _mali_osk_timer_init();
 	if (NULL == utilization_timer) {
+		_mali_osk_mutex_term(frame_lock);
 		_mali_osk_spinlock_irq_term(time_data_lock);
 		return _MALI_OSK_ERR_FAULT;
 	}
@@ -271,6 +300,9 @@ void mali_utilization_suspend(void)
 {
 	_mali_osk_spinlock_irq_lock(time_data_lock);
 
+	/* The frame in flight spans the suspend, don't account it */
+	frame_start_time = 0;
+
 	if (timer_running == MALI_TRUE) {
 		timer_running = MALI_FALSE;
 		_mali_osk_spinlock_irq_unlock(time_data_lock);
@@ -290,9 +322,84 @@ void mali_utilization_term(void)
 		utilization_timer = NULL;
 	}
 
+	if (NULL != frame_lock) {
+		_mali_osk_mutex_term(frame_lock);
+		frame_lock = NULL;
+	}
+
 	_mali_osk_spinlock_irq_term(time_data_lock);
 }
 
+static u32 frame_ns_to_us(u64 ns)
+{
+	/* Frames are far shorter than 4s, clamp rather than divide 64-bit */
+	if (ns > 0xFFFFFFFFULL) {
+		return 0xFFFFFFFF / 1000;
+	}
+	return (u32)ns / 1000;
+}
+
+void mali_utilization_frame_end(void)
+{
+	struct mali_gpu_frame_data data;
+	u64 time_now;
+	u64 work_now;
+	u64 frame_ns = 0;
+	u64 work_ns = 0;
+	mali_bool first;
+	u32 applied;
+	int fps = mali_frame_dvfs_fps; /* module parameter, may change under us */
+
+	if (NULL == mali_frame_callback || 0 >= fps) {
+		return;
+	}
+
+	_mali_osk_mutex_wait(frame_lock);
+
+	_mali_osk_spinlock_irq_lock(time_data_lock);
+
+	time_now = _mali_osk_time_get_ns();
+	work_now = total_work_time_gpu;
+	if (0 != work_start_time_gpu) {
+		work_now += time_now - work_start_time_gpu;
+	}
+
+	first = (0 == frame_start_time) ? MALI_TRUE : MALI_FALSE;
+	if (MALI_FALSE == first) {
+		frame_ns = time_now - frame_start_time;
+		work_ns = work_now - frame_start_work_gpu;
+	}
+	frame_start_time = time_now;
+	frame_start_work_gpu = work_now;
+
+	_mali_osk_spinlock_irq_unlock(time_data_lock);
+
+	if (MALI_TRUE == first) {
+		mali_frame_policy_reset(&frame_policy);
+		_mali_osk_mutex_signal(frame_lock);
+		return;
+	}
+
+	data.frame_time_us = frame_ns_to_us(frame_ns);
+	data.gpu_time_us = frame_ns_to_us(work_ns);
+	data.target_time_us = 1000000 / fps;
+	data.scale = mali_frame_policy_update(&frame_policy, data.frame_time_us,
+	                                      data.gpu_time_us, data.target_time_us);
+	data.predicted_time_us = frame_policy.predicted_us;
+
+	applied = mali_frame_callback(&data);
+	mali_frame_policy_rescale(&frame_policy, applied);
+
+	MALI_DEBUG_PRINT(4, ("Mali frame DVFS: frame %u us, gpu %u us, predicted %u us, scale %u, applied %u\n",
+	                     data.frame_time_us, data.gpu_time_us, data.predicted_time_us, data.scale, applied));
+#if defined(CONFIG_MALI400_PROFILING)
+	_mali_osk_profiling_report_frame_dvfs(data.frame_time_us, data.gpu_time_us, data.target_time_us,
+	                                      data.predicted_time_us, data.scale, applied);
+#endif
+
+	_mali_osk_mutex_signal(frame_lock);
+}
+
 void mali_utilization_gp_start(void)
 {
 	_mali_osk_spinlock_irq_lock(time_data_lock);
@@ -391,6 +498,7 @@ void mali_utilization_gp_end(void)
 			 * at which we consider the GPU to be idle as well.
 			 */
 			accumulated_work_time_gpu += (time_now - work_start_time_gpu);
+			total_work_time_gpu += (time_now - work_start_time_gpu);
 			work_start_time_gpu = 0;
 		}
 	}
@@ -416,6 +524,7 @@ void mali_utilization_pp_end(void)
 			 * at which we consider the GPU to be idle as well.
 			 */
 			accumulated_work_time_gpu += (time_now - work_start_time_gpu);
+			total_work_time_gpu += (time_now - work_start_time_gpu);
 			work_start_time_gpu = 0;
 		}
 	}
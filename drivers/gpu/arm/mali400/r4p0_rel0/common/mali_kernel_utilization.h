@@ -15,6 +15,7 @@
 #include "mali_osk.h"
 
 extern void (*mali_utilization_callback)(struct mali_gpu_utilization_data *data);
+extern unsigned int (*mali_frame_callback)(struct mali_gpu_frame_data *data);
 
 /**
  * Initialize/start the Mali GPU utilization metrics reporting.
@@ -33,7 +34,7 @@ void mali_utilization_term(void);
  */
 MALI_STATIC_INLINE mali_bool mali_utilization_enabled(void)
 {
-	return (NULL != mali_utilization_callback);
+	return (NULL != mali_utilization_callback || NULL != mali_frame_callback);
 }
 
 /**
@@ -61,5 +62,11 @@ void mali_utilization_pp_end(void);
  */
 void mali_utilization_suspend(void);
 
+/**
+ * Should be called at every frame boundary (vsync report). Measures the GPU
+ * time of the frame that just ended and runs the frame based DVFS policy.
+ */
+void mali_utilization_frame_end(void);
+
 
 #endif /* __MALI_KERNEL_UTILIZATION_H__ */
@@ -11,6 +11,7 @@
 #include "mali_kernel_common.h"
 #include "mali_osk.h"
 #include "mali_ukk.h"
+#include "mali_kernel_utilization.h"
 
 #if defined(CONFIG_MALI400_PROFILING)
 #include "mali_osk_profiling.h"
@@ -19,7 +20,11 @@
 _mali_osk_errcode_t _mali_ukk_vsync_event_report(_mali_uk_vsync_event_report_s *args)
 {
 	_mali_uk_vsync_event event = (_mali_uk_vsync_event)args->event;
-	MALI_IGNORE(event); /* event is not used for release code, and that is OK */
+
+	/* Each completed vsync wait closes a frame for the frame based DVFS */
+	if (event == _MALI_UK_VSYNC_EVENT_END_WAIT) {
+		mali_utilization_frame_end();
+	}
 
 #if defined(CONFIG_MALI400_PROFILING)
 	/*
@@ -49,6 +49,9 @@ struct _mali_osk_device_data {
 	/* Function that will receive periodic GPU utilization numbers */
 	void (*utilization_callback)(struct mali_gpu_utilization_data *data);
 
+	/* Function that will receive per-frame GPU time at every vsync report */
+	unsigned int (*frame_callback)(struct mali_gpu_frame_data *data);
+
 	/*
 	 * Mali PMU switch delay.
 	 * Only needed if the power gates are connected to the PMU in a high fanout
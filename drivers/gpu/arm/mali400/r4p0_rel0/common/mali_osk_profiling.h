@@ -70,6 +70,16 @@ _mali_osk_errcode_t _mali_osk_profiling_start(u32 * limit);
 /* Call Linux tracepoint directly */
 #define _mali_osk_profiling_report_hw_counter(counter_id, value) trace_mali_hw_counter(counter_id, value)
 
+/**
+ * Report a frame based DVFS decision.
+ *
+ * @see mali_dvfs_frame in mali_linux_trace.h
+ */
+
+/* Call Linux tracepoint directly */
+#define _mali_osk_profiling_report_frame_dvfs(frame_us, gpu_us, target_us, predicted_us, scale, applied) \
+	trace_mali_dvfs_frame(frame_us, gpu_us, target_us, predicted_us, scale, applied)
+
 /**
  * Report SW counters
  *
@@ -133,6 +143,7 @@ mali_bool _mali_osk_profiling_have_recording(void);
 /* Dummy add_event, for when profiling is disabled. */
 
 #define _mali_osk_profiling_add_event(event_id, data0, data1, data2, data3, data4)
+#define _mali_osk_profiling_report_frame_dvfs(frame_us, gpu_us, target_us, predicted_us, scale, applied)
 
 #endif /* defined(CONFIG_MALI400_PROFILING)  && defined(CONFIG_TRACEPOINTS) */
 
@@ -220,6 +220,7 @@ typedef enum {
 	_MALI_OSK_LOCK_ORDER_DMA_COMMAND,
 	_MALI_OSK_LOCK_ORDER_PROFILING,
 	_MALI_OSK_LOCK_ORDER_L2_COUNTER,
+	_MALI_OSK_LOCK_ORDER_FRAME_DVFS,
 	_MALI_OSK_LOCK_ORDER_UTILIZATION,
 	_MALI_OSK_LOCK_ORDER_PM_EXECUTE,
 	_MALI_OSK_LOCK_ORDER_SESSION_PENDING_JOBS,
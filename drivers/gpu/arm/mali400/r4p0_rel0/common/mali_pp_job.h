@@ -53,6 +53,7 @@ struct mali_pp_job {
 #if defined(CONFIG_DMA_SHARED_BUFFER) && !defined(CONFIG_MALI_DMA_BUF_MAP_ON_ATTACH)
 	struct mali_dma_buf_attachment **dma_bufs;         /**< Array of DMA-bufs used by job */
 	u32 num_dma_bufs;                                  /**< Number of DMA-bufs used by job */
+	struct fence *dma_buf_fence;                       /**< Fence published on the DMA-bufs, signaled when the job is done */
 #endif
 	struct mali_timeline_tracker tracker;              /**< Timeline tracker for this job */
 	u32 perf_counter_per_sub_job_count;                /**< Number of values in the two arrays which is != MALI_HW_CORE_NO_COUNTER */
@@ -340,6 +340,14 @@ struct mali_gpu_utilization_data {
 #endif
 };
 
+struct mali_gpu_frame_data {
+	unsigned int frame_time_us;     /* Time between the last two vsync reports */
+	unsigned int gpu_time_us;       /* Time the GPU was busy during that frame */
+	unsigned int target_time_us;    /* Frame period the GPU should fit in */
+	unsigned int predicted_time_us; /* Expected GPU time of the next frame at the current clock */
+	unsigned int scale;             /* Clock needed for the next frame relative to the current one, 256 = keep */
+};
+
 struct mali_gpu_device_data {
 	/* Dedicated GPU memory range (physical). */
 	unsigned long dedicated_mem_start;
@@ -361,6 +369,12 @@ struct mali_gpu_device_data {
 	/* Function that will receive periodic GPU utilization numbers */
 	void (*utilization_callback)(struct mali_gpu_utilization_data *data);
 
+	/*
+	 * Function that will receive per-frame GPU time at every vsync report.
+	 * Returns the clock it switched to relative to the current one, 256 = unchanged.
+	 */
+	unsigned int (*frame_callback)(struct mali_gpu_frame_data *data);
+
 	/*
 	 * Mali PMU switch delay.
 	 * Only needed if the power gates are connected to the PMU in a high fanout
@@ -38,6 +38,7 @@
 #include <linux/mali/mali_utgard.h>
 #include "mali_pm.h"
 #include "mali_pmu.h"
+#include "mali_memory_os_alloc.h"
 #include "mali_group.h"
 #include "mali_gp.h"
 #include "mali_pp.h"
@@ -852,6 +853,30 @@ static const struct file_operations memory_usage_fops = {
 	.read = memory_used_read,
 };
 
+static ssize_t memory_os_alloc_read(struct file *filp, char __user *ubuf, size_t cnt, loff_t *ppos)
+{
+	char buf[768];
+	size_t r;
+
+	r = mali_mem_os_stat_dump(buf, sizeof(buf));
+	return simple_read_from_buffer(ubuf, cnt, ppos, buf, r);
+}
+
+static ssize_t memory_os_alloc_write(struct file *filp, const char __user *ubuf, size_t cnt, loff_t *ppos)
+{
+	/* Any write resets the statistics */
+	mali_mem_os_stat_reset();
+
+	*ppos += cnt;
+	return cnt;
+}
+
+static const struct file_operations memory_os_alloc_fops = {
+	.owner = THIS_MODULE,
+	.read = memory_os_alloc_read,
+	.write = memory_os_alloc_write,
+};
+
 static ssize_t utilization_gp_pp_read(struct file *filp, char __user *ubuf, size_t cnt, loff_t *ppos)
 {
 	char buf[64];
@@ -1292,6 +1317,7 @@ int mali_sysfs_register(const char *mali_dev_name)
 			}
 
 			debugfs_create_file("memory_usage", 0400, mali_debugfs_dir, NULL, &memory_usage_fops);
+			debugfs_create_file("memory_os_alloc", 0600, mali_debugfs_dir, NULL, &memory_os_alloc_fops);
 
 			debugfs_create_file("utilization_gp_pp", 0400, mali_debugfs_dir, NULL, &utilization_gp_pp_fops);
 			debugfs_create_file("utilization_gp", 0400, mali_debugfs_dir, NULL, &utilization_gp_fops);
@@ -119,6 +119,47 @@ TRACE_EVENT(mali_sw_counters,
             TP_printk("counters were %s", __entry->counters == NULL? "NULL" : "not NULL")
            );
 
+/**
+ * Define a tracepoint used to log the frame based DVFS decision taken at
+ * every vsync report.
+ *
+ * @param frame_us Time between the last two vsync reports.
+ * @param gpu_us GPU busy time during that frame.
+ * @param target_us Frame period the GPU should fit in.
+ * @param predicted_us Expected GPU time of the next frame.
+ * @param scale Clock asked for, relative to the current one (256 = keep).
+ * @param applied Clock the platform switched to, relative to the old one.
+ */
+TRACE_EVENT(mali_dvfs_frame,
+
+            TP_PROTO(unsigned int frame_us, unsigned int gpu_us, unsigned int target_us,
+                     unsigned int predicted_us, unsigned int scale, unsigned int applied),
+
+            TP_ARGS(frame_us, gpu_us, target_us, predicted_us, scale, applied),
+
+            TP_STRUCT__entry(
+                __field(unsigned int, frame_us)
+                __field(unsigned int, gpu_us)
+                __field(unsigned int, target_us)
+                __field(unsigned int, predicted_us)
+                __field(unsigned int, scale)
+                __field(unsigned int, applied)
+            ),
+
+            TP_fast_assign(
+                __entry->frame_us = frame_us;
+                __entry->gpu_us = gpu_us;
+                __entry->target_us = target_us;
+                __entry->predicted_us = predicted_us;
+                __entry->scale = scale;
+                __entry->applied = applied;
+            ),
+
+            TP_printk("frame=%uus gpu=%uus target=%uus predicted=%uus scale=%u applied=%u",
+                      __entry->frame_us, __entry->gpu_us, __entry->target_us,
+                      __entry->predicted_us, __entry->scale, __entry->applied)
+           );
+
 #endif /* MALI_LINUX_TRACE_H */
 
 /* This part must exist outside the header guard. */
@@ -343,6 +343,9 @@ void mali_memory_session_end(struct mali_session_data *session)
 
 _mali_osk_errcode_t mali_memory_initialize(void)
 {
+#if defined(CONFIG_DMA_SHARED_BUFFER) && !defined(CONFIG_MALI_DMA_BUF_MAP_ON_ATTACH)
+	mali_dma_buf_fence_init();
+#endif
 	return mali_mem_os_init();
 }
 
@@ -11,6 +11,7 @@
 #include <linux/fs.h>	   /* file system operations */
 #include <asm/uaccess.h>	/* user space access */
 #include <linux/dma-buf.h>
+#include <linux/fence.h>
 #include <linux/scatterlist.h>
 #include <linux/rbtree.h>
 #include <linux/platform_device.h>
@@ -167,6 +168,42 @@ static void mali_dma_buf_unmap(struct mali_dma_buf_attachment *mem)
 }
 
 #if !defined(CONFIG_MALI_DMA_BUF_MAP_ON_ATTACH)
+/* How long a job waits for another device still writing one of its DMA-bufs */
+#define MALI_DMA_BUF_FENCE_TIMEOUT_MS 1000
+
+static unsigned mali_dma_buf_fence_context;
+static atomic_t mali_dma_buf_fence_seqno = ATOMIC_INIT(0);
+
+void mali_dma_buf_fence_init(void)
+{
+	mali_dma_buf_fence_context = fence_context_alloc(1);
+}
+
+/*
+ * Wait for the job writing the buffer last, unless it is a Mali job: those
+ * are ordered by the Mali timeline already, and their fences are only
+ * signaled from the job delete work, which may be queued behind this one.
+ */
+static void mali_dma_buf_wait_fence(struct dma_buf *buf)
+{
+	struct fence *fence;
+	long ret;
+
+	fence = dma_buf_get_excl_fence(buf);
+	if (NULL == fence) return;
+
+	if (fence->context != mali_dma_buf_fence_context) {
+		ret = fence_wait_timeout(fence, false,
+		                         msecs_to_jiffies(MALI_DMA_BUF_FENCE_TIMEOUT_MS));
+		if (0 == ret) {
+			MALI_DEBUG_PRINT_ERROR(("Mali DMA-buf: Timeout waiting for fence %u:%u\n",
+			                        fence->context, fence->seqno));
+		}
+	}
+
+	fence_put(fence);
+}
+
 int mali_dma_buf_map_job(struct mali_pp_job *job)
 {
 	mali_mem_allocation *descriptor;
@@ -175,6 +212,8 @@ int mali_dma_buf_map_job(struct mali_pp_job *job)
 	int i;
 	int ret = 0;
 
+	MALI_DEBUG_ASSERT(NULL == job->dma_buf_fence);
+
 	_mali_osk_mutex_wait(job->session->memory_lock);
 
 	for (i = 0; i < job->num_memory_cookies; i++) {
@@ -220,6 +259,20 @@ int mali_dma_buf_map_job(struct mali_pp_job *job)
 
 		/* Add mem to list of DMA-bufs mapped for this job */
 		job->dma_bufs[i] = mem;
+
+		mali_dma_buf_wait_fence(mem->buf);
+
+		/*
+		 * Mali can't tell the buffers a job reads from the ones it
+		 * renders to, so the job is published as writer of all of them.
+		 */
+		if (NULL == job->dma_buf_fence) {
+			job->dma_buf_fence = fence_create_sw(mali_dma_buf_fence_context,
+			                                     atomic_inc_return(&mali_dma_buf_fence_seqno));
+		}
+		if (NULL != job->dma_buf_fence) {
+			dma_buf_set_excl_fence(mem->buf, job->dma_buf_fence);
+		}
 	}
 
 	_mali_osk_mutex_signal(job->session->memory_lock);
@@ -236,6 +289,12 @@ void mali_dma_buf_unmap_job(struct mali_pp_job *job)
 		mali_dma_buf_unmap(job->dma_bufs[i]);
 		job->dma_bufs[i] = NULL;
 	}
+
+	if (NULL != job->dma_buf_fence) {
+		fence_signal(job->dma_buf_fence);
+		fence_put(job->dma_buf_fence);
+		job->dma_buf_fence = NULL;
+	}
 }
 #endif /* !CONFIG_MALI_DMA_BUF_MAP_ON_ATTACH */
 
@@ -29,6 +29,7 @@ int mali_dma_buf_get_size(struct mali_session_data *session, _mali_uk_dma_buf_ge
 void mali_mem_dma_buf_release(mali_mem_allocation *descriptor);
 
 #if !defined(CONFIG_MALI_DMA_BUF_MAP_ON_ATTACH)
+void mali_dma_buf_fence_init(void);
 int mali_dma_buf_map_job(struct mali_pp_job *job);
 void mali_dma_buf_unmap_job(struct mali_pp_job *job);
 #endif
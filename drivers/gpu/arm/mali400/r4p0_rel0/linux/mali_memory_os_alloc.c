@@ -16,6 +16,7 @@
 #include <linux/version.h>
 #include <linux/platform_device.h>
 #include <linux/workqueue.h>
+#include <asm/div64.h>
 
 #include "mali_osk.h"
 #include "mali_memory.h"
@@ -26,6 +27,20 @@
 #define MALI_OS_MEMORY_KERNEL_BUFFER_SIZE_IN_PAGES (MALI_OS_MEMORY_KERNEL_BUFFER_SIZE_IN_MB * 256)
 #define MALI_OS_MEMORY_POOL_TRIM_JIFFIES (10 * CONFIG_HZ) /* Default to 10s */
 
+/*
+ * Allocations of at least one chunk are backed by physically contiguous
+ * 64KB chunks when the page allocator has them to spare. The chunks are
+ * split into ordinary pages, so the pool, the shrinker and the free path
+ * keep dealing with single pages, but they are cleaned from the CPU caches
+ * in one go and mapped on Mali as contiguous runs.
+ */
+#define MALI_MEM_OS_CHUNK_ORDER 4
+#define MALI_MEM_OS_CHUNK_PAGES (1 << MALI_MEM_OS_CHUNK_ORDER)
+
+/* Allocation latency histogram bucket limits, in microseconds */
+static const u32 mali_mem_os_latency_limits_us[] = { 10, 50, 100, 500, 1000, 5000, 10000 };
+#define MALI_MEM_OS_LATENCY_BUCKETS (ARRAY_SIZE(mali_mem_os_latency_limits_us) + 1)
+
 #if LINUX_VERSION_CODE < KERNEL_VERSION(3,0,0)
 #if LINUX_VERSION_CODE < KERNEL_VERSION(2,6,35)
 static int mali_mem_os_shrink(int nr_to_scan, gfp_t gfp_mask);
@@ -48,8 +63,26 @@ static struct mali_mem_os_allocator {
 	struct shrinker shrinker;
 	struct delayed_work timed_shrinker;
 	struct workqueue_struct *wq;
+
+	spinlock_t stats_lock;
+	struct {
+		u32 allocs;
+		u64 pages;
+		u64 pool_pages;     /* taken from the pool */
+		u64 chunk_pages;    /* allocated as part of a 64KB chunk */
+		u64 single_pages;   /* allocated one at a time */
+		u64 spare_pages;    /* chunk remainders put on the pool */
+		u32 chunk_failures; /* chunk allocations that fell back to single pages */
+		u64 map_runs;       /* contiguous runs mapped on Mali */
+		u64 alloc_ns;
+		u64 max_alloc_ns;
+		u32 latency[MALI_MEM_OS_LATENCY_BUCKETS];
+		u64 shrunk_pages;   /* freed by the shrinker */
+		u64 trimmed_pages;  /* freed by the pool trim timer */
+	} stats;
 } mali_mem_os_allocator = {
 	.pool_lock = __SPIN_LOCK_UNLOCKED(pool_lock),
+	.stats_lock = __SPIN_LOCK_UNLOCKED(stats_lock),
 	.pool_pages = LIST_HEAD_INIT(mali_mem_os_allocator.pool_pages),
 	.pool_count = 0,
 
@@ -91,13 +124,81 @@ static void mali_mem_os_free(mali_mem_allocation *descriptor)
 	}
 }
 
+/* Clean a freshly allocated run of pages from the CPU caches and record their bus addresses */
+static void mali_mem_os_prepare_pages(struct page *page, size_t count, struct list_head *list)
+{
+	dma_addr_t dma_addr;
+	size_t i;
+
+	/* Ensure pages are flushed from CPU caches. */
+	dma_addr = dma_map_page(&mali_platform_device->dev, page,
+	                        0, count * _MALI_OSK_MALI_PAGE_SIZE, DMA_TO_DEVICE);
+
+	for (i = 0; i < count; i++) {
+		struct page *p = nth_page(page, i);
+
+		/* Store page phys addr */
+		SetPagePrivate(p);
+		set_page_private(p, dma_addr + i * _MALI_OSK_MALI_PAGE_SIZE);
+
+		list_add_tail(&p->lru, list);
+	}
+}
+
+static struct page *mali_mem_os_alloc_chunk(void)
+{
+	struct page *page;
+
+	/* Opportunistic: don't reclaim or compact hard for a chunk, single pages will do */
+	page = alloc_pages(GFP_HIGHUSER | __GFP_ZERO | __GFP_NORETRY | __GFP_NOWARN | __GFP_COLD,
+	                   MALI_MEM_OS_CHUNK_ORDER);
+	if (NULL != page) {
+		split_page(page, MALI_MEM_OS_CHUNK_ORDER);
+	}
+
+	return page;
+}
+
+static void mali_mem_os_account_alloc(size_t page_count, size_t pool_pages, size_t chunk_pages,
+                                      size_t spare_pages, u32 chunk_failures, u64 ns)
+{
+	u32 us = (ns > 0xFFFFFFFFULL) ? 0xFFFFFFFF / 1000 : (u32)ns / 1000;
+	u32 bucket = 0;
+
+	while (bucket < ARRAY_SIZE(mali_mem_os_latency_limits_us) &&
+	       us >= mali_mem_os_latency_limits_us[bucket]) {
+		bucket++;
+	}
+
+	spin_lock(&mali_mem_os_allocator.stats_lock);
+	mali_mem_os_allocator.stats.allocs++;
+	mali_mem_os_allocator.stats.pages += page_count;
+	mali_mem_os_allocator.stats.pool_pages += pool_pages;
+	mali_mem_os_allocator.stats.chunk_pages += chunk_pages;
+	mali_mem_os_allocator.stats.single_pages += page_count - pool_pages - chunk_pages;
+	mali_mem_os_allocator.stats.spare_pages += spare_pages;
+	mali_mem_os_allocator.stats.chunk_failures += chunk_failures;
+	mali_mem_os_allocator.stats.alloc_ns += ns;
+	if (ns > mali_mem_os_allocator.stats.max_alloc_ns) {
+		mali_mem_os_allocator.stats.max_alloc_ns = ns;
+	}
+	mali_mem_os_allocator.stats.latency[bucket]++;
+	spin_unlock(&mali_mem_os_allocator.stats_lock);
+}
+
 static int mali_mem_os_alloc_pages(mali_mem_allocation *descriptor, u32 size)
 {
-	struct page *new_page, *tmp;
+	struct page *new_page;
 	LIST_HEAD(pages);
+	LIST_HEAD(spare);
 	size_t page_count = PAGE_ALIGN(size) / _MALI_OSK_MALI_PAGE_SIZE;
 	size_t remaining = page_count;
-	u32 i;
+	size_t pool_pages;
+	size_t chunk_pages = 0;
+	size_t spare_pages = 0;
+	u32 chunk_failures = 0;
+	mali_bool use_chunks = (MALI_MEM_OS_CHUNK_PAGES <= page_count) ? MALI_TRUE : MALI_FALSE;
+	u64 start_ns = _mali_osk_time_get_ns();
 
 	MALI_DEBUG_ASSERT_POINTER(descriptor);
 	MALI_DEBUG_ASSERT(MALI_MEM_OS == descriptor->type);
@@ -105,60 +206,79 @@ static int mali_mem_os_alloc_pages(mali_mem_allocation *descriptor, u32 size)
 	INIT_LIST_HEAD(&descriptor->os_mem.pages);
 	descriptor->os_mem.count = page_count;
 
-	/* Grab pages from pool. */
-	{
-		size_t pool_pages;
-		spin_lock(&mali_mem_os_allocator.pool_lock);
-		pool_pages = min(remaining, mali_mem_os_allocator.pool_count);
-		for (i = pool_pages; i > 0; i--) {
-			BUG_ON(list_empty(&mali_mem_os_allocator.pool_pages));
-			list_move(mali_mem_os_allocator.pool_pages.next, &pages);
+	/* Grab pages from pool, in pool order so freed runs come back contiguous. */
+	spin_lock(&mali_mem_os_allocator.pool_lock);
+	pool_pages = min(remaining, mali_mem_os_allocator.pool_count);
+	if (0 < pool_pages) {
+		struct list_head *le = &mali_mem_os_allocator.pool_pages;
+		size_t i;
+
+		for (i = 0; i < pool_pages; i++) {
+			le = le->next;
+			BUG_ON(le == &mali_mem_os_allocator.pool_pages);
 		}
-		mali_mem_os_allocator.pool_count -= pool_pages;
-		remaining -= pool_pages;
-		spin_unlock(&mali_mem_os_allocator.pool_lock);
+		list_cut_position(&pages, &mali_mem_os_allocator.pool_pages, le);
 	}
+	mali_mem_os_allocator.pool_count -= pool_pages;
+	remaining -= pool_pages;
+	spin_unlock(&mali_mem_os_allocator.pool_lock);
 
-	/* Process pages from pool. */
-	i = 0;
-	list_for_each_entry_safe(new_page, tmp, &pages, lru) {
-		BUG_ON(NULL == new_page);
+	list_splice_tail(&pages, &descriptor->os_mem.pages);
 
-		list_move_tail(&new_page->lru, &descriptor->os_mem.pages);
-	}
+	/* Allocate new pages, if needed. Whole chunks first, the tail of the last one goes to the pool. */
+	while (MALI_TRUE == use_chunks && 0 < remaining) {
+		size_t used;
 
-	/* Allocate new pages, if needed. */
-	for (i = 0; i < remaining; i++) {
-		dma_addr_t dma_addr;
+		new_page = mali_mem_os_alloc_chunk();
+		if (NULL == new_page) {
+			/* Memory is fragmented, don't keep trying for this allocation */
+			chunk_failures++;
+			break;
+		}
+
+		used = min(remaining, (size_t)MALI_MEM_OS_CHUNK_PAGES);
+		mali_mem_os_prepare_pages(new_page, used, &descriptor->os_mem.pages);
+		if (MALI_MEM_OS_CHUNK_PAGES > used) {
+			mali_mem_os_prepare_pages(nth_page(new_page, used), MALI_MEM_OS_CHUNK_PAGES - used, &spare);
+			spare_pages = MALI_MEM_OS_CHUNK_PAGES - used;
+		}
 
+		chunk_pages += used;
+		remaining -= used;
+	}
+
+	while (0 < remaining) {
 		new_page = alloc_page(GFP_HIGHUSER | __GFP_ZERO | __GFP_REPEAT | __GFP_NOWARN | __GFP_COLD);
 
 		if (unlikely(NULL == new_page)) {
 			/* Calculate the number of pages actually allocated, and free them. */
-			descriptor->os_mem.count = (page_count - remaining) + i;
+			descriptor->os_mem.count = page_count - remaining;
 			atomic_add(descriptor->os_mem.count, &mali_mem_os_allocator.allocated_pages);
 			mali_mem_os_free(descriptor);
 			return -ENOMEM;
 		}
 
-		/* Ensure page is flushed from CPU caches. */
-		dma_addr = dma_map_page(&mali_platform_device->dev, new_page,
-		                        0, _MALI_OSK_MALI_PAGE_SIZE, DMA_TO_DEVICE);
-
-		/* Store page phys addr */
-		SetPagePrivate(new_page);
-		set_page_private(new_page, dma_addr);
-
-		list_add_tail(&new_page->lru, &descriptor->os_mem.pages);
+		mali_mem_os_prepare_pages(new_page, 1, &descriptor->os_mem.pages);
+		remaining--;
 	}
 
 	atomic_add(page_count, &mali_mem_os_allocator.allocated_pages);
 
+	if (0 < spare_pages) {
+		spin_lock(&mali_mem_os_allocator.pool_lock);
+		list_splice(&spare, &mali_mem_os_allocator.pool_pages);
+		mali_mem_os_allocator.pool_count += spare_pages;
+		spin_unlock(&mali_mem_os_allocator.pool_lock);
+	}
+
 	if (MALI_OS_MEMORY_KERNEL_BUFFER_SIZE_IN_PAGES > mali_mem_os_allocator.pool_count) {
 		MALI_DEBUG_PRINT(4, ("OS Mem: Stopping pool trim timer, only %u pages on pool\n", mali_mem_os_allocator.pool_count));
 		cancel_delayed_work(&mali_mem_os_allocator.timed_shrinker);
 	}
 
+	mali_mem_os_account_alloc(page_count, pool_pages, chunk_pages, spare_pages, chunk_failures,
+	                          _mali_osk_time_get_ns() - start_ns);
+
 	return 0;
 }
 
@@ -169,6 +289,9 @@ static int mali_mem_os_mali_map(mali_mem_allocation *descriptor, struct mali_ses
 	_mali_osk_errcode_t err;
 	u32 virt = descriptor->mali_mapping.addr;
 	u32 prop = descriptor->mali_mapping.properties;
+	u32 run_phys = 0;
+	u32 run_size = 0;
+	u32 runs = 0;
 
 	MALI_DEBUG_ASSERT(MALI_MEM_OS == descriptor->type);
 
@@ -177,12 +300,33 @@ static int mali_mem_os_mali_map(mali_mem_allocation *descriptor, struct mali_ses
 		return -ENOMEM;
 	}
 
+	/* Write the page table entries a physically contiguous run at a time */
 	list_for_each_entry(page, &descriptor->os_mem.pages, lru) {
 		u32 phys = page_private(page);
-		mali_mmu_pagedir_update(pagedir, virt, phys, MALI_MMU_PAGE_SIZE, prop);
-		virt += MALI_MMU_PAGE_SIZE;
+
+		if (0 != run_size && run_phys + run_size == phys) {
+			run_size += MALI_MMU_PAGE_SIZE;
+			continue;
+		}
+
+		if (0 != run_size) {
+			mali_mmu_pagedir_update(pagedir, virt, run_phys, run_size, prop);
+			virt += run_size;
+			runs++;
+		}
+		run_phys = phys;
+		run_size = MALI_MMU_PAGE_SIZE;
 	}
 
+	if (0 != run_size) {
+		mali_mmu_pagedir_update(pagedir, virt, run_phys, run_size, prop);
+		runs++;
+	}
+
+	spin_lock(&mali_mem_os_allocator.stats_lock);
+	mali_mem_os_allocator.stats.map_runs += runs;
+	spin_unlock(&mali_mem_os_allocator.stats_lock);
+
 	return 0;
 }
 
@@ -418,6 +562,7 @@ static int mali_mem_os_shrink(struct shrinker *shrinker, struct shrink_control *
 	struct page *page, *tmp;
 	unsigned long flags;
 	struct list_head *le, pages;
+	u32 freed = 0;
 #if LINUX_VERSION_CODE < KERNEL_VERSION(3,0,0)
 	int nr = nr_to_scan;
 #else
@@ -450,8 +595,13 @@ static int mali_mem_os_shrink(struct shrinker *shrinker, struct shrink_control *
 
 	list_for_each_entry_safe(page, tmp, &pages, lru) {
 		mali_mem_os_free_page(page);
+		++freed;
 	}
 
+	spin_lock(&mali_mem_os_allocator.stats_lock);
+	mali_mem_os_allocator.stats.shrunk_pages += freed;
+	spin_unlock(&mali_mem_os_allocator.stats_lock);
+
 	/* Release some pages from page table page pool */
 	mali_mem_os_trim_page_table_page_pool();
 
@@ -470,6 +620,7 @@ static void mali_mem_os_trim_pool(struct work_struct *data)
 	struct list_head *le;
 	LIST_HEAD(pages);
 	size_t nr_to_free;
+	u32 freed = 0;
 
 	MALI_IGNORE(data);
 
@@ -493,8 +644,13 @@ static void mali_mem_os_trim_pool(struct work_struct *data)
 
 	list_for_each_entry_safe(page, tmp, &pages, lru) {
 		mali_mem_os_free_page(page);
+		++freed;
 	}
 
+	spin_lock(&mali_mem_os_allocator.stats_lock);
+	mali_mem_os_allocator.stats.trimmed_pages += freed;
+	spin_unlock(&mali_mem_os_allocator.stats_lock);
+
 	/* Release some pages from page table page pool */
 	mali_mem_os_trim_page_table_page_pool();
 
@@ -557,3 +713,70 @@ u32 mali_mem_os_stat(void)
 {
 	return atomic_read(&mali_mem_os_allocator.allocated_pages) * _MALI_OSK_MALI_PAGE_SIZE;
 }
+
+u32 mali_mem_os_stat_dump(char *buf, u32 size)
+{
+	u32 latency[MALI_MEM_OS_LATENCY_BUCKETS];
+	u64 alloc_ns, max_alloc_ns, pages, pool_pages, chunk_pages, single_pages, spare_pages;
+	u64 map_runs, shrunk_pages, trimmed_pages;
+	u32 allocs, chunk_failures, avg_us, i, n;
+
+	spin_lock(&mali_mem_os_allocator.stats_lock);
+	allocs = mali_mem_os_allocator.stats.allocs;
+	pages = mali_mem_os_allocator.stats.pages;
+	pool_pages = mali_mem_os_allocator.stats.pool_pages;
+	chunk_pages = mali_mem_os_allocator.stats.chunk_pages;
+	single_pages = mali_mem_os_allocator.stats.single_pages;
+	spare_pages = mali_mem_os_allocator.stats.spare_pages;
+	chunk_failures = mali_mem_os_allocator.stats.chunk_failures;
+	map_runs = mali_mem_os_allocator.stats.map_runs;
+	alloc_ns = mali_mem_os_allocator.stats.alloc_ns;
+	max_alloc_ns = mali_mem_os_allocator.stats.max_alloc_ns;
+	shrunk_pages = mali_mem_os_allocator.stats.shrunk_pages;
+	trimmed_pages = mali_mem_os_allocator.stats.trimmed_pages;
+	memcpy(latency, mali_mem_os_allocator.stats.latency, sizeof(latency));
+	spin_unlock(&mali_mem_os_allocator.stats_lock);
+
+	if (0 != allocs) {
+		do_div(alloc_ns, allocs);
+	}
+	avg_us = (u32)alloc_ns / 1000;
+	do_div(max_alloc_ns, 1000);
+
+	n = scnprintf(buf, size,
+	             "allocations:    %u\n"
+	             "pages:          %llu\n"
+	             "  from pool:    %llu\n"
+	             "  from chunks:  %llu\n"
+	             "  single:       %llu\n"
+	             "spare to pool:  %llu\n"
+	             "chunk failures: %u\n"
+	             "mapped runs:    %llu\n"
+	             "pool pages:     %u\n"
+	             "shrunk pages:   %llu\n"
+	             "trimmed pages:  %llu\n"
+	             "avg latency:    %u us\n"
+	             "max latency:    %llu us\n",
+	             allocs, pages, pool_pages, chunk_pages, single_pages, spare_pages,
+	             chunk_failures, map_runs, mali_mem_os_allocator.pool_count,
+	             shrunk_pages, trimmed_pages, avg_us, max_alloc_ns);
+
+	for (i = 0; i < MALI_MEM_OS_LATENCY_BUCKETS; i++) {
+		if (i < ARRAY_SIZE(mali_mem_os_latency_limits_us)) {
+			n += scnprintf(buf + n, size - n, "  < %5u us:   %u\n",
+			              mali_mem_os_latency_limits_us[i], latency[i]);
+		} else {
+			n += scnprintf(buf + n, size - n, "  >=%5u us:   %u\n",
+			              mali_mem_os_latency_limits_us[i - 1], latency[i]);
+		}
+	}
+
+	return n;
+}
+
+void mali_mem_os_stat_reset(void)
+{
+	spin_lock(&mali_mem_os_allocator.stats_lock);
+	memset(&mali_mem_os_allocator.stats, 0, sizeof(mali_mem_os_allocator.stats));
+	spin_unlock(&mali_mem_os_allocator.stats_lock);
+}
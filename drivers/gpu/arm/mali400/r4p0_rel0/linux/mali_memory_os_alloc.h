@@ -44,4 +44,17 @@ _mali_osk_errcode_t mali_mem_os_init(void);
 void mali_mem_os_term(void);
 u32 mali_mem_os_stat(void);
 
+/** @brief Print OS allocator statistics
+ *
+ * Page sources, contiguous runs and allocation latency since the last reset.
+ *
+ * @param buf Buffer to print into
+ * @param size Size of buf
+ * @return Number of characters written
+ */
+u32 mali_mem_os_stat_dump(char *buf, u32 size);
+
+/** @brief Reset OS allocator statistics */
+void mali_mem_os_stat_reset(void);
+
 #endif /* __MALI_MEMORY_OS_ALLOC_H__ */
@@ -264,6 +264,9 @@ static const char * const lock_order_to_string(_mali_osk_lock_order_t order)
 	case _MALI_OSK_LOCK_ORDER_L2_COUNTER:
 		return "_MALI_OSK_LOCK_ORDER_L2_COUNTER";
 		break;
+	case _MALI_OSK_LOCK_ORDER_FRAME_DVFS:
+		return "_MALI_OSK_LOCK_ORDER_FRAME_DVFS";
+		break;
 	case _MALI_OSK_LOCK_ORDER_UTILIZATION:
 		return "_MALI_OSK_LOCK_ORDER_UTILIZATION";
 		break;
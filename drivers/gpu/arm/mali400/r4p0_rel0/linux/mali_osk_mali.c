@@ -90,6 +90,7 @@ _mali_osk_errcode_t _mali_osk_device_data_get(struct _mali_osk_device_data *data
 			data->max_job_runtime = os_data->max_job_runtime;
 			data->utilization_interval = os_data->utilization_interval;
 			data->utilization_callback = os_data->utilization_callback;
+			data->frame_callback = os_data->frame_callback;
 			data->pmu_switch_delay = os_data->pmu_switch_delay;
 			data->set_freq_callback = os_data->set_freq_callback;
 
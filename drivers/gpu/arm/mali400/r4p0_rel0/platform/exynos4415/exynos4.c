@@ -51,6 +51,7 @@ static struct mali_gpu_device_data mali_gpu_data =
 	.fb_size = 0xb1000000,
 	.utilization_interval = 100, /* 100ms */
 	.utilization_callback = mali_gpu_utilization_handler,
+	.frame_callback = mali_gpu_frame_handler,
 };
 
 int mali_platform_device_register(void)
@@ -65,6 +65,8 @@
 #endif
 
 #define MALI_DVFS_WATING 10 /* msec */
+/* utilization samples are ignored while frames drive DVFS */
+#define MALI_DVFS_FRAME_HOLDOFF 200 /* msec */
 #define MALI_DVFS_DEFAULT_STEP 1
 #define PD_G3D_LOCK_FLAG 2
 
@@ -184,6 +186,10 @@ static struct workqueue_struct *mali_dvfs_wq = 0;
 _mali_osk_mutex_t *mali_dvfs_lock;
 int mali_runtime_resumed = -1;
 static DECLARE_WORK(mali_dvfs_work, mali_dvfs_work_handler);
+static unsigned int mali_dvfs_level = 0;
+/* step asked for by the frame handler, -1 if none */
+static atomic_t mali_dvfs_frame_step = ATOMIC_INIT(-1);
+static unsigned long mali_dvfs_frame_jiffies;
 
 int cpufreq_lock_by_mali(unsigned int freq)
 {
@@ -568,7 +574,7 @@ static mali_bool change_mali_dvfs_status(u32 step, mali_bool boostup )
 
 static unsigned int decideNextStatus(unsigned int utilization)
 {
-	static unsigned int level = 0;
+	unsigned int level = mali_dvfs_level;
 	int iStepCount = 0;
 
 	if (mali_runtime_resumed >= 0) {
@@ -592,6 +598,7 @@ static unsigned int decideNextStatus(unsigned int utilization)
 			}
 		}
 	}
+	mali_dvfs_level = level;
 	return level;
 }
 
@@ -638,12 +645,39 @@ static mali_bool mali_dvfs_status(unsigned int utilization)
 	return MALI_TRUE;
 }
 
+/*
+ * The frame policy already applied its own hysteresis and may skip steps,
+ * so go straight to the step it picked.
+ */
+static mali_bool mali_dvfs_frame_status(unsigned int step)
+{
+	unsigned int curStatus = get_mali_dvfs_status();
+
+	MALI_DEBUG_PRINT(4, ("> mali_dvfs_frame_status: %d -> %d \n", curStatus, step));
+
+	mali_runtime_resumed = -1;
+	mali_dvfs_level = step;
+	if (curStatus == step)
+		return MALI_TRUE;
+
+#ifdef CONFIG_MALI_DVFS
+	update_time_in_state(curStatus);
+#endif
+	return change_mali_dvfs_status(step, step > curStatus);
+}
+
 static void mali_dvfs_work_handler(struct work_struct *w)
 {
+	int step;
+
 	bMaliDvfsRun = 1;
 	MALI_DEBUG_PRINT(3, ("=== mali_dvfs_work_handler\n"));
 
-	if(!mali_dvfs_status(mali_dvfs_utilization))
+	step = atomic_xchg(&mali_dvfs_frame_step, -1);
+	if (step >= 0) {
+		if (!mali_dvfs_frame_status(step))
+			MALI_DEBUG_PRINT(1, ( "error on mali dvfs frame status in mali_dvfs_work_handler"));
+	} else if(!mali_dvfs_status(mali_dvfs_utilization))
 		MALI_DEBUG_PRINT(1, ( "error on mali dvfs status in mali_dvfs_work_handler"));
 
 	bMaliDvfsRun = 0;
@@ -886,12 +920,56 @@ void mali_gpu_utilization_handler(struct mali_gpu_utilization_data *data)
 	if (nPowermode == MALI_POWER_MODE_ON)
 	{
 #ifdef CONFIG_MALI_DVFS
+		/* frames are being reported, let mali_gpu_frame_handler decide */
+		if (mali_dvfs_frame_jiffies &&
+				time_before(jiffies, mali_dvfs_frame_jiffies + msecs_to_jiffies(MALI_DVFS_FRAME_HOLDOFF)))
+			return;
+
 		if(!mali_dvfs_handler(data->utilization_gpu))
 			MALI_DEBUG_PRINT(1, ("error on mali dvfs status in utilization\n"));
 #endif
 	}
 }
 
+unsigned int mali_gpu_frame_handler(struct mali_gpu_frame_data *data)
+{
+#ifdef CONFIG_MALI_DVFS
+	unsigned int cur, step, want;
+	int pending;
+
+	if (nPowermode != MALI_POWER_MODE_ON || mali_dvfs_control != 0)
+		return 256;
+
+	mali_dvfs_frame_jiffies = jiffies;
+	if (data->scale == 256)
+		return 256;
+
+	/* a step change may still be pending, decide from where it lands */
+	pending = atomic_read(&mali_dvfs_frame_step);
+	cur = pending >= 0 ? pending : get_mali_dvfs_status();
+
+	want = (mali_dvfs[cur].clock * data->scale + 255) / 256;
+	step = cur;
+	if (data->scale > 256) {
+		while (step < MALI_DVFS_STEPS - 1 && mali_dvfs[step].clock < want)
+			step++;
+	} else {
+		while (step > 0 && mali_dvfs[step - 1].clock >= want)
+			step--;
+	}
+
+	if (step == cur)
+		return 256;
+
+	atomic_set(&mali_dvfs_frame_step, step);
+	queue_work_on(0, mali_dvfs_wq, &mali_dvfs_work);
+
+	return mali_dvfs[step].clock * 256 / mali_dvfs[cur].clock;
+#else
+	return 256;
+#endif
+}
+
 #ifdef CONFIG_MALI_DVFS
 static void update_time_in_state(int level)
 {
@@ -83,6 +83,15 @@ _mali_osk_errcode_t mali_platform_power_mode_change(struct device *dev, mali_pow
  */
 void mali_gpu_utilization_handler(struct mali_gpu_utilization_data *data);
 
+/** @brief Platform specific handling of per-frame GPU time
+ *
+ * Called at every vsync report with the GPU time of the frame that just
+ * ended and the clock the frame policy wants for the next one.
+ *
+ * @return The clock switched to relative to the current one, 256 = unchanged.
+ */
+unsigned int mali_gpu_frame_handler(struct mali_gpu_frame_data *data);
+
 #ifdef CONFIG_MALI_DVFS
 ssize_t show_time_in_state(struct device *dev, struct device_attribute *attr, char *buf);
 ssize_t set_time_in_state(struct device *dev, struct device_attribute *attr, const char *buf, size_t count);
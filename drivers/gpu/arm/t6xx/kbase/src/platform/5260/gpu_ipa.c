@@ -1,4 +1,6 @@
 
+#include <linux/thermal_ipa.h>
+
 #include "gpu_ipa.h"
 #include "gpu_dvfs_handler.h"
 
@@ -234,3 +236,100 @@ int gpu_ipa_dvfs_max_unlock(void)
 	gpu_dvfs_handler_control(kbdev, GPU_HANDLER_DVFS_MAX_UNLOCK, 0);
 	return 0;
 }
+
+/*
+ * Power actor of the GPU for the thermal power allocator, with the same
+ * C.V^2.f model scaled by the DVFS utilisation.  The cap is an IPA_LOCK max
+ * lock, which the DVFS handler combines with the TMU and sysfs locks.
+ */
+#define IPA_GPU_POWER_COEFF	2070	/* uW/(MHz.V^2), all cores on */
+
+static int gpu_ipa_utilisation;
+static int gpu_ipa_level = -1;
+
+static u32 gpu_ipa_level_power(struct exynos_context *platform, int level)
+{
+	gpu_dvfs_info *info = &platform->table[level];
+
+	return ipa_dynamic_power(IPA_GPU_POWER_COEFF, info->clock * 1000,
+				 info->voltage);
+}
+
+static u32 gpu_ipa_get_requested_power(struct ipa_actor *actor)
+{
+	struct exynos_context *platform = (struct exynos_context *)pkbdev->platform_context;
+	unsigned long flags;
+	int step;
+
+	spin_lock_irqsave(&platform->gpu_dvfs_spinlock, flags);
+	step = platform->step;
+	gpu_ipa_utilisation = platform->utilization;
+	spin_unlock_irqrestore(&platform->gpu_dvfs_spinlock, flags);
+
+	if (step < 0)
+		return 0;
+
+	return gpu_ipa_level_power(platform, step) * gpu_ipa_utilisation / 100;
+}
+
+static u32 gpu_ipa_get_max_power(struct ipa_actor *actor)
+{
+	struct exynos_context *platform = (struct exynos_context *)pkbdev->platform_context;
+
+	return gpu_ipa_level_power(platform, platform->table_size - 1);
+}
+
+static int gpu_ipa_set_power(struct ipa_actor *actor, u32 power)
+{
+	struct exynos_context *platform = (struct exynos_context *)pkbdev->platform_context;
+	u32 level_power;
+	int level;
+
+	if (power >= gpu_ipa_get_max_power(actor) || !gpu_ipa_utilisation) {
+		if (gpu_ipa_level < 0)
+			return 0;
+		gpu_ipa_level = -1;
+		return gpu_ipa_dvfs_max_unlock();
+	}
+
+	level_power = power * 100 / gpu_ipa_utilisation;
+	for (level = platform->table_size - 1; level > 0; level--)
+		if (gpu_ipa_level_power(platform, level) <= level_power)
+			break;
+
+	if (level == gpu_ipa_level)
+		return 0;
+
+	gpu_ipa_level = level;
+	return gpu_ipa_dvfs_max_lock(level);
+}
+
+static const struct ipa_actor_ops gpu_ipa_actor_ops = {
+	.get_requested_power	= gpu_ipa_get_requested_power,
+	.get_max_power		= gpu_ipa_get_max_power,
+	.set_power		= gpu_ipa_set_power,
+};
+
+static struct ipa_actor gpu_ipa_actor = {
+	.name	= "gpu",
+	.ops	= &gpu_ipa_actor_ops,
+	.weight	= IPA_WEIGHT_ONE,
+};
+
+int gpu_ipa_init(struct kbase_device *kbdev)
+{
+	struct exynos_context *platform = (struct exynos_context *)kbdev->platform_context;
+
+	if (!platform || !platform->table_size)
+		return -ENODEV;
+
+	return ipa_register_actor(&gpu_ipa_actor);
+}
+
+void gpu_ipa_term(void)
+{
+	ipa_unregister_actor(&gpu_ipa_actor);
+	if (gpu_ipa_level >= 0)
+		gpu_ipa_dvfs_max_unlock();
+	gpu_ipa_level = -1;
+}
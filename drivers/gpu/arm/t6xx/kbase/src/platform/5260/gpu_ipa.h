@@ -10,5 +10,7 @@ void gpu_ipa_dvfs_get_utilisation_stats(struct mali_debug_utilisation_stats *sta
 void gpu_ipa_dvfs_calc_norm_utilisation(struct kbase_device *kbdev);
 int gpu_ipa_dvfs_max_lock(int level);
 int gpu_ipa_dvfs_max_unlock(void);
+int gpu_ipa_init(struct kbase_device *kbdev);
+void gpu_ipa_term(void);
 
 #endif
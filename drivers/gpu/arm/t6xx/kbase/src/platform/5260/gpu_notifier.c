@@ -27,6 +27,9 @@
 #if defined(CONFIG_EXYNOS_THERMAL)
 #include <mach/tmu.h>
 #endif /* CONFIG_EXYNOS_THERMAL */
+#ifdef CONFIG_CPU_THERMAL_IPA
+#include "gpu_ipa.h"
+#endif /* CONFIG_CPU_THERMAL_IPA */
 
 extern struct kbase_device *pkbdev;
 
@@ -256,6 +259,10 @@ int gpu_notifier_init(kbase_device *kbdev)
 #else /* CONFIG_EXYNOS_THERMAL */
 	platform->tmu_status = false;
 #endif /* CONFIG_EXYNOS_THERMAL */
+#ifdef CONFIG_CPU_THERMAL_IPA
+	if (gpu_ipa_init(kbdev))
+		GPU_LOG(DVFS_ERROR, "failed to register the gpu power actor\n");
+#endif /* CONFIG_CPU_THERMAL_IPA */
 
 #ifdef CONFIG_MALI_T6XX_RT_PM
 	if (register_pm_notifier(&gpu_pm_nb))
@@ -267,6 +274,9 @@ int gpu_notifier_init(kbase_device *kbdev)
 
 void gpu_notifier_term(void)
 {
+#ifdef CONFIG_CPU_THERMAL_IPA
+	gpu_ipa_term();
+#endif /* CONFIG_CPU_THERMAL_IPA */
 #ifdef CONFIG_MALI_T6XX_RT_PM
 	unregister_pm_notifier(&gpu_pm_nb);
 #endif /* CONFIG_MALI_T6XX_RT_PM */
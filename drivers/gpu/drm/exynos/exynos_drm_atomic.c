@@ -0,0 +1,581 @@
+/* exynos_drm_atomic.c
+ *
+ * Copyright (C) 2013 Samsung Electronics Co.Ltd
+ *
+ * This program is free software; you can redistribute  it and/or modify it
+ * under  the terms of  the GNU General  Public License as published by the
+ * Free Software Foundation;  either version 2 of the  License, or (at your
+ * option) any later version.
+ *
+ */
+
+#include "drmP.h"
+
+#include <linux/file.h>
+#include <linux/dma-buf.h>
+#include <linux/sw_sync.h>
+
+#include <drm/exynos_drm.h>
+
+#include "exynos_drm_drv.h"
+#include "exynos_drm_encoder.h"
+#include "exynos_drm_fb.h"
+#include "exynos_drm_plane.h"
+#include "exynos_drm_atomic.h"
+
+/* How long a commit waits for the producers of its buffers. */
+#define ATOMIC_FENCE_TIMEOUT	1000	/* Millisecond. */
+
+/* How long a commit waits for the vblank latching it. */
+#define ATOMIC_VBLANK_TIMEOUT	100	/* Millisecond. */
+
+/*
+ * new state of a plane.
+ *
+ * @fb: framebuffer to show, with a reference held. NULL disables the plane.
+ * @src_x, @src_y, @src_w, @src_h: source rectangle in 16.16 fixed point.
+ */
+struct exynos_drm_atomic_plane {
+	struct drm_plane	*plane;
+	struct drm_framebuffer	*fb;
+	int			crtc_x;
+	int			crtc_y;
+	unsigned int		crtc_w;
+	unsigned int		crtc_h;
+	uint32_t		src_x;
+	uint32_t		src_y;
+	uint32_t		src_w;
+	uint32_t		src_h;
+};
+
+/*
+ * atomic commit of the planes of a crtc.
+ *
+ * @pipe: index of @crtc in private->crtc.
+ * @event: event sent once the commit is shown, protected by dev->event_lock
+ *	once the commit is in flight.
+ * @work: applies a non-blocking commit.
+ */
+struct exynos_drm_atomic_commit {
+	struct drm_device		*dev;
+	struct drm_crtc			*crtc;
+	int				pipe;
+	unsigned int			nr_planes;
+	struct exynos_drm_atomic_plane	planes[MAX_PLANE];
+	struct drm_pending_vblank_event	*event;
+	struct work_struct		work;
+};
+
+static int exynos_drm_atomic_get_pipe(struct drm_crtc *crtc)
+{
+	struct exynos_drm_private *private = crtc->dev->dev_private;
+	int pipe;
+
+	for (pipe = 0; pipe < MAX_CRTC; pipe++)
+		if (private->crtc[pipe] == crtc)
+			return pipe;
+
+	return -EINVAL;
+}
+
+static int exynos_drm_atomic_check_plane(struct exynos_drm_atomic_commit *commit,
+					 struct drm_exynos_atomic_plane *req)
+{
+	struct exynos_drm_atomic_plane *state =
+					&commit->planes[commit->nr_planes];
+	struct drm_mode_object *obj;
+	struct drm_plane *plane;
+	struct drm_framebuffer *fb;
+	unsigned int fb_width, fb_height;
+	unsigned int i;
+
+	obj = drm_mode_object_find(commit->dev, req->plane_id,
+				   DRM_MODE_OBJECT_PLANE);
+	if (!obj) {
+		DRM_DEBUG_KMS("unknown plane ID %d\n", req->plane_id);
+		return -ENOENT;
+	}
+	plane = obj_to_plane(obj);
+
+	if (!(plane->possible_crtcs & (1 << commit->pipe))) {
+		DRM_DEBUG_KMS("plane %d can't be used on crtc %d\n",
+				req->plane_id, commit->crtc->base.id);
+		return -EINVAL;
+	}
+
+	for (i = 0; i < commit->nr_planes; i++) {
+		if (commit->planes[i].plane == plane) {
+			DRM_DEBUG_KMS("plane %d updated twice\n",
+					req->plane_id);
+			return -EINVAL;
+		}
+	}
+
+	/* fb_id 0 disables the plane. */
+	if (!req->fb_id) {
+		state->plane = plane;
+		state->fb = NULL;
+		return 0;
+	}
+
+	obj = drm_mode_object_find(commit->dev, req->fb_id,
+				   DRM_MODE_OBJECT_FB);
+	if (!obj) {
+		DRM_DEBUG_KMS("unknown framebuffer ID %d\n", req->fb_id);
+		return -ENOENT;
+	}
+	fb = obj_to_fb(obj);
+
+	for (i = 0; i < plane->format_count; i++)
+		if (fb->pixel_format == plane->format_types[i])
+			break;
+	if (i == plane->format_count) {
+		DRM_DEBUG_KMS("invalid pixel format 0x%08x\n",
+				fb->pixel_format);
+		return -EINVAL;
+	}
+
+	if (!exynos_drm_fb_get_buf_cnt(fb)) {
+		DRM_DEBUG_KMS("framebuffer %d has no buffer\n", req->fb_id);
+		return -EINVAL;
+	}
+
+	fb_width = fb->width << 16;
+	fb_height = fb->height << 16;
+
+	if (req->src_w > fb_width || req->src_x > fb_width - req->src_w ||
+	    req->src_h > fb_height || req->src_y > fb_height - req->src_h) {
+		DRM_DEBUG_KMS("invalid source coordinates %ux%u+%u+%u\n",
+				req->src_w >> 16, req->src_h >> 16,
+				req->src_x >> 16, req->src_y >> 16);
+		return -ENOSPC;
+	}
+
+	if (!req->crtc_w || !req->crtc_h ||
+	    req->crtc_w > INT_MAX ||
+	    req->crtc_x > INT_MAX - (int32_t)req->crtc_w ||
+	    req->crtc_h > INT_MAX ||
+	    req->crtc_y > INT_MAX - (int32_t)req->crtc_h) {
+		DRM_DEBUG_KMS("invalid crtc coordinates %ux%u+%d+%d\n",
+				req->crtc_w, req->crtc_h,
+				req->crtc_x, req->crtc_y);
+		return -ERANGE;
+	}
+
+	drm_framebuffer_reference(fb);
+
+	state->plane = plane;
+	state->fb = fb;
+	state->crtc_x = req->crtc_x;
+	state->crtc_y = req->crtc_y;
+	state->crtc_w = req->crtc_w;
+	state->crtc_h = req->crtc_h;
+	state->src_x = req->src_x;
+	state->src_y = req->src_y;
+	state->src_w = req->src_w;
+	state->src_h = req->src_h;
+
+	return 0;
+}
+
+/* called with dev->mode_config.mutex held. */
+static void exynos_drm_atomic_free(struct exynos_drm_atomic_commit *commit)
+{
+	unsigned int i;
+
+	for (i = 0; i < commit->nr_planes; i++)
+		if (commit->planes[i].fb)
+			drm_framebuffer_unreference(commit->planes[i].fb);
+
+	kfree(commit);
+}
+
+static struct drm_pending_vblank_event *
+exynos_drm_atomic_create_event(struct drm_device *dev,
+			       struct drm_file *file_priv, uint64_t user_data)
+{
+	struct drm_pending_vblank_event *e;
+	unsigned long flags;
+
+	spin_lock_irqsave(&dev->event_lock, flags);
+	if (file_priv->event_space < sizeof(e->event)) {
+		spin_unlock_irqrestore(&dev->event_lock, flags);
+		return NULL;
+	}
+	file_priv->event_space -= sizeof(e->event);
+	spin_unlock_irqrestore(&dev->event_lock, flags);
+
+	e = kzalloc(sizeof(*e), GFP_KERNEL);
+	if (!e) {
+		spin_lock_irqsave(&dev->event_lock, flags);
+		file_priv->event_space += sizeof(e->event);
+		spin_unlock_irqrestore(&dev->event_lock, flags);
+		return NULL;
+	}
+
+	e->event.base.type = DRM_EVENT_FLIP_COMPLETE;
+	e->event.base.length = sizeof(e->event);
+	e->event.user_data = user_data;
+	e->base.event = &e->event.base;
+	e->base.file_priv = file_priv;
+	e->base.destroy = (void (*) (struct drm_pending_event *)) kfree;
+
+	return e;
+}
+
+static void exynos_drm_atomic_free_event(struct drm_device *dev,
+					 struct drm_pending_vblank_event *e)
+{
+	unsigned long flags;
+
+	spin_lock_irqsave(&dev->event_lock, flags);
+	e->base.file_priv->event_space += sizeof(e->event);
+	spin_unlock_irqrestore(&dev->event_lock, flags);
+
+	e->base.destroy(&e->base);
+}
+
+/*
+ * wait for the devices still writing the buffers, such as the GPU or a
+ * V4L2 capture device, so that no buffer is shown before it is complete.
+ */
+static void exynos_drm_atomic_wait_fences(struct exynos_drm_atomic_commit *commit)
+{
+	struct drm_framebuffer *fb;
+	struct dma_buf *dmabuf;
+	unsigned int i, j;
+	long ret;
+
+	for (i = 0; i < commit->nr_planes; i++) {
+		fb = commit->planes[i].fb;
+		if (!fb)
+			continue;
+
+		for (j = 0; j < exynos_drm_fb_get_buf_cnt(fb); j++) {
+			dmabuf = exynos_drm_fb_dma_buf(fb, j);
+			if (!dmabuf)
+				continue;
+
+			ret = dma_buf_wait_excl_fence(dmabuf, false,
+				msecs_to_jiffies(ATOMIC_FENCE_TIMEOUT));
+			if (!ret)
+				DRM_ERROR("timeout waiting for fb %d.\n",
+						fb->base.id);
+		}
+	}
+}
+
+static void exynos_drm_atomic_apply(struct exynos_drm_atomic_commit *commit)
+{
+	struct drm_device *dev = commit->dev;
+	struct exynos_drm_private *private = dev->dev_private;
+	struct drm_crtc *crtc = commit->crtc;
+	struct exynos_drm_atomic_plane *state;
+	unsigned long flags;
+	bool vblank;
+	u32 seq = 0;
+	unsigned int i;
+	int ret;
+
+	exynos_drm_atomic_wait_fences(commit);
+
+	mutex_lock(&dev->mode_config.mutex);
+
+	vblank = !drm_vblank_get(dev, commit->pipe);
+
+	/*
+	 * write the registers of all planes while the hardware holds them
+	 * back, so that they are latched together at the same vsync.
+	 */
+	exynos_drm_fn_encoder(crtc, NULL,
+			exynos_drm_encoder_crtc_atomic_begin);
+
+	for (i = 0; i < commit->nr_planes; i++) {
+		state = &commit->planes[i];
+
+		if (!state->fb) {
+			exynos_plane_dpms(state->plane, DRM_MODE_DPMS_OFF);
+			state->plane->crtc = NULL;
+			state->plane->fb = NULL;
+			continue;
+		}
+
+		ret = exynos_plane_mode_set(state->plane, crtc, state->fb,
+				state->crtc_x, state->crtc_y,
+				state->crtc_w, state->crtc_h,
+				state->src_x >> 16, state->src_y >> 16,
+				state->src_w >> 16, state->src_h >> 16);
+		if (ret < 0) {
+			DRM_ERROR("failed to set plane %d.\n",
+					state->plane->base.id);
+			continue;
+		}
+
+		state->plane->crtc = crtc;
+		state->plane->fb = state->fb;
+
+		exynos_plane_commit(state->plane);
+		exynos_plane_dpms(state->plane, DRM_MODE_DPMS_ON);
+	}
+
+	exynos_drm_fn_encoder(crtc, NULL,
+			exynos_drm_encoder_crtc_atomic_flush);
+
+	if (vblank)
+		seq = drm_vblank_count(dev, commit->pipe);
+
+	mutex_unlock(&dev->mode_config.mutex);
+
+	/* the new state is shown from the next vblank on. */
+	if (vblank) {
+		if (!wait_event_timeout(dev->vbl_queue[commit->pipe],
+				drm_vblank_count(dev, commit->pipe) != seq,
+				msecs_to_jiffies(ATOMIC_VBLANK_TIMEOUT)))
+			DRM_DEBUG_KMS("timeout waiting for vblank.\n");
+		drm_vblank_put(dev, commit->pipe);
+	}
+
+	sw_sync_timeline_inc(private->atomic_timeline[commit->pipe], 1);
+
+	spin_lock_irqsave(&dev->event_lock, flags);
+	if (commit->event)
+		drm_send_vblank_event(dev, vblank ? commit->pipe : -1,
+				commit->event);
+	private->atomic_commit[commit->pipe] = NULL;
+	spin_unlock_irqrestore(&dev->event_lock, flags);
+
+	wake_up(&private->atomic_wait);
+
+	mutex_lock(&dev->mode_config.mutex);
+	exynos_drm_atomic_free(commit);
+	mutex_unlock(&dev->mode_config.mutex);
+}
+
+static void exynos_drm_atomic_work(struct work_struct *work)
+{
+	struct exynos_drm_atomic_commit *commit = container_of(work,
+				struct exynos_drm_atomic_commit, work);
+
+	exynos_drm_atomic_apply(commit);
+}
+
+static bool exynos_drm_atomic_claim(struct exynos_drm_atomic_commit *commit)
+{
+	struct drm_device *dev = commit->dev;
+	struct exynos_drm_private *private = dev->dev_private;
+	bool claimed = false;
+
+	spin_lock_irq(&dev->event_lock);
+	if (!private->atomic_commit[commit->pipe]) {
+		private->atomic_commit[commit->pipe] = commit;
+		claimed = true;
+	}
+	spin_unlock_irq(&dev->event_lock);
+
+	return claimed;
+}
+
+static void exynos_drm_atomic_unclaim(struct exynos_drm_atomic_commit *commit)
+{
+	struct drm_device *dev = commit->dev;
+	struct exynos_drm_private *private = dev->dev_private;
+
+	spin_lock_irq(&dev->event_lock);
+	private->atomic_commit[commit->pipe] = NULL;
+	spin_unlock_irq(&dev->event_lock);
+
+	wake_up(&private->atomic_wait);
+}
+
+/* installs a fence signaled at @value and returns its fd in @out_fence. */
+static int exynos_drm_atomic_out_fence(struct exynos_drm_private *private,
+				       int pipe, u32 value, s32 *out_fence)
+{
+	struct sync_fence *fence;
+	struct sync_pt *pt;
+	int fd;
+
+	fd = get_unused_fd();
+	if (fd < 0)
+		return fd;
+
+	pt = sw_sync_pt_create(private->atomic_timeline[pipe], value);
+	if (!pt)
+		goto err_put_fd;
+
+	fence = sync_fence_create("exynos-atomic", pt);
+	if (!fence) {
+		sync_pt_free(pt);
+		goto err_put_fd;
+	}
+
+	sync_fence_install(fence, fd);
+	*out_fence = fd;
+
+	return 0;
+
+err_put_fd:
+	put_unused_fd(fd);
+	return -ENOMEM;
+}
+
+int exynos_drm_atomic_commit_ioctl(struct drm_device *dev, void *data,
+				   struct drm_file *file_priv)
+{
+	struct exynos_drm_private *private = dev->dev_private;
+	struct drm_exynos_atomic_commit *args = data;
+	struct drm_exynos_atomic_plane __user *user_planes;
+	struct drm_exynos_atomic_plane req;
+	struct exynos_drm_atomic_commit *commit;
+	struct drm_mode_object *obj;
+	unsigned int i;
+	u32 value;
+	int ret;
+
+	DRM_DEBUG_KMS("%s\n", __FILE__);
+
+	if (args->flags & ~EXYNOS_DRM_ATOMIC_FLAGS_MASK)
+		return -EINVAL;
+
+	if (!args->count_planes || args->count_planes > MAX_PLANE)
+		return -EINVAL;
+
+	args->out_fence = -1;
+
+	commit = kzalloc(sizeof(*commit), GFP_KERNEL);
+	if (!commit)
+		return -ENOMEM;
+
+	commit->dev = dev;
+	INIT_WORK(&commit->work, exynos_drm_atomic_work);
+
+	mutex_lock(&dev->mode_config.mutex);
+
+	obj = drm_mode_object_find(dev, args->crtc_id, DRM_MODE_OBJECT_CRTC);
+	if (!obj) {
+		DRM_DEBUG_KMS("unknown crtc ID %d\n", args->crtc_id);
+		ret = -ENOENT;
+		goto err_free;
+	}
+	commit->crtc = obj_to_crtc(obj);
+
+	if (!commit->crtc->enabled) {
+		DRM_DEBUG_KMS("crtc %d is disabled\n", args->crtc_id);
+		ret = -EINVAL;
+		goto err_free;
+	}
+
+	commit->pipe = exynos_drm_atomic_get_pipe(commit->crtc);
+	if (commit->pipe < 0) {
+		ret = commit->pipe;
+		goto err_free;
+	}
+
+	/* check the whole new state before anything is changed. */
+	user_planes = (struct drm_exynos_atomic_plane __user *)
+			(unsigned long)args->planes;
+	for (i = 0; i < args->count_planes; i++) {
+		if (copy_from_user(&req, &user_planes[i], sizeof(req))) {
+			ret = -EFAULT;
+			goto err_free;
+		}
+
+		ret = exynos_drm_atomic_check_plane(commit, &req);
+		if (ret)
+			goto err_free;
+
+		commit->nr_planes++;
+	}
+
+	if (args->flags & EXYNOS_DRM_ATOMIC_TEST_ONLY) {
+		ret = 0;
+		goto err_free;
+	}
+
+	if (args->flags & EXYNOS_DRM_ATOMIC_EVENT) {
+		commit->event = exynos_drm_atomic_create_event(dev, file_priv,
+							args->user_data);
+		if (!commit->event) {
+			ret = -ENOMEM;
+			goto err_free;
+		}
+		commit->event->pipe = commit->pipe;
+	}
+
+	if (!private->atomic_timeline[commit->pipe]) {
+		private->atomic_timeline[commit->pipe] =
+				sw_sync_timeline_create("exynos-atomic");
+		if (!private->atomic_timeline[commit->pipe]) {
+			ret = -ENOMEM;
+			goto err_free_event;
+		}
+	}
+
+	/* one commit in flight per crtc, a blocking one waits for its turn. */
+	while (!exynos_drm_atomic_claim(commit)) {
+		if (args->flags & EXYNOS_DRM_ATOMIC_NONBLOCK) {
+			ret = -EBUSY;
+			goto err_free_event;
+		}
+
+		mutex_unlock(&dev->mode_config.mutex);
+		ret = wait_event_interruptible(private->atomic_wait,
+				!private->atomic_commit[commit->pipe]);
+		mutex_lock(&dev->mode_config.mutex);
+		if (ret)
+			goto err_free_event;
+	}
+
+	/*
+	 * commits of a crtc are applied in order, so the timeline of its
+	 * out-fences advances by one per commit.
+	 */
+	value = private->atomic_timeline_max[commit->pipe] + 1;
+	if (args->flags & EXYNOS_DRM_ATOMIC_OUT_FENCE) {
+		/* out_fence stays -1, the commit is not applied. */
+		ret = exynos_drm_atomic_out_fence(private, commit->pipe,
+						  value, &args->out_fence);
+		if (ret) {
+			DRM_ERROR("failed to create out-fence.\n");
+			exynos_drm_atomic_unclaim(commit);
+			goto err_free_event;
+		}
+	}
+	private->atomic_timeline_max[commit->pipe] = value;
+
+	mutex_unlock(&dev->mode_config.mutex);
+
+	if (args->flags & EXYNOS_DRM_ATOMIC_NONBLOCK)
+		schedule_work(&commit->work);
+	else
+		exynos_drm_atomic_apply(commit);
+
+	return 0;
+
+err_free_event:
+	if (commit->event)
+		exynos_drm_atomic_free_event(dev, commit->event);
+err_free:
+	exynos_drm_atomic_free(commit);
+	mutex_unlock(&dev->mode_config.mutex);
+
+	return ret;
+}
+
+void exynos_drm_atomic_release_events(struct drm_device *dev,
+				      struct drm_file *file)
+{
+	struct exynos_drm_private *private = dev->dev_private;
+	struct exynos_drm_atomic_commit *commit;
+	int pipe;
+
+	/* called with dev->event_lock held. */
+	for (pipe = 0; pipe < MAX_CRTC; pipe++) {
+		commit = private->atomic_commit[pipe];
+		if (commit && commit->event &&
+		    commit->event->base.file_priv == file) {
+			commit->event->base.destroy(&commit->event->base);
+			commit->event = NULL;
+		}
+	}
+}
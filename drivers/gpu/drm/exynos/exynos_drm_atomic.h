@@ -0,0 +1,22 @@
+/* exynos_drm_atomic.h
+ *
+ * Copyright (C) 2013 Samsung Electronics Co.Ltd
+ *
+ * This program is free software; you can redistribute  it and/or modify it
+ * under  the terms of  the GNU General  Public License as published by the
+ * Free Software Foundation;  either version 2 of the  License, or (at your
+ * option) any later version.
+ *
+ */
+
+#ifndef _EXYNOS_DRM_ATOMIC_H_
+#define _EXYNOS_DRM_ATOMIC_H_
+
+int exynos_drm_atomic_commit_ioctl(struct drm_device *dev, void *data,
+				   struct drm_file *file_priv);
+
+/* drop the events of atomic commits in flight of a file being closed. */
+void exynos_drm_atomic_release_events(struct drm_device *dev,
+				      struct drm_file *file);
+
+#endif
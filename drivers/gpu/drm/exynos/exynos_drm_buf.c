@@ -32,6 +32,33 @@
 #include "exynos_drm_buf.h"
 #include "exynos_drm_iommu.h"
 
+/*
+ * freed buffers are kept in the cache up to this many bytes in total, and
+ * only buffers up to the last bucket size are kept at all.
+ */
+static unsigned int buf_cache_size_kb = 32 * 1024;
+module_param(buf_cache_size_kb, uint, 0644);
+MODULE_PARM_DESC(buf_cache_size_kb,
+		"size of freed buffers kept for reuse in KB");
+
+/*
+ * a buffer kept in the cache. the backing memory, its sg table and the
+ * device address it was mapped at are all kept, so handing it out again
+ * costs neither an allocation nor an iommu mapping.
+ */
+struct exynos_drm_buf_cache_entry {
+	struct list_head	bucket_list;
+	struct list_head	lru_list;
+	unsigned int		flags;
+	struct exynos_drm_gem_buf buf;
+};
+
+static inline unsigned int buf_cache_bucket(unsigned long size)
+{
+	return min_t(unsigned int, fls((size >> PAGE_SHIFT) - 1),
+			EXYNOS_DRM_BUF_CACHE_BUCKETS - 1);
+}
+
 static struct sg_table *exynos_pages_to_sg(struct page **pages, int nr_pages)
 {
 	struct sg_table *sgt = NULL;
@@ -179,6 +206,225 @@ static void lowlevel_buffer_deallocate(struct drm_device *dev,
 	buf->dma_addr = (dma_addr_t)NULL;
 }
 
+static bool exynos_drm_buf_cache_get(struct drm_device *dev,
+		unsigned int flags, struct exynos_drm_gem_buf *buf)
+{
+	struct exynos_drm_private *private = dev->dev_private;
+	struct exynos_drm_buf_cache *cache = private->buf_cache;
+	struct exynos_drm_buf_cache_entry *entry, *found = NULL;
+	unsigned int bucket = buf_cache_bucket(buf->size);
+
+	if (!cache)
+		return false;
+
+	mutex_lock(&cache->lock);
+	list_for_each_entry(entry, &cache->buckets[bucket], bucket_list) {
+		if (entry->buf.size == buf->size && entry->flags == flags) {
+			found = entry;
+			break;
+		}
+	}
+
+	if (!found) {
+		cache->misses++;
+		mutex_unlock(&cache->lock);
+		return false;
+	}
+
+	list_del(&found->bucket_list);
+	list_del(&found->lru_list);
+	cache->cached_bytes -= found->buf.size;
+	cache->cached_count--;
+	cache->hits++;
+	mutex_unlock(&cache->lock);
+
+	*buf = found->buf;
+	kfree(found);
+
+	DRM_DEBUG_KMS("reused dma_addr(0x%lx), size(0x%lx)\n",
+			(unsigned long)buf->dma_addr, buf->size);
+
+	return true;
+}
+
+/* release cached buffers until no more than @target bytes are left. */
+static unsigned long exynos_drm_buf_cache_evict(struct drm_device *dev,
+		unsigned long target)
+{
+	struct exynos_drm_private *private = dev->dev_private;
+	struct exynos_drm_buf_cache *cache = private->buf_cache;
+	struct exynos_drm_buf_cache_entry *entry;
+	unsigned long freed = 0;
+
+	/*
+	 * called with the lock held so the buffers are only moved to the
+	 * evict list here, and freed by the caller after dropping the lock.
+	 */
+	while (cache->cached_bytes > target && !list_empty(&cache->lru)) {
+		entry = list_first_entry(&cache->lru,
+				struct exynos_drm_buf_cache_entry, lru_list);
+		list_del(&entry->bucket_list);
+		list_move_tail(&entry->lru_list, &cache->evict);
+		cache->cached_bytes -= entry->buf.size;
+		cache->cached_count--;
+		cache->evictions++;
+		freed += entry->buf.size;
+	}
+
+	return freed;
+}
+
+static void exynos_drm_buf_cache_free_evicted(struct drm_device *dev)
+{
+	struct exynos_drm_private *private = dev->dev_private;
+	struct exynos_drm_buf_cache *cache = private->buf_cache;
+	struct exynos_drm_buf_cache_entry *entry, *tmp;
+	LIST_HEAD(evict);
+
+	mutex_lock(&cache->lock);
+	list_splice_init(&cache->evict, &evict);
+	mutex_unlock(&cache->lock);
+
+	list_for_each_entry_safe(entry, tmp, &evict, lru_list) {
+		list_del(&entry->lru_list);
+		lowlevel_buffer_deallocate(dev, entry->flags, &entry->buf);
+		kfree(entry);
+	}
+}
+
+static bool exynos_drm_buf_cache_put(struct drm_device *dev,
+		unsigned int flags, struct exynos_drm_gem_buf *buf)
+{
+	struct exynos_drm_private *private = dev->dev_private;
+	struct exynos_drm_buf_cache *cache = private->buf_cache;
+	struct exynos_drm_buf_cache_entry *entry;
+	unsigned long max_bytes = (unsigned long)buf_cache_size_kb << 10;
+
+	if (!cache || !buf->dma_addr || buf->size > max_bytes ||
+			buf->size > (PAGE_SIZE << (EXYNOS_DRM_BUF_CACHE_BUCKETS - 1)))
+		return false;
+
+	entry = kmalloc(sizeof(*entry), GFP_KERNEL);
+	if (!entry)
+		return false;
+
+	entry->flags = flags;
+	entry->buf = *buf;
+
+	mutex_lock(&cache->lock);
+	list_add(&entry->bucket_list,
+			&cache->buckets[buf_cache_bucket(buf->size)]);
+	list_add_tail(&entry->lru_list, &cache->lru);
+	cache->cached_bytes += buf->size;
+	cache->cached_count++;
+	exynos_drm_buf_cache_evict(dev, max_bytes);
+	mutex_unlock(&cache->lock);
+
+	exynos_drm_buf_cache_free_evicted(dev);
+
+	buf->dma_addr = (dma_addr_t)NULL;
+	buf->sgt = NULL;
+	buf->pages = NULL;
+	buf->kvaddr = NULL;
+
+	return true;
+}
+
+static int exynos_drm_buf_cache_shrink(struct shrinker *shrinker,
+		struct shrink_control *sc)
+{
+	struct exynos_drm_buf_cache *cache =
+		container_of(shrinker, struct exynos_drm_buf_cache, shrinker);
+	unsigned long nr_bytes = sc->nr_to_scan << PAGE_SHIFT;
+	int count;
+
+	if (!mutex_trylock(&cache->lock))
+		return sc->nr_to_scan ? -1 : 0;
+
+	if (sc->nr_to_scan) {
+		cache->shrunk += exynos_drm_buf_cache_evict(cache->drm_dev,
+				cache->cached_bytes > nr_bytes ?
+				cache->cached_bytes - nr_bytes : 0) >> PAGE_SHIFT;
+		mutex_unlock(&cache->lock);
+
+		exynos_drm_buf_cache_free_evicted(cache->drm_dev);
+
+		mutex_lock(&cache->lock);
+	}
+
+	count = cache->cached_bytes >> PAGE_SHIFT;
+	mutex_unlock(&cache->lock);
+
+	return count;
+}
+
+int exynos_drm_buf_cache_init(struct drm_device *dev)
+{
+	struct exynos_drm_private *private = dev->dev_private;
+	struct exynos_drm_buf_cache *cache;
+	int i;
+
+	cache = kzalloc(sizeof(*cache), GFP_KERNEL);
+	if (!cache)
+		return -ENOMEM;
+
+	cache->drm_dev = dev;
+	mutex_init(&cache->lock);
+	for (i = 0; i < EXYNOS_DRM_BUF_CACHE_BUCKETS; i++)
+		INIT_LIST_HEAD(&cache->buckets[i]);
+	INIT_LIST_HEAD(&cache->lru);
+	INIT_LIST_HEAD(&cache->evict);
+
+	cache->shrinker.shrink = exynos_drm_buf_cache_shrink;
+	cache->shrinker.seeks = DEFAULT_SEEKS;
+	register_shrinker(&cache->shrinker);
+
+	private->buf_cache = cache;
+
+	return 0;
+}
+
+void exynos_drm_buf_cache_fini(struct drm_device *dev)
+{
+	struct exynos_drm_private *private = dev->dev_private;
+	struct exynos_drm_buf_cache *cache = private->buf_cache;
+
+	if (!cache)
+		return;
+
+	unregister_shrinker(&cache->shrinker);
+
+	mutex_lock(&cache->lock);
+	exynos_drm_buf_cache_evict(dev, 0);
+	mutex_unlock(&cache->lock);
+	exynos_drm_buf_cache_free_evicted(dev);
+
+	private->buf_cache = NULL;
+	kfree(cache);
+}
+
+void exynos_drm_buf_cache_get_stats(struct drm_device *dev,
+		struct exynos_drm_buf_cache_stats *stats)
+{
+	struct exynos_drm_private *private = dev->dev_private;
+	struct exynos_drm_buf_cache *cache = private->buf_cache;
+
+	memset(stats, 0, sizeof(*stats));
+	stats->max_bytes = (unsigned long)buf_cache_size_kb << 10;
+
+	if (!cache)
+		return;
+
+	mutex_lock(&cache->lock);
+	stats->hits = cache->hits;
+	stats->misses = cache->misses;
+	stats->evictions = cache->evictions;
+	stats->shrunk = cache->shrunk;
+	stats->cached_bytes = cache->cached_bytes;
+	stats->cached_count = cache->cached_count;
+	mutex_unlock(&cache->lock);
+}
+
 struct exynos_drm_gem_buf *exynos_drm_init_buf(struct drm_device *dev,
 						unsigned int size)
 {
@@ -215,6 +461,13 @@ int exynos_drm_alloc_buf(struct drm_device *dev,
 		struct exynos_drm_gem_buf *buf, unsigned int flags)
 {
 
+	/*
+	 * a buffer of the same size and memory type freed a moment ago
+	 * can be used as is, still mapped at its device address.
+	 */
+	if (exynos_drm_buf_cache_get(dev, flags, buf))
+		return 0;
+
 	/*
 	 * allocate memory region and set the memory information
 	 * to dma_addr of a buffer object.
@@ -228,6 +481,13 @@ int exynos_drm_alloc_buf(struct drm_device *dev,
 void exynos_drm_free_buf(struct drm_device *dev,
 		unsigned int flags, struct exynos_drm_gem_buf *buffer)
 {
+	/*
+	 * keep the buffer for a later allocation if the cache has room.
+	 * the contents are not cleared, same as for a new allocation which
+	 * skips clearing with DMA_ATTR_SKIP_BUFFER_CLEAR.
+	 */
+	if (exynos_drm_buf_cache_put(dev, flags, buffer))
+		return;
 
 	lowlevel_buffer_deallocate(dev, flags, buffer);
 }
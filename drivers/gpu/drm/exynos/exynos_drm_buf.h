@@ -26,6 +26,49 @@
 #ifndef _EXYNOS_DRM_BUF_H_
 #define _EXYNOS_DRM_BUF_H_
 
+/* buckets of power of two pages, the last one holds up to 8MB. */
+#define EXYNOS_DRM_BUF_CACHE_BUCKETS	12
+
+/*
+ * cache of freed buffers.
+ *
+ * @lock: lock for the lists and counters.
+ * @buckets: cached buffers by size, see buf_cache_bucket().
+ * @lru: all cached buffers, least recently freed first.
+ * @evict: buffers taken out of the cache and not yet freed.
+ * @shrinker: gives the cached buffers back under memory pressure.
+ * @cached_bytes: total size of the cached buffers.
+ * @cached_count: number of the cached buffers.
+ * @hits: allocations served from the cache.
+ * @misses: allocations which needed a new buffer.
+ * @evictions: buffers freed to keep the cache under its size limit.
+ * @shrunk: pages given back by the shrinker.
+ */
+struct exynos_drm_buf_cache {
+	struct drm_device	*drm_dev;
+	struct mutex		lock;
+	struct list_head	buckets[EXYNOS_DRM_BUF_CACHE_BUCKETS];
+	struct list_head	lru;
+	struct list_head	evict;
+	struct shrinker		shrinker;
+	unsigned long		cached_bytes;
+	unsigned int		cached_count;
+	unsigned long		hits;
+	unsigned long		misses;
+	unsigned long		evictions;
+	unsigned long		shrunk;
+};
+
+struct exynos_drm_buf_cache_stats {
+	unsigned long		hits;
+	unsigned long		misses;
+	unsigned long		evictions;
+	unsigned long		shrunk;
+	unsigned long		cached_bytes;
+	unsigned int		cached_count;
+	unsigned long		max_bytes;
+};
+
 /* create and initialize buffer object. */
 struct exynos_drm_gem_buf *exynos_drm_init_buf(struct drm_device *dev,
 						unsigned int size);
@@ -44,4 +87,12 @@ void exynos_drm_free_buf(struct drm_device *dev,
 				unsigned int flags,
 				struct exynos_drm_gem_buf *buffer);
 
+/* setup and release the cache of freed buffers. */
+int exynos_drm_buf_cache_init(struct drm_device *dev);
+void exynos_drm_buf_cache_fini(struct drm_device *dev);
+
+/* get a snapshot of the counters of the cache of freed buffers. */
+void exynos_drm_buf_cache_get_stats(struct drm_device *dev,
+				struct exynos_drm_buf_cache_stats *stats);
+
 #endif
@@ -37,6 +37,7 @@
 #include "exynos_drm_gem.h"
 
 #include <linux/dmabuf-sync.h>
+#include <linux/dma-buf.h>
 
 /* undefine it if Xorg supports no-vblank mode. */
 #define XORG_VBLANK_MODE
@@ -63,6 +64,8 @@ enum exynos_crtc_mode {
  *	this pipe value.
  * @dpms: store the crtc dpms value
  * @mode: store the crtc mode value
+ * @fence_flip: page flip deferred until the new framebuffer is written,
+ *	protected by dev->event_lock.
  */
 struct exynos_drm_crtc {
 	struct drm_crtc			drm_crtc;
@@ -74,6 +77,24 @@ struct exynos_drm_crtc {
 	atomic_t			pending_flip;
 	struct list_head		sync_committed;
 	atomic_t			partial_mode;
+	struct exynos_drm_fence_flip	*fence_flip;
+};
+
+/*
+ * Page flip deferred because a producer, such as the GPU or a V4L2 capture
+ * device, still writes one of the buffers of the new framebuffer.
+ *
+ * @pending: waiters not called back yet, plus one held while they are
+ *	being installed.
+ * @work: does the flip once all producers are done.
+ */
+struct exynos_drm_fence_flip {
+	struct drm_crtc			*crtc;
+	struct drm_framebuffer		*fb;
+	struct drm_pending_vblank_event	*event;
+	struct dma_buf_fence_waiter	waiters[MAX_FB_BUFFER];
+	atomic_t			pending;
+	struct work_struct		work;
 };
 
 static void exynos_drm_dmabuf_sync_free(void *priv)
@@ -283,9 +304,9 @@ static void exynos_drm_crtc_adjust_partial_region(struct drm_crtc *crtc,
 	exynos_plane_adjust_partial_region(plane, pos);
 }
 
-static int exynos_drm_crtc_page_flip(struct drm_crtc *crtc,
-				      struct drm_framebuffer *fb,
-				      struct drm_pending_vblank_event *event)
+static int exynos_drm_crtc_do_page_flip(struct drm_crtc *crtc,
+					 struct drm_framebuffer *fb,
+					 struct drm_pending_vblank_event *event)
 {
 	struct drm_device *dev = crtc->dev;
 	struct exynos_drm_private *dev_priv = dev->dev_private;
@@ -443,6 +464,133 @@ out_fence:
 	return ret;
 }
 
+static void exynos_drm_fence_flip_work(struct work_struct *work)
+{
+	struct exynos_drm_fence_flip *flip = container_of(work,
+					struct exynos_drm_fence_flip, work);
+	struct drm_crtc *crtc = flip->crtc;
+	struct drm_device *dev = crtc->dev;
+	struct exynos_drm_crtc *exynos_crtc = to_exynos_crtc(crtc);
+	struct drm_pending_vblank_event *event;
+	int ret;
+
+	mutex_lock(&dev->mode_config.mutex);
+
+	spin_lock_irq(&dev->event_lock);
+	event = flip->event;
+	exynos_crtc->fence_flip = NULL;
+	spin_unlock_irq(&dev->event_lock);
+
+	/* event is NULL if the file was closed meanwhile. */
+	if (event) {
+		ret = exynos_drm_crtc_do_page_flip(crtc, flip->fb, event);
+		if (ret) {
+			DRM_ERROR("failed deferred page flip: %d\n", ret);
+
+			/* userspace still waits for the event. */
+			spin_lock_irq(&dev->event_lock);
+			drm_send_vblank_event(dev, -1, event);
+			spin_unlock_irq(&dev->event_lock);
+		}
+	}
+
+	drm_framebuffer_unreference(flip->fb);
+	mutex_unlock(&dev->mode_config.mutex);
+
+	kfree(flip);
+}
+
+static void exynos_drm_fence_flip_cb(struct dma_buf_fence_waiter *waiter)
+{
+	struct exynos_drm_fence_flip *flip = waiter->priv;
+
+	if (atomic_dec_and_test(&flip->pending))
+		schedule_work(&flip->work);
+}
+
+static int exynos_drm_crtc_page_flip(struct drm_crtc *crtc,
+				      struct drm_framebuffer *fb,
+				      struct drm_pending_vblank_event *event)
+{
+	struct drm_device *dev = crtc->dev;
+	struct exynos_drm_crtc *exynos_crtc = to_exynos_crtc(crtc);
+	struct exynos_drm_fb *exynos_fb = to_exynos_fb(fb);
+	struct exynos_drm_fence_flip *flip;
+	struct dma_buf *dmabuf;
+	unsigned int i;
+
+	if (!event)
+		return exynos_drm_crtc_do_page_flip(crtc, fb, event);
+
+	if (exynos_crtc->fence_flip)
+		return -EBUSY;
+
+	flip = kzalloc(sizeof(*flip), GFP_KERNEL);
+	if (!flip)
+		return exynos_drm_crtc_do_page_flip(crtc, fb, event);
+
+	flip->crtc = crtc;
+	flip->fb = fb;
+	flip->event = event;
+	INIT_WORK(&flip->work, exynos_drm_fence_flip_work);
+	atomic_set(&flip->pending, 1);
+
+	/*
+	 * Publish the flip before the first waiter may be called back so
+	 * that a concurrent close of the file finds the event.
+	 */
+	drm_framebuffer_reference(fb);
+	spin_lock_irq(&dev->event_lock);
+	exynos_crtc->fence_flip = flip;
+	spin_unlock_irq(&dev->event_lock);
+
+	for (i = 0; i < exynos_fb->buf_cnt; i++) {
+		dmabuf = exynos_drm_fb_dma_buf(fb, i);
+		if (!dmabuf)
+			continue;
+
+		flip->waiters[i].func = exynos_drm_fence_flip_cb;
+		flip->waiters[i].priv = flip;
+
+		atomic_inc(&flip->pending);
+		if (dma_buf_wait_excl_fence_async(dmabuf, &flip->waiters[i]))
+			atomic_dec(&flip->pending);
+	}
+
+	/* Nothing to wait for, which is the common case: flip right away. */
+	if (atomic_read(&flip->pending) == 1) {
+		spin_lock_irq(&dev->event_lock);
+		exynos_crtc->fence_flip = NULL;
+		spin_unlock_irq(&dev->event_lock);
+
+		drm_framebuffer_unreference(fb);
+		kfree(flip);
+
+		return exynos_drm_crtc_do_page_flip(crtc, fb, event);
+	}
+
+	if (atomic_dec_and_test(&flip->pending))
+		schedule_work(&flip->work);
+
+	return 0;
+}
+
+/*
+ * Drop the event of a deferred page flip of a file being closed, called
+ * with dev->event_lock held.
+ */
+void exynos_drm_crtc_release_events(struct drm_crtc *crtc,
+				    struct drm_file *file)
+{
+	struct exynos_drm_crtc *exynos_crtc = to_exynos_crtc(crtc);
+	struct exynos_drm_fence_flip *flip = exynos_crtc->fence_flip;
+
+	if (flip && flip->event && flip->event->base.file_priv == file) {
+		flip->event->base.destroy(&flip->event->base);
+		flip->event = NULL;
+	}
+}
+
 static void exynos_drm_crtc_destroy(struct drm_crtc *crtc)
 {
 	struct exynos_drm_crtc *exynos_crtc = to_exynos_crtc(crtc);
@@ -36,6 +36,8 @@ void exynos_drm_crtc_prepare_vblank(struct drm_device *dev, int crtc);
 int exynos_drm_crtc_enable_vblank(struct drm_device *dev, int crtc);
 void exynos_drm_crtc_disable_vblank(struct drm_device *dev, int crtc);
 void exynos_drm_crtc_finish_pageflip(struct drm_device *dev, int crtc);
+void exynos_drm_crtc_release_events(struct drm_crtc *crtc,
+				    struct drm_file *file);
 int exynos_drm_crtc_set_partial_region(struct drm_crtc *crtc,
 					struct exynos_drm_partial_pos *pos);
 void change_to_full_screen_mode(struct drm_crtc *crtc,
@@ -15,6 +15,8 @@
 
 #include "exynos_drm_drv.h"
 #include "exynos_drm_gem.h"
+#include "exynos_drm_buf.h"
+#include "exynos_drm_ipp.h"
 
 struct exynos_drm_debugfs_gem_info_data {
 	struct drm_file *filp;
@@ -31,7 +33,7 @@ static int exynos_drm_debugfs_gem_one_info(int id, void *ptr, void *data)
 	struct exynos_drm_gem_buf *buf = exynos_gem_obj->buffer;
 
 	seq_printf(gem_info_data->m,
-		"%5d\t%5d\t%4d\t%4d\t\t%4d\t0x%08lx\t0x%x\t%4d\t%4d\t\t%4d\n",
+		"%5d\t%5d\t%4d\t%4d\t\t%4d\t0x%08lx\t0x%x\t%4d\t%4d\t\t%4d\t\t%4d\n",
 					gem_info_data->filp->pid,
 					file_priv->tgid,
 					id,
@@ -41,7 +43,8 @@ static int exynos_drm_debugfs_gem_one_info(int id, void *ptr, void *data)
 					exynos_gem_obj->flags,
 					buf->pfnmap,
 					obj->export_dma_buf ? 1 : 0,
-					obj->import_attach ? 1 : 0);
+					obj->import_attach ? 1 : 0,
+					buf->userptr ? 1 : 0);
 
 	return 0;
 }
@@ -56,7 +59,7 @@ static int exynos_drm_debugfs_gem_info(struct seq_file *m, void *data)
 
 	seq_printf(gem_info_data.m,
 			"pid\ttgid\thandle\trefcount\thcount\tsize\t\tflags\t" \
-			"pfnmap\texport_to_fd\timport_from_fd\n");
+			"pfnmap\texport_to_fd\timport_from_fd\tuserptr\n");
 
 	mutex_lock(&drm_dev->struct_mutex);
 
@@ -75,8 +78,40 @@ static int exynos_drm_debugfs_gem_info(struct seq_file *m, void *data)
 	return 0;
 }
 
+static int exynos_drm_debugfs_buf_cache(struct seq_file *m, void *data)
+{
+	struct drm_info_node *node = (struct drm_info_node *)m->private;
+	struct drm_device *drm_dev = node->minor->dev;
+	struct exynos_drm_buf_cache_stats stats;
+	unsigned long lookups;
+
+	exynos_drm_buf_cache_get_stats(drm_dev, &stats);
+	lookups = stats.hits + stats.misses;
+
+	seq_printf(m, "hits\t\t%lu\n", stats.hits);
+	seq_printf(m, "misses\t\t%lu\n", stats.misses);
+	seq_printf(m, "hit rate\t%lu%%\n",
+			lookups ? stats.hits * 100 / lookups : 0);
+	seq_printf(m, "evictions\t%lu\n", stats.evictions);
+	seq_printf(m, "shrunk pages\t%lu\n", stats.shrunk);
+	seq_printf(m, "cached\t\t%u buffers, %lu bytes\n",
+			stats.cached_count, stats.cached_bytes);
+	seq_printf(m, "limit\t\t%lu bytes\n", stats.max_bytes);
+
+	return 0;
+}
+
+static int exynos_drm_debugfs_ipp_stats(struct seq_file *m, void *data)
+{
+	exynos_drm_ipp_show_stats(m);
+
+	return 0;
+}
+
 static struct drm_info_list exynos_drm_debugfs_list[] = {
 	{"gem_info", exynos_drm_debugfs_gem_info, DRIVER_GEM},
+	{"buf_cache", exynos_drm_debugfs_buf_cache, DRIVER_GEM},
+	{"ipp_stats", exynos_drm_debugfs_ipp_stats, 0},
 };
 #define EXYNOS_DRM_DEBUGFS_ENTRIES ARRAY_SIZE(exynos_drm_debugfs_list)
 
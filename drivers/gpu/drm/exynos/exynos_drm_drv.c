@@ -29,6 +29,8 @@
 #include "drm.h"
 #include "drm_crtc_helper.h"
 
+#include <linux/sw_sync.h>
+
 #include <drm/exynos_drm.h>
 
 #include "exynos_drm_drv.h"
@@ -37,9 +39,11 @@
 #include "exynos_drm_fbdev.h"
 #include "exynos_drm_fb.h"
 #include "exynos_drm_gem.h"
+#include "exynos_drm_buf.h"
 #include "exynos_drm_ipp.h"
 #include "exynos_drm_plane.h"
 #include "exynos_drm_vidi.h"
+#include "exynos_drm_atomic.h"
 #include "exynos_drm_dmabuf.h"
 #include "exynos_drm_iommu.h"
 #include "exynos_drm_debugfs.h"
@@ -67,6 +71,7 @@ static int exynos_drm_load(struct drm_device *dev, unsigned long flags)
 	}
 
 	INIT_LIST_HEAD(&private->pageflip_event_list);
+	init_waitqueue_head(&private->atomic_wait);
 	dev->dev_private = (void *)private;
 
 	/*
@@ -81,6 +86,12 @@ static int exynos_drm_load(struct drm_device *dev, unsigned long flags)
 		goto err_crtc;
 	}
 
+	ret = exynos_drm_buf_cache_init(dev);
+	if (ret < 0) {
+		DRM_ERROR("failed to initialize buffer cache.\n");
+		goto err_release_iommu_mapping;
+	}
+
 	drm_mode_config_init(dev);
 
 	/* init kms poll for handling hpd */
@@ -142,6 +153,7 @@ err_drm_device:
 err_vblank:
 	drm_vblank_cleanup(dev);
 err_release_iommu_mapping:
+	exynos_drm_buf_cache_fini(dev);
 	drm_release_iommu_mapping(dev);
 err_crtc:
 	drm_mode_config_cleanup(dev);
@@ -152,14 +164,22 @@ err_crtc:
 
 static int exynos_drm_unload(struct drm_device *dev)
 {
+	struct exynos_drm_private *private = dev->dev_private;
+	int nr;
+
 	DRM_DEBUG_DRIVER("%s\n", __FILE__);
 
+	for (nr = 0; nr < MAX_CRTC; nr++)
+		if (private->atomic_timeline[nr])
+			sync_timeline_destroy(&private->atomic_timeline[nr]->obj);
+
 	exynos_drm_fbdev_fini(dev);
 	exynos_drm_device_unregister(dev);
 	drm_vblank_cleanup(dev);
 	drm_kms_helper_poll_fini(dev);
 	drm_mode_config_cleanup(dev);
 
+	exynos_drm_buf_cache_fini(dev);
 	drm_release_iommu_mapping(dev);
 	kfree(dev->dev_private);
 
@@ -198,6 +218,7 @@ static void exynos_drm_preclose(struct drm_device *dev,
 {
 	struct exynos_drm_private *private = dev->dev_private;
 	struct drm_pending_vblank_event *e, *t;
+	struct drm_crtc *crtc;
 	unsigned long flags;
 
 	DRM_DEBUG_DRIVER("%s\n", __FILE__);
@@ -211,6 +232,9 @@ static void exynos_drm_preclose(struct drm_device *dev,
 			e->base.destroy(&e->base);
 		}
 	}
+	list_for_each_entry(crtc, &dev->mode_config.crtc_list, head)
+		exynos_drm_crtc_release_events(crtc, file);
+	exynos_drm_atomic_release_events(dev, file);
 	drm_prime_destroy_file_private(&file->prime);
 	spin_unlock_irqrestore(&dev->event_lock, flags);
 
@@ -248,12 +272,17 @@ static struct drm_ioctl_desc exynos_ioctls[] = {
 			exynos_drm_gem_map_offset_ioctl, DRM_UNLOCKED),
 	DRM_IOCTL_DEF_DRV(EXYNOS_GEM_MMAP,
 			exynos_drm_gem_mmap_ioctl, DRM_UNLOCKED),
+	DRM_IOCTL_DEF_DRV(EXYNOS_GEM_USERPTR,
+			exynos_drm_gem_userptr_ioctl, DRM_UNLOCKED),
 	DRM_IOCTL_DEF_DRV(EXYNOS_GEM_GET,
 			exynos_drm_gem_get_ioctl, DRM_UNLOCKED),
 	DRM_IOCTL_DEF_DRV(EXYNOS_GEM_CACHE_OP,
 			exynos_drm_gem_cache_op_ioctl, DRM_UNLOCKED),
 	DRM_IOCTL_DEF_DRV(EXYNOS_VIDI_CONNECTION,
 			vidi_connection_ioctl, DRM_UNLOCKED | DRM_AUTH),
+	DRM_IOCTL_DEF_DRV(EXYNOS_ATOMIC_COMMIT,
+			exynos_drm_atomic_commit_ioctl,
+			DRM_UNLOCKED | DRM_AUTH | DRM_MASTER),
 	DRM_IOCTL_DEF_DRV(EXYNOS_IPP_GET_PROPERTY,
 			exynos_drm_ipp_get_property, DRM_UNLOCKED | DRM_AUTH),
 	DRM_IOCTL_DEF_DRV(EXYNOS_IPP_SET_PROPERTY,
@@ -380,6 +409,12 @@ static int __init exynos_drm_init(void)
 		goto out_sc;
 #endif
 
+#ifdef CONFIG_DRM_EXYNOS_IPP_SW
+	ret = platform_driver_register(&ipp_sw_driver);
+	if (ret < 0)
+		goto out_ipp_sw;
+#endif
+
 #ifdef CONFIG_DRM_EXYNOS_IPP
 	ret = platform_driver_register(&ipp_driver);
 	if (ret < 0)
@@ -409,6 +444,11 @@ out_dbg:
 out_ipp:
 #endif
 
+#ifdef CONFIG_DRM_EXYNOS_IPP_SW
+	platform_driver_unregister(&ipp_sw_driver);
+out_ipp_sw:
+#endif
+
 #ifdef CONFIG_DRM_EXYNOS_SC
 	platform_driver_unregister(&sc_driver);
 out_sc:
@@ -454,6 +494,10 @@ static void __exit exynos_drm_exit(void)
 	platform_driver_unregister(&ipp_driver);
 #endif
 
+#ifdef CONFIG_DRM_EXYNOS_IPP_SW
+	platform_driver_unregister(&ipp_sw_driver);
+#endif
+
 #ifdef CONFIG_DRM_EXYNOS_SC
 	platform_driver_unregister(&sc_driver);
 #endif
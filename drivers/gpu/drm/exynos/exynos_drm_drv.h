@@ -54,6 +54,9 @@
 struct drm_device;
 struct exynos_drm_overlay;
 struct drm_connector;
+struct exynos_drm_atomic_commit;
+struct sw_sync_timeline;
+struct exynos_drm_buf_cache;
 
 extern unsigned int drm_vblank_offdelay;
 
@@ -201,6 +204,10 @@ struct exynos_drm_display_ops {
  * @disable_vblank: specific driver callback for disabling vblank interrupt.
  * @wait_for_vblank: wait for vblank interrupt to make sure that
  *	hardware overlay is updated.
+ * @atomic_begin: hold back the overlay registers written from now on
+ *	from being latched at vsync.
+ * @atomic_flush: release the overlay registers held back since
+ *	atomic_begin so that they are all latched at the same vsync.
  */
 struct exynos_drm_manager_ops {
 	int (*initialize)(struct device *dev, struct drm_device *drm_dev, int pipe);
@@ -220,6 +227,8 @@ struct exynos_drm_manager_ops {
 	void (*disable_vblank)(struct device *subdrv_dev);
 	void (*wait_for_vblank)(struct device *subdrv_dev);
 	int (*set_runtime_activate)(struct device *dev);
+	void (*atomic_begin)(struct device *subdrv_dev);
+	void (*atomic_flush)(struct device *subdrv_dev);
 };
 
 /*
@@ -274,6 +283,11 @@ struct drm_exynos_file_private {
  * @da_space_size: size of device address space.
  *	if 0 then default value is used for it.
  * @da_space_order: order to device address space.
+ * @atomic_commit: atomic commit in flight per crtc, protected by
+ *	dev->event_lock.
+ * @atomic_wait: wait queue for a crtc to be done with its atomic commit.
+ * @atomic_timeline: timeline of the out-fences of atomic commits per crtc.
+ * @atomic_timeline_max: value of the last out-fence created per crtc.
  */
 struct exynos_drm_private {
 	struct drm_fb_helper *fb_helper;
@@ -293,6 +307,13 @@ struct exynos_drm_private {
 	unsigned long da_start;
 	unsigned long da_space_size;
 	unsigned long da_space_order;
+
+	struct exynos_drm_atomic_commit *atomic_commit[MAX_CRTC];
+	wait_queue_head_t atomic_wait;
+	struct sw_sync_timeline *atomic_timeline[MAX_CRTC];
+	u32 atomic_timeline_max[MAX_CRTC];
+
+	struct exynos_drm_buf_cache *buf_cache;
 };
 
 /*
@@ -363,6 +384,7 @@ extern struct platform_driver exynos_drm_common_hdmi_driver;
 extern struct platform_driver vidi_driver;
 extern struct platform_driver gsc_driver;
 extern struct platform_driver sc_driver;
+extern struct platform_driver ipp_sw_driver;
 extern struct platform_driver ipp_driver;
 extern struct platform_driver dbg_driver;
 #endif
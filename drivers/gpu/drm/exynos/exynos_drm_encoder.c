@@ -455,6 +455,28 @@ void exynos_drm_disable_vblank(struct drm_encoder *encoder, void *data)
 		manager_ops->disable_vblank(manager->dev);
 }
 
+void exynos_drm_encoder_crtc_atomic_begin(struct drm_encoder *encoder,
+					  void *data)
+{
+	struct exynos_drm_manager *manager =
+		to_exynos_encoder(encoder)->manager;
+	struct exynos_drm_manager_ops *manager_ops = manager->ops;
+
+	if (manager_ops && manager_ops->atomic_begin)
+		manager_ops->atomic_begin(manager->dev);
+}
+
+void exynos_drm_encoder_crtc_atomic_flush(struct drm_encoder *encoder,
+					  void *data)
+{
+	struct exynos_drm_manager *manager =
+		to_exynos_encoder(encoder)->manager;
+	struct exynos_drm_manager_ops *manager_ops = manager->ops;
+
+	if (manager_ops && manager_ops->atomic_flush)
+		manager_ops->atomic_flush(manager->dev);
+}
+
 void exynos_drm_encoder_crtc_dpms(struct drm_encoder *encoder, void *data)
 {
 	struct exynos_drm_encoder *exynos_encoder = to_exynos_encoder(encoder);
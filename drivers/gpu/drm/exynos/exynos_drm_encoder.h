@@ -41,6 +41,10 @@ void exynos_drm_fn_encoder(struct drm_crtc *crtc, void *data,
 void exynos_drm_prepare_vblank(struct drm_encoder *encoder, void *data);
 void exynos_drm_enable_vblank(struct drm_encoder *encoder, void *data);
 void exynos_drm_disable_vblank(struct drm_encoder *encoder, void *data);
+void exynos_drm_encoder_crtc_atomic_begin(struct drm_encoder *encoder,
+					  void *data);
+void exynos_drm_encoder_crtc_atomic_flush(struct drm_encoder *encoder,
+					  void *data);
 void exynos_drm_encoder_crtc_dpms(struct drm_encoder *encoder, void *data);
 void exynos_drm_encoder_crtc_pipe(struct drm_encoder *encoder, void *data);
 void exynos_drm_encoder_plane_mode_set(struct drm_encoder *encoder, void *data);
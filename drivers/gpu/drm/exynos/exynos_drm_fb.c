@@ -522,6 +522,23 @@ struct exynos_drm_gem_buf *exynos_drm_fb_buffer(struct drm_framebuffer *fb,
 	return buffer;
 }
 
+struct dma_buf *exynos_drm_fb_dma_buf(struct drm_framebuffer *fb, int index)
+{
+	struct exynos_drm_fb *exynos_fb = to_exynos_fb(fb);
+	struct drm_gem_object *obj;
+
+	if (index >= MAX_FB_BUFFER || !exynos_fb->exynos_gem_obj[index])
+		return NULL;
+
+	obj = &exynos_fb->exynos_gem_obj[index]->base;
+
+	/* imported buffers carry the fences of their exporter. */
+	if (obj->import_attach)
+		return obj->import_attach->dmabuf;
+
+	return obj->export_dma_buf;
+}
+
 static void exynos_drm_output_poll_changed(struct drm_device *dev)
 {
 	struct exynos_drm_private *private = dev->dev_private;
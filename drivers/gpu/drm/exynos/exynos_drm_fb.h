@@ -59,6 +59,9 @@ exynos_drm_framebuffer_init(struct drm_device *dev,
 struct exynos_drm_gem_buf *exynos_drm_fb_buffer(struct drm_framebuffer *fb,
 						 int index);
 
+/* get the dma-buf of a buffer of a drm framebuffer, if shared. */
+struct dma_buf *exynos_drm_fb_dma_buf(struct drm_framebuffer *fb, int index);
+
 void exynos_drm_mode_config_init(struct drm_device *dev);
 
 /* set a buffer count to drm framebuffer. */
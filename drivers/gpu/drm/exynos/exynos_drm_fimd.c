@@ -206,6 +206,7 @@ struct fimd_context {
 	atomic_t			partial_requested;
 	spinlock_t			win_updated_lock;
 	bool				pm_gating_on;
+	bool				atomic_update;
 	int	(*smies_on)(struct device *smies);
 	int	(*smies_off)(struct device *smies);
 	int	(*smies_mode)(struct device *smies, int mode);
@@ -1310,6 +1311,52 @@ static void fimd_subdrv_remove(struct drm_device *drm_dev, struct device *dev)
 	/* TODO. */
 }
 
+static void fimd_atomic_begin(struct device *dev)
+{
+	struct fimd_context *ctx = get_fimd_context(dev);
+	unsigned long val;
+	int win;
+
+	DRM_DEBUG_KMS("%s\n", __FILE__);
+
+	if (ctx->i80_if)
+		fimd_prepare_i80_access(ctx, __func__);
+
+	if (fimd_get_dpms(ctx, 0) > 0)
+		return;
+
+	/*
+	 * protect all windows at once, so the registers of every window
+	 * updated until fimd_atomic_flush() are latched at the same vsync.
+	 */
+	val = readl(ctx->regs + SHADOWCON);
+	for (win = 0; win < WINDOWS_NR; win++)
+		val |= SHADOWCON_WINx_PROTECT(win);
+	writel(val, ctx->regs + SHADOWCON);
+
+	ctx->atomic_update = true;
+}
+
+static void fimd_atomic_flush(struct device *dev)
+{
+	struct fimd_context *ctx = get_fimd_context(dev);
+	unsigned long val;
+	int win;
+
+	DRM_DEBUG_KMS("%s\n", __FILE__);
+
+	if (!ctx->atomic_update)
+		return;
+
+	ctx->atomic_update = false;
+
+	/* unprotect windows */
+	val = readl(ctx->regs + SHADOWCON);
+	for (win = 0; win < WINDOWS_NR; win++)
+		val &= ~SHADOWCON_WINx_PROTECT(win);
+	writel(val, ctx->regs + SHADOWCON);
+}
+
 static struct exynos_drm_manager_ops fimd_manager_ops = {
 	.dpms = fimd_dpms,
 	.apply = fimd_apply,
@@ -1318,6 +1365,8 @@ static struct exynos_drm_manager_ops fimd_manager_ops = {
 	.enable_vblank = fimd_enable_vblank,
 	.disable_vblank = fimd_disable_vblank,
 	.wait_for_vblank = fimd_wait_for_completed_signal,
+	.atomic_begin = fimd_atomic_begin,
+	.atomic_flush = fimd_atomic_flush,
 };
 
 static void fimd_win_mode_set(struct device *dev,
@@ -1590,6 +1639,10 @@ static inline void fimd_win_shadow_ctrl(struct fimd_context *ctx,
 		}
 	}
 
+	/* windows stay protected until fimd_atomic_flush(). */
+	if (ctx->atomic_update)
+		val |= SHADOWCON_WINx_PROTECT(win);
+
 	writel(val, ctx->regs + SHADOWCON);
 }
 
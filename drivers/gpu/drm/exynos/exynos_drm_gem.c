@@ -35,6 +35,7 @@
 #include "exynos_drm_drv.h"
 #include "exynos_drm_gem.h"
 #include "exynos_drm_buf.h"
+#include "exynos_drm_iommu.h"
 
 static unsigned int convert_to_vm_err_msg(int msg)
 {
@@ -155,6 +156,26 @@ static int exynos_drm_gem_handle_create(struct drm_gem_object *obj,
 	return 0;
 }
 
+static void exynos_drm_gem_put_userptr(struct exynos_drm_gem_obj *exynos_gem_obj)
+{
+	struct drm_device *dev = exynos_gem_obj->base.dev;
+	struct exynos_drm_gem_buf *buf = exynos_gem_obj->buffer;
+
+	exynos_gem_unmap_sgt_from_dma(dev, buf->sgt, DMA_BIDIRECTIONAL);
+	sg_free_table(buf->sgt);
+	kfree(buf->sgt);
+	buf->sgt = NULL;
+
+	exynos_gem_put_pages_to_userptr(buf->pages, buf->size >> PAGE_SHIFT,
+					exynos_gem_obj->vma);
+	exynos_gem_put_vma(exynos_gem_obj->vma);
+	exynos_gem_obj->vma = NULL;
+
+	drm_free_large(buf->pages);
+	buf->pages = NULL;
+	buf->dma_addr = (dma_addr_t)NULL;
+}
+
 void exynos_drm_gem_destroy(struct exynos_drm_gem_obj *exynos_gem_obj)
 {
 	struct drm_gem_object *obj;
@@ -176,6 +197,12 @@ void exynos_drm_gem_destroy(struct exynos_drm_gem_obj *exynos_gem_obj)
 	if (obj->import_attach)
 		goto out;
 
+	/* user pages are unpinned rather than freed. */
+	if (buf->userptr) {
+		exynos_drm_gem_put_userptr(exynos_gem_obj);
+		goto out;
+	}
+
 	exynos_drm_free_buf(obj->dev, exynos_gem_obj->flags, buf);
 
 out:
@@ -481,6 +508,10 @@ static int exynos_drm_gem_mmap_buffer(struct file *filp,
 	if (vm_size > buffer->size)
 		return -EINVAL;
 
+	/* the memory region from userptr is already mapped by its owner. */
+	if (buffer->userptr)
+		return -EINVAL;
+
 	if (exynos_gem_obj->flags & EXYNOS_BO_CACHABLE)
 		dma_set_attr(DMA_ATTR_NON_CONSISTENT, &buffer->dma_attrs);
 
@@ -617,6 +648,147 @@ int exynos_drm_gem_get_ioctl(struct drm_device *dev, void *data,
 	return 0;
 }
 
+int exynos_drm_gem_userptr_ioctl(struct drm_device *dev, void *data,
+				      struct drm_file *file_priv)
+{
+	struct drm_exynos_gem_userptr *args = data;
+	struct exynos_drm_gem_obj *exynos_gem_obj;
+	struct exynos_drm_gem_buf *buf;
+	struct vm_area_struct *vma;
+	unsigned long userptr = args->userptr;
+	unsigned long size = args->size;
+	unsigned int npages;
+	int ret;
+
+	DRM_DEBUG_KMS("%s\n", __FILE__);
+
+	if (!size || userptr != args->userptr || size != args->size ||
+			(userptr | size) & ~PAGE_MASK ||
+			userptr + size < userptr) {
+		DRM_ERROR("invalid userptr(0x%llx) or size(0x%llx).\n",
+				args->userptr, args->size);
+		return -EINVAL;
+	}
+
+	if (args->flags & ~EXYNOS_BO_CACHABLE) {
+		DRM_ERROR("invalid flags.\n");
+		return -EINVAL;
+	}
+
+	npages = size >> PAGE_SHIFT;
+
+	buf = exynos_drm_init_buf(dev, size);
+	if (!buf)
+		return -ENOMEM;
+
+	buf->pages = drm_calloc_large(npages, sizeof(struct page *));
+	if (!buf->pages) {
+		DRM_ERROR("failed to allocate pages.\n");
+		ret = -ENOMEM;
+		goto err_fini_buf;
+	}
+
+	exynos_gem_obj = exynos_drm_gem_init(dev, size);
+	if (!exynos_gem_obj) {
+		ret = -ENOMEM;
+		goto err_free_pages;
+	}
+
+	exynos_gem_obj->packed_size = size;
+	exynos_gem_obj->buffer = buf;
+	exynos_gem_obj->flags = args->flags | EXYNOS_BO_NONCONTIG;
+
+	/*
+	 * the whole region has to belong to one vma, a copy of which is
+	 * kept to release the pages the same way they were taken.
+	 */
+	down_read(&current->mm->mmap_sem);
+
+	vma = find_vma(current->mm, userptr);
+	if (!vma || vma->vm_start > userptr || vma->vm_end < userptr + size) {
+		DRM_ERROR("invalid userptr region.\n");
+		up_read(&current->mm->mmap_sem);
+		ret = -EFAULT;
+		goto err_release_gem;
+	}
+
+	exynos_gem_obj->vma = exynos_gem_get_vma(vma);
+	if (!exynos_gem_obj->vma) {
+		up_read(&current->mm->mmap_sem);
+		ret = -ENOMEM;
+		goto err_release_gem;
+	}
+
+	buf->pfnmap = vma_is_io(vma);
+
+	ret = exynos_gem_get_pages_from_userptr(userptr, npages, buf->pages,
+						vma);
+	up_read(&current->mm->mmap_sem);
+	if (ret < 0)
+		goto err_put_vma;
+
+	buf->sgt = kzalloc(sizeof(*buf->sgt), GFP_KERNEL);
+	if (!buf->sgt) {
+		ret = -ENOMEM;
+		goto err_put_pages;
+	}
+
+	ret = sg_alloc_table_from_pages(buf->sgt, buf->pages, npages, 0,
+					size, GFP_KERNEL);
+	if (ret < 0) {
+		DRM_ERROR("failed to get sg table.\n");
+		goto err_free_sgt;
+	}
+
+	/* without iommu, dma can only reach physically contiguous pages. */
+	if (!is_drm_iommu_supported(dev) && buf->sgt->nents != 1) {
+		DRM_ERROR("userptr region is not contiguous.\n");
+		ret = -EINVAL;
+		goto err_free_table;
+	}
+
+	/* with iommu, the pages get one contiguous device address range. */
+	ret = exynos_gem_map_sgt_with_dma(dev, buf->sgt, DMA_BIDIRECTIONAL);
+	if (ret < 0)
+		goto err_free_table;
+
+	buf->userptr = userptr;
+	buf->write = 1;
+	buf->dma_addr = sg_dma_address(buf->sgt->sgl);
+
+	DRM_DEBUG_KMS("userptr(0x%lx), dma_addr(0x%lx), size(0x%lx)\n",
+			userptr, (unsigned long)buf->dma_addr, size);
+
+	ret = exynos_drm_gem_handle_create(&exynos_gem_obj->base, file_priv,
+			&args->handle);
+	if (ret) {
+		exynos_drm_gem_destroy(exynos_gem_obj);
+		return ret;
+	}
+
+	return 0;
+
+err_free_table:
+	sg_free_table(buf->sgt);
+err_free_sgt:
+	kfree(buf->sgt);
+	buf->sgt = NULL;
+err_put_pages:
+	exynos_gem_put_pages_to_userptr(buf->pages, npages,
+					exynos_gem_obj->vma);
+err_put_vma:
+	exynos_gem_put_vma(exynos_gem_obj->vma);
+	exynos_gem_obj->vma = NULL;
+err_release_gem:
+	drm_gem_object_release(&exynos_gem_obj->base);
+	kfree(exynos_gem_obj);
+err_free_pages:
+	drm_free_large(buf->pages);
+err_fini_buf:
+	exynos_drm_fini_buf(dev, buf);
+	return ret;
+}
+
 static int exynos_gem_l1_cache_ops(struct drm_device *drm_dev,
 					struct drm_exynos_gem_cache_op *op) {
 	if (op->flags & EXYNOS_DRM_CACHE_FSH_ALL) {
@@ -867,7 +1039,7 @@ int exynos_gem_map_sgt_with_dma(struct drm_device *drm_dev,
 	if (!nents) {
 		DRM_ERROR("failed to map sgl with dma.\n");
 		mutex_unlock(&drm_dev->struct_mutex);
-		return nents;
+		return -ENOMEM;
 	}
 
 	mutex_unlock(&drm_dev->struct_mutex);
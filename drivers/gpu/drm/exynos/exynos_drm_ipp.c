@@ -17,6 +17,10 @@
 #include <linux/types.h>
 #include <linux/clk.h>
 #include <linux/pm_runtime.h>
+#include <linux/file.h>
+#include <linux/math64.h>
+#include <linux/seq_file.h>
+#include <linux/sw_sync.h>
 #include <plat/map-base.h>
 
 #include <drm/drmP.h>
@@ -68,6 +72,10 @@ struct drm_exynos_ipp_send_event {
  * @buf_id: id of buffer.
  * @buf_info: gem objects and dma address, size.
  * @filp: a pointer to drm_file.
+ * @in_fence: fence to wait for before the buffer is used.
+ * @out_seqno: timeline value signaled when the job writing to the buffer
+ *	is done, 0 without out-fence.
+ * @queued: queueing time of the buffer.
  */
 struct drm_exynos_ipp_mem_node {
 	struct list_head	list;
@@ -76,6 +84,9 @@ struct drm_exynos_ipp_mem_node {
 	u32	buf_id;
 	struct drm_exynos_ipp_buf_info	buf_info;
 	struct drm_file		*filp;
+	struct sync_fence	*in_fence;
+	u32	out_seqno;
+	ktime_t	queued;
 };
 
 /*
@@ -152,6 +163,8 @@ static int ipp_stop_property(struct drm_device *drm_dev,
 		struct drm_exynos_ipp_cmd_node *c_node);
 static int ipp_send_event(struct exynos_drm_ippdrv *ippdrv,
 		struct drm_exynos_ipp_cmd_node *c_node, int *buf_id);
+static void ipp_pipeline_kick(struct exynos_drm_ippdrv *ippdrv,
+		struct drm_exynos_ipp_cmd_node *c_node, bool job_done);
 
 int exynos_drm_ippdrv_register(struct exynos_drm_ippdrv *ippdrv)
 {
@@ -160,6 +173,8 @@ int exynos_drm_ippdrv_register(struct exynos_drm_ippdrv *ippdrv)
 	if (!ippdrv)
 		return -EINVAL;
 
+	spin_lock_init(&ippdrv->stats.lock);
+
 	mutex_lock(&exynos_drm_ippdrv_lock);
 	list_add(&ippdrv->drv_list, &exynos_drm_ippdrv_list);
 	mutex_unlock(&exynos_drm_ippdrv_lock);
@@ -752,6 +767,36 @@ static struct drm_exynos_ipp_event_info *ipp_create_event_info(void)
 	return event;
 }
 
+static void ipp_fence_cb(struct sync_fence *fence,
+		struct sync_fence_waiter *waiter)
+{
+	struct drm_exynos_ipp_cmd_node *c_node = container_of(waiter,
+		struct drm_exynos_ipp_cmd_node, waiter);
+
+	/* called from the signaling context, run the pipeline later. */
+	queue_work(c_node->cmd_workq, &c_node->fence_work);
+}
+
+static void ipp_fence_work(struct work_struct *work)
+{
+	struct drm_exynos_ipp_cmd_node *c_node = container_of(work,
+		struct drm_exynos_ipp_cmd_node, fence_work);
+	struct exynos_drm_ippdrv *ippdrv;
+
+	mutex_lock(&c_node->mem_lock);
+	c_node->wait_fence = NULL;
+	mutex_unlock(&c_node->mem_lock);
+
+	ippdrv = ipp_find_drv_by_handle(c_node->property.prop_id);
+	if (IS_ERR(ippdrv)) {
+		DRM_DEBUG_KMS("%s:no ipp driver for prop_id[%d]\n",
+			__func__, c_node->property.prop_id);
+		return;
+	}
+
+	ipp_pipeline_kick(ippdrv, c_node, false);
+}
+
 int exynos_drm_ipp_set_property(struct drm_device *drm_dev, void *data,
 		struct drm_file *file)
 {
@@ -794,6 +839,17 @@ int exynos_drm_ipp_set_property(struct drm_device *drm_dev, void *data,
 		return ipp_find_and_set_property(property);
 	}
 
+	/*
+	 * pipelined jobs are started from the completion of the previous
+	 * one, which only the event driven m2m path supports.
+	 */
+	if (ipp_is_pipelined(property) &&
+	    (!ipp_is_m2m_cmd(property->cmd) ||
+	     !(property->type & IPP_EVENT_DRIVEN))) {
+		DRM_ERROR("pipelined type needs event driven m2m.\n");
+		return -EINVAL;
+	}
+
 	/* find ipp driver using ipp id */
 	ippdrv = ipp_find_driver(ctx, property);
 	if (IS_ERR_OR_NULL(ippdrv)) {
@@ -801,6 +857,15 @@ int exynos_drm_ipp_set_property(struct drm_device *drm_dev, void *data,
 		return -EINVAL;
 	}
 
+	/*
+	 * pipelined jobs keep the hardware programmed between jobs,
+	 * so they can't share the driver with other command nodes.
+	 */
+	if (ipp_is_pipelined(property) && ipp_get_link_count(ippdrv)) {
+		DRM_ERROR("ipp driver is busy for pipelined type.\n");
+		return -EBUSY;
+	}
+
 	/* allocate command node */
 	c_node = kzalloc(sizeof(*c_node), GFP_KERNEL);
 	if (!c_node) {
@@ -852,6 +917,7 @@ int exynos_drm_ipp_set_property(struct drm_device *drm_dev, void *data,
 		}
 
 		init_completion(&c_node->stop_complete);
+		INIT_WORK(&c_node->fence_work, ipp_fence_work);
 	}
 
 	c_node->event = ipp_create_event_info();
@@ -872,8 +938,8 @@ int exynos_drm_ipp_set_property(struct drm_device *drm_dev, void *data,
 	list_splice_init(&priv->event_list, &c_node->event_list);
 	list_add_tail(&c_node->list, &ippdrv->cmd_list);
 
-	/* make dedicated state without m2m */
-	if (!ipp_is_m2m_cmd(property->cmd))
+	/* make dedicated state without m2m or for pipelined m2m */
+	if (!ipp_is_m2m_cmd(property->cmd) || ipp_is_pipelined(property))
 		ippdrv->dedicated = true;
 
 #ifdef CONFIG_DRM_EXYNOS_IPP_TC
@@ -923,11 +989,7 @@ static void ipp_clean_cmd_node(struct ipp_context *ctx,
 	ipp_remove_id(&ctx->prop_idr, &ctx->prop_lock,
 		property->prop_id);
 
-	/* destroy mutex */
-	mutex_destroy(&c_node->cmd_lock);
-	mutex_destroy(&c_node->mem_lock);
-	mutex_destroy(&c_node->event_lock);
-
+	/* queued fence work takes mem_lock: flush it before the mutexes go */
 	if (property->type & IPP_EVENT_DRIVEN) {
 		destroy_workqueue(c_node->cmd_workq);
 
@@ -936,6 +998,14 @@ static void ipp_clean_cmd_node(struct ipp_context *ctx,
 		kfree(c_node->stop_work);
 	}
 
+	/* destroy mutex */
+	mutex_destroy(&c_node->cmd_lock);
+	mutex_destroy(&c_node->mem_lock);
+	mutex_destroy(&c_node->event_lock);
+
+	if (c_node->timeline)
+		sync_timeline_destroy(&c_node->timeline->obj);
+
 	kfree(c_node->event);
 	kfree(c_node);
 }
@@ -1057,24 +1127,75 @@ static int ipp_set_mem_node(struct exynos_drm_ippdrv *ippdrv,
 	return ret;
 }
 
+static struct sync_fence *ipp_create_out_fence(
+		struct drm_exynos_ipp_cmd_node *c_node,
+		struct drm_exynos_ipp_mem_node *m_node)
+{
+	struct sync_fence *fence;
+	struct sync_pt *pt;
+	char name[IPP_STR_LEN];
+
+	if (!c_node->timeline) {
+		snprintf(name, IPP_STR_LEN, "ipp_%d", c_node->property.prop_id);
+		c_node->timeline = sw_sync_timeline_create(name);
+		if (!c_node->timeline)
+			return NULL;
+	}
+
+	pt = sw_sync_pt_create(c_node->timeline, c_node->timeline_max + 1);
+	if (!pt)
+		return NULL;
+
+	fence = sync_fence_create("exynos-ipp", pt);
+	if (!fence) {
+		sync_pt_free(pt);
+		return NULL;
+	}
+
+	m_node->out_seqno = ++c_node->timeline_max;
+
+	return fence;
+}
+
+/*
+ * signal the out-fences up to value, with error if it is not 0.
+ * called with mem_lock held.
+ */
+static void ipp_signal_out_fence(struct drm_exynos_ipp_cmd_node *c_node,
+		u32 value, int error)
+{
+	struct sw_sync_timeline *timeline = c_node->timeline;
+
+	if (!timeline || (int)(value - timeline->value) <= 0)
+		return;
+
+	if (error)
+		sw_sync_timeline_fail(timeline, value - timeline->value, error);
+	else
+		sw_sync_timeline_inc(timeline, value - timeline->value);
+}
+
 static struct drm_exynos_ipp_mem_node
 		*ipp_get_mem_node(struct drm_device *drm_dev,
 		struct drm_file *file,
 		struct drm_exynos_ipp_cmd_node *c_node,
-		struct drm_exynos_ipp_queue_buf *qbuf)
+		struct drm_exynos_ipp_queue_buf *qbuf,
+		struct sync_fence **out_fence)
 {
 	struct drm_exynos_ipp_mem_node *m_node;
 	struct drm_exynos_ipp_buf_info buf_info;
+	struct drm_gem_object *obj;
 	void *addr;
 	unsigned long size;
 	int protect = c_node->property.protect, i;
+	int ret = -EFAULT;
 
 	DRM_DEBUG_KMS("%s\n", __func__);
 
 	m_node = kzalloc(sizeof(*m_node), GFP_KERNEL);
 	if (!m_node) {
 		DRM_ERROR("failed to allocate queue node.\n");
-		goto err_unlock;
+		return ERR_PTR(-ENOMEM);
 	}
 
 	/* clear base address for error handling */
@@ -1090,6 +1211,15 @@ static struct drm_exynos_ipp_mem_node
 	DRM_DEBUG_KMS("%s:prop_id[%d]buf_id[%d]\n", __func__,
 		qbuf->prop_id, m_node->buf_id);
 
+	if (qbuf->flags & IPP_BUF_FLAG_IN_FENCE) {
+		m_node->in_fence = sync_fence_fdget(qbuf->fence);
+		if (!m_node->in_fence) {
+			DRM_ERROR("failed to get in-fence[%d]\n", qbuf->fence);
+			ret = -EINVAL;
+			goto err_free;
+		}
+	}
+
 	for_each_ipp_planar(i) {
 		DRM_DEBUG_KMS("%s:i[%d]handle[0x%x]\n", __func__,
 			i, qbuf->handle[i]);
@@ -1106,17 +1236,25 @@ static struct drm_exynos_ipp_mem_node
 			if (IS_ERR_OR_NULL(addr)) {
 				DRM_ERROR("protect[%d]:failed to get addr.\n",
 					protect);
-				goto err_clear;
+				goto err_put_addr;
 			}
+			buf_info.handles[i] = qbuf->handle[i];
 
 			size = exynos_drm_gem_get_size(drm_dev,
 						qbuf->handle[i], file);
 			if (!size) {
 				DRM_ERROR("failed to get size.\n");
-				goto err_clear;
+				goto err_put_addr;
+			}
+
+			/* the reference is held by the dma address above */
+			obj = drm_gem_object_lookup(drm_dev, file,
+				qbuf->handle[i]);
+			if (obj) {
+				buf_info.obj[i] = to_exynos_gem_obj(obj);
+				drm_gem_object_unreference_unlocked(obj);
 			}
 
-			buf_info.handles[i] = qbuf->handle[i];
 			buf_info.base[i] = protect ?
 				(dma_addr_t) addr : *(dma_addr_t *) addr;
 			buf_info.size[i] = (uint64_t) size;
@@ -1129,17 +1267,37 @@ static struct drm_exynos_ipp_mem_node
 
 	m_node->filp = file;
 	m_node->buf_info = buf_info;
+	m_node->queued = ktime_get();
+
 	mutex_lock(&c_node->mem_lock);
+	/*
+	 * out-fence values must follow the queue order of the buffers,
+	 * so create it together with the list insertion.
+	 */
+	if (qbuf->flags & IPP_BUF_FLAG_OUT_FENCE) {
+		*out_fence = ipp_create_out_fence(c_node, m_node);
+		if (!*out_fence) {
+			mutex_unlock(&c_node->mem_lock);
+			DRM_ERROR("failed to create out-fence.\n");
+			ret = -ENOMEM;
+			goto err_put_addr;
+		}
+	}
 	list_add_tail(&m_node->list, &c_node->mem_list[qbuf->ops_id]);
 	mutex_unlock(&c_node->mem_lock);
 
 	return m_node;
 
-err_clear:
+err_put_addr:
+	for_each_ipp_planar(i)
+		if (buf_info.handles[i])
+			exynos_drm_gem_put_dma_addr(drm_dev,
+				buf_info.handles[i], file);
+	if (m_node->in_fence)
+		sync_fence_put(m_node->in_fence);
+err_free:
 	kfree(m_node);
-err_unlock:
-	mutex_unlock(&c_node->mem_lock);
-	return ERR_PTR(-EFAULT);
+	return ERR_PTR(ret);
 }
 
 static int ipp_put_mem_node(struct drm_device *drm_dev,
@@ -1172,6 +1330,17 @@ static int ipp_put_mem_node(struct drm_device *drm_dev,
 		}
 	}
 
+	if (m_node->in_fence) {
+		/*
+		 * if the waiter is already off the fence, its callback is
+		 * pending and ipp_fence_work clears wait_fence.
+		 */
+		if (c_node->wait_fence == m_node->in_fence &&
+		    !sync_fence_cancel_async(m_node->in_fence, &c_node->waiter))
+			c_node->wait_fence = NULL;
+		sync_fence_put(m_node->in_fence);
+	}
+
 	/* delete list in queue */
 	list_del(&m_node->list);
 	kfree(m_node);
@@ -1304,7 +1473,11 @@ static int ipp_queue_buf_with_run(struct device *dev,
 	 * then m2m operations need start operations at queue_buf
 	 */
 	if (ipp_is_m2m_cmd(property->cmd)) {
-		if (property->type & IPP_EVENT_DRIVEN) {
+		if (ipp_is_pipelined(property)) {
+			/* start right away if the hardware is idle */
+			ipp_pipeline_kick(ippdrv, c_node, false);
+			ret = 0;
+		} else if (property->type & IPP_EVENT_DRIVEN) {
 			struct drm_exynos_ipp_cmd_work *cmd_work = c_node->start_work;
 
 			mutex_lock(&c_node->mem_lock);
@@ -1391,6 +1564,8 @@ int exynos_drm_ipp_queue_buf(struct drm_device *drm_dev, void *data,
 	struct drm_exynos_ipp_cmd_node *c_node;
 	struct drm_exynos_ipp_property *property;
 	struct drm_exynos_ipp_mem_node *m_node;
+	struct sync_fence *out_fence = NULL;
+	int out_fd = -1;
 	int ret;
 
 	DRM_DEBUG_KMS("%s\n", __func__);
@@ -1427,11 +1602,28 @@ int exynos_drm_ipp_queue_buf(struct drm_device *drm_dev, void *data,
 	/* buffer control */
 	switch (qbuf->buf_type) {
 	case IPP_BUF_ENQUEUE:
+		/* fences are only supported by pipelined m2m jobs */
+		if ((qbuf->flags & ~IPP_BUF_FLAG_MASK) ||
+		    (qbuf->flags && !ipp_is_pipelined(property)) ||
+		    ((qbuf->flags & IPP_BUF_FLAG_OUT_FENCE) &&
+		     qbuf->ops_id != EXYNOS_DRM_OPS_DST)) {
+			DRM_ERROR("invalid flags[0x%x]\n", qbuf->flags);
+			return -EINVAL;
+		}
+
+		if (qbuf->flags & IPP_BUF_FLAG_OUT_FENCE) {
+			out_fd = get_unused_fd();
+			if (out_fd < 0)
+				return out_fd;
+		}
+
 		/* get memory node */
-		m_node = ipp_get_mem_node(drm_dev, file, c_node, qbuf);
+		m_node = ipp_get_mem_node(drm_dev, file, c_node, qbuf,
+			&out_fence);
 		if (IS_ERR(m_node)) {
 			DRM_ERROR("failed to get m_node.\n");
-			return PTR_ERR(m_node);
+			ret = PTR_ERR(m_node);
+			goto err_put_fd;
 		}
 
 		/*
@@ -1458,6 +1650,12 @@ int exynos_drm_ipp_queue_buf(struct drm_device *drm_dev, void *data,
 				goto err_put_event;
 			}
 		}
+
+		/* the job may be done already, which is fine for the fence */
+		if (out_fence) {
+			sync_fence_install(out_fence, out_fd);
+			qbuf->fence = out_fd;
+		}
 		break;
 	case IPP_BUF_DEQUEUE:
 		mutex_lock(&c_node->cmd_lock);
@@ -1486,6 +1684,12 @@ err_clean_node:
 	DRM_ERROR("clean memory nodes.\n");
 	ipp_clean_queue_buf(drm_dev, c_node, qbuf);
 
+	if (out_fence)
+		sync_fence_put(out_fence);
+err_put_fd:
+	if (out_fd >= 0)
+		put_unused_fd(out_fd);
+
 	return ret;
 }
 
@@ -1821,6 +2025,10 @@ static int ipp_start_property(struct exynos_drm_ippdrv *ippdrv,
 				goto err_unlock;
 			}
 		}
+
+		/* m_node is the destination, for the job latency */
+		c_node->job_queued = m_node->queued;
+		c_node->job_start = ktime_get();
 		break;
 	case IPP_CMD_WB:
 		/* destination memory list */
@@ -1953,6 +2161,11 @@ static int ipp_stop_property(struct drm_device *drm_dev,
 				}
 			}
 		}
+
+		/* dropped jobs must not leave their out-fences pending */
+		ipp_signal_out_fence(c_node, c_node->timeline_max, 0);
+		c_node->job_busy = false;
+		c_node->configured = false;
 		break;
 	case IPP_CMD_WB:
 		/* destination memory list */
@@ -2082,6 +2295,11 @@ void ipp_sched_cmd(struct work_struct *work)
 		ipp_save_timing(IPP_LOG_WORK);
 #endif
 
+		if (ipp_is_pipelined(property)) {
+			ipp_pipeline_kick(ippdrv, c_node, false);
+			break;
+		}
+
 		ret = ipp_start_property(ippdrv, c_node);
 		if (ret) {
 			DRM_INFO("%s:failed to start property:prop_id[%d]\n",
@@ -2150,6 +2368,45 @@ err_unlock:
 	mutex_unlock(&ippdrv->cwq_lock);
 }
 
+/*
+ * send the first event of the event list, with the buffer ids of the
+ * finished job. called with event_lock held and the list not empty.
+ */
+static void ipp_deliver_event(struct drm_device *drm_dev,
+		struct drm_exynos_ipp_cmd_node *c_node, u32 *tbuf_id, int error)
+{
+	struct drm_exynos_ipp_send_event *e;
+	struct timeval now;
+	unsigned long flags;
+	int i;
+
+	/*
+	 * command node have event list of destination buffer
+	 * If destination buffer enqueue to mem list,
+	 * then we make event and link to event list tail.
+	 * so, we get first event for first enqueued buffer.
+	 */
+	e = list_first_entry(&c_node->event_list,
+		struct drm_exynos_ipp_send_event, base.link);
+
+	do_gettimeofday(&now);
+	DRM_DEBUG_KMS("%s:tv_sec[%ld]tv_usec[%ld]\n"
+		, __func__, now.tv_sec, now.tv_usec);
+	e->event.tv_sec = now.tv_sec;
+	e->event.tv_usec = now.tv_usec;
+	e->event.prop_id = c_node->property.prop_id;
+	e->event.error = error;
+
+	/* set buffer id about source destination */
+	for_each_ipp_ops(i)
+		e->event.buf_id[i] = tbuf_id[i];
+
+	spin_lock_irqsave(&drm_dev->event_lock, flags);
+	list_move_tail(&e->base.link, &e->base.file_priv->event_list);
+	wake_up_interruptible(&e->base.file_priv->event_wait);
+	spin_unlock_irqrestore(&drm_dev->event_lock, flags);
+}
+
 static int ipp_send_event(struct exynos_drm_ippdrv *ippdrv,
 		struct drm_exynos_ipp_cmd_node *c_node, int *buf_id)
 {
@@ -2157,10 +2414,7 @@ static int ipp_send_event(struct exynos_drm_ippdrv *ippdrv,
 	struct drm_exynos_ipp_property *property = &c_node->property;
 	struct drm_exynos_ipp_mem_node *m_node;
 	struct drm_exynos_ipp_queue_buf qbuf;
-	struct drm_exynos_ipp_send_event *e;
 	struct list_head *head;
-	struct timeval now;
-	unsigned long flags;
 	u32 tbuf_id[EXYNOS_DRM_OPS_MAX] = {0, };
 	int ret, i;
 
@@ -2211,6 +2465,10 @@ static int ipp_send_event(struct exynos_drm_ippdrv *ippdrv,
 			DRM_DEBUG_KMS("%s:%s buf_id[%d]\n", __func__,
 				i ? "dst" : "src", tbuf_id[i]);
 
+			if (m_node->out_seqno)
+				ipp_signal_out_fence(c_node, m_node->out_seqno,
+					0);
+
 			ret = ipp_put_mem_node(drm_dev, c_node, m_node);
 			if (ret)
 				DRM_ERROR("failed to put m_node.\n");
@@ -2265,30 +2523,7 @@ static int ipp_send_event(struct exynos_drm_ippdrv *ippdrv,
 		DRM_ERROR("failed to match buf_id[%d %d]prop_id[%d]\n",
 			tbuf_id[1], buf_id[1], property->prop_id);
 
-	/*
-	 * command node have event list of destination buffer
-	 * If destination buffer enqueue to mem list,
-	 * then we make event and link to event list tail.
-	 * so, we get first event for first enqueued buffer.
-	 */
-	e = list_first_entry(&c_node->event_list,
-		struct drm_exynos_ipp_send_event, base.link);
-
-	do_gettimeofday(&now);
-	DRM_DEBUG_KMS("%s:tv_sec[%ld]tv_usec[%ld]\n"
-		, __func__, now.tv_sec, now.tv_usec);
-	e->event.tv_sec = now.tv_sec;
-	e->event.tv_usec = now.tv_usec;
-	e->event.prop_id = property->prop_id;
-
-	/* set buffer id about source destination */
-	for_each_ipp_ops(i)
-		e->event.buf_id[i] = tbuf_id[i];
-
-	spin_lock_irqsave(&drm_dev->event_lock, flags);
-	list_move_tail(&e->base.link, &e->base.file_priv->event_list);
-	wake_up_interruptible(&e->base.file_priv->event_wait);
-	spin_unlock_irqrestore(&drm_dev->event_lock, flags);
+	ipp_deliver_event(drm_dev, c_node, tbuf_id, 0);
 	mutex_unlock(&c_node->event_lock);
 
 	DRM_DEBUG_KMS("%s:done cmd[%d]prop_id[%d]buf_id[%d]\n", __func__,
@@ -2307,6 +2542,226 @@ err_event_unlock:
 	return ret;
 }
 
+static void ipp_job_stats_account(struct exynos_drm_ippdrv *ippdrv,
+		struct drm_exynos_ipp_cmd_node *c_node, u32 buf_id)
+{
+	struct exynos_drm_ipp_stats *stats = &ippdrv->stats;
+	struct exynos_drm_ipp_job_stat *job;
+	ktime_t now = ktime_get();
+	u32 wait_us, run_us;
+
+	if (!c_node->job_start.tv64)
+		return;
+
+	wait_us = (u32)ktime_us_delta(c_node->job_start, c_node->job_queued);
+	run_us = (u32)ktime_us_delta(now, c_node->job_start);
+	c_node->job_start = ktime_set(0, 0);
+
+	spin_lock(&stats->lock);
+	stats->jobs++;
+	stats->wait_us += wait_us;
+	stats->run_us += run_us;
+	stats->max_wait_us = max(stats->max_wait_us, wait_us);
+	stats->max_run_us = max(stats->max_run_us, run_us);
+
+	job = &stats->history[stats->next];
+	job->prop_id = c_node->property.prop_id;
+	job->buf_id = buf_id;
+	job->wait_us = wait_us;
+	job->run_us = run_us;
+	stats->next = (stats->next + 1) % IPP_STATS_HISTORY;
+	spin_unlock(&stats->lock);
+}
+
+/*
+ * drop the first queued job of a pipelined command node that could not be
+ * started, and signal its out-fence with error. the buffer ids of the job
+ * are returned in tbuf_id for its event. called with mem_lock held.
+ */
+static void ipp_pipeline_fail(struct exynos_drm_ippdrv *ippdrv,
+		struct drm_exynos_ipp_cmd_node *c_node,
+		struct drm_exynos_ipp_mem_node **m_node, u32 *tbuf_id,
+		int error)
+{
+	int i;
+
+	DRM_ERROR("failed to run job:prop_id[%d]buf_id[%d]ret[%d]\n",
+		c_node->property.prop_id,
+		m_node[EXYNOS_DRM_OPS_DST]->buf_id, error);
+
+	for_each_ipp_ops(i) {
+		tbuf_id[i] = m_node[i]->buf_id;
+
+		if (m_node[i]->out_seqno)
+			ipp_signal_out_fence(c_node, m_node[i]->out_seqno,
+				error);
+
+		if (ipp_put_mem_node(ippdrv->drm_dev, c_node, m_node[i]))
+			DRM_ERROR("failed to put m_node.\n");
+	}
+}
+
+/*
+ * start the first queued job of a pipelined command node if the hardware
+ * is idle and the in-fences of its buffers are signaled, otherwise wait
+ * for the fence of the first unsignaled one. The hardware is set up only
+ * for the first job after idle, later jobs just get their addresses.
+ * called with mem_lock held, returns 1 if a job was started, 0 if none
+ * could be, or a negative error if the first job failed and was dropped
+ * by ipp_pipeline_fail().
+ */
+static int ipp_pipeline_run(struct exynos_drm_ippdrv *ippdrv,
+		struct drm_exynos_ipp_cmd_node *c_node, u32 *tbuf_id)
+{
+	struct drm_exynos_ipp_property *property = &c_node->property;
+	struct drm_exynos_ipp_mem_node *m_node[EXYNOS_DRM_OPS_MAX];
+	struct sync_fence *fence;
+	int ret, i;
+
+	if (c_node->state != IPP_STATE_START || c_node->job_busy)
+		return 0;
+
+	if (!ipp_check_mem_list(c_node))
+		return 0;
+
+	for_each_ipp_ops(i) {
+		m_node[i] = list_first_entry(&c_node->mem_list[i],
+			struct drm_exynos_ipp_mem_node, list);
+
+		fence = m_node[i]->in_fence;
+		if (!fence || fence->status)
+			continue;
+
+		if (c_node->wait_fence)
+			return 0;
+
+		sync_fence_waiter_init(&c_node->waiter, ipp_fence_cb);
+		if (!sync_fence_wait_async(fence, &c_node->waiter)) {
+			c_node->wait_fence = fence;
+			return 0;
+		}
+	}
+
+	ippdrv->c_node = c_node;
+
+	if (!c_node->configured) {
+		ret = ipp_set_property(ippdrv, property);
+		if (ret) {
+			DRM_ERROR("failed to set property.\n");
+			goto err_fail;
+		}
+		c_node->configured = true;
+	}
+
+	for_each_ipp_ops(i) {
+		ret = ipp_set_mem_node(ippdrv, c_node, m_node[i]);
+		if (ret) {
+			DRM_ERROR("failed to set m node.\n");
+			goto err_fail;
+		}
+	}
+
+	c_node->job_busy = true;
+	c_node->job_queued = m_node[EXYNOS_DRM_OPS_DST]->queued;
+	c_node->job_start = ktime_get();
+
+	if (ippdrv->start) {
+		ret = ippdrv->start(ippdrv->dev, property->cmd);
+		if (ret) {
+			DRM_ERROR("failed to start ops.\n");
+			c_node->job_busy = false;
+			c_node->job_start = ktime_set(0, 0);
+			goto err_fail;
+		}
+	}
+
+	return 1;
+
+err_fail:
+	ipp_pipeline_fail(ippdrv, c_node, m_node, tbuf_id, ret);
+	return ret;
+}
+
+static void ipp_pipeline_kick(struct exynos_drm_ippdrv *ippdrv,
+		struct drm_exynos_ipp_cmd_node *c_node, bool job_done)
+{
+	u32 tbuf_id[EXYNOS_DRM_OPS_MAX];
+	bool idle = false;
+	int ret;
+
+	DRM_DEBUG_KMS("%s:prop_id[%d]done[%d]\n", __func__,
+		c_node->property.prop_id, job_done);
+
+	mutex_lock(&c_node->mem_lock);
+	if (job_done)
+		c_node->job_busy = false;
+
+	/*
+	 * a job that can't be run is completed with an error event, then
+	 * the next one is tried. event_lock is taken before mem_lock.
+	 */
+	while ((ret = ipp_pipeline_run(ippdrv, c_node, tbuf_id)) < 0) {
+		mutex_unlock(&c_node->mem_lock);
+
+		mutex_lock(&c_node->event_lock);
+		if (!list_empty(&c_node->event_list))
+			ipp_deliver_event(ippdrv->drm_dev, c_node, tbuf_id,
+				ret);
+		mutex_unlock(&c_node->event_lock);
+
+		mutex_lock(&c_node->mem_lock);
+	}
+
+	/* nothing to run, so release the hardware until the next job */
+	if (!ret && !c_node->job_busy && c_node->configured) {
+		c_node->configured = false;
+		idle = true;
+	}
+	mutex_unlock(&c_node->mem_lock);
+
+	if (idle)
+		ipp_runtime_put_sync(ippdrv);
+}
+
+void exynos_drm_ipp_show_stats(struct seq_file *m)
+{
+	struct exynos_drm_ippdrv *ippdrv;
+	struct exynos_drm_ipp_stats *stats;
+	struct exynos_drm_ipp_job_stat *job;
+	int i;
+
+	mutex_lock(&exynos_drm_ippdrv_lock);
+	list_for_each_entry(ippdrv, &exynos_drm_ippdrv_list, drv_list) {
+		stats = &ippdrv->stats;
+
+		spin_lock(&stats->lock);
+		seq_printf(m, "ipp%d %s\n", ippdrv->ipp_id,
+			dev_name(ippdrv->dev));
+		seq_printf(m, "  jobs\t\t%llu\n", stats->jobs);
+		if (stats->jobs) {
+			seq_printf(m, "  wait avg/max\t%llu/%u us\n",
+				div64_u64(stats->wait_us, stats->jobs),
+				stats->max_wait_us);
+			seq_printf(m, "  run avg/max\t%llu/%u us\n",
+				div64_u64(stats->run_us, stats->jobs),
+				stats->max_run_us);
+		}
+
+		/* oldest first */
+		for (i = 0; i < IPP_STATS_HISTORY; i++) {
+			job = &stats->history[(stats->next + i) %
+				IPP_STATS_HISTORY];
+			if (!job->prop_id)
+				continue;
+			seq_printf(m, "  prop_id[%u]buf_id[%u] wait %u us run %u us\n",
+				job->prop_id, job->buf_id, job->wait_us,
+				job->run_us);
+		}
+		spin_unlock(&stats->lock);
+	}
+	mutex_unlock(&exynos_drm_ippdrv_lock);
+}
+
 void ipp_sched_event(struct drm_exynos_ipp_event_info *ipp_event)
 {
 	struct drm_exynos_ipp_event_info *event =
@@ -2347,6 +2802,23 @@ void ipp_sched_event(struct drm_exynos_ipp_event_info *ipp_event)
 		goto err_completion;
 	}
 
+	if (ipp_is_m2m_cmd(c_node->property.cmd))
+		ipp_job_stats_account(ippdrv, c_node,
+			event->buf_id[EXYNOS_DRM_OPS_DST]);
+
+	/*
+	 * pipelined jobs keep the power and the setting of the hardware,
+	 * and the next queued job is started from here.
+	 */
+	if (ipp_is_pipelined(&c_node->property)) {
+		ret = ipp_send_event(ippdrv, c_node, event->buf_id);
+		if (ret)
+			DRM_ERROR("failed to send event.\n");
+
+		ipp_pipeline_kick(ippdrv, c_node, true);
+		return;
+	}
+
 	if (ipp_is_m2m_cmd(c_node->property.cmd))
 		ipp_runtime_put_sync(ippdrv);
 
@@ -17,6 +17,11 @@
 #ifndef _EXYNOS_DRM_IPP_H_
 #define _EXYNOS_DRM_IPP_H_
 
+#include <linux/sync.h>
+
+struct seq_file;
+struct sw_sync_timeline;
+
 #define for_each_ipp_ops(pos)	\
 	for (pos = 0; pos < EXYNOS_DRM_OPS_MAX; pos++)
 #define for_each_ipp_planar(pos)	\
@@ -25,6 +30,10 @@
 #define ipp_is_m2m_cmd(c)	(c == IPP_CMD_M2M)
 #define ipp_is_wb_cmd(c)	(c == IPP_CMD_WB)
 #define ipp_is_output_cmd(c)	(c == IPP_CMD_OUTPUT)
+#define ipp_is_pipelined(p)	((p)->type & IPP_PIPELINED)
+
+/* number of jobs kept in the latency history of each ipp driver */
+#define IPP_STATS_HISTORY	16
 
 /* definition of state */
 enum drm_exynos_ipp_state {
@@ -73,6 +82,18 @@ struct drm_exynos_ipp_cmd_work {
  * @stop_work: stop command work structure.
  * @event: event information structure.
  * @state: state of command node.
+ * @fence_work: work to run pipelined jobs once @wait_fence is signaled.
+ * @waiter: waiter on the in-fence of the first queued job.
+ * @wait_fence: in-fence @waiter is added to, cleared by @fence_work.
+ * @timeline: timeline of the out-fences of destination buffers.
+ * @timeline_max: last value handed out on @timeline.
+ * @job_busy: a pipelined job is running on the hardware.
+ * @configured: the hardware is set up with @property.
+ * @job_queued: queueing time of the running job.
+ * @job_start: start time of the running job.
+ *
+ * @wait_fence, @timeline_max, @job_busy and @configured are protected by
+ * @mem_lock.
  */
 struct drm_exynos_ipp_cmd_node {
 	struct exynos_drm_ipp_private *priv;
@@ -90,6 +111,15 @@ struct drm_exynos_ipp_cmd_node {
 	struct drm_exynos_ipp_cmd_work *stop_work;
 	struct drm_exynos_ipp_event_info *event;
 	enum drm_exynos_ipp_state	state;
+	struct work_struct	fence_work;
+	struct sync_fence_waiter	waiter;
+	struct sync_fence	*wait_fence;
+	struct sw_sync_timeline	*timeline;
+	u32	timeline_max;
+	bool	job_busy;
+	bool	configured;
+	ktime_t	job_queued;
+	ktime_t	job_start;
 };
 
 /*
@@ -98,11 +128,13 @@ struct drm_exynos_ipp_cmd_node {
  * @handles: Y, Cb, Cr each gem object.
  * @base: Y, Cb, Cr each planar address.
  * @size: Y, Cb, Cr each planar size.
+ * @obj: Y, Cb, Cr each gem object, for drivers accessing the buffer by cpu.
  */
 struct drm_exynos_ipp_buf_info {
 	unsigned long	handles[EXYNOS_DRM_PLANAR_MAX];
 	dma_addr_t	base[EXYNOS_DRM_PLANAR_MAX];
 	uint64_t	size[EXYNOS_DRM_PLANAR_MAX];
+	struct exynos_drm_gem_obj	*obj[EXYNOS_DRM_PLANAR_MAX];
 };
 
 /*
@@ -127,6 +159,44 @@ struct drm_exynos_ipp_event_info {
 	u32	buf_id[EXYNOS_DRM_OPS_MAX];
 };
 
+/*
+ * A structure of m2m job latency.
+ *
+ * @prop_id: id of property.
+ * @buf_id: id of destination buffer.
+ * @wait_us: time from queueing of the buffers to start of the job.
+ * @run_us: time from start to completion of the job.
+ */
+struct exynos_drm_ipp_job_stat {
+	u32	prop_id;
+	u32	buf_id;
+	u32	wait_us;
+	u32	run_us;
+};
+
+/*
+ * A structure of m2m job statistics of an ipp driver.
+ *
+ * @lock: lock for synchronization of access to statistics.
+ * @jobs: number of completed jobs.
+ * @wait_us: total waiting time of completed jobs.
+ * @run_us: total running time of completed jobs.
+ * @max_wait_us: longest waiting time.
+ * @max_run_us: longest running time.
+ * @next: index of the next history entry.
+ * @history: latency of the last completed jobs.
+ */
+struct exynos_drm_ipp_stats {
+	spinlock_t	lock;
+	u64	jobs;
+	u64	wait_us;
+	u64	run_us;
+	u32	max_wait_us;
+	u32	max_run_us;
+	unsigned int	next;
+	struct exynos_drm_ipp_job_stat	history[IPP_STATS_HISTORY];
+};
+
 /*
  * A structure of source,destination operations.
  *
@@ -163,6 +233,7 @@ struct exynos_drm_ipp_ops {
  * @cmd_list: list head for command information.
  * @capability: capability information of current ipp driver.
  * @cwq_lock: lock for synchronization of access to command workqueue.
+ * @stats: m2m job statistics.
  * @check_property: check property about format, size, buffer.
  * @reset: reset ipp block.
  * @start: ipp each device start.
@@ -184,6 +255,7 @@ struct exynos_drm_ippdrv {
 	struct list_head	cmd_list;
 	struct drm_exynos_ipp_capability *capability;
 	struct mutex	cwq_lock;
+	struct exynos_drm_ipp_stats	stats;
 
 	int (*check_property)(struct device *dev,
 		struct drm_exynos_ipp_property *property);
@@ -210,6 +282,7 @@ extern int exynos_drm_ippnb_unregister(struct notifier_block *nb);
 extern int exynos_drm_ippnb_send_event(unsigned long val, void *v);
 extern void ipp_sched_cmd(struct work_struct *work);
 extern void ipp_sched_event(struct drm_exynos_ipp_event_info *ipp_event);
+extern void exynos_drm_ipp_show_stats(struct seq_file *m);
 
 #ifdef CONFIG_PM_RUNTIME
 extern bool ipp_runtime_suspended(struct device *dev);
@@ -273,6 +346,10 @@ static inline int exynos_drm_ippnb_send_event(unsigned long val, void *v)
 	return -ENOTTY;
 }
 
+static inline void exynos_drm_ipp_show_stats(struct seq_file *m)
+{
+}
+
 #ifdef CONFIG_PM_RUNTIME
 static inline bool ipp_runtime_suspended(struct device *dev)
 {
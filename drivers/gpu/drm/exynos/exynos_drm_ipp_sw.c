@@ -0,0 +1,580 @@
+/*
+ * Copyright (C) 2013 Samsung Electronics Co.Ltd
+ *
+ * This program is free software; you can redistribute  it and/or modify it
+ * under  the terms of  the GNU General  Public License as published by the
+ * Free Software Foundation;  either version 2 of the  License, or (at your
+ * option) any later version.
+ *
+ */
+#include <linux/kernel.h>
+#include <linux/module.h>
+#include <linux/platform_device.h>
+#include <linux/pm_runtime.h>
+#include <linux/vmalloc.h>
+#include <linux/workqueue.h>
+
+#include <drm/drmP.h>
+#include <drm/exynos_drm.h>
+#include "exynos_drm_drv.h"
+#include "exynos_drm_gem.h"
+#include "exynos_drm_ipp.h"
+
+/*
+ * IPP_SW is a reference implementation of the m2m scaler operations
+ * done by the cpu. It has no hardware behind it: a job runs from a
+ * workqueue and completes through sched_event like the GSC and SC
+ * interrupts do, so the ipp job queue can be exercised and measured
+ * without those blocks, and their results compared against it.
+ *
+ * M2M operation : supports crop/nearest neighbour scale/flip/rotation
+ * of 180 degree and conversion between XRGB8888, ARGB8888 and RGB565.
+ */
+
+#define IPP_SW_MAX_SIZE		4096
+#define get_ipp_sw_context(dev)	platform_get_drvdata(to_platform_device(dev))
+
+/*
+ * A structure of configuration of source or destination.
+ *
+ * @fmt: format of image.
+ * @degree: rotation.
+ * @flip: flip.
+ * @pos: region of image.
+ * @sz: size of buffer.
+ */
+struct ipp_sw_config {
+	u32	fmt;
+	enum drm_exynos_degree	degree;
+	enum drm_exynos_flip	flip;
+	struct drm_exynos_pos	pos;
+	struct drm_exynos_sz	sz;
+};
+
+/*
+ * A structure of ipp_sw context.
+ *
+ * @ippdrv: prepare initialization using ippdrv.
+ * @config: source, destination configuration.
+ * @buf_info: source, destination buffer of the current job.
+ * @cur_buf_id: id of current buffer.
+ * @workq: workqueue running the jobs.
+ * @work: work of the current job.
+ */
+struct ipp_sw_context {
+	struct exynos_drm_ippdrv	ippdrv;
+	struct ipp_sw_config	config[EXYNOS_DRM_OPS_MAX];
+	struct drm_exynos_ipp_buf_info	buf_info[EXYNOS_DRM_OPS_MAX];
+	int	cur_buf_id[EXYNOS_DRM_OPS_MAX];
+	struct workqueue_struct	*workq;
+	struct work_struct	work;
+};
+
+static int ipp_sw_bpp(u32 fmt)
+{
+	switch (fmt) {
+	case DRM_FORMAT_XRGB8888:
+	case DRM_FORMAT_ARGB8888:
+		return 4;
+	case DRM_FORMAT_RGB565:
+		return 2;
+	default:
+		return 0;
+	}
+}
+
+static u32 ipp_sw_read_pixel(u32 fmt, void *p)
+{
+	u16 v;
+
+	switch (fmt) {
+	case DRM_FORMAT_XRGB8888:
+		return *(u32 *)p | 0xff000000;
+	case DRM_FORMAT_ARGB8888:
+		return *(u32 *)p;
+	default:
+		v = *(u16 *)p;
+		return 0xff000000 |
+			((v >> 11) << 19) | (((v >> 11) & 0x1c) << 14) |
+			(((v >> 5) & 0x3f) << 10) | (((v >> 5) & 0x30) << 4) |
+			((v & 0x1f) << 3) | ((v & 0x1c) >> 2);
+	}
+}
+
+static void ipp_sw_write_pixel(u32 fmt, void *p, u32 argb)
+{
+	switch (fmt) {
+	case DRM_FORMAT_XRGB8888:
+	case DRM_FORMAT_ARGB8888:
+		*(u32 *)p = argb;
+		break;
+	default:
+		*(u16 *)p = ((argb >> 8) & 0xf800) | ((argb >> 5) & 0x07e0) |
+			((argb >> 3) & 0x001f);
+		break;
+	}
+}
+
+static int ipp_sw_set_fmt(struct device *dev, int ops_id, u32 fmt)
+{
+	struct ipp_sw_context *ctx = get_ipp_sw_context(dev);
+
+	DRM_DEBUG_KMS("%s:ops_id[%d]fmt[0x%x]\n", __func__, ops_id, fmt);
+
+	if (!ipp_sw_bpp(fmt)) {
+		dev_err(dev, "not support format[0x%x]\n", fmt);
+		return -EINVAL;
+	}
+
+	ctx->config[ops_id].fmt = fmt;
+
+	return 0;
+}
+
+static int ipp_sw_set_transf(struct device *dev, int ops_id,
+		enum drm_exynos_degree degree,
+		enum drm_exynos_flip flip, bool *swap)
+{
+	struct ipp_sw_context *ctx = get_ipp_sw_context(dev);
+
+	DRM_DEBUG_KMS("%s:ops_id[%d]degree[%d]flip[0x%x]\n", __func__,
+		ops_id, degree, flip);
+
+	if (degree != EXYNOS_DRM_DEGREE_0 && degree != EXYNOS_DRM_DEGREE_180) {
+		dev_err(dev, "not support degree[%d]\n", degree);
+		return -EINVAL;
+	}
+
+	ctx->config[ops_id].degree = degree;
+	ctx->config[ops_id].flip = flip;
+	*swap = false;
+
+	return 0;
+}
+
+static int ipp_sw_set_size(struct device *dev, int ops_id,
+		struct drm_exynos_pos *pos, struct drm_exynos_sz *sz)
+{
+	struct ipp_sw_context *ctx = get_ipp_sw_context(dev);
+
+	DRM_DEBUG_KMS("%s:ops_id[%d]pos[%d %d %d %d]sz[%d %d]\n", __func__,
+		ops_id, pos->x, pos->y, pos->w, pos->h, sz->hsize, sz->vsize);
+
+	ctx->config[ops_id].pos = *pos;
+	ctx->config[ops_id].sz = *sz;
+
+	return 0;
+}
+
+static int ipp_sw_set_addr(struct device *dev, int ops_id,
+		struct drm_exynos_ipp_buf_info *buf_info, u32 buf_id,
+		enum drm_exynos_ipp_buf_type buf_type)
+{
+	struct ipp_sw_context *ctx = get_ipp_sw_context(dev);
+
+	DRM_DEBUG_KMS("%s:ops_id[%d]buf_id[%d]buf_type[%d]\n", __func__,
+		ops_id, buf_id, buf_type);
+
+	switch (buf_type) {
+	case IPP_BUF_ENQUEUE:
+		ctx->buf_info[ops_id] = *buf_info;
+		ctx->cur_buf_id[ops_id] = buf_id;
+		break;
+	case IPP_BUF_DEQUEUE:
+		memset(&ctx->buf_info[ops_id], 0x0, sizeof(*buf_info));
+		break;
+	default:
+		return -EINVAL;
+	}
+
+	return 0;
+}
+
+static int ipp_sw_src_set_fmt(struct device *dev, u32 fmt)
+{
+	return ipp_sw_set_fmt(dev, EXYNOS_DRM_OPS_SRC, fmt);
+}
+
+static int ipp_sw_src_set_transf(struct device *dev,
+		enum drm_exynos_degree degree,
+		enum drm_exynos_flip flip, bool *swap)
+{
+	return ipp_sw_set_transf(dev, EXYNOS_DRM_OPS_SRC, degree, flip, swap);
+}
+
+static int ipp_sw_src_set_size(struct device *dev, int swap,
+		struct drm_exynos_pos *pos, struct drm_exynos_sz *sz)
+{
+	return ipp_sw_set_size(dev, EXYNOS_DRM_OPS_SRC, pos, sz);
+}
+
+static int ipp_sw_src_set_addr(struct device *dev,
+		struct drm_exynos_ipp_buf_info *buf_info, u32 buf_id,
+		enum drm_exynos_ipp_buf_type buf_type)
+{
+	return ipp_sw_set_addr(dev, EXYNOS_DRM_OPS_SRC, buf_info, buf_id,
+		buf_type);
+}
+
+static struct exynos_drm_ipp_ops ipp_sw_src_ops = {
+	.set_fmt = ipp_sw_src_set_fmt,
+	.set_transf = ipp_sw_src_set_transf,
+	.set_size = ipp_sw_src_set_size,
+	.set_addr = ipp_sw_src_set_addr,
+};
+
+static int ipp_sw_dst_set_fmt(struct device *dev, u32 fmt)
+{
+	return ipp_sw_set_fmt(dev, EXYNOS_DRM_OPS_DST, fmt);
+}
+
+static int ipp_sw_dst_set_transf(struct device *dev,
+		enum drm_exynos_degree degree,
+		enum drm_exynos_flip flip, bool *swap)
+{
+	return ipp_sw_set_transf(dev, EXYNOS_DRM_OPS_DST, degree, flip, swap);
+}
+
+static int ipp_sw_dst_set_size(struct device *dev, int swap,
+		struct drm_exynos_pos *pos, struct drm_exynos_sz *sz)
+{
+	return ipp_sw_set_size(dev, EXYNOS_DRM_OPS_DST, pos, sz);
+}
+
+static int ipp_sw_dst_set_addr(struct device *dev,
+		struct drm_exynos_ipp_buf_info *buf_info, u32 buf_id,
+		enum drm_exynos_ipp_buf_type buf_type)
+{
+	return ipp_sw_set_addr(dev, EXYNOS_DRM_OPS_DST, buf_info, buf_id,
+		buf_type);
+}
+
+static struct exynos_drm_ipp_ops ipp_sw_dst_ops = {
+	.set_fmt = ipp_sw_dst_set_fmt,
+	.set_transf = ipp_sw_dst_set_transf,
+	.set_size = ipp_sw_dst_set_size,
+	.set_addr = ipp_sw_dst_set_addr,
+};
+
+/*
+ * map the first plane of a buffer. write-combined, so that the cpu sees
+ * what the other devices and user space wrote without cache maintenance.
+ * all supported formats are single plane, so the whole image has to fit
+ * in the gem object of that plane.
+ */
+static void *ipp_sw_vmap(struct drm_exynos_ipp_buf_info *buf_info,
+		struct ipp_sw_config *config)
+{
+	struct exynos_drm_gem_obj *obj = buf_info->obj[0];
+	struct exynos_drm_gem_buf *buffer;
+	u64 size;
+
+	if (!obj || !obj->buffer || !obj->buffer->pages)
+		return NULL;
+
+	buffer = obj->buffer;
+	size = (u64)config->sz.hsize * config->sz.vsize *
+		ipp_sw_bpp(config->fmt);
+	if (!size || size > buffer->size || size > obj->base.size)
+		return NULL;
+
+	return vmap(buffer->pages, buffer->size >> PAGE_SHIFT, VM_MAP,
+		pgprot_writecombine(PAGE_KERNEL));
+}
+
+static int ipp_sw_process(struct ipp_sw_context *ctx)
+{
+	struct ipp_sw_config *src = &ctx->config[EXYNOS_DRM_OPS_SRC];
+	struct ipp_sw_config *dst = &ctx->config[EXYNOS_DRM_OPS_DST];
+	int sbpp = ipp_sw_bpp(src->fmt), dbpp = ipp_sw_bpp(dst->fmt);
+	bool hflip, vflip;
+	void *saddr, *daddr;
+	u32 x_step, y_step, sx, sy, x, y;
+	u8 *sline, *dline;
+	int ret = 0;
+
+	saddr = ipp_sw_vmap(&ctx->buf_info[EXYNOS_DRM_OPS_SRC], src);
+	daddr = ipp_sw_vmap(&ctx->buf_info[EXYNOS_DRM_OPS_DST], dst);
+	if (!saddr || !daddr) {
+		DRM_ERROR("failed to map buffers.\n");
+		ret = -EFAULT;
+		goto out;
+	}
+
+	/* 180 degree is both flips, and flips of src and dst cancel out */
+	hflip = !!((src->flip ^ dst->flip) & EXYNOS_DRM_FLIP_HORIZONTAL);
+	vflip = !!((src->flip ^ dst->flip) & EXYNOS_DRM_FLIP_VERTICAL);
+	if ((src->degree == EXYNOS_DRM_DEGREE_180) ^
+	    (dst->degree == EXYNOS_DRM_DEGREE_180)) {
+		hflip = !hflip;
+		vflip = !vflip;
+	}
+
+	/* 16.16 fixed point steps of nearest neighbour sampling */
+	x_step = (src->pos.w << 16) / dst->pos.w;
+	y_step = (src->pos.h << 16) / dst->pos.h;
+
+	for (y = 0; y < dst->pos.h; y++) {
+		sy = ((vflip ? dst->pos.h - 1 - y : y) * y_step) >> 16;
+		sline = saddr + ((src->pos.y + sy) * src->sz.hsize +
+			src->pos.x) * sbpp;
+		dline = daddr + ((dst->pos.y + y) * dst->sz.hsize +
+			dst->pos.x) * dbpp;
+
+		for (x = 0; x < dst->pos.w; x++) {
+			sx = ((hflip ? dst->pos.w - 1 - x : x) * x_step) >> 16;
+			ipp_sw_write_pixel(dst->fmt, dline + x * dbpp,
+				ipp_sw_read_pixel(src->fmt, sline + sx * sbpp));
+		}
+	}
+
+out:
+	if (saddr)
+		vunmap(saddr);
+	if (daddr)
+		vunmap(daddr);
+
+	return ret;
+}
+
+static void ipp_sw_work(struct work_struct *work)
+{
+	struct ipp_sw_context *ctx = container_of(work,
+		struct ipp_sw_context, work);
+	struct exynos_drm_ippdrv *ippdrv = &ctx->ippdrv;
+	struct drm_exynos_ipp_cmd_node *c_node = ippdrv->c_node;
+	struct drm_exynos_ipp_event_info *event;
+	int *buf_id = ctx->cur_buf_id;
+
+	if (!c_node) {
+		DRM_ERROR("failed to get c_node.\n");
+		return;
+	}
+
+	/* a failed job still completes, or the queue would stall */
+	if (ipp_sw_process(ctx))
+		DRM_ERROR("failed to process:prop_id[%d]\n",
+			c_node->property.prop_id);
+
+	if (c_node->state == IPP_STATE_STOP) {
+		DRM_ERROR("invalid state:prop_id[%d]\n",
+			c_node->property.prop_id);
+		return;
+	}
+
+	DRM_DEBUG_KMS("%s:src buf_id[%d]dst buf_id[%d]\n", __func__,
+		buf_id[EXYNOS_DRM_OPS_SRC], buf_id[EXYNOS_DRM_OPS_DST]);
+
+	event = c_node->event;
+	event->ippdrv = ippdrv;
+	event->buf_id[EXYNOS_DRM_OPS_SRC] = buf_id[EXYNOS_DRM_OPS_SRC];
+	event->buf_id[EXYNOS_DRM_OPS_DST] = buf_id[EXYNOS_DRM_OPS_DST];
+	ippdrv->sched_event(event);
+}
+
+static int ipp_sw_init_capability(struct exynos_drm_ippdrv *ippdrv)
+{
+	struct drm_exynos_ipp_capability *capability;
+
+	DRM_DEBUG_KMS("%s\n", __func__);
+
+	capability = devm_kzalloc(ippdrv->dev, sizeof(*capability), GFP_KERNEL);
+	if (!capability) {
+		DRM_ERROR("failed to alloc capability.\n");
+		return -ENOMEM;
+	}
+
+	capability->flip = (1 << EXYNOS_DRM_FLIP_VERTICAL) |
+				(1 << EXYNOS_DRM_FLIP_HORIZONTAL);
+	capability->degree = (1 << EXYNOS_DRM_DEGREE_0) |
+				(1 << EXYNOS_DRM_DEGREE_180);
+	capability->csc = 1;
+	capability->crop = 1;
+	capability->crop_max.hsize = IPP_SW_MAX_SIZE;
+	capability->crop_max.vsize = IPP_SW_MAX_SIZE;
+	capability->crop_min.hsize = 1;
+	capability->crop_min.vsize = 1;
+	capability->scale = 1;
+	capability->scale_max.hsize = IPP_SW_MAX_SIZE;
+	capability->scale_max.vsize = IPP_SW_MAX_SIZE;
+	capability->scale_min.hsize = 1;
+	capability->scale_min.vsize = 1;
+
+	ippdrv->capability = capability;
+
+	return 0;
+}
+
+static int ipp_sw_ippdrv_check_property(struct device *dev,
+		struct drm_exynos_ipp_property *property)
+{
+	struct drm_exynos_ipp_config *config;
+	struct drm_exynos_pos *pos;
+	struct drm_exynos_sz *sz;
+	int i;
+
+	DRM_DEBUG_KMS("%s\n", __func__);
+
+	/* the buffers are accessed by the cpu */
+	if (!ipp_is_m2m_cmd(property->cmd) || property->protect)
+		return -EPERM;
+
+	for_each_ipp_ops(i) {
+		config = &property->config[i];
+		pos = &config->pos;
+		sz = &config->sz;
+
+		if (!ipp_sw_bpp(config->fmt) ||
+		    (config->flip & ~EXYNOS_DRM_FLIP_BOTH) ||
+		    (config->degree != EXYNOS_DRM_DEGREE_0 &&
+		     config->degree != EXYNOS_DRM_DEGREE_180))
+			goto err_property;
+
+		if (sz->hsize > IPP_SW_MAX_SIZE || sz->vsize > IPP_SW_MAX_SIZE)
+			goto err_property;
+
+		/* written not to wrap, the values come from user space */
+		if (!pos->w || !pos->h ||
+		    pos->w > sz->hsize || pos->x > sz->hsize - pos->w ||
+		    pos->h > sz->vsize || pos->y > sz->vsize - pos->h)
+			goto err_property;
+	}
+
+	return 0;
+
+err_property:
+	for_each_ipp_ops(i) {
+		config = &property->config[i];
+		pos = &config->pos;
+		sz = &config->sz;
+
+		DRM_DEBUG_KMS("%s:[%s]fmt[0x%x]f[%d]r[%d]pos[%d %d %d %d]sz[%d %d]\n",
+			__func__, i ? "dst" : "src", config->fmt, config->flip,
+			config->degree, pos->x, pos->y, pos->w, pos->h,
+			sz->hsize, sz->vsize);
+	}
+
+	return -EINVAL;
+}
+
+static int ipp_sw_ippdrv_reset(struct device *dev)
+{
+	struct ipp_sw_context *ctx = get_ipp_sw_context(dev);
+
+	DRM_DEBUG_KMS("%s\n", __func__);
+
+	memset(ctx->config, 0x0, sizeof(ctx->config));
+	memset(ctx->buf_info, 0x0, sizeof(ctx->buf_info));
+
+	return 0;
+}
+
+static int ipp_sw_ippdrv_start(struct device *dev, enum drm_exynos_ipp_cmd cmd)
+{
+	struct ipp_sw_context *ctx = get_ipp_sw_context(dev);
+
+	DRM_DEBUG_KMS("%s:cmd[%d]\n", __func__, cmd);
+
+	if (!ipp_is_m2m_cmd(cmd)) {
+		dev_err(dev, "invalid operations.\n");
+		return -EINVAL;
+	}
+
+	queue_work(ctx->workq, &ctx->work);
+
+	return 0;
+}
+
+static void ipp_sw_ippdrv_stop(struct device *dev, enum drm_exynos_ipp_cmd cmd)
+{
+	struct ipp_sw_context *ctx = get_ipp_sw_context(dev);
+
+	DRM_DEBUG_KMS("%s:cmd[%d]\n", __func__, cmd);
+
+	cancel_work_sync(&ctx->work);
+}
+
+static int __devinit ipp_sw_probe(struct platform_device *pdev)
+{
+	struct device *dev = &pdev->dev;
+	struct ipp_sw_context *ctx;
+	struct exynos_drm_ippdrv *ippdrv;
+	int ret;
+
+	ctx = devm_kzalloc(dev, sizeof(*ctx), GFP_KERNEL);
+	if (!ctx)
+		return -ENOMEM;
+
+	ctx->workq = create_singlethread_workqueue("ipp_sw");
+	if (!ctx->workq) {
+		dev_err(dev, "failed to create workqueue.\n");
+		ret = -ENOMEM;
+		goto err_ctx;
+	}
+	INIT_WORK(&ctx->work, ipp_sw_work);
+
+	ippdrv = &ctx->ippdrv;
+	ippdrv->dev = dev;
+	ippdrv->ops[EXYNOS_DRM_OPS_SRC] = &ipp_sw_src_ops;
+	ippdrv->ops[EXYNOS_DRM_OPS_DST] = &ipp_sw_dst_ops;
+	ippdrv->check_property = ipp_sw_ippdrv_check_property;
+	ippdrv->reset = ipp_sw_ippdrv_reset;
+	ippdrv->start = ipp_sw_ippdrv_start;
+	ippdrv->stop = ipp_sw_ippdrv_stop;
+	ret = ipp_sw_init_capability(ippdrv);
+	if (ret < 0) {
+		dev_err(dev, "failed to init property list.\n");
+		goto err_workq;
+	}
+
+	platform_set_drvdata(pdev, ctx);
+
+	pm_runtime_set_active(dev);
+	pm_runtime_enable(dev);
+
+	ret = exynos_drm_ippdrv_register(ippdrv);
+	if (ret < 0) {
+		dev_err(dev, "failed to register drm ipp_sw device.\n");
+		goto err_ippdrv_register;
+	}
+
+	dev_info(dev, "drm ipp_sw registered successfully.\n");
+
+	return 0;
+
+err_ippdrv_register:
+	devm_kfree(dev, ippdrv->capability);
+	pm_runtime_disable(dev);
+err_workq:
+	destroy_workqueue(ctx->workq);
+err_ctx:
+	devm_kfree(dev, ctx);
+	return ret;
+}
+
+static int __devexit ipp_sw_remove(struct platform_device *pdev)
+{
+	struct device *dev = &pdev->dev;
+	struct ipp_sw_context *ctx = get_ipp_sw_context(dev);
+	struct exynos_drm_ippdrv *ippdrv = &ctx->ippdrv;
+
+	devm_kfree(dev, ippdrv->capability);
+	exynos_drm_ippdrv_unregister(ippdrv);
+
+	pm_runtime_set_suspended(dev);
+	pm_runtime_disable(dev);
+
+	destroy_workqueue(ctx->workq);
+	devm_kfree(dev, ctx);
+
+	return 0;
+}
+
+struct platform_driver ipp_sw_driver = {
+	.probe		= ipp_sw_probe,
+	.remove		= __devexit_p(ipp_sw_remove),
+	.driver		= {
+		.name	= "exynos-drm-ipp-sw",
+		.owner	= THIS_MODULE,
+	},
+};
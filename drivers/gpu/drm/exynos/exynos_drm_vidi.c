@@ -15,6 +15,7 @@
 #include <linux/kernel.h>
 #include <linux/module.h>
 #include <linux/platform_device.h>
+#include <linux/hrtimer.h>
 
 #include <drm/exynos_drm.h>
 
@@ -59,7 +60,7 @@ struct vidi_context {
 	atomic_t			vblank_on;
 	atomic_t			win_updated;
 	bool				suspended;
-	struct work_struct		work;
+	struct hrtimer			vblank_timer;
 	struct mutex			lock;
 };
 
@@ -89,8 +90,8 @@ static const char fake_edid_info[] = {
 };
 
 #define VBLANK_INTERVAL(x)	(USEC_PER_SEC / (x))
-
-static void vidi_fake_vblank_handler(struct work_struct *work);
+#define VBLANK_PERIOD(ctx)	ktime_set(0, (ctx)->vblank_interval_us * \
+					NSEC_PER_USEC)
 
 static bool vidi_display_is_connected(struct device *dev)
 {
@@ -241,16 +242,16 @@ static int vidi_enable_vblank(struct device *dev)
 	if (ctx->suspended)
 		return -EPERM;
 
-	if (!test_and_set_bit(0, &ctx->irq_flags))
-		atomic_set(&ctx->vblank_on, 1);
-
 	/*
-	 * in case of page flip request, vidi_finish_pageflip function
-	 * will not be called because vblank_on is true and then
-	 * that function will be called by manager_ops->win_commit callback
+	 * vblank is emulated with a periodic timer, at the refresh rate of
+	 * the mode set, so page flips and atomic commits complete with
+	 * the same timing as with a panel.
 	 */
-	if (atomic_read(&ctx->vblank_on))
-		schedule_work(&ctx->work);
+	if (!test_and_set_bit(0, &ctx->irq_flags)) {
+		atomic_set(&ctx->vblank_on, 1);
+		hrtimer_start(&ctx->vblank_timer, VBLANK_PERIOD(ctx),
+				HRTIMER_MODE_REL);
+	}
 
 	return 0;
 }
@@ -264,8 +265,10 @@ static void vidi_disable_vblank(struct device *dev)
 	if (ctx->suspended)
 		return;
 
-	if (test_and_clear_bit(0, &ctx->irq_flags))
+	if (test_and_clear_bit(0, &ctx->irq_flags)) {
 		atomic_set(&ctx->vblank_on, 0);
+		hrtimer_try_to_cancel(&ctx->vblank_timer);
+	}
 }
 
 static struct exynos_drm_manager_ops vidi_manager_ops = {
@@ -366,10 +369,8 @@ static void vidi_win_commit(struct device *dev, int zpos)
 
 	DRM_DEBUG_KMS("dma_addr = 0x%x\n", win_data->dma_addr);
 
+	/* the page flip completes at the next emulated vblank. */
 	atomic_set(&ctx->win_updated, 1);
-
-	if (atomic_read(&ctx->vblank_on))
-		schedule_work(&ctx->work);
 }
 
 static void vidi_win_disable(struct device *dev, int zpos)
@@ -405,34 +406,29 @@ static struct exynos_drm_manager vidi_manager = {
 	.display_ops	= &vidi_display_ops,
 };
 
-static void vidi_fake_vblank_handler(struct work_struct *work)
+static enum hrtimer_restart vidi_fake_vblank_handler(struct hrtimer *timer)
 {
-	struct vidi_context *ctx = container_of(work, struct vidi_context,
-					work);
+	struct vidi_context *ctx = container_of(timer, struct vidi_context,
+					vblank_timer);
 	struct exynos_drm_subdrv *subdrv = &ctx->subdrv;
 	struct exynos_drm_manager *manager = subdrv->manager;
 
 	if (manager->pipe < 0 || ctx->suspended ||
-	    !ctx->connected)
-		return;
+	    !ctx->connected || !atomic_read(&ctx->vblank_on))
+		return HRTIMER_NORESTART;
 
-	usleep_range(ctx->vblank_interval_us,
-		ctx->vblank_interval_us+1000);
+	drm_handle_vblank(subdrv->drm_dev, manager->pipe);
 
-	mutex_lock(&ctx->lock);
-
-	if (atomic_read(&ctx->vblank_on))
-		drm_handle_vblank(subdrv->drm_dev, manager->pipe);
-
-	mutex_unlock(&ctx->lock);
-
-	if (atomic_read(&ctx->win_updated)) {
-		atomic_set(&ctx->win_updated, 0);
+	if (atomic_xchg(&ctx->win_updated, 0))
 		exynos_drm_crtc_finish_pageflip(subdrv->drm_dev, manager->pipe);
-	}
 
-	if (atomic_read(&ctx->vblank_on))
-		schedule_work(&ctx->work);
+	/*
+	 * forward from the previous expiry rather than from now so that
+	 * the emulated vblank doesn't drift with the timer latency.
+	 */
+	hrtimer_forward_now(timer, VBLANK_PERIOD(ctx));
+
+	return HRTIMER_RESTART;
 }
 
 static int vidi_subdrv_probe(struct drm_device *drm_dev, struct device *dev)
@@ -605,7 +601,8 @@ static int __devinit vidi_probe(struct platform_device *pdev)
 	ctx->refresh = 60;
 	ctx->vblank_interval_us = 16000;
 
-	INIT_WORK(&ctx->work, vidi_fake_vblank_handler);
+	hrtimer_init(&ctx->vblank_timer, CLOCK_MONOTONIC, HRTIMER_MODE_REL);
+	ctx->vblank_timer.function = vidi_fake_vblank_handler;
 
 	/* for test */
 	ctx->raw_edid = (struct edid *)fake_edid_info;
@@ -637,6 +634,7 @@ static int __devexit vidi_remove(struct platform_device *pdev)
 
 	exynos_drm_subdrv_unregister(&ctx->subdrv);
 
+	hrtimer_cancel(&ctx->vblank_timer);
 	kfree(ctx);
 
 	return 0;
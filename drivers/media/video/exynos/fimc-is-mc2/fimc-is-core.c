@@ -1857,11 +1857,14 @@ static int __init fimc_is_init(void)
 	int ret = platform_driver_register(&fimc_is_driver);
 	if (ret)
 		err("platform_driver_register failed: %d\n", ret);
+	else
+		fimc_is_frame_debugfs_init();
 	return ret;
 }
 
 static void __exit fimc_is_exit(void)
 {
+	fimc_is_frame_debugfs_exit();
 	platform_driver_unregister(&fimc_is_driver);
 }
 module_init(fimc_is_init);
@@ -0,0 +1,281 @@
+/*
+ * Samsung Exynos5 SoC series FIMC-IS driver
+ *
+ * exynos5 fimc-is frame manager self test
+ *
+ * Copyright (c) 2011 Samsung Electronics Co., Ltd
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ */
+
+#include <linux/module.h>
+#include <linux/kernel.h>
+#include <linux/delay.h>
+#include <linux/slab.h>
+
+#include "fimc-is-core.h"
+
+#define TEST_ID			FRAMEMGR_ID_ISP_GRP
+#define TEST_BUFFERS		8
+#define TEST_CYCLES		16
+#define TEST_REQUEST_US		200
+#define TEST_PROCESS_US		500
+
+static int fimc_is_framemgr_test_cnt(struct fimc_is_framemgr *this,
+	u32 fre, u32 req, u32 pro, u32 com)
+{
+	if (this->frame_fre_cnt != fre || this->frame_req_cnt != req ||
+		this->frame_pro_cnt != pro || this->frame_com_cnt != com) {
+		err("count is %d %d %d %d(%d %d %d %d)",
+			this->frame_fre_cnt, this->frame_req_cnt,
+			this->frame_pro_cnt, this->frame_com_cnt,
+			fre, req, pro, com);
+		return -EINVAL;
+	}
+
+	return 0;
+}
+
+/* frames queued by index go through the lists in order */
+static int fimc_is_framemgr_test_trans(struct fimc_is_framemgr *this)
+{
+	int ret = 0;
+	u32 i;
+	unsigned long flags;
+	struct fimc_is_frame *frame;
+
+	fimc_is_frame_open(this, TEST_ID, TEST_BUFFERS);
+
+	framemgr_e_barrier_irqs(this, 0, flags);
+
+	ret = fimc_is_framemgr_test_cnt(this, TEST_BUFFERS, 0, 0, 0);
+	if (ret)
+		goto p_err;
+
+	/* queue in reverse, like a client handing buffers back out of order */
+	for (i = TEST_BUFFERS; i > 0; --i)
+		fimc_is_frame_trans_fre_to_req(this, &this->frame[i - 1]);
+
+	ret = fimc_is_framemgr_test_cnt(this, 0, TEST_BUFFERS, 0, 0);
+	if (ret)
+		goto p_err;
+
+	for (i = TEST_BUFFERS; i > 0; --i) {
+		fimc_is_frame_request_head(this, &frame);
+		if (!frame || frame->index != i - 1) {
+			err("request head is %d(%d)",
+				frame ? frame->index : -1, i - 1);
+			ret = -EINVAL;
+			goto p_err;
+		}
+
+		if (frame->state != FIMC_IS_FRAME_STATE_REQUEST) {
+			err("frame %d state is %d", i - 1, frame->state);
+			ret = -EINVAL;
+			goto p_err;
+		}
+
+		fimc_is_frame_trans_req_to_pro(this, frame);
+		fimc_is_frame_trans_pro_to_com(this, frame);
+		if (frame->state != FIMC_IS_FRAME_STATE_COMPLETE) {
+			err("frame %d state is %d", i - 1, frame->state);
+			ret = -EINVAL;
+			goto p_err;
+		}
+	}
+
+	ret = fimc_is_framemgr_test_cnt(this, 0, 0, 0, TEST_BUFFERS);
+	if (ret)
+		goto p_err;
+
+	for (i = TEST_BUFFERS; i > 0; --i) {
+		fimc_is_frame_complete_head(this, &frame);
+		if (!frame || frame->index != i - 1) {
+			err("complete head is %d(%d)",
+				frame ? frame->index : -1, i - 1);
+			ret = -EINVAL;
+			goto p_err;
+		}
+
+		fimc_is_frame_trans_com_to_fre(this, frame);
+		if (frame->state != FIMC_IS_FRAME_STATE_FREE) {
+			err("frame %d state is %d", i - 1, frame->state);
+			ret = -EINVAL;
+			goto p_err;
+		}
+	}
+
+	/* empty lists refuse the transition */
+	fimc_is_frame_request_head(this, &frame);
+	if (frame ||
+		fimc_is_frame_trans_req_to_pro(this, &this->frame[0]) != -EFAULT ||
+		fimc_is_frame_trans_pro_to_com(this, &this->frame[0]) != -EFAULT ||
+		fimc_is_frame_trans_com_to_fre(this, &this->frame[0]) != -EFAULT) {
+		err("empty list is not refused");
+		ret = -EINVAL;
+		goto p_err;
+	}
+
+	/* a frame taken off the free list can be put back */
+	fimc_is_frame_g_free_shot(this, &frame);
+	if (!frame || frame->state != FIMC_IS_FRAME_STATE_INVALID) {
+		err("free shot is invalid");
+		ret = -EINVAL;
+		goto p_err;
+	}
+
+	ret = fimc_is_framemgr_test_cnt(this, TEST_BUFFERS - 1, 0, 0, 0);
+	fimc_is_frame_s_free_shot(this, frame);
+	if (ret)
+		goto p_err;
+
+	ret = fimc_is_framemgr_test_cnt(this, TEST_BUFFERS, 0, 0, 0);
+
+p_err:
+	framemgr_x_barrier_irqr(this, 0, flags);
+	fimc_is_frame_close(this);
+	return ret;
+}
+
+static int fimc_is_framemgr_test_stage(enum fimc_is_frame_stage stage,
+	u32 *samples, int count, u32 min_us)
+{
+	int i, n;
+
+	n = fimc_is_frame_g_latency(TEST_ID, stage, samples,
+		FRAMEMGR_STAT_SAMPLES);
+	if (n != count) {
+		err("stage %d has %d samples(%d)", stage, n, count);
+		return -EINVAL;
+	}
+
+	for (i = 0; i < n; ++i) {
+		if (samples[i] < min_us) {
+			err("stage %d sample %d is %dus(%dus)", stage, i,
+				samples[i], min_us);
+			return -EINVAL;
+		}
+	}
+
+	return 0;
+}
+
+/* every stage of every cycle leaves one sample of at least its delay */
+static int fimc_is_framemgr_test_latency(struct fimc_is_framemgr *this)
+{
+	int ret = 0;
+	int n;
+	u32 i;
+	u32 *samples;
+	unsigned long flags;
+	struct fimc_is_frame *frame;
+
+	samples = kmalloc(FRAMEMGR_STAT_SAMPLES * sizeof(u32), GFP_KERNEL);
+	if (!samples) {
+		err("samples is NULL");
+		return -ENOMEM;
+	}
+
+	fimc_is_frame_reset_latency();
+	fimc_is_frame_open(this, TEST_ID, TEST_BUFFERS);
+
+	for (i = 0; i < TEST_CYCLES; ++i) {
+		frame = &this->frame[i % TEST_BUFFERS];
+
+		framemgr_e_barrier_irqs(this, 0, flags);
+		fimc_is_frame_trans_fre_to_req(this, frame);
+		framemgr_x_barrier_irqr(this, 0, flags);
+
+		udelay(TEST_REQUEST_US);
+
+		framemgr_e_barrier_irqs(this, 0, flags);
+		fimc_is_frame_trans_req_to_pro(this, frame);
+		framemgr_x_barrier_irqr(this, 0, flags);
+
+		udelay(TEST_PROCESS_US);
+
+		framemgr_e_barrier_irqs(this, 0, flags);
+		fimc_is_frame_trans_pro_to_com(this, frame);
+		fimc_is_frame_trans_com_to_fre(this, frame);
+		framemgr_x_barrier_irqr(this, 0, flags);
+	}
+
+	ret = fimc_is_framemgr_test_stage(FRAME_STAGE_REQUEST, samples,
+		TEST_CYCLES, TEST_REQUEST_US);
+	if (ret)
+		goto p_err;
+
+	ret = fimc_is_framemgr_test_stage(FRAME_STAGE_PROCESS, samples,
+		TEST_CYCLES, TEST_PROCESS_US);
+	if (ret)
+		goto p_err;
+
+	ret = fimc_is_framemgr_test_stage(FRAME_STAGE_TOTAL, samples,
+		TEST_CYCLES, TEST_REQUEST_US + TEST_PROCESS_US);
+	if (ret)
+		goto p_err;
+
+	/* the ring keeps the latest FRAMEMGR_STAT_SAMPLES */
+	frame = &this->frame[0];
+	for (i = 0; i < FRAMEMGR_STAT_SAMPLES; ++i) {
+		framemgr_e_barrier_irqs(this, 0, flags);
+		fimc_is_frame_trans_fre_to_req(this, frame);
+		fimc_is_frame_trans_req_to_com(this, frame);
+		fimc_is_frame_trans_com_to_fre(this, frame);
+		framemgr_x_barrier_irqr(this, 0, flags);
+	}
+
+	n = fimc_is_frame_g_latency(TEST_ID, FRAME_STAGE_REQUEST, samples,
+		FRAMEMGR_STAT_SAMPLES);
+	if (n != FRAMEMGR_STAT_SAMPLES || samples[n - 1] >= TEST_REQUEST_US) {
+		err("request ring did not wrap(%d)", n);
+		ret = -EINVAL;
+		goto p_err;
+	}
+
+	/* request to complete does not go through process */
+	n = fimc_is_frame_g_latency(TEST_ID, FRAME_STAGE_PROCESS, samples,
+		FRAMEMGR_STAT_SAMPLES);
+	if (n != TEST_CYCLES) {
+		err("process stage has %d samples(%d)", n, TEST_CYCLES);
+		ret = -EINVAL;
+	}
+
+p_err:
+	fimc_is_frame_close(this);
+	fimc_is_frame_reset_latency();
+	kfree(samples);
+	return ret;
+}
+
+static int __init fimc_is_framemgr_test_init(void)
+{
+	int ret = 0;
+	struct fimc_is_framemgr *framemgr;
+
+	framemgr = kzalloc(sizeof(struct fimc_is_framemgr), GFP_KERNEL);
+	if (!framemgr) {
+		err("framemgr is NULL");
+		return -ENOMEM;
+	}
+
+	ret = fimc_is_framemgr_test_trans(framemgr);
+	if (ret) {
+		err("fimc_is_framemgr_test_trans is fail(%d)", ret);
+		goto p_err;
+	}
+
+	ret = fimc_is_framemgr_test_latency(framemgr);
+	if (ret)
+		err("fimc_is_framemgr_test_latency is fail(%d)", ret);
+
+p_err:
+	kfree(framemgr);
+	return 0;
+}
+module_init(fimc_is_framemgr_test_init);
+
+MODULE_DESCRIPTION("Exynos FIMC-IS frame manager self test");
+MODULE_LICENSE("GPL");
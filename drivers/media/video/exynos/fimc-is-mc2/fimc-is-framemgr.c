@@ -31,6 +31,11 @@
 #include <linux/videodev2_exynos_media.h>
 #include <linux/v4l2-mediabus.h>
 #include <linux/bug.h>
+#include <linux/ktime.h>
+#include <linux/math64.h>
+#include <linux/sort.h>
+#include <linux/debugfs.h>
+#include <linux/seq_file.h>
 
 #include <mach/map.h>
 #include <mach/regs-clock.h>
@@ -44,12 +49,105 @@
 
 #include "fimc-is-device-sensor.h"
 
+/*
+ * Stage latency samples of all frame managers with the same id.  Writers
+ * only reserve a slot with an atomic increment, so the front and rear
+ * chains can record under their own framemgr locks, and the debugfs reader
+ * never blocks the interrupt paths; a slot being overwritten while it is
+ * read only costs one sample.
+ */
+struct fimc_is_frame_ring {
+	atomic_t		head;
+	u32			sample[FRAMEMGR_STAT_SAMPLES];
+};
+
+struct fimc_is_frame_stats {
+	u32			id;
+	const char		*name;
+	struct fimc_is_frame_ring	ring[FRAME_STAGE_MAX];
+};
+
+static struct fimc_is_frame_stats frame_stats[] = {
+	{ .id = FRAMEMGR_ID_SS0,	.name = "ss0" },
+	{ .id = FRAMEMGR_ID_SS1,	.name = "ss1" },
+	{ .id = FRAMEMGR_ID_3A0_GRP,	.name = "3aa0" },
+	{ .id = FRAMEMGR_ID_3A0,	.name = "3ac0" },
+	{ .id = FRAMEMGR_ID_3A1_GRP,	.name = "3aa1" },
+	{ .id = FRAMEMGR_ID_3A1,	.name = "3ac1" },
+	{ .id = FRAMEMGR_ID_ISP_GRP,	.name = "isp" },
+	{ .id = FRAMEMGR_ID_SCC,	.name = "scc" },
+	{ .id = FRAMEMGR_ID_DIS,	.name = "vdc" },
+	{ .id = FRAMEMGR_ID_DIS_GRP,	.name = "vdo" },
+	{ .id = FRAMEMGR_ID_SCP,	.name = "scp" },
+};
+
+static const char * const frame_stage_name[FRAME_STAGE_MAX] = {
+	"request", "process", "complete", "total"
+};
+
+static struct dentry *frame_debugfs;
+
+static struct fimc_is_frame_stats *fimc_is_frame_find_stats(u32 id)
+{
+	u32 i;
+
+	for (i = 0; i < ARRAY_SIZE(frame_stats); ++i)
+		if (frame_stats[i].id == id)
+			return &frame_stats[i];
+
+	return NULL;
+}
+
+static void fimc_is_frame_record(struct fimc_is_frame_stats *stats,
+	enum fimc_is_frame_stage stage, u64 ns)
+{
+	struct fimc_is_frame_ring *ring = &stats->ring[stage];
+	u32 pos;
+
+	pos = (u32)atomic_inc_return(&ring->head) - 1;
+	ring->sample[pos & (FRAMEMGR_STAT_SAMPLES - 1)] =
+		(u32)min_t(u64, div_u64(ns, NSEC_PER_USEC), UINT_MAX);
+}
+
+/*
+ * Called with the new state of item from every list insertion, the time
+ * spent in the previous state goes to its stage, REQUEST being the first.
+ */
+static void fimc_is_frame_stamp(struct fimc_is_framemgr *this,
+	struct fimc_is_frame *item, u32 state)
+{
+	u32 prev = item->stamp_state;
+	u64 now;
+
+	if (prev == state)
+		return;
+
+	now = ktime_to_ns(ktime_get());
+
+	if (this->stats) {
+		if (prev != FIMC_IS_FRAME_STATE_FREE)
+			fimc_is_frame_record(this->stats,
+				prev - FIMC_IS_FRAME_STATE_REQUEST,
+				now - item->stamp_ns);
+		if (state == FIMC_IS_FRAME_STATE_FREE)
+			fimc_is_frame_record(this->stats, FRAME_STAGE_TOTAL,
+				now - item->queued_ns);
+	}
+
+	if (prev == FIMC_IS_FRAME_STATE_FREE)
+		item->queued_ns = now;
+
+	item->stamp_state = state;
+	item->stamp_ns = now;
+}
+
 int fimc_is_frame_s_free_shot(struct fimc_is_framemgr *this,
 	struct fimc_is_frame *item)
 {
 	int ret = 0;
 
 	if (item) {
+		fimc_is_frame_stamp(this, item, FIMC_IS_FRAME_STATE_FREE);
 		item->state = FIMC_IS_FRAME_STATE_FREE;
 
 		list_add_tail(&item->list, &this->frame_free_head);
@@ -128,6 +226,7 @@ int fimc_is_frame_s_request_shot(struct fimc_is_framemgr *this,
 		list_add_tail(&item->list, &this->frame_request_head);
 		this->frame_req_cnt++;
 
+		fimc_is_frame_stamp(this, item, FIMC_IS_FRAME_STATE_REQUEST);
 		item->state = FIMC_IS_FRAME_STATE_REQUEST;
 
 #ifdef TRACE_FRAME
@@ -203,6 +302,7 @@ int fimc_is_frame_s_process_shot(struct fimc_is_framemgr *this,
 		list_add_tail(&item->list, &this->frame_process_head);
 		this->frame_pro_cnt++;
 
+		fimc_is_frame_stamp(this, item, FIMC_IS_FRAME_STATE_PROCESS);
 		item->state = FIMC_IS_FRAME_STATE_PROCESS;
 
 #ifdef TRACE_FRAME
@@ -278,6 +378,7 @@ int fimc_is_frame_s_complete_shot(struct fimc_is_framemgr *this,
 		list_add_tail(&item->list, &this->frame_complete_head);
 		this->frame_com_cnt++;
 
+		fimc_is_frame_stamp(this, item, FIMC_IS_FRAME_STATE_COMPLETE);
 		item->state = FIMC_IS_FRAME_STATE_COMPLETE;
 
 #ifdef TRACE_FRAME
@@ -518,6 +619,7 @@ int fimc_is_frame_open(struct fimc_is_framemgr *this, u32 id, u32 buffers)
 	INIT_LIST_HEAD(&this->frame_complete_head);
 
 	this->id = id;
+	this->stats = fimc_is_frame_find_stats(id);
 	this->frame_cnt = buffers;
 	this->frame_fre_cnt = 0;
 	this->frame_req_cnt = 0;
@@ -550,6 +652,7 @@ int fimc_is_frame_open(struct fimc_is_framemgr *this, u32 id, u32 buffers)
 
 		this->frame[i].kvaddr_shot = 0;
 		this->frame[i].dvaddr_shot = 0;
+		this->frame[i].stamp_state = FIMC_IS_FRAME_STATE_FREE;
 		fimc_is_frame_s_free_shot(this, &this->frame[i]);
 	}
 
@@ -599,3 +702,130 @@ void fimc_is_frame_print_all(struct fimc_is_framemgr *this)
 	fimc_is_frame_print_process_list(this);
 	fimc_is_frame_print_complete_list(this);
 }
+
+/**
+ * fimc_is_frame_g_latency - copy the latest latency samples of a stage
+ * @id: FRAMEMGR_ID_* of the frame managers
+ * @samples: array of @count latencies in us, oldest first
+ *
+ * Returns the number of samples copied.
+ */
+int fimc_is_frame_g_latency(u32 id, enum fimc_is_frame_stage stage,
+	u32 *samples, u32 count)
+{
+	struct fimc_is_frame_stats *stats;
+	struct fimc_is_frame_ring *ring;
+	u32 head, i;
+
+	stats = fimc_is_frame_find_stats(id);
+	if (!stats || stage >= FRAME_STAGE_MAX)
+		return -EINVAL;
+
+	ring = &stats->ring[stage];
+	head = (u32)atomic_read(&ring->head);
+	smp_rmb();
+
+	count = min3(count, head, (u32)FRAMEMGR_STAT_SAMPLES);
+	for (i = 0; i < count; ++i)
+		samples[i] = ring->sample[(head - count + i) &
+			(FRAMEMGR_STAT_SAMPLES - 1)];
+
+	return count;
+}
+
+void fimc_is_frame_reset_latency(void)
+{
+	u32 i, j;
+
+	for (i = 0; i < ARRAY_SIZE(frame_stats); ++i)
+		for (j = 0; j < FRAME_STAGE_MAX; ++j)
+			atomic_set(&frame_stats[i].ring[j].head, 0);
+}
+
+static int fimc_is_frame_cmp_u32(const void *a, const void *b)
+{
+	u32 x = *(const u32 *)a, y = *(const u32 *)b;
+
+	return x < y ? -1 : x > y;
+}
+
+static int fimc_is_frame_latency_show(struct seq_file *s, void *unused)
+{
+	struct fimc_is_frame_stats *stats;
+	u32 *samples;
+	u32 i, j;
+	int n;
+
+	samples = kmalloc(FRAMEMGR_STAT_SAMPLES * sizeof(u32), GFP_KERNEL);
+	if (!samples)
+		return -ENOMEM;
+
+	seq_printf(s, "%-5s %-8s %8s %8s %8s %8s %8s\n", "id", "stage",
+		"frames", "p50_us", "p90_us", "p99_us", "max_us");
+
+	for (i = 0; i < ARRAY_SIZE(frame_stats); ++i) {
+		stats = &frame_stats[i];
+
+		for (j = 0; j < FRAME_STAGE_MAX; ++j) {
+			n = fimc_is_frame_g_latency(stats->id, j, samples,
+				FRAMEMGR_STAT_SAMPLES);
+			if (n <= 0)
+				continue;
+
+			sort(samples, n, sizeof(u32), fimc_is_frame_cmp_u32,
+				NULL);
+
+			seq_printf(s, "%-5s %-8s %8u %8u %8u %8u %8u\n",
+				stats->name, frame_stage_name[j],
+				(u32)atomic_read(&stats->ring[j].head),
+				samples[(n - 1) * 50 / 100],
+				samples[(n - 1) * 90 / 100],
+				samples[(n - 1) * 99 / 100],
+				samples[n - 1]);
+		}
+	}
+
+	kfree(samples);
+
+	return 0;
+}
+
+static int fimc_is_frame_latency_open(struct inode *inode, struct file *file)
+{
+	return single_open(file, fimc_is_frame_latency_show, NULL);
+}
+
+/* any write starts the statistics over */
+static ssize_t fimc_is_frame_latency_write(struct file *file,
+	const char __user *buf, size_t count, loff_t *ppos)
+{
+	fimc_is_frame_reset_latency();
+
+	return count;
+}
+
+static const struct file_operations fimc_is_frame_latency_fops = {
+	.open		= fimc_is_frame_latency_open,
+	.read		= seq_read,
+	.write		= fimc_is_frame_latency_write,
+	.llseek		= seq_lseek,
+	.release	= single_release,
+};
+
+void fimc_is_frame_debugfs_init(void)
+{
+	frame_debugfs = debugfs_create_dir("fimc-is-framemgr", NULL);
+	if (IS_ERR_OR_NULL(frame_debugfs)) {
+		frame_debugfs = NULL;
+		return;
+	}
+
+	debugfs_create_file("latency", S_IRUGO | S_IWUSR, frame_debugfs,
+		NULL, &fimc_is_frame_latency_fops);
+}
+
+void fimc_is_frame_debugfs_exit(void)
+{
+	debugfs_remove_recursive(frame_debugfs);
+	frame_debugfs = NULL;
+}
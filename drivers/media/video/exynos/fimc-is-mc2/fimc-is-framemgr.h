@@ -35,6 +35,9 @@
 
 #define FRAMEMGR_MAX_REQUEST	12
 
+/* latency samples kept per stage and frame manager id, power of 2 */
+#define FRAMEMGR_STAT_SAMPLES	256
+
 /*flite frame start tasklet*/
 #define FMGR_IDX_0		(0x10)
 /*flite frame end tasklet*/
@@ -77,6 +80,15 @@ enum fimc_is_frame_shot_state {
 	FIMC_IS_FRAME_STATE_INVALID
 };
 
+/* time a frame spends in each state, and from queue to dequeue */
+enum fimc_is_frame_stage {
+	FRAME_STAGE_REQUEST,
+	FRAME_STAGE_PROCESS,
+	FRAME_STAGE_COMPLETE,
+	FRAME_STAGE_TOTAL,
+	FRAME_STAGE_MAX
+};
+
 enum fimc_is_frame_reqeust {
 	/* SCC, SCP frame done,
 	   ISP meta done */
@@ -151,8 +163,14 @@ struct fimc_is_frame {
 	struct timeval		time_shot;
 	struct timeval		time_shotdone;
 	struct timeval		time_dequeued;
+	/* stage latency, stamped at every state change */
+	u32			stamp_state;
+	u64			stamp_ns;
+	u64			queued_ns;
 };
 
+struct fimc_is_frame_stats;
+
 struct fimc_is_framemgr {
 	struct fimc_is_frame	frame[FRAMEMGR_MAX_REQUEST];
 
@@ -170,11 +188,17 @@ struct fimc_is_framemgr {
 	u32			frame_com_cnt;
 
 	u32			id;
+	struct fimc_is_frame_stats	*stats;
 };
 
 int fimc_is_frame_open(struct fimc_is_framemgr *this, u32 id, u32 buffers);
 int fimc_is_frame_close(struct fimc_is_framemgr *this);
 void fimc_is_frame_print_all(struct fimc_is_framemgr *this);
+int fimc_is_frame_g_latency(u32 id, enum fimc_is_frame_stage stage,
+	u32 *samples, u32 count);
+void fimc_is_frame_reset_latency(void);
+void fimc_is_frame_debugfs_init(void);
+void fimc_is_frame_debugfs_exit(void);
 
 int fimc_is_frame_s_free_shot(struct fimc_is_framemgr *this,
 	struct fimc_is_frame *frame);
@@ -86,6 +86,9 @@ enum debug_level {
 #define FIMG2D_BITBLT_SYNC	_IOW(FIMG2D_IOCTL_MAGIC, 1, int)
 #define FIMG2D_BITBLT_VERSION	_IOR(FIMG2D_IOCTL_MAGIC, 2, struct fimg2d_version)
 #define FIMG2D_BITBLT_ACTIVATE	_IOW(FIMG2D_IOCTL_MAGIC, 3, enum driver_act)
+#define FIMG2D_BITBLT_BATCH	_IOWR(FIMG2D_IOCTL_MAGIC, 4, struct fimg2d_batch)
+
+#define FIMG2D_MAX_BATCH	32
 
 enum fimg2d_qos_status {
 	FIMG2D_QOS_ON = 0,
@@ -433,6 +436,17 @@ struct fimg2d_blit {
 	unsigned int seq_no;
 };
 
+/**
+ * @blt: array of blit requests, run in order in one hardware session
+ * @nr_blits: number of requests in @blt, at most FIMG2D_MAX_BATCH
+ * @fence: [out] sync fence fd, signaled when the last blit is done
+ */
+struct fimg2d_batch {
+	struct fimg2d_blit *blt;
+	unsigned int nr_blits;
+	int fence;
+};
+
 #ifdef __KERNEL__
 
 enum perf_desc {
@@ -450,17 +464,27 @@ struct fimg2d_perf {
 	struct timeval end;
 };
 
+struct sw_sync_timeline;
+
 /**
- * @pgd: base address of arm mmu pagetable
  * @ncmd: request count in blit command queue
  * @wait_q: conext wait queue head
+ * @lock: serializes batch submissions of this context
+ * @async_mm: address space pinned for batch submissions
+ * @timeline: batch completion timeline, created on first batch
+ * @timeline_max: fence value of the last submitted batch
+ * @qos: holds a pm qos reference, taken on first hardware blit
 */
 struct fimg2d_context {
-	struct mm_struct *mm;
 	atomic_t ncmd;
 	wait_queue_head_t wait_q;
 	struct fimg2d_perf perf[MAX_PERF_DESCS];
 	void *vma_lock;
+	struct mutex lock;
+	struct mm_struct *async_mm;
+	struct sw_sync_timeline *timeline;
+	unsigned int timeline_max;
+	bool qos;
 };
 
 /**
@@ -478,7 +502,12 @@ struct fimg2d_context {
  * @dma_all: total dma size of src, msk, dst
  * @dma: array of dma info for each src, msk, tmp and dst
  * @ctx: context is created when user open fimg2d device.
+ * @mm: address space of the submitter, the command holds a reference.
+ *      not kept in @ctx, its next submitter may be another process.
  * @node: list head of blit command queue
+ * @async: submitted by FIMG2D_BITBLT_BATCH, nobody waits in the ioctl
+ * @fence_value: timeline value to signal when done, 0 if none.
+ *               set on the last command of a batch.
  */
 struct fimg2d_bltcmd {
 	struct fimg2d_blit blt;
@@ -486,7 +515,33 @@ struct fimg2d_bltcmd {
 	size_t dma_all;
 	struct fimg2d_dma_group dma[MAX_IMAGES];
 	struct fimg2d_context *ctx;
+	struct mm_struct *mm;
 	struct list_head node;
+	bool async;
+	unsigned int fence_value;
+};
+
+/**
+ * @hw_blits: blits routed to the hardware one by one
+ * @hw_pixels: pixels of @hw_blits
+ * @batched: blits submitted through FIMG2D_BITBLT_BATCH
+ * @cpu_blits: blits done by the cpu engine
+ * @cpu_pixels: pixels of @cpu_blits
+ * @cpu_ns: time spent in the cpu engine
+ * @cpu_busy: @cpu_blits taken because the hardware had work queued
+ * @unsupported: small blits the cpu engine can not do
+ * @ordered: small blits kept on the hardware behind pending ones
+ */
+struct fimg2d_route_stats {
+	unsigned long hw_blits;
+	unsigned long long hw_pixels;
+	unsigned long batched;
+	unsigned long cpu_blits;
+	unsigned long long cpu_pixels;
+	unsigned long long cpu_ns;
+	unsigned long cpu_busy;
+	unsigned long unsupported;
+	unsigned long ordered;
 };
 
 /**
@@ -503,6 +558,11 @@ struct fimg2d_bltcmd {
  * @wait_q: blit wait queue head
  * @cmd_q: blit command queue
  * @workqueue: workqueue_struct for kfimg2dd
+ * @nqos: contexts holding a pm qos reference, under @qoslock
+ * @cpu_idle_area: max pixels of a blit done by the cpu, hardware idle
+ * @cpu_busy_area: max pixels of a blit done by the cpu, hardware busy
+ * @stats: cpu/hardware routing statistics, under @bltlock
+ * @debugfs: debugfs directory
 */
 struct fimg2d_control {
 	struct clk *clock;
@@ -526,6 +586,13 @@ struct fimg2d_control {
 	struct pm_qos_request exynos5_g2d_mif_qos;
 	struct pm_qos_request exynos5_g2d_int_qos;
 
+	int nqos;
+	struct mutex qoslock;
+	u32 cpu_idle_area;
+	u32 cpu_busy_area;
+	struct fimg2d_route_stats stats;
+	struct dentry *debugfs;
+
 	int (*blit)(struct fimg2d_control *ctrl);
 	int (*configure)(struct fimg2d_control *ctrl,
 			struct fimg2d_bltcmd *cmd);
@@ -536,6 +603,11 @@ struct fimg2d_control {
 };
 
 int fimg2d_register_ops(struct fimg2d_control *ctrl);
+int fimg2d_ref_bitblt(struct fimg2d_control *ctrl);
+bool fimg2d_cpu_route(struct fimg2d_control *ctrl, struct fimg2d_bltcmd *cmd);
+int fimg2d_cpu_bitblt(struct fimg2d_control *ctrl, struct fimg2d_bltcmd *cmd);
+void fimg2d_cpu_init(struct fimg2d_control *ctrl);
+void fimg2d_cpu_exit(struct fimg2d_control *ctrl);
 int fimg2d_ip_version_is(void);
 int bit_per_pixel(struct fimg2d_image *img, int plane);
 
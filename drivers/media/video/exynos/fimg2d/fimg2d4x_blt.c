@@ -205,7 +205,7 @@ int fimg2d4x_bitblt(struct fimg2d_control *ctrl)
 	enum addr_space addr_type;
 	struct fimg2d_context *ctx;
 	struct fimg2d_bltcmd *cmd;
-	unsigned long *pgd;
+	unsigned long *pgd, *mmu_pgd = NULL;
 
 	fimg2d_debug("%s : enter blitter\n", __func__);
 
@@ -228,26 +228,43 @@ int fimg2d4x_bitblt(struct fimg2d_control *ctrl)
 
 		addr_type = cmd->image[IDST].addr.type;
 
-		ctx->vma_lock = vma_lock_mapping(ctx->mm, prefbuf, MAX_IMAGES - 1);
+		ctx->vma_lock = vma_lock_mapping(cmd->mm, prefbuf, MAX_IMAGES - 1);
 
-		if (fimg2d_check_pgd(ctx->mm, cmd)) {
+		if (fimg2d_check_pgd(cmd->mm, cmd)) {
 			ret = -EFAULT;
 			goto fail_n_del;
 		}
 
 		if (addr_type == ADDR_USER || addr_type == ADDR_USER_CONTIG) {
-			if (!ctx->mm || !ctx->mm->pgd) {
+			if (!cmd->mm || !cmd->mm->pgd) {
 				atomic_set(&ctrl->busy, 0);
 				goto fail_n_del;
 			}
-			pgd = (unsigned long *)ctx->mm->pgd;
-			exynos_sysmmu_enable(ctrl->dev,
+			pgd = (unsigned long *)cmd->mm->pgd;
+
+			/*
+			 * Back to back commands of one address space, e.g. a
+			 * batch, keep the sysmmu on and only drop its TLB.
+			 */
+			if (pgd == mmu_pgd) {
+				exynos_sysmmu_tlb_invalidate(ctrl->dev);
+			} else {
+				if (mmu_pgd)
+					exynos_sysmmu_disable(ctrl->dev);
+				exynos_sysmmu_enable(ctrl->dev,
 					(unsigned long)virt_to_phys(pgd));
-			fimg2d_debug("%s : sysmmu enable: pgd %p ctx %p seq_no(%u)\n",
-				__func__, pgd, ctx, cmd->blt.seq_no);
+				mmu_pgd = pgd;
+				fimg2d_debug("%s : sysmmu enable: pgd %p ctx %p seq_no(%u)\n",
+					__func__, pgd, ctx, cmd->blt.seq_no);
+			}
 
 			exynos_sysmmu_set_pbuf(ctrl->dev, nbufs, prefbuf);
 			fimg2d_debug("%s : set smmu prefbuf\n", __func__);
+		} else if (mmu_pgd) {
+			/* no other address space may stay behind the sysmmu */
+			exynos_sysmmu_disable(ctrl->dev);
+			mmu_pgd = NULL;
+			fimg2d_debug("sysmmu disable\n");
 		}
 
 		fimg2d4x_pre_bitblt(ctrl, cmd);
@@ -258,16 +275,16 @@ int fimg2d4x_bitblt(struct fimg2d_control *ctrl)
 		ctrl->run(ctrl);
 		ret = fimg2d4x_blit_wait(ctrl, cmd);
 		perf_end(cmd, PERF_BLIT);
-
-		if (addr_type == ADDR_USER || addr_type == ADDR_USER_CONTIG) {
-			exynos_sysmmu_disable(ctrl->dev);
-			fimg2d_debug("sysmmu disable\n");
-		}
 fail_n_del:
 		vma_unlock_mapping(ctx->vma_lock);
 		fimg2d_del_command(ctrl, cmd);
 	}
 
+	if (mmu_pgd) {
+		exynos_sysmmu_disable(ctrl->dev);
+		fimg2d_debug("sysmmu disable\n");
+	}
+
 	fimg2d_debug("%s : exit blitter\n", __func__);
 
 	return ret;
@@ -0,0 +1,503 @@
+/* linux/drivers/media/video/exynos/fimg2d/fimg2d_cpu.c
+ *
+ * Copyright (c) 2011 Samsung Electronics Co., Ltd.
+ *	http://www.samsung.com/
+ *
+ * Samsung Graphics 2D driver, cpu engine for small blits
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+*/
+
+#include <linux/slab.h>
+#include <linux/sched.h>
+#include <linux/uaccess.h>
+#include <linux/ktime.h>
+#include <linux/math64.h>
+#include <linux/debugfs.h>
+#include <linux/seq_file.h>
+#include "fimg2d.h"
+#include "fimg2d_ctx.h"
+#include "fimg2d_helper.h"
+
+/*
+ * A small blit costs more in clock gating, pm qos, sysmmu setup and cache
+ * maintenance than in the blit itself, so blits below an area threshold
+ * are done right away by the cpu in the context of the caller.
+ *
+ * The engine works on chunks of CPU_CHUNK pixels unpacked to ARGB8888 and
+ * blends two channels per multiply.  Results are bit exact with the
+ * reference blitter in fimg2d_ref.c.
+ */
+
+#define CPU_CHUNK		64	/* pixels per pass, kept on stack */
+#define CPU_IDLE_AREA		(64 * 64)
+#define CPU_BUSY_AREA		(128 * 128)
+
+static inline bool cpu_fmt_supported(struct fimg2d_image *img)
+{
+	if (img->order != AX_RGB)
+		return false;
+
+	switch (img->fmt) {
+	case CF_XRGB_8888:
+	case CF_ARGB_8888:
+	case CF_RGB_565:
+	case CF_XRGB_1555:
+	case CF_ARGB_1555:
+	case CF_XRGB_4444:
+	case CF_ARGB_4444:
+	case CF_RGB_888:
+	case CF_A8:
+		return true;
+	default:
+		return false;
+	}
+}
+
+static inline bool cpu_fmt_opaque(enum color_format fmt)
+{
+	switch (fmt) {
+	case CF_ARGB_8888:
+	case CF_ARGB_1555:
+	case CF_ARGB_4444:
+	case CF_A8:
+		return false;
+	default:
+		return true;
+	}
+}
+
+static void cpu_unpack(const u8 *p, enum color_format fmt, u32 *out, int n)
+{
+	u32 v, r, g, b, a;
+	int i;
+
+	switch (fmt) {
+	case CF_XRGB_8888:
+		for (i = 0; i < n; i++)
+			out[i] = ((const u32 *)p)[i] | 0xff000000;
+		break;
+	case CF_ARGB_8888:
+		memcpy(out, p, n * 4);
+		break;
+	case CF_RGB_565:
+		for (i = 0; i < n; i++) {
+			v = ((const u16 *)p)[i];
+			r = (v >> 11) & 0x1f;
+			g = (v >> 5) & 0x3f;
+			b = v & 0x1f;
+			r = (r << 3) | (r >> 2);
+			g = (g << 2) | (g >> 4);
+			b = (b << 3) | (b >> 2);
+			out[i] = 0xff000000 | (r << 16) | (g << 8) | b;
+		}
+		break;
+	case CF_XRGB_1555:
+	case CF_ARGB_1555:
+		for (i = 0; i < n; i++) {
+			v = ((const u16 *)p)[i];
+			r = (v >> 10) & 0x1f;
+			g = (v >> 5) & 0x1f;
+			b = v & 0x1f;
+			r = (r << 3) | (r >> 2);
+			g = (g << 3) | (g >> 2);
+			b = (b << 3) | (b >> 2);
+			a = (fmt == CF_XRGB_1555 || (v & 0x8000)) ? 0xff : 0;
+			out[i] = (a << 24) | (r << 16) | (g << 8) | b;
+		}
+		break;
+	case CF_XRGB_4444:
+	case CF_ARGB_4444:
+		for (i = 0; i < n; i++) {
+			v = ((const u16 *)p)[i];
+			v = ((v & 0xf000) << 12) | ((v & 0x0f00) << 8) |
+				((v & 0x00f0) << 4) | (v & 0x000f);
+			v |= v << 4;
+			out[i] = (fmt == CF_XRGB_4444) ? v | 0xff000000 : v;
+		}
+		break;
+	case CF_RGB_888:
+		for (i = 0; i < n; i++, p += 3)
+			out[i] = 0xff000000 | (p[2] << 16) | (p[1] << 8) | p[0];
+		break;
+	case CF_A8:
+		for (i = 0; i < n; i++)
+			out[i] = p[i] << 24;
+		break;
+	default:
+		break;
+	}
+}
+
+static void cpu_pack(const u32 *in, enum color_format fmt, u8 *p, int n)
+{
+	u32 v;
+	int i;
+
+	switch (fmt) {
+	case CF_XRGB_8888:
+		for (i = 0; i < n; i++)
+			((u32 *)p)[i] = in[i] | 0xff000000;
+		break;
+	case CF_ARGB_8888:
+		memcpy(p, in, n * 4);
+		break;
+	case CF_RGB_565:
+		for (i = 0; i < n; i++) {
+			v = in[i];
+			((u16 *)p)[i] = ((v >> 8) & 0xf800) |
+				((v >> 5) & 0x07e0) | ((v >> 3) & 0x001f);
+		}
+		break;
+	case CF_XRGB_1555:
+	case CF_ARGB_1555:
+		for (i = 0; i < n; i++) {
+			v = in[i];
+			((u16 *)p)[i] = ((v >> 9) & 0x7c00) |
+				((v >> 6) & 0x03e0) | ((v >> 3) & 0x001f) |
+				((fmt == CF_XRGB_1555 || (v & 0x80000000)) ?
+				 0x8000 : 0);
+		}
+		break;
+	case CF_XRGB_4444:
+	case CF_ARGB_4444:
+		for (i = 0; i < n; i++) {
+			v = in[i];
+			if (fmt == CF_XRGB_4444)
+				v |= 0xff000000;
+			((u16 *)p)[i] = ((v >> 16) & 0xf000) |
+				((v >> 12) & 0x0f00) | ((v >> 8) & 0x00f0) |
+				((v >> 4) & 0x000f);
+		}
+		break;
+	case CF_RGB_888:
+		for (i = 0; i < n; i++, p += 3) {
+			p[0] = in[i];
+			p[1] = in[i] >> 8;
+			p[2] = in[i] >> 16;
+		}
+		break;
+	case CF_A8:
+		for (i = 0; i < n; i++)
+			p[i] = in[i] >> 24;
+		break;
+	default:
+		break;
+	}
+}
+
+/* c * f / 255 for all four channels, two at a time */
+static inline u32 cpu_mul(u32 c, u32 f)
+{
+	u32 rb = (c & 0x00ff00ff) * f + 0x00800080;
+	u32 ag = ((c >> 8) & 0x00ff00ff) * f + 0x00800080;
+
+	rb = ((rb + ((rb >> 8) & 0x00ff00ff)) >> 8) & 0x00ff00ff;
+	ag = (ag + ((ag >> 8) & 0x00ff00ff)) & 0xff00ff00;
+	return rb | ag;
+}
+
+/* per channel saturating add */
+static inline u32 cpu_add_sat(u32 a, u32 b)
+{
+	u32 rb = (a & 0x00ff00ff) + (b & 0x00ff00ff);
+	u32 ag = ((a >> 8) & 0x00ff00ff) + ((b >> 8) & 0x00ff00ff);
+
+	rb |= 0x01000100 - ((rb >> 8) & 0x00010001);
+	ag |= 0x01000100 - ((ag >> 8) & 0x00010001);
+	return (rb & 0x00ff00ff) | ((ag & 0x00ff00ff) << 8);
+}
+
+/* premultiplied src-over with global alpha, d = s * ga + d * (1 - sa * ga) */
+static void cpu_src_over(const u32 *s, u32 *d, u32 ga, int n)
+{
+	u32 c;
+	int i;
+
+	for (i = 0; i < n; i++) {
+		c = (ga == 0xff) ? s[i] : cpu_mul(s[i], ga);
+		if ((c >> 24) == 0xff)
+			d[i] = c;
+		else
+			d[i] = cpu_add_sat(c, cpu_mul(d[i], 0xff - (c >> 24)));
+	}
+}
+
+/* cpu_blit() reaches the images through copy_{from,to}_user() */
+static inline bool cpu_addr_user(struct fimg2d_image *img)
+{
+	return img->addr.type == ADDR_USER ||
+		img->addr.type == ADDR_USER_CONTIG;
+}
+
+static int cpu_check(struct fimg2d_bltcmd *cmd)
+{
+	struct fimg2d_param *p = &cmd->blt.param;
+	struct fimg2d_image *src = &cmd->image[ISRC];
+	struct fimg2d_image *dst = &cmd->image[IDST];
+
+	if (cmd->image[IMSK].addr.type || cmd->image[ITMP].addr.type)
+		return -EOPNOTSUPP;
+
+	if (!cpu_addr_user(dst) || (src->addr.type && !cpu_addr_user(src)))
+		return -EOPNOTSUPP;
+
+	if (p->scaling.mode || p->rotate || p->bluscr.mode)
+		return -EOPNOTSUPP;
+
+	if (!cpu_fmt_supported(dst))
+		return -EOPNOTSUPP;
+
+	switch (cmd->blt.op) {
+	case BLIT_OP_SOLID_FILL:
+	case BLIT_OP_CLR:
+		return 0;
+	case BLIT_OP_SRC:
+		break;
+	case BLIT_OP_SRC_OVER:
+		if (p->premult != PREMULTIPLIED)
+			return -EOPNOTSUPP;
+		break;
+	default:
+		return -EOPNOTSUPP;
+	}
+
+	if (!src->addr.type)
+		return 0;
+
+	if (!cpu_fmt_supported(src) ||
+			rect_w(&src->rect) != rect_w(&dst->rect) ||
+			rect_h(&src->rect) != rect_h(&dst->rect))
+		return -EOPNOTSUPP;
+
+	return 0;
+}
+
+/* dst rect clipped, the area the blit writes */
+static void cpu_dst_rect(struct fimg2d_bltcmd *cmd, struct fimg2d_rect *r)
+{
+	struct fimg2d_clip *clp = &cmd->blt.param.clipping;
+
+	*r = cmd->image[IDST].rect;
+	if (clp->enable) {
+		r->x1 = max(r->x1, clp->x1);
+		r->y1 = max(r->y1, clp->y1);
+		r->x2 = min(r->x2, clp->x2);
+		r->y2 = min(r->y2, clp->y2);
+	}
+}
+
+static int cpu_blit(struct fimg2d_bltcmd *cmd, struct fimg2d_rect *r)
+{
+	struct fimg2d_param *p = &cmd->blt.param;
+	struct fimg2d_image *src = &cmd->image[ISRC];
+	struct fimg2d_image *dst = &cmd->image[IDST];
+	u32 sbuf[CPU_CHUNK], dbuf[CPU_CHUNK];
+	u8 raw[CPU_CHUNK * 4];
+	int op = cmd->blt.op;
+	int sbpp = 0, dbpp, x, y, n, sx, sy;
+	unsigned long saddr = 0, daddr;
+	bool copy = false;
+
+	dbpp = bit_per_pixel(dst, 0) >> 3;
+
+	if (src->addr.type) {
+		sbpp = bit_per_pixel(src, 0) >> 3;
+		/* opaque src-over without global alpha is a copy */
+		if (op == BLIT_OP_SRC_OVER && p->g_alpha == 0xff &&
+				cpu_fmt_opaque(src->fmt))
+			op = BLIT_OP_SRC;
+		copy = (op == BLIT_OP_SRC && src->fmt == dst->fmt);
+	} else {
+		u32 color = (op == BLIT_OP_CLR) ? 0 : p->solid_color;
+
+		for (x = 0; x < CPU_CHUNK; x++)
+			sbuf[x] = color;
+		if (op != BLIT_OP_SRC_OVER) {
+			cpu_pack(sbuf, dst->fmt, raw, CPU_CHUNK);
+			copy = true;
+		}
+	}
+
+	sx = src->rect.x1 + (r->x1 - dst->rect.x1);
+	sy = src->rect.y1 + (r->y1 - dst->rect.y1);
+
+	for (y = 0; y < rect_h(r); y++) {
+		for (x = 0; x < rect_w(r); x += n) {
+			n = min(CPU_CHUNK, rect_w(r) - x);
+			daddr = dst->addr.start + (r->y1 + y) * dst->stride +
+				(r->x1 + x) * dbpp;
+			if (src->addr.type)
+				saddr = src->addr.start +
+					(sy + y) * src->stride + (sx + x) * sbpp;
+
+			if (copy) {
+				/* same format copy or fill, no unpacking */
+				if (src->addr.type && copy_from_user(raw,
+						(void __user *)saddr, n * sbpp))
+					return -EFAULT;
+				if (copy_to_user((void __user *)daddr, raw,
+						n * dbpp))
+					return -EFAULT;
+				continue;
+			}
+
+			if (src->addr.type) {
+				if (copy_from_user(raw, (void __user *)saddr,
+						n * sbpp))
+					return -EFAULT;
+				cpu_unpack(raw, src->fmt, sbuf, n);
+			}
+
+			if (op == BLIT_OP_SRC_OVER) {
+				if (copy_from_user(raw, (void __user *)daddr,
+						n * dbpp))
+					return -EFAULT;
+				cpu_unpack(raw, dst->fmt, dbuf, n);
+				cpu_src_over(sbuf, dbuf, p->g_alpha, n);
+				cpu_pack(dbuf, dst->fmt, raw, n);
+			} else {
+				cpu_pack(sbuf, dst->fmt, raw, n);
+			}
+
+			if (copy_to_user((void __user *)daddr, raw, n * dbpp))
+				return -EFAULT;
+		}
+	}
+
+	return 0;
+}
+
+/**
+ * fimg2d_cpu_route - decide whether the cpu does @cmd
+ *
+ * Small blits go to the cpu, with a higher threshold while the hardware
+ * has work queued.  Blits of a context with commands still queued stay on
+ * the hardware to keep them in order.
+ */
+bool fimg2d_cpu_route(struct fimg2d_control *ctrl, struct fimg2d_bltcmd *cmd)
+{
+	struct fimg2d_route_stats *st = &ctrl->stats;
+	struct fimg2d_rect r;
+	unsigned long flags;
+	unsigned int area, limit;
+	bool busy, cpu = false;
+
+	cpu_dst_rect(cmd, &r);
+	area = max(rect_w(&r), 0) * max(rect_h(&r), 0);
+
+	g2d_spin_lock(&ctrl->bltlock, flags);
+	busy = atomic_read(&ctrl->busy) || !fimg2d_queue_is_empty(&ctrl->cmd_q);
+	limit = busy ? ctrl->cpu_busy_area : ctrl->cpu_idle_area;
+
+	if (area > limit) {
+		/* hardware */
+	} else if (cpu_check(cmd)) {
+		st->unsupported++;
+	} else if (atomic_read(&cmd->ctx->ncmd)) {
+		st->ordered++;
+	} else {
+		cpu = true;
+		if (busy && area > ctrl->cpu_idle_area)
+			st->cpu_busy++;
+	}
+
+	if (!cpu) {
+		st->hw_blits++;
+		st->hw_pixels += area;
+	}
+	g2d_spin_unlock(&ctrl->bltlock, flags);
+
+	return cpu;
+}
+
+/* run @cmd on the cpu in the caller's context, @cmd is consumed */
+int fimg2d_cpu_bitblt(struct fimg2d_control *ctrl, struct fimg2d_bltcmd *cmd)
+{
+	struct fimg2d_route_stats *st = &ctrl->stats;
+	struct fimg2d_rect r;
+	unsigned long flags;
+	ktime_t start;
+	s64 ns;
+	int ret = 0;
+
+	cpu_dst_rect(cmd, &r);
+
+	start = ktime_get();
+	if (rect_w(&r) > 0 && rect_h(&r) > 0)
+		ret = cpu_blit(cmd, &r);
+	ns = ktime_to_ns(ktime_sub(ktime_get(), start));
+
+	fimg2d_debug("ctx %p seq_no(%u) op(%d) %dx%d by cpu, ret %d\n",
+			cmd->ctx, cmd->blt.seq_no, cmd->blt.op,
+			rect_w(&r), rect_h(&r), ret);
+
+	g2d_spin_lock(&ctrl->bltlock, flags);
+	st->cpu_blits++;
+	st->cpu_pixels += max(rect_w(&r), 0) * max(rect_h(&r), 0);
+	st->cpu_ns += ns;
+	g2d_spin_unlock(&ctrl->bltlock, flags);
+
+	fimg2d_free_command(cmd);
+	return ret;
+}
+
+static int fimg2d_route_show(struct seq_file *s, void *unused)
+{
+	struct fimg2d_control *ctrl = s->private;
+	struct fimg2d_route_stats st;
+	unsigned long flags;
+
+	g2d_spin_lock(&ctrl->bltlock, flags);
+	st = ctrl->stats;
+	g2d_spin_unlock(&ctrl->bltlock, flags);
+
+	seq_printf(s, "hw_blits     %lu\n", st.hw_blits);
+	seq_printf(s, "hw_pixels    %llu\n", st.hw_pixels);
+	seq_printf(s, "batched      %lu\n", st.batched);
+	seq_printf(s, "cpu_blits    %lu\n", st.cpu_blits);
+	seq_printf(s, "cpu_pixels   %llu\n", st.cpu_pixels);
+	seq_printf(s, "cpu_us       %llu\n", div_u64(st.cpu_ns, NSEC_PER_USEC));
+	seq_printf(s, "cpu_busy     %lu\n", st.cpu_busy);
+	seq_printf(s, "unsupported  %lu\n", st.unsupported);
+	seq_printf(s, "ordered      %lu\n", st.ordered);
+	return 0;
+}
+
+static int fimg2d_route_open(struct inode *inode, struct file *file)
+{
+	return single_open(file, fimg2d_route_show, inode->i_private);
+}
+
+static const struct file_operations fimg2d_route_fops = {
+	.open           = fimg2d_route_open,
+	.read           = seq_read,
+	.llseek         = seq_lseek,
+	.release        = single_release,
+};
+
+void fimg2d_cpu_init(struct fimg2d_control *ctrl)
+{
+	ctrl->cpu_idle_area = CPU_IDLE_AREA;
+	ctrl->cpu_busy_area = CPU_BUSY_AREA;
+
+	ctrl->debugfs = debugfs_create_dir("fimg2d", NULL);
+	if (IS_ERR_OR_NULL(ctrl->debugfs)) {
+		ctrl->debugfs = NULL;
+		return;
+	}
+
+	debugfs_create_file("route", S_IRUGO, ctrl->debugfs, ctrl,
+			&fimg2d_route_fops);
+	debugfs_create_u32("cpu_idle_area", S_IRUGO | S_IWUSR, ctrl->debugfs,
+			&ctrl->cpu_idle_area);
+	debugfs_create_u32("cpu_busy_area", S_IRUGO | S_IWUSR, ctrl->debugfs,
+			&ctrl->cpu_busy_area);
+}
+
+void fimg2d_cpu_exit(struct fimg2d_control *ctrl)
+{
+	debugfs_remove_recursive(ctrl->debugfs);
+}
@@ -13,6 +13,8 @@
 #include <linux/slab.h>
 #include <linux/sched.h>
 #include <linux/uaccess.h>
+#include <linux/mmu_context.h>
+#include <linux/sw_sync.h>
 #include <plat/fimg2d.h>
 #include "fimg2d.h"
 #include "fimg2d_clk.h"
@@ -493,7 +495,7 @@ static void outer_flush_clip_range(struct fimg2d_bltcmd *cmd)
 	if (WARN_ON(!cmd->ctx))
 		return;
 
-	mm = cmd->ctx->mm;
+	mm = cmd->mm;
 
 	clp = &blt->param.clipping;
 	dir = CACHE_CLEAN;
@@ -581,9 +583,9 @@ static void outer_flush_clip_range(struct fimg2d_bltcmd *cmd)
 }
 #endif /* CONFIG_OUTER_CACHE */
 
-static int fimg2d_check_dma_sync(struct fimg2d_bltcmd *cmd)
+static int fimg2d_check_dma(struct fimg2d_bltcmd *cmd)
 {
-	struct mm_struct *mm = cmd->ctx->mm;
+	struct mm_struct *mm = cmd->mm;
 	struct fimg2d_dma *c;
 	enum pt_status pt;
 	int i;
@@ -603,25 +605,42 @@ static int fimg2d_check_dma_sync(struct fimg2d_bltcmd *cmd)
 			return -EFAULT;
 	}
 
+	return 0;
+}
+
+/*
+ * Cache maintenance for a list of commands at once.  The flush-all
+ * thresholds are applied to the total dma size of the list, so a batch of
+ * many small blits costs one whole-cache flush instead of one ranged flush
+ * per blit.
+ */
+static void fimg2d_dma_sync_commands(struct list_head *cmds, size_t dma_all)
+{
 #ifndef CCI_SNOOP
+	struct fimg2d_bltcmd *cmd, *first;
+
+	first = list_first_entry(cmds, struct fimg2d_bltcmd, node);
+
 	fimg2d_debug("cache flush\n");
-	perf_start(cmd, PERF_CACHE);
-	if (is_inner_flushall(cmd->dma_all)) {
-		inner_touch_range(cmd);
+	perf_start(first, PERF_CACHE);
+	if (is_inner_flushall(dma_all)) {
+		list_for_each_entry(cmd, cmds, node)
+			inner_touch_range(cmd);
 		flush_all_cpu_caches();
 	} else {
-		inner_flush_clip_range(cmd);
+		list_for_each_entry(cmd, cmds, node)
+			inner_flush_clip_range(cmd);
 	}
 
 #ifdef CONFIG_OUTER_CACHE
-	if (is_outer_flushall(cmd->dma_all))
+	if (is_outer_flushall(dma_all))
 		outer_flush_all();
 	else
-		outer_flush_clip_range(cmd);
+		list_for_each_entry(cmd, cmds, node)
+			outer_flush_clip_range(cmd);
 #endif
-	perf_end(cmd, PERF_CACHE);
+	perf_end(first, PERF_CACHE);
 #endif
-	return 0;
 }
 
 int fimg2d_check_pgd(struct mm_struct *mm, struct fimg2d_bltcmd *cmd)
@@ -647,10 +666,16 @@ err_pgtable:
 	return ret;
 }
 
-int fimg2d_add_command(struct fimg2d_control *ctrl,
-		struct fimg2d_context *ctx, struct fimg2d_blit __user *buf)
+/**
+ * fimg2d_copy_command - copy a blit request from user and check it
+ * @mm: address space the request is done in, referenced by the command
+ *
+ * The returned command is not yet checked for dma, it can be given to
+ * fimg2d_queue_command() or run by the cpu engine.
+ */
+struct fimg2d_bltcmd *fimg2d_copy_command(struct fimg2d_context *ctx,
+		struct mm_struct *mm, struct fimg2d_blit __user *buf)
 {
-	unsigned long flags;
 	struct fimg2d_blit *blt;
 	struct fimg2d_bltcmd *cmd;
 	int len = sizeof(struct fimg2d_image);
@@ -658,7 +683,7 @@ int fimg2d_add_command(struct fimg2d_control *ctrl,
 
 	cmd = kzalloc(sizeof(*cmd), GFP_KERNEL);
 	if (!cmd)
-		return -ENOMEM;
+		return ERR_PTR(-ENOMEM);
 
 	if (copy_from_user(&cmd->blt, buf, sizeof(cmd->blt))) {
 		ret = -EFAULT;
@@ -666,6 +691,8 @@ int fimg2d_add_command(struct fimg2d_control *ctrl,
 	}
 
 	cmd->ctx = ctx;
+	cmd->mm = mm;
+	atomic_inc(&mm->mm_users);
 
 	blt = &cmd->blt;
 
@@ -712,32 +739,149 @@ int fimg2d_add_command(struct fimg2d_control *ctrl,
 
 	fimg2d_fixup_params(cmd);
 
-	if (fimg2d_check_dma_sync(cmd)) {
-		ret = -EFAULT;
-		goto err;
-	}
+	return cmd;
+
+err:
+	fimg2d_free_command(cmd);
+	return ERR_PTR(ret);
+}
+
+/* free a command that is not or no longer queued, may sleep */
+void fimg2d_free_command(struct fimg2d_bltcmd *cmd)
+{
+	if (cmd->mm)
+		mmput(cmd->mm);
+	kfree(cmd);
+}
+
+/* do cache maintenance for @cmds and queue them, @cmds is consumed */
+static int fimg2d_queue_commands(struct fimg2d_control *ctrl,
+		struct fimg2d_context *ctx, struct list_head *cmds,
+		int nr, size_t dma_all)
+{
+	unsigned long flags;
+	struct fimg2d_bltcmd *cmd, *tmp;
 
-	/* add command node and increase ncmd */
+	fimg2d_dma_sync_commands(cmds, dma_all);
+
+	/* add command nodes and increase ncmd */
 	g2d_spin_lock(&ctrl->bltlock, flags);
 	if (atomic_read(&ctrl->drvact) || atomic_read(&ctrl->suspended)) {
 		fimg2d_debug("driver is unavailable, do sw fallback\n");
 		g2d_spin_unlock(&ctrl->bltlock, flags);
-		ret = -EPERM;
-		goto err;
+		list_for_each_entry_safe(cmd, tmp, cmds, node)
+			fimg2d_free_command(cmd);
+		return -EPERM;
 	}
-	atomic_inc(&ctx->ncmd);
-	fimg2d_enqueue(&cmd->node, &ctrl->cmd_q);
+	cmd = list_entry(cmds->prev, struct fimg2d_bltcmd, node);
+	atomic_add(nr, &ctx->ncmd);
+	list_splice_tail(cmds, &ctrl->cmd_q);
 	fimg2d_debug("ctx %p pgd %p ncmd(%d) seq_no(%u)\n",
-			cmd->ctx, (unsigned long *)cmd->ctx->mm->pgd,
+			ctx, (unsigned long *)cmd->mm->pgd,
 			atomic_read(&ctx->ncmd), cmd->blt.seq_no);
 	g2d_spin_unlock(&ctrl->bltlock, flags);
 	return 0;
+}
+
+/* queue a command from fimg2d_copy_command(), @cmd is consumed */
+int fimg2d_queue_command(struct fimg2d_control *ctrl,
+		struct fimg2d_context *ctx, struct fimg2d_bltcmd *cmd)
+{
+	LIST_HEAD(cmds);
+
+	if (fimg2d_check_dma(cmd)) {
+		fimg2d_free_command(cmd);
+		return -EFAULT;
+	}
+
+	list_add_tail(&cmd->node, &cmds);
+	return fimg2d_queue_commands(ctrl, ctx, &cmds, 1, cmd->dma_all);
+}
+
+/**
+ * fimg2d_add_commands - validate and queue blit requests
+ * @buf: user array of @nr blit requests
+ * @fence_value: timeline value signaled when the last request is done,
+ *               0 for a synchronous request
+ *
+ * Either all requests are queued back to back or none is.  Cache
+ * maintenance is done once for the whole set.
+ */
+int fimg2d_add_commands(struct fimg2d_control *ctrl,
+		struct fimg2d_context *ctx, struct mm_struct *mm,
+		struct fimg2d_blit __user *buf, int nr,
+		unsigned int fence_value)
+{
+	struct fimg2d_bltcmd *cmd, *tmp;
+	LIST_HEAD(cmds);
+	size_t dma_all = 0;
+	int i, ret = 0;
+
+	for (i = 0; i < nr; i++) {
+		cmd = fimg2d_copy_command(ctx, mm, buf + i);
+		if (IS_ERR(cmd)) {
+			ret = PTR_ERR(cmd);
+			goto err;
+		}
+		list_add_tail(&cmd->node, &cmds);
+		if (fimg2d_check_dma(cmd)) {
+			ret = -EFAULT;
+			goto err;
+		}
+		cmd->async = !!fence_value;
+		dma_all += cmd->dma_all;
+	}
+	cmd->fence_value = fence_value;
+
+	return fimg2d_queue_commands(ctrl, ctx, &cmds, nr, dma_all);
 
 err:
-	kfree(cmd);
+	list_for_each_entry_safe(cmd, tmp, &cmds, node)
+		fimg2d_free_command(cmd);
 	return ret;
 }
 
+/* called with ctx->lock held, the fence takes value timeline_max + 1 */
+struct sync_fence *fimg2d_create_fence(struct fimg2d_context *ctx)
+{
+	struct sync_fence *fence;
+	struct sync_pt *pt;
+
+	if (!ctx->timeline) {
+		ctx->timeline = sw_sync_timeline_create("fimg2d");
+		if (!ctx->timeline)
+			return NULL;
+	}
+
+	pt = sw_sync_pt_create(ctx->timeline, ctx->timeline_max + 1);
+	if (!pt)
+		return NULL;
+
+	fence = sync_fence_create("fimg2d", pt);
+	if (!fence)
+		sync_pt_free(pt);
+
+	return fence;
+}
+
+/*
+ * Nobody waits in the ioctl for a batched command, so the invalidate the
+ * synchronous path does after the blit is done here, in the address space
+ * of the submitter.
+ */
+static void fimg2d_unsync_dst(struct fimg2d_bltcmd *cmd)
+{
+	struct mm_struct *mm = cmd->mm;
+	struct fimg2d_dma *c = &cmd->dma[IDST].base;
+	bool adopt = !current->mm;
+
+	if (adopt)
+		use_mm(mm);
+	fimg2d_dma_unsync_inner(c->addr, c->size, DMA_FROM_DEVICE);
+	if (adopt)
+		unuse_mm(mm);
+}
+
 void fimg2d_del_command(struct fimg2d_control *ctrl, struct fimg2d_bltcmd *cmd)
 {
 	unsigned long flags;
@@ -745,9 +889,18 @@ void fimg2d_del_command(struct fimg2d_control *ctrl, struct fimg2d_bltcmd *cmd)
 
 	perf_end(cmd, PERF_TOTAL);
 	perf_print(cmd);
+
+	if (cmd->async)
+		fimg2d_unsync_dst(cmd);
+
+	/* batches retire in order, so the timeline moves to this value */
+	if (cmd->fence_value && ctx->timeline &&
+			(int)(cmd->fence_value - ctx->timeline->value) > 0)
+		sw_sync_timeline_inc(ctx->timeline,
+				cmd->fence_value - ctx->timeline->value);
+
 	g2d_spin_lock(&ctrl->bltlock, flags);
 	fimg2d_dequeue(&cmd->node);
-	kfree(cmd);
 	atomic_dec(&ctx->ncmd);
 #ifdef BLIT_WORKQUE
 	/* wake up context */
@@ -755,6 +908,8 @@ void fimg2d_del_command(struct fimg2d_control *ctrl, struct fimg2d_bltcmd *cmd)
 		wake_up(&ctx->wait_q);
 #endif
 	g2d_spin_unlock(&ctrl->bltlock, flags);
+
+	fimg2d_free_command(cmd);
 }
 
 struct fimg2d_bltcmd *fimg2d_get_command(struct fimg2d_control *ctrl)
@@ -772,6 +927,7 @@ void fimg2d_add_context(struct fimg2d_control *ctrl, struct fimg2d_context *ctx)
 {
 	atomic_set(&ctx->ncmd, 0);
 	init_waitqueue_head(&ctx->wait_q);
+	mutex_init(&ctx->lock);
 
 	atomic_inc(&ctrl->nctx);
 	fimg2d_debug("ctx %p nctx(%d)\n", ctx, atomic_read(&ctrl->nctx));
@@ -13,6 +13,8 @@
 #include "fimg2d.h"
 #include "fimg2d_helper.h"
 
+struct sync_fence;
+
 static inline void fimg2d_enqueue(struct list_head *node, struct list_head *q)
 {
 	list_add_tail(node, q);
@@ -41,8 +43,16 @@ void fimg2d_add_context(struct fimg2d_control *ctrl,
 		struct fimg2d_context *ctx);
 void fimg2d_del_context(struct fimg2d_control *ctrl,
 		struct fimg2d_context *ctx);
-int fimg2d_add_command(struct fimg2d_control *ctrl,
-		struct fimg2d_context *ctx, struct fimg2d_blit __user *buf);
+struct fimg2d_bltcmd *fimg2d_copy_command(struct fimg2d_context *ctx,
+		struct mm_struct *mm, struct fimg2d_blit __user *buf);
+void fimg2d_free_command(struct fimg2d_bltcmd *cmd);
+int fimg2d_queue_command(struct fimg2d_control *ctrl,
+		struct fimg2d_context *ctx, struct fimg2d_bltcmd *cmd);
+int fimg2d_add_commands(struct fimg2d_control *ctrl,
+		struct fimg2d_context *ctx, struct mm_struct *mm,
+		struct fimg2d_blit __user *buf, int nr,
+		unsigned int fence_value);
+struct sync_fence *fimg2d_create_fence(struct fimg2d_context *ctx);
 void fimg2d_del_command(struct fimg2d_control *ctrl, struct fimg2d_bltcmd *cmd);
 struct fimg2d_bltcmd *fimg2d_get_command(struct fimg2d_control *ctrl);
 int fimg2d_check_pgd(struct mm_struct *mm, struct fimg2d_bltcmd *cmd);
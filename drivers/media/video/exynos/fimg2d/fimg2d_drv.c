@@ -26,6 +26,9 @@
 #include <linux/wait.h>
 #include <linux/atomic.h>
 #include <linux/delay.h>
+#include <linux/file.h>
+#include <linux/sync.h>
+#include <linux/sw_sync.h>
 #include <asm/cacheflush.h>
 #include <plat/cpu.h>
 #include <plat/fimg2d.h>
@@ -47,6 +50,13 @@ int g2d_debug = DBG_INFO;
 module_param(g2d_debug, int, S_IRUGO | S_IWUSR);
 #endif
 
+/*
+ * Run queued blits with the CPU reference blitter instead of the hardware.
+ * Used to validate output and measure submission overhead.
+ */
+static bool g2d_refblit;
+module_param(g2d_refblit, bool, S_IRUGO | S_IWUSR);
+
 static struct fimg2d_control *ctrl;
 
 /* To prevent buffer release as memory compaction */
@@ -139,6 +149,9 @@ static int fimg2d_do_bitblt(struct fimg2d_control *ctrl)
 {
 	int ret;
 
+	if (g2d_refblit)
+		return fimg2d_ref_bitblt(ctrl);
+
 	if (fimg2d_ip_version_is() >= IP_VER_G2D_5AR) {
 		pm_runtime_get_sync(ctrl->dev);
 		fimg2d_debug("Done pm_runtime_get_sync()\n");
@@ -212,7 +225,7 @@ static int fimg2d_sysmmu_fault_handler(struct device *dev, const char *mmuname,
 	if (WARN_ON(!cmd))
 		goto next;
 
-	if (cmd->ctx->mm->pgd != phys_to_virt(pgtable_base)) {
+	if (cmd->mm->pgd != phys_to_virt(pgtable_base)) {
 		fimg2d_err("pgtable base invalid\n");
 		goto next;
 	}
@@ -242,10 +255,67 @@ static int fimg2d_request_bitblt(struct fimg2d_control *ctrl,
 #endif
 }
 
+/*
+ * The pm qos request is raised when a context first uses the hardware
+ * rather than on open, a client whose blits all go to the cpu never
+ * needs it.
+ */
+static void fimg2d_qos_get(struct fimg2d_context *ctx)
+{
+	int count;
+
+	mutex_lock(&ctrl->qoslock);
+	if (ctx->qos) {
+		mutex_unlock(&ctrl->qoslock);
+		return;
+	}
+	ctx->qos = true;
+	count = ++ctrl->nqos;
+
+	if (count == 1)
+		fimg2d_pm_qos_update(ctrl, FIMG2D_QOS_ON);
+	else {
+#ifdef CONFIG_FIMG2D_USE_BUS_DEVFREQ
+		fimg2d_debug("count:%d, fimg2d_pm_qos_update(ON,mif,int) is already called\n", count);
+#endif
+#if defined(CONFIG_ARM_EXYNOS_IKS_CPUFREQ) || \
+	defined(CONFIG_ARM_EXYNOS_MP_CPUFREQ)
+		fimg2d_debug("count:%d, fimg2d_pm_qos_update(ON,cpu) is already called\n", count);
+#endif
+	}
+	mutex_unlock(&ctrl->qoslock);
+}
+
+static void fimg2d_qos_put(struct fimg2d_context *ctx)
+{
+	int count;
+
+	mutex_lock(&ctrl->qoslock);
+	if (!ctx->qos) {
+		mutex_unlock(&ctrl->qoslock);
+		return;
+	}
+	ctx->qos = false;
+	count = --ctrl->nqos;
+
+	if (!count)
+		fimg2d_pm_qos_update(ctrl, FIMG2D_QOS_OFF);
+	else {
+#ifdef CONFIG_FIMG2D_USE_BUS_DEVFREQ
+		fimg2d_debug("count:%d, fimg2d_pm_qos_update(OFF,mif.int) is not called yet\n", count);
+#endif
+#if defined(CONFIG_ARM_EXYNOS_IKS_CPUFREQ) || \
+	defined(CONFIG_ARM_EXYNOS_MP_CPUFREQ)
+		fimg2d_debug("count:%d, fimg2d_pm_qos_update(OFF, cpu) is not called yet\n", count);
+#endif
+	}
+	mutex_unlock(&ctrl->qoslock);
+}
+
 static int fimg2d_open(struct inode *inode, struct file *file)
 {
 	struct fimg2d_context *ctx;
-	unsigned long flags, count;
+	unsigned long flags;
 
 	ctx = kzalloc(sizeof(*ctx), GFP_KERNEL);
 	if (!ctx) {
@@ -256,20 +326,8 @@ static int fimg2d_open(struct inode *inode, struct file *file)
 
 	g2d_spin_lock(&ctrl->bltlock, flags);
 	fimg2d_add_context(ctrl, ctx);
-	count = atomic_read(&ctrl->nctx);
 	g2d_spin_unlock(&ctrl->bltlock, flags);
 
-	if (count == 1)
-		fimg2d_pm_qos_update(ctrl, FIMG2D_QOS_ON);
-	else {
-#ifdef CONFIG_FIMG2D_USE_BUS_DEVFREQ
-		fimg2d_debug("count:%ld, fimg2d_pm_qos_update(ON,mif,int) is already called\n", count);
-#endif
-#if defined(CONFIG_ARM_EXYNOS_IKS_CPUFREQ) || \
-	defined(CONFIG_ARM_EXYNOS_MP_CPUFREQ)
-		fimg2d_debug("count:%ld, fimg2d_pm_qos_update(ON,cpu) is already called\n", count);
-#endif
-	}
 	return 0;
 }
 
@@ -277,9 +335,14 @@ static int fimg2d_release(struct inode *inode, struct file *file)
 {
 	struct fimg2d_context *ctx = file->private_data;
 	int retry = POLL_RETRY;
-	unsigned long flags, count;
+	unsigned long flags;
 
 	fimg2d_debug("ctx %p\n", ctx);
+#ifdef BLIT_WORKQUE
+	/* batched commands may still be queued */
+	if (ctx->async_mm)
+		fimg2d_context_wait(ctx);
+#endif
 	while (retry--) {
 		if (!atomic_read(&ctx->ncmd))
 			break;
@@ -288,20 +351,16 @@ static int fimg2d_release(struct inode *inode, struct file *file)
 
 	g2d_spin_lock(&ctrl->bltlock, flags);
 	fimg2d_del_context(ctrl, ctx);
-	count = atomic_read(&ctrl->nctx);
 	g2d_spin_unlock(&ctrl->bltlock, flags);
 
-	if (!count)
-		fimg2d_pm_qos_update(ctrl, FIMG2D_QOS_OFF);
-	else {
-#ifdef CONFIG_FIMG2D_USE_BUS_DEVFREQ
-		fimg2d_debug("count:%ld, fimg2d_pm_qos_update(OFF,mif.int) is not called yet\n", count);
-#endif
-#if defined(CONFIG_ARM_EXYNOS_IKS_CPUFREQ) || \
-	defined(CONFIG_ARM_EXYNOS_MP_CPUFREQ)
-		fimg2d_debug("count:%ld, fimg2d_pm_qos_update(OFF, cpu) is not called yet\n", count);
-#endif
-	}
+	fimg2d_qos_put(ctx);
+
+	if (ctx->timeline)
+		sync_timeline_destroy(&ctx->timeline->obj);
+	if (ctx->async_mm)
+		mmput(ctx->async_mm);
+
+	mutex_destroy(&ctx->lock);
 	kfree(ctx);
 	return 0;
 }
@@ -347,10 +406,100 @@ static int store_user_dst(struct fimg2d_blit __user *buf,
 	return 0;
 }
 
+#ifdef BLIT_WORKQUE
+/*
+ * Queue a batch of blits and return without waiting.  The batch runs back
+ * to back in one worker pass and its fence is signaled by the last blit.
+ */
+static int fimg2d_submit_batch(struct fimg2d_context *ctx,
+		struct fimg2d_batch __user *buf)
+{
+	struct fimg2d_batch batch;
+	struct sync_fence *fence;
+	unsigned long flags;
+	int fd, ret;
+
+	if (copy_from_user(&batch, buf, sizeof(batch)))
+		return -EFAULT;
+
+	if (!batch.nr_blits || batch.nr_blits > FIMG2D_MAX_BATCH)
+		return -EINVAL;
+
+	mutex_lock(&ctx->lock);
+
+	/* commands outlive the ioctl, keep the address space around */
+	if (!ctx->async_mm) {
+		ctx->async_mm = get_task_mm(current);
+		if (!ctx->async_mm) {
+			fimg2d_err("no mm for ctx\n");
+			ret = -ENXIO;
+			goto unlock;
+		}
+	} else if (ctx->async_mm != current->mm) {
+		fimg2d_err("ctx %p is bound to another mm\n", ctx);
+		ret = -EPERM;
+		goto unlock;
+	}
+	fimg2d_qos_get(ctx);
+
+	fd = get_unused_fd();
+	if (fd < 0) {
+		ret = fd;
+		goto unlock;
+	}
+
+	fence = fimg2d_create_fence(ctx);
+	if (!fence) {
+		ret = -ENOMEM;
+		goto put_fd;
+	}
+
+	ret = fimg2d_add_commands(ctrl, ctx, ctx->async_mm, batch.blt,
+			batch.nr_blits, ctx->timeline_max + 1);
+	if (ret) {
+		fimg2d_err("add batch not allowed.\n");
+		goto put_fence;
+	}
+	ctx->timeline_max++;
+
+	/*
+	 * Userspace only gets the fd once the batch is queued.  The batch
+	 * cannot be taken back anymore, it still runs if the fd can't be
+	 * handed over.
+	 */
+	if (put_user(fd, &buf->fence)) {
+		sync_fence_put(fence);
+		put_unused_fd(fd);
+		ret = -EFAULT;
+	} else {
+		sync_fence_install(fence, fd);
+	}
+
+	g2d_spin_lock(&ctrl->bltlock, flags);
+	ctrl->stats.batched += batch.nr_blits;
+	fimg2d_debug("dispatch ctx %p batch(%u) to kernel thread\n",
+			ctx, batch.nr_blits);
+	queue_work(ctrl->work_q, &fimg2d_work);
+	g2d_spin_unlock(&ctrl->bltlock, flags);
+
+	mutex_unlock(&ctx->lock);
+	return ret;
+
+put_fence:
+	sync_fence_put(fence);
+put_fd:
+	put_unused_fd(fd);
+unlock:
+	mutex_unlock(&ctx->lock);
+	return ret;
+}
+#endif
+
 static long fimg2d_ioctl(struct file *file, unsigned int cmd, unsigned long arg)
 {
 	int ret = 0;
 	struct fimg2d_context *ctx;
+	struct fimg2d_bltcmd *bltcmd;
 	struct mm_struct *mm;
 	struct fimg2d_dma *usr_dst;
 
@@ -366,7 +515,6 @@ static long fimg2d_ioctl(struct file *file, unsigned int cmd, unsigned long arg)
 		}
 
 		g2d_lock(&ctrl->drvlock);
-		ctx->mm = mm;
 
 		if (atomic_read(&ctrl->drvact) ||
 				atomic_read(&ctrl->suspended)) {
@@ -376,7 +524,25 @@ static long fimg2d_ioctl(struct file *file, unsigned int cmd, unsigned long arg)
 			return -EPERM;
 		}
 
-		ret = fimg2d_add_command(ctrl, ctx, (struct fimg2d_blit __user *)arg);
+		bltcmd = fimg2d_copy_command(ctx, mm,
+				(struct fimg2d_blit __user *)arg);
+		if (IS_ERR(bltcmd)) {
+			fimg2d_err("add command not allowed.\n");
+			g2d_unlock(&ctrl->drvlock);
+			mmput(mm);
+			return PTR_ERR(bltcmd);
+		}
+
+		/* small blits are done right here, see fimg2d_cpu.c */
+		if (fimg2d_cpu_route(ctrl, bltcmd)) {
+			ret = fimg2d_cpu_bitblt(ctrl, bltcmd);
+			g2d_unlock(&ctrl->drvlock);
+			mmput(mm);
+			break;
+		}
+
+		fimg2d_qos_get(ctx);
+		ret = fimg2d_queue_command(ctrl, ctx, bltcmd);
 		if (ret) {
 			fimg2d_err("add command not allowed.\n");
 			g2d_unlock(&ctrl->drvlock);
@@ -420,6 +586,13 @@ static long fimg2d_ioctl(struct file *file, unsigned int cmd, unsigned long arg)
 		mmput(mm);
 		break;
 
+#ifdef BLIT_WORKQUE
+	case FIMG2D_BITBLT_BATCH:
+		ret = fimg2d_submit_batch(ctx,
+				(struct fimg2d_batch __user *)arg);
+		break;
+#endif
+
 	case FIMG2D_BITBLT_VERSION:
 	{
 		struct fimg2d_version ver;
@@ -486,6 +659,7 @@ static int fimg2d_setup_controller(struct fimg2d_control *ctrl)
 
 	spin_lock_init(&ctrl->bltlock);
 	mutex_init(&ctrl->drvlock);
+	mutex_init(&ctrl->qoslock);
 
 	INIT_LIST_HEAD(&ctrl->cmd_q);
 	init_waitqueue_head(&ctrl->wait_q);
@@ -595,6 +769,7 @@ static int fimg2d_probe(struct platform_device *pdev)
 	}
 
 	fimg2d_pm_qos_add(ctrl);
+	fimg2d_cpu_init(ctrl);
 
 	dev_info(&pdev->dev, "fimg2d registered successfully\n");
 
@@ -620,6 +795,7 @@ drv_free:
 		destroy_workqueue(ctrl->work_q);
 #endif
 	mutex_destroy(&ctrl->drvlock);
+	mutex_destroy(&ctrl->qoslock);
 	kfree(ctrl);
 
 	return ret;
@@ -629,6 +805,7 @@ static int fimg2d_remove(struct platform_device *pdev)
 {
 	struct fimg2d_platdata *pdata = to_fimg2d_plat(&pdev->dev);
 
+	fimg2d_cpu_exit(ctrl);
 	fimg2d_pm_qos_remove(ctrl);
 
 	misc_deregister(&fimg2d_dev);
@@ -654,6 +831,7 @@ static int fimg2d_remove(struct platform_device *pdev)
 	destroy_workqueue(ctrl->work_q);
 #endif
 	mutex_destroy(&ctrl->drvlock);
+	mutex_destroy(&ctrl->qoslock);
 	kfree(ctrl);
 	return 0;
 }
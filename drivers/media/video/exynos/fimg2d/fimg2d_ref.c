@@ -0,0 +1,265 @@
+/* linux/drivers/media/video/exynos/fimg2d/fimg2d_ref.c
+ *
+ * Copyright (c) 2011 Samsung Electronics Co., Ltd.
+ *	http://www.samsung.com/
+ *
+ * Samsung Graphics 2D driver, CPU reference blitter
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+*/
+
+#include <linux/slab.h>
+#include <linux/sched.h>
+#include <linux/uaccess.h>
+#include <linux/mmu_context.h>
+#include "fimg2d.h"
+#include "fimg2d_ctx.h"
+#include "fimg2d_helper.h"
+
+/*
+ * A straightforward, line by line implementation of the common subset of
+ * the blitter: solid fill, clear, copy and premultiplied src-over with
+ * global alpha between XRGB8888, ARGB8888 and RGB565 images.  No scaling,
+ * rotation, mask or bluescreen.  It is meant to be obviously correct, not
+ * fast; the queue, batching and fences work exactly as with the hardware.
+ */
+
+static inline bool ref_fmt_supported(struct fimg2d_image *img)
+{
+	if (img->order != AX_RGB)
+		return false;
+
+	switch (img->fmt) {
+	case CF_XRGB_8888:
+	case CF_ARGB_8888:
+	case CF_RGB_565:
+		return true;
+	default:
+		return false;
+	}
+}
+
+static inline u32 ref_mul255(u32 a, u32 b)
+{
+	u32 t = a * b + 128;
+
+	return (t + (t >> 8)) >> 8;
+}
+
+static inline u32 ref_read(const u8 *p, enum color_format fmt)
+{
+	u32 v, r, g, b;
+
+	switch (fmt) {
+	case CF_RGB_565:
+		v = *(const u16 *)p;
+		r = (v >> 11) & 0x1f;
+		g = (v >> 5) & 0x3f;
+		b = v & 0x1f;
+		r = (r << 3) | (r >> 2);
+		g = (g << 2) | (g >> 4);
+		b = (b << 3) | (b >> 2);
+		return 0xff000000 | (r << 16) | (g << 8) | b;
+	case CF_XRGB_8888:
+		return *(const u32 *)p | 0xff000000;
+	default:
+		return *(const u32 *)p;
+	}
+}
+
+static inline void ref_write(u8 *p, enum color_format fmt, u32 argb)
+{
+	switch (fmt) {
+	case CF_RGB_565:
+		*(u16 *)p = ((argb >> 8) & 0xf800) | ((argb >> 5) & 0x07e0) |
+			((argb >> 3) & 0x001f);
+		break;
+	case CF_XRGB_8888:
+		*(u32 *)p = argb | 0xff000000;
+		break;
+	default:
+		*(u32 *)p = argb;
+		break;
+	}
+}
+
+/* Dc = Sc * ga + (1 - Sa * ga) * Dc, premultiplied */
+static inline u32 ref_src_over(u32 s, u32 d, u32 ga)
+{
+	u32 sa = ref_mul255(s >> 24, ga);
+	u32 out = 0, c;
+	int shift;
+
+	for (shift = 0; shift < 32; shift += 8) {
+		c = ref_mul255((s >> shift) & 0xff, ga) +
+			ref_mul255((d >> shift) & 0xff, 255 - sa);
+		out |= min_t(u32, c, 0xff) << shift;
+	}
+	return out;
+}
+
+static int ref_check(struct fimg2d_bltcmd *cmd)
+{
+	struct fimg2d_param *p = &cmd->blt.param;
+	struct fimg2d_image *src = &cmd->image[ISRC];
+	struct fimg2d_image *dst = &cmd->image[IDST];
+
+	if (cmd->image[IMSK].addr.type || cmd->image[ITMP].addr.type)
+		return -EOPNOTSUPP;
+
+	if (p->scaling.mode || p->rotate || p->bluscr.mode)
+		return -EOPNOTSUPP;
+
+	if (!ref_fmt_supported(dst))
+		return -EOPNOTSUPP;
+
+	switch (cmd->blt.op) {
+	case BLIT_OP_SOLID_FILL:
+	case BLIT_OP_CLR:
+		return 0;
+	case BLIT_OP_SRC:
+		break;
+	case BLIT_OP_SRC_OVER:
+		if (p->premult != PREMULTIPLIED)
+			return -EOPNOTSUPP;
+		break;
+	default:
+		return -EOPNOTSUPP;
+	}
+
+	if (!src->addr.type)
+		return 0;
+
+	if (!ref_fmt_supported(src) ||
+			rect_w(&src->rect) != rect_w(&dst->rect) ||
+			rect_h(&src->rect) != rect_h(&dst->rect))
+		return -EOPNOTSUPP;
+
+	return 0;
+}
+
+static int ref_blit(struct fimg2d_bltcmd *cmd)
+{
+	struct fimg2d_param *p = &cmd->blt.param;
+	struct fimg2d_image *src = &cmd->image[ISRC];
+	struct fimg2d_image *dst = &cmd->image[IDST];
+	struct fimg2d_rect r = dst->rect;
+	struct fimg2d_clip *clp = &p->clipping;
+	int op = cmd->blt.op;
+	int sbpp = 0, dbpp, x, y, w, h, sx, sy;
+	u8 *sline = NULL, *dline;
+	u32 color, s;
+	int ret;
+
+	ret = ref_check(cmd);
+	if (ret)
+		return ret;
+
+	if (clp->enable) {
+		r.x1 = max(r.x1, clp->x1);
+		r.y1 = max(r.y1, clp->y1);
+		r.x2 = min(r.x2, clp->x2);
+		r.y2 = min(r.y2, clp->y2);
+	}
+
+	w = rect_w(&r);
+	h = rect_h(&r);
+	if (w <= 0 || h <= 0)
+		return 0;
+
+	dbpp = bit_per_pixel(dst, 0) >> 3;
+	dline = kmalloc(w * dbpp, GFP_KERNEL);
+	if (!dline)
+		return -ENOMEM;
+
+	if (src->addr.type) {
+		sbpp = bit_per_pixel(src, 0) >> 3;
+		sline = kmalloc(w * sbpp, GFP_KERNEL);
+		if (!sline) {
+			kfree(dline);
+			return -ENOMEM;
+		}
+	}
+
+	color = (op == BLIT_OP_CLR) ? 0 : p->solid_color;
+	sx = src->rect.x1 + (r.x1 - dst->rect.x1);
+	sy = src->rect.y1 + (r.y1 - dst->rect.y1);
+
+	for (y = 0; y < h; y++) {
+		unsigned long daddr = dst->addr.start +
+			(r.y1 + y) * dst->stride + r.x1 * dbpp;
+
+		if (sline && copy_from_user(sline, (void __user *)
+				(src->addr.start + (sy + y) * src->stride +
+				 sx * sbpp), w * sbpp)) {
+			ret = -EFAULT;
+			break;
+		}
+
+		if (op == BLIT_OP_SRC_OVER &&
+				copy_from_user(dline, (void __user *)daddr,
+					w * dbpp)) {
+			ret = -EFAULT;
+			break;
+		}
+
+		for (x = 0; x < w; x++) {
+			s = sline ? ref_read(sline + x * sbpp, src->fmt) :
+				color;
+			if (op == BLIT_OP_SRC_OVER)
+				s = ref_src_over(s, ref_read(dline + x * dbpp,
+						dst->fmt), p->g_alpha);
+			ref_write(dline + x * dbpp, dst->fmt, s);
+		}
+
+		if (copy_to_user((void __user *)daddr, dline, w * dbpp)) {
+			ret = -EFAULT;
+			break;
+		}
+	}
+
+	kfree(sline);
+	kfree(dline);
+	return ret;
+}
+
+int fimg2d_ref_bitblt(struct fimg2d_control *ctrl)
+{
+	struct fimg2d_bltcmd *cmd;
+	struct mm_struct *mm;
+	bool adopt;
+	int ret = 0;
+
+	fimg2d_debug("%s : enter reference blitter\n", __func__);
+
+	while (1) {
+		cmd = fimg2d_get_command(ctrl);
+		if (!cmd)
+			break;
+
+		/* the worker has no user address space of its own */
+		mm = cmd->mm;
+		adopt = !current->mm;
+		if (adopt)
+			use_mm(mm);
+
+		perf_start(cmd, PERF_BLIT);
+		ret = ref_blit(cmd);
+		perf_end(cmd, PERF_BLIT);
+
+		if (adopt)
+			unuse_mm(mm);
+
+		if (ret)
+			fimg2d_err("seq_no(%u) op(%d) failed, ret %d\n",
+					cmd->blt.seq_no, cmd->blt.op, ret);
+
+		fimg2d_del_command(ctrl, cmd);
+	}
+
+	fimg2d_debug("%s : exit reference blitter\n", __func__);
+
+	return ret;
+}
@@ -1364,6 +1364,15 @@ static irqreturn_t s5p_mfc_irq(int irq, void *priv)
 
 	dev->preempt_ctx = MFC_NO_INSTANCE_SET;
 
+	/* Anything but a slice ends the frame on the hardware */
+	if (reason != S5P_FIMV_R2H_CMD_SLICE_DONE_RET)
+		s5p_mfc_sched_done(ctx);
+
+	if (reason == S5P_FIMV_R2H_CMD_FRAME_DONE_RET)
+		s5p_mfc_qos_frame_done(ctx, (ctx->type == MFCINST_DECODER) ?
+				s5p_mfc_get_consumed_stream() :
+				s5p_mfc_get_enc_strm_size());
+
 	switch (reason) {
 	case S5P_FIMV_R2H_CMD_ERR_RET:
 		/* An error has occured */
@@ -2348,7 +2357,7 @@ static int __devinit s5p_mfc_probe(struct platform_device *pdev)
 			s5p_mfc_sysmmu_fault_handler);
 
 #ifdef CONFIG_MFC_USE_BUS_DEVFREQ
-	INIT_LIST_HEAD(&dev->qos_queue);
+	s5p_mfc_qos_init(dev);
 #endif
 	dev->variant = (struct s5p_mfc_variant *)
 		platform_get_device_id(pdev)->driver_data;
@@ -2483,6 +2492,8 @@ static int __devinit s5p_mfc_probe(struct platform_device *pdev)
 		atomic_set(&dev->qos_req_cnt[i], 0);
 #endif
 
+	s5p_mfc_sched_debugfs_init(dev);
+
 	pr_debug("%s--\n", __func__);
 	return 0;
 
@@ -2548,6 +2559,8 @@ static int __devexit s5p_mfc_remove(struct platform_device *pdev)
 
 	dev_dbg(&pdev->dev, "%s++\n", __func__);
 	v4l2_info(&dev->v4l2_dev, "Removing %s\n", pdev->name);
+	s5p_mfc_sched_debugfs_exit(dev);
+	s5p_mfc_qos_exit(dev);
 	del_timer_sync(&dev->watchdog_timer);
 	flush_workqueue(dev->watchdog_wq);
 	destroy_workqueue(dev->watchdog_wq);
@@ -29,6 +29,8 @@
 
 #include <mach/exynos-mfc.h>
 
+#include "s5p_mfc_sched.h"
+
 /*
  * CONFIG_MFC_USE_BUS_DEVFREQ might be defined in exynos-mfc.h.
  * So pm_qos.h should be checked after exynos-mfc.h
@@ -68,6 +70,10 @@
 
 #define MFC_BASE_MASK		((1 << 17) - 1)
 
+/* QoS load is measured over MFC_QOS_BUCKETS - 1 completed buckets */
+#define MFC_QOS_BUCKETS		5
+#define MFC_QOS_BUCKET_MS	250
+
 #define DEC_LAST_FRAME		0x80000000
 
 /**
@@ -310,8 +316,13 @@ struct s5p_mfc_dev {
 	struct workqueue_struct *sched_wq;
 	struct work_struct sched_work;
 
+	struct dentry *debugfs_root;
+
 #ifdef CONFIG_MFC_USE_BUS_DEVFREQ
 	struct list_head qos_queue;
+	struct mutex qos_mutex;
+	spinlock_t qos_lock;
+	struct delayed_work qos_work;
 	atomic_t qos_req_cur;
 	atomic_t *qos_req_cnt;
 	struct pm_qos_request qos_req_int;
@@ -674,6 +685,35 @@ struct s5p_mfc_enc {
 	int stored_tag;
 };
 
+/**
+ * struct s5p_mfc_sched_stats - Frames run on the hardware by a context
+ */
+struct s5p_mfc_sched_stats {
+	int running;		/* a frame of this context is on the hardware */
+	u64 start_us;		/* and when it was dispatched */
+	u64 deadline_us;	/* and when it is due */
+	u64 prev_deadline_us;	/* sched.deadline_us before the dispatch */
+
+	unsigned long frames;
+	unsigned long misses;
+	u64 busy_us;
+	u32 max_busy_us;
+	u32 max_late_us;
+	u64 first_us;
+	u64 last_us;
+};
+
+/**
+ * struct s5p_mfc_qos_window - Work done by a context in the last second
+ */
+struct s5p_mfc_qos_window {
+	unsigned long start;	/* jiffies when the current bucket started */
+	int cur;
+	int warm;		/* buckets completed since the context started */
+	u32 mb[MFC_QOS_BUCKETS];
+	u32 bytes[MFC_QOS_BUCKETS];
+};
+
 /**
  * struct s5p_mfc_ctx - This struct contains the instance context
  */
@@ -762,6 +802,7 @@ struct s5p_mfc_ctx {
 #ifdef CONFIG_MFC_USE_BUS_DEVFREQ
 	int qos_req_step;
 	struct list_head qos_list;
+	struct s5p_mfc_qos_window qos_win;
 #endif
 	int qos_ratio;
 	int framerate;
@@ -771,6 +812,9 @@ struct s5p_mfc_ctx {
 	struct timeval last_timestamp;
 	int qp_min_change;
 	int qp_max_change;
+
+	struct s5p_mfc_sched_entity sched;
+	struct s5p_mfc_sched_stats sched_stats;
 };
 
 #define fh_to_mfc_ctx(x)	\
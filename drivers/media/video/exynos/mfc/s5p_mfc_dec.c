@@ -383,6 +383,24 @@ static struct v4l2_queryctrl controls[] = {
 		.step = 10,
 		.default_value = 100,
 	},
+	{
+		.id = V4L2_CID_MPEG_VIDEO_SCHED_PRIORITY,
+		.type = V4L2_CTRL_TYPE_INTEGER,
+		.name = "Scheduling priority",
+		.minimum = V4L2_MPEG_MFC_SCHED_PRIO_REALTIME,
+		.maximum = V4L2_MPEG_MFC_SCHED_PRIO_BACKGROUND,
+		.step = 1,
+		.default_value = V4L2_MPEG_MFC_SCHED_PRIO_NORMAL,
+	},
+	{
+		.id = V4L2_CID_MPEG_VIDEO_FRAME_DEADLINE,
+		.type = V4L2_CTRL_TYPE_INTEGER,
+		.name = "Frame deadline in usec",
+		.minimum = 0,
+		.maximum = USEC_PER_SEC,
+		.step = 1,
+		.default_value = 0,
+	},
 	{
 		.id = V4L2_CID_MPEG_MFC_SET_DYNAMIC_DPB_MODE,
 		.type = V4L2_CTRL_TYPE_INTEGER,
@@ -1940,6 +1958,12 @@ static int get_ctrl_val(struct s5p_mfc_ctx *ctx, struct v4l2_control *ctrl)
 	case V4L2_CID_MPEG_VIDEO_QOS_RATIO:
 		ctrl->value = ctx->qos_ratio;
 		break;
+	case V4L2_CID_MPEG_VIDEO_SCHED_PRIORITY:
+		ctrl->value = ctx->sched.prio;
+		break;
+	case V4L2_CID_MPEG_VIDEO_FRAME_DEADLINE:
+		ctrl->value = ctx->sched.period_us;
+		break;
 	case V4L2_CID_MPEG_MFC_SET_DYNAMIC_DPB_MODE:
 		ctrl->value = dec->is_dynamic_dpb;
 		break;
@@ -2130,6 +2154,15 @@ static int vidioc_s_ctrl(struct file *file, void *priv,
 	case V4L2_CID_MPEG_VIDEO_QOS_RATIO:
 		ctx->qos_ratio = ctrl->value;
 		break;
+	case V4L2_CID_MPEG_VIDEO_SCHED_PRIORITY:
+		ctx->sched.prio = ctrl->value;
+		break;
+	case V4L2_CID_MPEG_VIDEO_FRAME_DEADLINE:
+		spin_lock_irq(&dev->condlock);
+		ctx->sched.period_us = ctrl->value;
+		ctx->sched.deadline_us = 0;
+		spin_unlock_irq(&dev->condlock);
+		break;
 	case V4L2_CID_MPEG_MFC_SET_DYNAMIC_DPB_MODE:
 		if (FW_HAS_DYNAMIC_DPB(dev))
 			dec->is_dynamic_dpb = ctrl->value;
@@ -2949,6 +2982,7 @@ int s5p_mfc_init_dec_ctx(struct s5p_mfc_ctx *ctx)
 
 	ctx->framerate = DEC_MAX_FPS;
 	ctx->qos_ratio = 100;
+	s5p_mfc_sched_init(ctx);
 #ifdef CONFIG_MFC_USE_BUS_DEVFREQ
 	INIT_LIST_HEAD(&ctx->qos_list);
 #endif
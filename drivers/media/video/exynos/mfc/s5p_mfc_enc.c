@@ -902,6 +902,24 @@ static struct v4l2_queryctrl controls[] = {
 		.step = 10,
 		.default_value = 100,
 	},
+	{
+		.id = V4L2_CID_MPEG_VIDEO_SCHED_PRIORITY,
+		.type = V4L2_CTRL_TYPE_INTEGER,
+		.name = "Scheduling priority",
+		.minimum = V4L2_MPEG_MFC_SCHED_PRIO_REALTIME,
+		.maximum = V4L2_MPEG_MFC_SCHED_PRIO_BACKGROUND,
+		.step = 1,
+		.default_value = V4L2_MPEG_MFC_SCHED_PRIO_NORMAL,
+	},
+	{
+		.id = V4L2_CID_MPEG_VIDEO_FRAME_DEADLINE,
+		.type = V4L2_CTRL_TYPE_INTEGER,
+		.name = "Frame deadline in usec",
+		.minimum = 0,
+		.maximum = USEC_PER_SEC,
+		.step = 1,
+		.default_value = 0,
+	},
 	{
 		.id = V4L2_CID_MPEG_MFC70_VIDEO_VP8_VERSION,
 		.type = V4L2_CTRL_TYPE_INTEGER,
@@ -2797,6 +2815,12 @@ static int get_ctrl_val(struct s5p_mfc_ctx *ctx, struct v4l2_control *ctrl)
 	case V4L2_CID_MPEG_VIDEO_QOS_RATIO:
 		ctrl->value = ctx->qos_ratio;
 		break;
+	case V4L2_CID_MPEG_VIDEO_SCHED_PRIORITY:
+		ctrl->value = ctx->sched.prio;
+		break;
+	case V4L2_CID_MPEG_VIDEO_FRAME_DEADLINE:
+		ctrl->value = ctx->sched.period_us;
+		break;
 	case V4L2_CID_MPEG_MFC_GET_EXT_INFO:
 		ctrl->value = enc_ext_info(ctx);
 		break;
@@ -3260,6 +3284,15 @@ static int set_ctrl_val(struct s5p_mfc_ctx *ctx, struct v4l2_control *ctrl)
 	case V4L2_CID_MPEG_VIDEO_QOS_RATIO:
 		ctx->qos_ratio = ctrl->value;
 		break;
+	case V4L2_CID_MPEG_VIDEO_SCHED_PRIORITY:
+		ctx->sched.prio = ctrl->value;
+		break;
+	case V4L2_CID_MPEG_VIDEO_FRAME_DEADLINE:
+		spin_lock_irq(&dev->condlock);
+		ctx->sched.period_us = ctrl->value;
+		ctx->sched.deadline_us = 0;
+		spin_unlock_irq(&dev->condlock);
+		break;
 	case V4L2_CID_MPEG_VIDEO_H264_MAX_QP:
 	case V4L2_CID_MPEG_VIDEO_H263_MAX_QP:
 	case V4L2_CID_MPEG_VIDEO_MPEG4_MAX_QP:
@@ -3919,6 +3952,7 @@ int s5p_mfc_init_enc_ctx(struct s5p_mfc_ctx *ctx)
 
 	ctx->framerate = ENC_MAX_FPS;
 	ctx->qos_ratio = 100;
+	s5p_mfc_sched_init(ctx);
 #ifdef CONFIG_MFC_USE_BUS_DEVFREQ
 	INIT_LIST_HEAD(&ctx->qos_list);
 #endif
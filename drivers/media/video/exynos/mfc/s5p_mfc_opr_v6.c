@@ -18,6 +18,7 @@
 #include <linux/mm.h>
 #include <linux/io.h>
 #include <linux/jiffies.h>
+#include <linux/ktime.h>
 
 #include <linux/firmware.h>
 #include <linux/err.h>
@@ -2160,10 +2161,20 @@ int s5p_mfc_encode_one_frame(struct s5p_mfc_ctx *ctx, int last_frame)
 	return 0;
 }
 
+static inline int s5p_mfc_ctx_runs_frame(struct s5p_mfc_ctx *ctx)
+{
+	return ctx->state == MFCINST_RUNNING ||
+		ctx->state == MFCINST_RUNNING_NO_OUTPUT ||
+		ctx->state == MFCINST_FINISHING;
+}
+
+/* Called with condlock held */
 static inline int s5p_mfc_get_new_ctx(struct s5p_mfc_dev *dev)
 {
+	struct s5p_mfc_sched_entity *ent[MFC_NUM_CONTEXTS];
+	struct s5p_mfc_ctx *ctx;
 	int new_ctx;
-	int cnt;
+	int i;
 
 	if (!dev) {
 		mfc_err("no mfc device to run\n");
@@ -2174,17 +2185,20 @@ static inline int s5p_mfc_get_new_ctx(struct s5p_mfc_dev *dev)
 
 	if (dev->preempt_ctx > MFC_NO_INSTANCE_SET)
 		return dev->preempt_ctx;
-	else
-		new_ctx = (dev->curr_ctx + 1) % MFC_NUM_CONTEXTS;
-
-	cnt = 0;
-	while (!test_bit(new_ctx, &dev->ctx_work_bits)) {
-		new_ctx = (new_ctx + 1) % MFC_NUM_CONTEXTS;
-		cnt++;
-		if (cnt > MFC_NUM_CONTEXTS) {
-			/* No contexts to run */
-			return -EAGAIN;
-		}
+
+	for (i = 0; i < MFC_NUM_CONTEXTS; i++) {
+		ctx = dev->ctx[i];
+		ent[i] = ctx ? &ctx->sched : NULL;
+		if (ctx)
+			ctx->sched.urgent = !s5p_mfc_ctx_runs_frame(ctx);
+	}
+
+	new_ctx = s5p_mfc_sched_pick(ent, MFC_NUM_CONTEXTS,
+			dev->ctx_work_bits, dev->curr_ctx,
+			ktime_to_us(ktime_get()));
+	if (new_ctx < 0) {
+		/* No contexts to run */
+		return -EAGAIN;
 	}
 
 	return new_ctx;
@@ -2668,7 +2682,7 @@ static inline int s5p_mfc_ctx_ready(struct s5p_mfc_ctx *ctx)
 void s5p_mfc_try_run(struct s5p_mfc_dev *dev)
 {
 	struct s5p_mfc_ctx *ctx;
-	int new_ctx;
+	int new_ctx, resumed;
 	unsigned int ret = 0;
 
 	mfc_debug(1, "Try run dev: %p\n", dev);
@@ -2707,6 +2721,8 @@ void s5p_mfc_try_run(struct s5p_mfc_dev *dev)
 		mfc_err("Failed to lock hardware.\n");
 		return;
 	}
+	/* The next slice of a frame already on the hardware */
+	resumed = (new_ctx == dev->preempt_ctx);
 	spin_unlock_irq(&dev->condlock);
 
 	mfc_debug(1, "New context: %d\n", new_ctx);
@@ -2723,6 +2739,9 @@ void s5p_mfc_try_run(struct s5p_mfc_dev *dev)
 
 	s5p_mfc_clock_on();
 
+	if (!resumed)
+		s5p_mfc_sched_start(ctx);
+
 	if (ctx->type == MFCINST_DECODER) {
 		switch (ctx->state) {
 		case MFCINST_FINISHING:
@@ -2794,6 +2813,9 @@ void s5p_mfc_try_run(struct s5p_mfc_dev *dev)
 	}
 
 	if (ret) {
+		if (!resumed)
+			s5p_mfc_sched_cancel(ctx);
+
 		/* Check again the ctx condition and clear work bits
 		 * if ctx is not available. */
 		if (s5p_mfc_ctx_ready(ctx) == 0) {
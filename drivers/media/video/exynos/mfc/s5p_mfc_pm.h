@@ -30,9 +30,15 @@ int s5p_mfc_clock_set_rate(struct s5p_mfc_dev *dev, unsigned long rate);
 #ifdef CONFIG_MFC_USE_BUS_DEVFREQ
 void s5p_mfc_qos_on(struct s5p_mfc_ctx *ctx);
 void s5p_mfc_qos_off(struct s5p_mfc_ctx *ctx);
+void s5p_mfc_qos_frame_done(struct s5p_mfc_ctx *ctx, unsigned int bytes);
+void s5p_mfc_qos_init(struct s5p_mfc_dev *dev);
+void s5p_mfc_qos_exit(struct s5p_mfc_dev *dev);
 #else
 #define s5p_mfc_qos_on(ctx)	do {} while (0)
 #define s5p_mfc_qos_off(ctx)	do {} while (0)
+#define s5p_mfc_qos_frame_done(ctx, bytes)	do {} while (0)
+#define s5p_mfc_qos_init(dev)	do {} while (0)
+#define s5p_mfc_qos_exit(dev)	do {} while (0)
 #endif
 
 #endif /* __S5P_MFC_PM_H */
@@ -13,6 +13,7 @@
 #include <linux/err.h>
 #include <linux/clk.h>
 #include <linux/jiffies.h>
+#include <linux/math64.h>
 #include <linux/pm_runtime.h>
 #include <linux/platform_device.h>
 
@@ -23,18 +24,52 @@
 #include "s5p_mfc_pm.h"
 #include "s5p_mfc_reg.h"
 
+#define CREATE_TRACE_POINTS
+#include <trace/events/mfc.h>
+
 #ifdef CONFIG_MFC_USE_BUS_DEVFREQ
+/*
+ * Bitstream bits that cost about as much as decoding or encoding one
+ * macroblock.  A context loads the codec and the bus by the higher of its
+ * macroblock rate and its bitrate in these units, so intra heavy, high
+ * bitrate streams ask for more than their resolution alone would.
+ */
+#define MFC_QOS_BITS_PER_MB	128
+
 enum {
 	MFC_QOS_ADD,
 	MFC_QOS_UPDATE,
 	MFC_QOS_REMOVE,
 };
 
-void mfc_qos_operate(struct s5p_mfc_ctx *ctx, int opr_type, int idx)
+struct mfc_qos_load {
+	unsigned int load;	/* macroblocks per second the steps compare to */
+	unsigned int mb_rate;	/* measured macroblocks per second */
+	unsigned int kbps;	/* measured bitstream kbit per second */
+};
+
+static void mfc_qos_trace(struct s5p_mfc_dev *dev, int prev,
+			struct mfc_qos_load *l)
+{
+	struct s5p_mfc_qos *qos_table = dev->pdata->qos_table;
+	int level = atomic_read(&dev->qos_req_cur);
+
+	if (level)
+		trace_mfc_qos(level, prev, l->load, l->mb_rate, l->kbps,
+				qos_table[level - 1].freq_mfc,
+				qos_table[level - 1].freq_int,
+				qos_table[level - 1].freq_mif);
+	else
+		trace_mfc_qos(0, prev, l->load, l->mb_rate, l->kbps,
+				dev->min_rate, 0, 0);
+}
+
+static void mfc_qos_operate(struct s5p_mfc_dev *dev, int opr_type, int idx,
+			struct mfc_qos_load *l)
 {
-	struct s5p_mfc_dev *dev = ctx->dev;
 	struct s5p_mfc_platdata *pdata = dev->pdata;
 	struct s5p_mfc_qos *qos_table = pdata->qos_table;
+	int prev = atomic_read(&dev->qos_req_cur);
 
 	switch (opr_type) {
 	case MFC_QOS_ADD:
@@ -99,71 +134,191 @@ void mfc_qos_operate(struct s5p_mfc_ctx *ctx, int opr_type, int idx)
 		break;
 	default:
 		mfc_err("Unknown request for opr [%d]\n", opr_type);
-		break;
+		return;
 	}
+
+	mfc_qos_trace(dev, prev, l);
 }
 
-void mfc_qos_add_or_update(struct s5p_mfc_ctx *ctx, int total_mb)
+static inline int get_ctx_mb(struct s5p_mfc_ctx *ctx)
+{
+	int mb_width, mb_height, fps;
+
+	mb_width = (ctx->img_width + 15) / 16;
+	mb_height = (ctx->img_height + 15) / 16;
+	fps = ctx->framerate / 1000;
+
+	return mb_width * mb_height * fps;
+}
+
+/* Called with qos_lock held */
+static void mfc_qos_advance(struct s5p_mfc_qos_window *win, unsigned long now)
+{
+	unsigned long len = msecs_to_jiffies(MFC_QOS_BUCKET_MS);
+	unsigned long steps = (now - win->start) / len;
+	int n;
+
+	if (!steps)
+		return;
+
+	win->start += steps * len;
+	n = min_t(unsigned long, steps, MFC_QOS_BUCKETS);
+	win->warm = min(win->warm + n, MFC_QOS_BUCKETS);
+	while (n--) {
+		win->cur = (win->cur + 1) % MFC_QOS_BUCKETS;
+		win->mb[win->cur] = 0;
+		win->bytes[win->cur] = 0;
+	}
+}
+
+/*
+ * The load of a context is the higher of its rate over the last completed
+ * buckets and over the last one alone, so the request follows a context
+ * that speeds up within a bucket, and one that slowed down or stopped
+ * after a whole window.  Until a window has passed since the context
+ * started, the declared resolution and frame rate count as well.
+ */
+static void mfc_qos_ctx_load(struct s5p_mfc_ctx *ctx, struct mfc_qos_load *l)
 {
 	struct s5p_mfc_dev *dev = ctx->dev;
+	struct s5p_mfc_qos_window *win = &ctx->qos_win;
+	unsigned int window_ms = (MFC_QOS_BUCKETS - 1) * MFC_QOS_BUCKET_MS;
+	u64 mb = 0, bytes = 0, last_mb, last_bytes;
+	unsigned int mb_rate, kbps, load;
+	unsigned long flags;
+	int i, last, warm;
+
+	spin_lock_irqsave(&dev->qos_lock, flags);
+	mfc_qos_advance(win, jiffies);
+	for (i = 0; i < MFC_QOS_BUCKETS; i++) {
+		if (i == win->cur)
+			continue;
+		mb += win->mb[i];
+		bytes += win->bytes[i];
+	}
+	last = (win->cur + MFC_QOS_BUCKETS - 1) % MFC_QOS_BUCKETS;
+	last_mb = win->mb[last];
+	last_bytes = win->bytes[last];
+	warm = win->warm;
+	spin_unlock_irqrestore(&dev->qos_lock, flags);
+
+	mb_rate = (unsigned int)div_u64(max(mb * 1000, last_mb * 1000 *
+				(MFC_QOS_BUCKETS - 1)), window_ms);
+	kbps = (unsigned int)div_u64(max(bytes * 8, last_bytes * 8 *
+				(MFC_QOS_BUCKETS - 1)), window_ms);
+
+	if (warm < MFC_QOS_BUCKETS - 1)
+		mb_rate = max_t(unsigned int, mb_rate, get_ctx_mb(ctx));
+
+	load = max_t(unsigned int, mb_rate, kbps * 1000 / MFC_QOS_BITS_PER_MB);
+
+	mfc_debug(7, "ctx %d: %u mb/s, %u kbps, load %u\n",
+			ctx->num, mb_rate, kbps, load);
+
+	l->load += load;
+	l->mb_rate += mb_rate;
+	l->kbps += kbps;
+}
+
+/* Called with qos_mutex held */
+static void mfc_qos_update(struct s5p_mfc_dev *dev)
+{
 	struct s5p_mfc_platdata *pdata = dev->pdata;
 	struct s5p_mfc_qos *qos_table = pdata->qos_table;
+	struct s5p_mfc_ctx *qos_ctx;
+	struct mfc_qos_load l = { 0, 0, 0 };
+	int cur = atomic_read(&dev->qos_req_cur);
 	int i;
 
+	list_for_each_entry(qos_ctx, &dev->qos_queue, qos_list)
+		mfc_qos_ctx_load(qos_ctx, &l);
+
 	for (i = (pdata->num_qos_steps - 1); i >= 0; i--) {
 		mfc_debug(7, "QoS index: %d\n", i + 1);
-		if (total_mb > qos_table[i].thrd_mb) {
+		if (l.load > qos_table[i].thrd_mb)
+			break;
+	}
+
+	if (i < 0) {
+		/* Every context is idle */
+		if (cur != 0)
+			mfc_qos_operate(dev, MFC_QOS_REMOVE, 0, &l);
+		return;
+	}
+
 #ifdef CONFIG_ARM_EXYNOS_IKS_CPUFREQ
-			mfc_debug(2, "\tint: %d, mif: %d, cpu: %d\n",
-					qos_table[i].freq_int,
-					qos_table[i].freq_mif,
-					qos_table[i].freq_cpu);
+	mfc_debug(2, "\tint: %d, mif: %d, cpu: %d\n",
+			qos_table[i].freq_int,
+			qos_table[i].freq_mif,
+			qos_table[i].freq_cpu);
 #endif
 #ifdef CONFIG_ARM_EXYNOS_MP_CPUFREQ
-			mfc_debug(2, "\tint: %d, mif: %d, cpu: %d, kfc: %d\n",
-					qos_table[i].freq_int,
-					qos_table[i].freq_mif,
-					qos_table[i].freq_cpu,
-					qos_table[i].freq_kfc);
+	mfc_debug(2, "\tint: %d, mif: %d, cpu: %d, kfc: %d\n",
+			qos_table[i].freq_int,
+			qos_table[i].freq_mif,
+			qos_table[i].freq_cpu,
+			qos_table[i].freq_kfc);
 #endif
-			if (atomic_read(&dev->qos_req_cur) == 0)
-				mfc_qos_operate(ctx, MFC_QOS_ADD, i);
-			else if (atomic_read(&dev->qos_req_cur) != (i + 1))
-				mfc_qos_operate(ctx, MFC_QOS_UPDATE, i);
+	if (cur == 0)
+		mfc_qos_operate(dev, MFC_QOS_ADD, i, &l);
+	else if (cur != (i + 1))
+		mfc_qos_operate(dev, MFC_QOS_UPDATE, i, &l);
+}
 
-			break;
-		}
+static void mfc_qos_work(struct work_struct *work)
+{
+	struct s5p_mfc_dev *dev = container_of(to_delayed_work(work),
+					struct s5p_mfc_dev, qos_work);
+
+	mutex_lock(&dev->qos_mutex);
+	if (!list_empty(&dev->qos_queue)) {
+		mfc_qos_update(dev);
+		schedule_delayed_work(&dev->qos_work,
+				msecs_to_jiffies(MFC_QOS_BUCKET_MS));
 	}
+	mutex_unlock(&dev->qos_mutex);
 }
 
-static inline int get_ctx_mb(struct s5p_mfc_ctx *ctx)
+/* Account a frame the hardware finished, from the interrupt handler */
+void s5p_mfc_qos_frame_done(struct s5p_mfc_ctx *ctx, unsigned int bytes)
 {
-	int mb_width, mb_height, fps;
+	struct s5p_mfc_dev *dev = ctx->dev;
+	struct s5p_mfc_qos_window *win = &ctx->qos_win;
+	unsigned long flags;
+	u32 mb;
 
-	mb_width = (ctx->img_width + 15) / 16;
-	mb_height = (ctx->img_height + 15) / 16;
-	fps = ctx->framerate / 1000;
+	mb = ((ctx->img_width + 15) / 16) * ((ctx->img_height + 15) / 16);
 
-	return mb_width * mb_height * fps;
+	spin_lock_irqsave(&dev->qos_lock, flags);
+	mfc_qos_advance(win, jiffies);
+	win->mb[win->cur] += mb;
+	win->bytes[win->cur] += bytes;
+	spin_unlock_irqrestore(&dev->qos_lock, flags);
 }
 
 void s5p_mfc_qos_on(struct s5p_mfc_ctx *ctx)
 {
 	struct s5p_mfc_dev *dev = ctx->dev;
 	struct s5p_mfc_ctx *qos_ctx;
-	int found = 0, total_mb = 0;
+	unsigned long flags;
+	int found = 0;
 	/* TODO: cpu lock is not separated yet */
 	int need_cpulock = 0;
 
+	mutex_lock(&dev->qos_mutex);
+
 	list_for_each_entry(qos_ctx, &dev->qos_queue, qos_list) {
-		total_mb += get_ctx_mb(qos_ctx);
 		if (qos_ctx == ctx)
 			found = 1;
 	}
 
 	if (!found) {
+		spin_lock_irqsave(&dev->qos_lock, flags);
+		memset(&ctx->qos_win, 0, sizeof(ctx->qos_win));
+		ctx->qos_win.start = jiffies;
+		spin_unlock_irqrestore(&dev->qos_lock, flags);
+
 		list_add_tail(&ctx->qos_list, &dev->qos_queue);
-		total_mb += get_ctx_mb(ctx);
 	}
 
 	/* TODO: need_cpulock will be used for cpu lock */
@@ -172,38 +327,60 @@ void s5p_mfc_qos_on(struct s5p_mfc_ctx *ctx)
 			need_cpulock++;
 	}
 
-	mfc_qos_add_or_update(ctx, total_mb);
+	mfc_qos_update(dev);
+	schedule_delayed_work(&dev->qos_work,
+			msecs_to_jiffies(MFC_QOS_BUCKET_MS));
+
+	mutex_unlock(&dev->qos_mutex);
 }
 
 void s5p_mfc_qos_off(struct s5p_mfc_ctx *ctx)
 {
 	struct s5p_mfc_dev *dev = ctx->dev;
 	struct s5p_mfc_ctx *qos_ctx;
-	int found = 0, total_mb = 0;
+	struct mfc_qos_load l = { 0, 0, 0 };
+	int found = 0;
+
+	mutex_lock(&dev->qos_mutex);
 
 	if (list_empty(&dev->qos_queue)) {
 		if (atomic_read(&dev->qos_req_cur) != 0) {
 			mfc_err("MFC request count is wrong!\n");
-			mfc_qos_operate(ctx, MFC_QOS_REMOVE, 0);
+			mfc_qos_operate(dev, MFC_QOS_REMOVE, 0, &l);
 		}
 
-		return;
+		goto out;
 	}
 
 	list_for_each_entry(qos_ctx, &dev->qos_queue, qos_list) {
-		total_mb += get_ctx_mb(qos_ctx);
 		if (qos_ctx == ctx)
 			found = 1;
 	}
 
-	if (found) {
+	if (found)
 		list_del(&ctx->qos_list);
-		total_mb -= get_ctx_mb(ctx);
+
+	if (list_empty(&dev->qos_queue)) {
+		if (atomic_read(&dev->qos_req_cur) != 0)
+			mfc_qos_operate(dev, MFC_QOS_REMOVE, 0, &l);
+		cancel_delayed_work(&dev->qos_work);
+	} else {
+		mfc_qos_update(dev);
 	}
+out:
+	mutex_unlock(&dev->qos_mutex);
+}
 
-	if (list_empty(&dev->qos_queue))
-		mfc_qos_operate(ctx, MFC_QOS_REMOVE, 0);
-	else
-		mfc_qos_add_or_update(ctx, total_mb);
+void s5p_mfc_qos_init(struct s5p_mfc_dev *dev)
+{
+	INIT_LIST_HEAD(&dev->qos_queue);
+	mutex_init(&dev->qos_mutex);
+	spin_lock_init(&dev->qos_lock);
+	INIT_DELAYED_WORK(&dev->qos_work, mfc_qos_work);
+}
+
+void s5p_mfc_qos_exit(struct s5p_mfc_dev *dev)
+{
+	cancel_delayed_work_sync(&dev->qos_work);
 }
 #endif
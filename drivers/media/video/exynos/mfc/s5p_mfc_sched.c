@@ -0,0 +1,174 @@
+/*
+ * linux/drivers/media/video/exynos/mfc/s5p_mfc_sched.c
+ *
+ * Copyright (c) 2012 Samsung Electronics Co., Ltd.
+ *		http://www.samsung.com/
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ */
+
+#include <linux/err.h>
+#include <linux/ktime.h>
+#include <linux/math64.h>
+#include <linux/debugfs.h>
+#include <linux/seq_file.h>
+
+#include "s5p_mfc_common.h"
+#include "s5p_mfc_debug.h"
+
+/*
+ * Called when ctx is opened.  Its wait starts now, a context that has never
+ * run is not starved.
+ */
+void s5p_mfc_sched_init(struct s5p_mfc_ctx *ctx)
+{
+	ctx->sched.prio = V4L2_MPEG_MFC_SCHED_PRIO_NORMAL;
+	ctx->sched.waiting_us = ktime_to_us(ktime_get());
+}
+
+/* Called with the hardware locked for ctx, before the command is issued */
+void s5p_mfc_sched_start(struct s5p_mfc_ctx *ctx)
+{
+	struct s5p_mfc_dev *dev = ctx->dev;
+	struct s5p_mfc_sched_stats *st = &ctx->sched_stats;
+	u64 now = ktime_to_us(ktime_get());
+	unsigned long flags;
+
+	spin_lock_irqsave(&dev->condlock, flags);
+	if (ctx->sched.urgent) {
+		ctx->sched.waiting_us = now;
+	} else {
+		st->prev_deadline_us = ctx->sched.deadline_us;
+		st->deadline_us = s5p_mfc_sched_charge(&ctx->sched, now);
+		st->start_us = now;
+		st->running = 1;
+	}
+	spin_unlock_irqrestore(&dev->condlock, flags);
+}
+
+/* The command could not be issued after all, undo s5p_mfc_sched_start() */
+void s5p_mfc_sched_cancel(struct s5p_mfc_ctx *ctx)
+{
+	struct s5p_mfc_dev *dev = ctx->dev;
+	struct s5p_mfc_sched_stats *st = &ctx->sched_stats;
+	unsigned long flags;
+
+	spin_lock_irqsave(&dev->condlock, flags);
+	if (st->running) {
+		ctx->sched.deadline_us = st->prev_deadline_us;
+		st->running = 0;
+	}
+	spin_unlock_irqrestore(&dev->condlock, flags);
+}
+
+/* Called from the interrupt handler when the hardware is done with ctx */
+void s5p_mfc_sched_done(struct s5p_mfc_ctx *ctx)
+{
+	struct s5p_mfc_dev *dev = ctx->dev;
+	struct s5p_mfc_sched_stats *st = &ctx->sched_stats;
+	u64 now = ktime_to_us(ktime_get());
+	unsigned long flags;
+	u32 busy;
+
+	spin_lock_irqsave(&dev->condlock, flags);
+	if (!st->running) {
+		spin_unlock_irqrestore(&dev->condlock, flags);
+		return;
+	}
+	st->running = 0;
+
+	busy = (u32)min_t(u64, now - st->start_us, UINT_MAX);
+	if (!st->frames)
+		st->first_us = st->start_us;
+	st->frames++;
+	st->busy_us += busy;
+	st->max_busy_us = max(st->max_busy_us, busy);
+	st->last_us = now;
+
+	if (now > st->deadline_us) {
+		st->misses++;
+		st->max_late_us = max_t(u32, st->max_late_us,
+				min_t(u64, now - st->deadline_us, UINT_MAX));
+	}
+	spin_unlock_irqrestore(&dev->condlock, flags);
+
+	mfc_debug(3, "ctx %d: frame took %u us\n", ctx->num, busy);
+}
+
+static int s5p_mfc_sched_show(struct seq_file *s, void *unused)
+{
+	struct s5p_mfc_dev *dev = s->private;
+	struct s5p_mfc_sched_stats st;
+	struct s5p_mfc_ctx *ctx;
+	u64 span;
+	u32 fps, avg;
+	int prio, period;
+	int i;
+
+	seq_printf(s, "%3s %4s %4s %9s %8s %6s %8s %8s %7s %8s\n",
+			"ctx", "type", "prio", "period_us", "frames", "fps",
+			"avg_us", "max_us", "misses", "late_us");
+
+	mutex_lock(&dev->mfc_mutex);
+	for (i = 0; i < MFC_NUM_CONTEXTS; i++) {
+		ctx = dev->ctx[i];
+		if (!ctx)
+			continue;
+
+		spin_lock_irq(&dev->condlock);
+		st = ctx->sched_stats;
+		prio = ctx->sched.prio;
+		period = ctx->sched.period_us;
+		spin_unlock_irq(&dev->condlock);
+
+		fps = 0;
+		avg = 0;
+		span = st.last_us - st.first_us;
+		if (st.frames > 1 && span)
+			fps = (u32)div64_u64((u64)(st.frames - 1) * 10 *
+						USEC_PER_SEC, span);
+		if (st.frames)
+			avg = (u32)div64_u64(st.busy_us, st.frames);
+
+		seq_printf(s, "%3d %4s %4d %9d %8lu %4u.%u %8u %8u %7lu %8u\n",
+				i, ctx->type == MFCINST_ENCODER ? "enc" : "dec",
+				prio, period, st.frames, fps / 10, fps % 10,
+				avg, st.max_busy_us, st.misses, st.max_late_us);
+	}
+	mutex_unlock(&dev->mfc_mutex);
+
+	return 0;
+}
+
+static int s5p_mfc_sched_open(struct inode *inode, struct file *file)
+{
+	return single_open(file, s5p_mfc_sched_show, inode->i_private);
+}
+
+static const struct file_operations s5p_mfc_sched_fops = {
+	.open		= s5p_mfc_sched_open,
+	.read		= seq_read,
+	.llseek		= seq_lseek,
+	.release	= single_release,
+};
+
+void s5p_mfc_sched_debugfs_init(struct s5p_mfc_dev *dev)
+{
+	dev->debugfs_root = debugfs_create_dir("s5p-mfc", NULL);
+	if (IS_ERR_OR_NULL(dev->debugfs_root)) {
+		dev->debugfs_root = NULL;
+		return;
+	}
+
+	debugfs_create_file("sched", S_IRUGO, dev->debugfs_root, dev,
+			&s5p_mfc_sched_fops);
+}
+
+void s5p_mfc_sched_debugfs_exit(struct s5p_mfc_dev *dev)
+{
+	debugfs_remove_recursive(dev->debugfs_root);
+	dev->debugfs_root = NULL;
+}
@@ -0,0 +1,146 @@
+/*
+ * Samsung S5P Multi Format Codec V5/V6
+ *
+ * Context scheduling policy
+ *
+ * Copyright (c) 2012 Samsung Electronics Co., Ltd.
+ *		http://www.samsung.com/
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ */
+
+#ifndef S5P_MFC_SCHED_H_
+#define S5P_MFC_SCHED_H_
+
+/*
+ * Picks the next context to run on the hardware among the runnable ones:
+ *
+ * - Pending commands (open, init, flush, close) go first, they are short
+ *   and someone sleeps on them.
+ * - A context that has been runnable for MFC_SCHED_STARVE_US without
+ *   being picked goes next, so background work always makes progress.
+ * - Otherwise the lowest V4L2_MPEG_MFC_SCHED_PRIO_* class wins, and inside
+ *   a class the earliest frame deadline.  A context with a frame deadline
+ *   hint of period_us gets one frame per period: the deadline of its next
+ *   frame moves by one period each time a frame is dispatched, and restarts
+ *   from now after an idle period.  Contexts without a hint come after
+ *   those with one.
+ * - Ties go round robin, starting after the previous context.
+ *
+ * Only plain integer arithmetic on u32/u64 is used, so that the simulator
+ * in tools/mfc can build this file unchanged.
+ */
+
+#define MFC_SCHED_STARVE_US	100000
+#define MFC_SCHED_NO_DEADLINE	(~0ULL)
+
+struct s5p_mfc_sched_entity {
+	int prio;		/* V4L2_MPEG_MFC_SCHED_PRIO_*, lower runs first */
+	u32 period_us;		/* frame deadline hint, 0 for none */
+	u64 deadline_us;	/* deadline of the next frame */
+	u64 waiting_us;		/* runnable and not picked since */
+	int urgent;		/* pending work is a command, not a frame */
+};
+
+/* Deadline of the next frame, MFC_SCHED_NO_DEADLINE without a hint */
+static inline u64 s5p_mfc_sched_deadline(struct s5p_mfc_sched_entity *ent,
+					 u64 now_us)
+{
+	if (!ent->period_us)
+		return MFC_SCHED_NO_DEADLINE;
+
+	/* Idle for more than a period: the stream starts over */
+	if (ent->deadline_us + ent->period_us < now_us)
+		return now_us + ent->period_us;
+
+	return ent->deadline_us;
+}
+
+/**
+ * s5p_mfc_sched_pick - choose the next context
+ * @ent: scheduling state per context number, NULL for free slots
+ * @nr: number of slots
+ * @work_bits: runnable contexts, one bit per context number
+ * @prev: previously run context number
+ * @now_us: current time
+ *
+ * Returns the context number, or -1 if nothing is runnable.
+ */
+static inline int s5p_mfc_sched_pick(struct s5p_mfc_sched_entity **ent,
+				     int nr, unsigned long work_bits,
+				     int prev, u64 now_us)
+{
+	struct s5p_mfc_sched_entity *e;
+	u64 deadline, best_deadline = 0;
+	int class, best_class = 0;
+	int best = -1;
+	int i, n;
+
+	if (prev < 0)
+		prev = nr - 1;
+
+	for (n = 1; n <= nr; n++) {
+		i = (prev + n) % nr;
+		e = ent[i];
+		if (!e)
+			continue;
+
+		if (!(work_bits & (1UL << i))) {
+			e->waiting_us = now_us;
+			continue;
+		}
+
+		deadline = MFC_SCHED_NO_DEADLINE;
+		if (e->urgent) {
+			class = 0;
+		} else if (now_us - e->waiting_us > MFC_SCHED_STARVE_US) {
+			class = 1;
+		} else {
+			class = 2 + e->prio;
+			deadline = s5p_mfc_sched_deadline(e, now_us);
+		}
+
+		if (best < 0 || class < best_class ||
+		    (class == best_class && deadline < best_deadline)) {
+			best = i;
+			best_class = class;
+			best_deadline = deadline;
+		}
+	}
+
+	return best;
+}
+
+/**
+ * s5p_mfc_sched_charge - account a frame dispatched to the hardware
+ *
+ * Returns the deadline of that frame.
+ */
+static inline u64 s5p_mfc_sched_charge(struct s5p_mfc_sched_entity *ent,
+				       u64 now_us)
+{
+	u64 deadline = s5p_mfc_sched_deadline(ent, now_us);
+
+	ent->waiting_us = now_us;
+	if (deadline != MFC_SCHED_NO_DEADLINE)
+		ent->deadline_us = deadline + ent->period_us;
+
+	return deadline;
+}
+
+#ifdef __KERNEL__
+struct s5p_mfc_ctx;
+struct s5p_mfc_dev;
+
+void s5p_mfc_sched_init(struct s5p_mfc_ctx *ctx);
+void s5p_mfc_sched_start(struct s5p_mfc_ctx *ctx);
+void s5p_mfc_sched_cancel(struct s5p_mfc_ctx *ctx);
+void s5p_mfc_sched_done(struct s5p_mfc_ctx *ctx);
+void s5p_mfc_sched_debugfs_init(struct s5p_mfc_dev *dev);
+void s5p_mfc_sched_debugfs_exit(struct s5p_mfc_dev *dev);
+#endif
+
+#endif /* S5P_MFC_SCHED_H_ */
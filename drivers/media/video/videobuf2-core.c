@@ -24,6 +24,14 @@
 static int debug;
 module_param(debug, int, 0644);
 
+/*
+ * USERPTR/DMABUF planes each queue keeps acquired after their buffer moved
+ * on to other memory, 0 disables the mapping cache.  Entries already cached
+ * are released at the next USERPTR/DMABUF qbuf on their queue.
+ */
+static unsigned int map_cache = 8;
+module_param(map_cache, uint, 0644);
+
 #define dprintk(level, fmt, arg...)					\
 	do {								\
 		if (debug >= level)					\
@@ -37,6 +45,9 @@ module_param(debug, int, 0644);
 #define call_qop(q, op, args...)					\
 	(((q)->ops->op) ? ((q)->ops->op(args)) : 0)
 
+/* How long qbuf on an output queue waits for the producer of a dma-buf. */
+#define VB2_FENCE_TIMEOUT	1000	/* Millisecond. */
+
 #define V4L2_BUFFER_STATE_FLAGS	(V4L2_BUF_FLAG_MAPPED | V4L2_BUF_FLAG_QUEUED | \
 				 V4L2_BUF_FLAG_DONE | V4L2_BUF_FLAG_ERROR | \
 				 V4L2_BUF_FLAG_PREPARED)
@@ -141,6 +152,178 @@ static void __vb2_buf_dmabuf_put(struct vb2_buffer *vb)
 		__vb2_plane_dmabuf_put(q, &vb->planes[plane]);
 }
 
+/**
+ * struct vb2_map_entry - plane memory in the mapping cache of a queue
+ * @list:	entry in the cache LRU
+ * @alloc_ctx:	allocator context the memory was acquired with
+ * @dbuf:	DMABUF: the shared buffer, the entry owns a reference to it
+ * @mm:		USERPTR: address space of @userptr, the entry holds an
+ *		mm_count reference so that the pointer is not reused
+ * @userptr:	USERPTR: userspace address of the plane
+ * @length:	USERPTR: length of the plane
+ * @mem_priv:	allocator private data of the plane
+ */
+struct vb2_map_entry {
+	struct list_head	list;
+	void			*alloc_ctx;
+	struct dma_buf		*dbuf;
+	struct mm_struct	*mm;
+	unsigned long		userptr;
+	unsigned long		length;
+	void			*mem_priv;
+};
+
+/**
+ * __vb2_map_release() - release USERPTR or DMABUF plane memory
+ */
+static void __vb2_map_release(struct vb2_queue *q, struct dma_buf *dbuf,
+			      void *mem_priv)
+{
+	if (dbuf) {
+		call_memop(q, detach_dmabuf, mem_priv);
+		dma_buf_put(dbuf);
+	} else {
+		call_memop(q, put_userptr, mem_priv);
+	}
+}
+
+static void __vb2_map_entry_free(struct vb2_queue *q, struct vb2_map_entry *e)
+{
+	list_del(&e->list);
+	q->map_cache.count--;
+	if (e->mm)
+		mmdrop(e->mm);
+	kfree(e);
+}
+
+/**
+ * __vb2_map_cache_get() - take plane memory out of the mapping cache
+ *
+ * Looks up the memory for a DMABUF plane by @dbuf, or for a USERPTR plane
+ * (@dbuf is NULL) by @userptr and @length in the address space of the
+ * caller, in the same way __qbuf_userptr() trusts an unchanged pointer for
+ * the buffer it was acquired for.
+ * Returns the allocator private data, or NULL on a miss.  On a DMABUF hit
+ * the reference to @dbuf held by the cache moves to the caller.
+ */
+static void *__vb2_map_cache_get(struct vb2_queue *q, unsigned int plane,
+				 struct dma_buf *dbuf, unsigned long userptr,
+				 unsigned long length)
+{
+	struct mm_struct *mm = dbuf ? NULL : current->mm;
+	struct vb2_map_entry *e;
+	void *mem_priv;
+
+	/* Most recently cached first */
+	list_for_each_entry_reverse(e, &q->map_cache.lru, list) {
+		if (e->alloc_ctx != q->alloc_ctx[plane] || e->dbuf != dbuf ||
+		    e->mm != mm || e->userptr != userptr ||
+		    e->length != length)
+			continue;
+
+		mem_priv = e->mem_priv;
+		__vb2_map_entry_free(q, e);
+		q->map_cache.hits++;
+		dprintk(3, "map cache: hit for plane %d\n", plane);
+		return mem_priv;
+	}
+
+	q->map_cache.misses++;
+	return NULL;
+}
+
+/**
+ * __vb2_map_cache_put() - keep plane memory that is no longer used by its
+ * buffer acquired, for when it is queued again
+ *
+ * The least recently cached planes are released beyond map_cache entries.
+ * Takes over the reference to @dbuf.  USERPTR memory is cached for the
+ * address space of the caller, the one queueing into its buffer.
+ */
+static void __vb2_map_cache_put(struct vb2_queue *q, unsigned int plane,
+				struct dma_buf *dbuf, unsigned long userptr,
+				unsigned long length, void *mem_priv)
+{
+	struct vb2_map_entry *e = NULL;
+
+	if (map_cache)
+		e = kmalloc(sizeof(*e), GFP_KERNEL);
+	if (!e) {
+		__vb2_map_release(q, dbuf, mem_priv);
+		return;
+	}
+
+	e->alloc_ctx = q->alloc_ctx[plane];
+	e->dbuf = dbuf;
+	e->mm = NULL;
+	if (!dbuf && current->mm) {
+		e->mm = current->mm;
+		atomic_inc(&e->mm->mm_count);
+	}
+	e->userptr = userptr;
+	e->length = length;
+	e->mem_priv = mem_priv;
+	list_add_tail(&e->list, &q->map_cache.lru);
+	q->map_cache.count++;
+
+	while (q->map_cache.count > map_cache) {
+		e = list_first_entry(&q->map_cache.lru, struct vb2_map_entry,
+				     list);
+		__vb2_map_release(q, e->dbuf, e->mem_priv);
+		__vb2_map_entry_free(q, e);
+		q->map_cache.evictions++;
+	}
+}
+
+/**
+ * __vb2_map_cache_flush() - release all plane memory in the mapping cache
+ */
+static void __vb2_map_cache_flush(struct vb2_queue *q)
+{
+	struct vb2_map_entry *e, *tmp;
+
+	if (!q->map_cache.count)
+		return;
+
+	list_for_each_entry_safe(e, tmp, &q->map_cache.lru, list) {
+		__vb2_map_release(q, e->dbuf, e->mem_priv);
+		__vb2_map_entry_free(q, e);
+	}
+
+	dprintk(1, "%s: map cache: %lu hits, %lu misses, %lu evictions\n",
+		q->name, q->map_cache.hits, q->map_cache.misses,
+		q->map_cache.evictions);
+}
+
+/**
+ * __vb2_map_cache_check() - release the cached planes of a queue once the
+ * mapping cache has been turned off
+ */
+static void __vb2_map_cache_check(struct vb2_queue *q)
+{
+	if (!ACCESS_ONCE(map_cache))
+		__vb2_map_cache_flush(q);
+}
+
+/**
+ * __vb2_plane_dmabuf_cache() - move the memory of a DMABUF plane to the
+ * mapping cache
+ */
+static void __vb2_plane_dmabuf_cache(struct vb2_queue *q, struct vb2_buffer *vb,
+				     unsigned int plane)
+{
+	struct vb2_plane *p = &vb->planes[plane];
+
+	if (!p->mem_priv)
+		return;
+
+	if (p->dbuf_mapped)
+		call_memop(q, unmap_dmabuf, p->mem_priv);
+
+	__vb2_map_cache_put(q, plane, p->dbuf, 0, 0, p->mem_priv);
+	memset(p, 0, sizeof *p);
+}
+
 /**
  * __setup_offsets() - setup unique offsets ("cookies") for every plane in
  * every buffer on the queue
@@ -307,8 +490,10 @@ static void __vb2_queue_free(struct vb2_queue *q, unsigned int buffers)
 	}
 
 	q->num_buffers -= buffers;
-	if (!q->num_buffers)
+	if (!q->num_buffers) {
 		q->memory = 0;
+		__vb2_map_cache_flush(q);
+	}
 	INIT_LIST_HEAD(&q->queued_list);
 
 	if (q->timeline) {
@@ -850,6 +1035,76 @@ void *vb2_plane_cookie(struct vb2_buffer *vb, unsigned int plane_no)
 }
 EXPORT_SYMBOL_GPL(vb2_plane_cookie);
 
+/**
+ * __vb2_publish_fences() - publish a fence on each dma-buf plane of a capture
+ * buffer, so that consumers of the dma-buf wait for the driver to fill it
+ */
+static void __vb2_publish_fences(struct vb2_buffer *vb)
+{
+	struct vb2_queue *q = vb->vb2_queue;
+	unsigned int plane;
+
+	if (q->memory != V4L2_MEMORY_DMABUF || V4L2_TYPE_IS_OUTPUT(q->type))
+		return;
+
+	q->fence_seqno++;
+
+	for (plane = 0; plane < vb->num_planes; ++plane) {
+		struct vb2_plane *p = &vb->planes[plane];
+
+		p->fence = fence_create_sw(q->fence_context, q->fence_seqno);
+		if (!p->fence) {
+			dprintk(1, "failed to create fence for plane %d\n",
+				plane);
+			continue;
+		}
+
+		dma_buf_set_excl_fence(p->dbuf, p->fence);
+	}
+}
+
+/**
+ * __vb2_signal_fences() - signal the fences published by
+ * __vb2_publish_fences(), the driver is done with the buffer
+ */
+static void __vb2_signal_fences(struct vb2_buffer *vb)
+{
+	unsigned int plane;
+
+	for (plane = 0; plane < vb->num_planes; ++plane) {
+		struct vb2_plane *p = &vb->planes[plane];
+
+		if (!p->fence)
+			continue;
+
+		fence_signal(p->fence);
+		fence_put(p->fence);
+		p->fence = NULL;
+	}
+}
+
+/**
+ * __vb2_wait_fences() - wait for the producers of the dma-buf planes of an
+ * output buffer before the driver reads them
+ */
+static int __vb2_wait_fences(struct vb2_buffer *vb)
+{
+	unsigned int plane;
+	long ret;
+
+	for (plane = 0; plane < vb->num_planes; ++plane) {
+		ret = dma_buf_wait_excl_fence(vb->planes[plane].dbuf, true,
+				msecs_to_jiffies(VB2_FENCE_TIMEOUT));
+		if (ret == -ERESTARTSYS)
+			return ret;
+		if (!ret)
+			pr_warn("%s: timeout waiting for dma-buf of plane %d\n",
+				vb->vb2_queue->name, plane);
+	}
+
+	return 0;
+}
+
 /**
  * vb2_buffer_done() - inform videobuf that an operation on a buffer is finished
  * @vb:		vb2_buffer returned from the driver
@@ -881,6 +1136,8 @@ void vb2_buffer_done(struct vb2_buffer *vb, enum vb2_buffer_state state)
 	for (plane = 0; plane < vb->num_planes; ++plane)
 		call_memop(q, finish, vb->planes[plane].mem_priv);
 
+	__vb2_signal_fences(vb);
+
 	/* Add the buffer to the done buffers list */
 	spin_lock_irqsave(&q->done_lock, flags);
 	vb->state = state;
@@ -997,6 +1254,8 @@ static int __qbuf_userptr(struct vb2_buffer *vb, const struct v4l2_buffer *b)
 	if (ret)
 		return ret;
 
+	__vb2_map_cache_check(q);
+
 	for (plane = 0; plane < vb->num_planes; ++plane) {
 		/* Skip the plane if already verified */
 		if (vb->v4l2_planes[plane].m.userptr &&
@@ -1013,24 +1272,32 @@ static int __qbuf_userptr(struct vb2_buffer *vb, const struct v4l2_buffer *b)
 			goto err;
 		}
 
-		/* Release previously acquired memory if present */
-		if (vb->planes[plane].mem_priv)
-			call_memop(q, put_userptr, vb->planes[plane].mem_priv);
-
-		vb->planes[plane].mem_priv = NULL;
-		vb->v4l2_planes[plane].m.userptr = 0;
-		vb->v4l2_planes[plane].length = 0;
-
 		/* Acquire each plane's memory */
-		mem_priv = call_memop(q, get_userptr, q->alloc_ctx[plane],
-				      planes[plane].m.userptr,
-				      planes[plane].length, write, plane);
+		mem_priv = __vb2_map_cache_get(q, plane, NULL,
+					       planes[plane].m.userptr,
+					       planes[plane].length);
+		if (!mem_priv)
+			mem_priv = call_memop(q, get_userptr,
+					      q->alloc_ctx[plane],
+					      planes[plane].m.userptr,
+					      planes[plane].length, write,
+					      plane);
 		if (IS_ERR_OR_NULL(mem_priv)) {
 			dprintk(1, "qbuf: failed acquiring userspace "
 						"memory for plane %d\n", plane);
 			ret = mem_priv ? PTR_ERR(mem_priv) : -EINVAL;
 			goto err;
 		}
+
+		/* Keep previously acquired memory for when it comes back */
+		if (vb->planes[plane].mem_priv)
+			__vb2_map_cache_put(q, plane, NULL,
+					    vb->v4l2_planes[plane].m.userptr,
+					    vb->v4l2_planes[plane].length,
+					    vb->planes[plane].mem_priv);
+
+		vb->v4l2_planes[plane].m.userptr = 0;
+		vb->v4l2_planes[plane].length = 0;
 		vb->planes[plane].mem_priv = mem_priv;
 	}
 
@@ -1092,6 +1359,8 @@ static int __qbuf_dmabuf(struct vb2_buffer *vb, const struct v4l2_buffer *b)
 		return ret;
 	}
 
+	__vb2_map_cache_check(q);
+
 	for (plane = 0; plane < vb->num_planes; ++plane) {
 		struct dma_buf *dbuf = dma_buf_get(planes[plane].m.fd);
 
@@ -1114,21 +1383,31 @@ static int __qbuf_dmabuf(struct vb2_buffer *vb, const struct v4l2_buffer *b)
 		dprintk(3, "qbuf: buffer description for plane %d changed, "
 			"reattaching dma buf\n", plane);
 
-		/* Release previously acquired memory if present */
-		__vb2_plane_dmabuf_put(q, &vb->planes[plane]);
-
 		/* Acquire each plane's memory */
-		mem_priv = call_memop(q, attach_dmabuf, q->alloc_ctx[plane],
-			dbuf, q->plane_sizes[plane], write);
+		mem_priv = NULL;
+		if (dbuf->size >= q->plane_sizes[plane])
+			mem_priv = __vb2_map_cache_get(q, plane, dbuf, 0, 0);
+		if (mem_priv) {
+			/* The cache held a reference of its own */
+			dma_buf_put(dbuf);
+		} else {
+			mem_priv = call_memop(q, attach_dmabuf,
+					q->alloc_ctx[plane], dbuf,
+					q->plane_sizes[plane], write);
+		}
 		if (IS_ERR(mem_priv)) {
 			dprintk(1, "qbuf: failed acquiring dmabuf "
 				"memory for plane %d\n", plane);
 			pr_err("qbuf: failed acquiring dmabuf "
 				"memory for plane %d\n", plane);
+			dma_buf_put(dbuf);
 			ret = PTR_ERR(mem_priv);
 			goto err;
 		}
 
+		/* Keep previously acquired memory for when it comes back */
+		__vb2_plane_dmabuf_cache(q, vb, plane);
+
 		planes[plane].length = dbuf->size;
 		vb->planes[plane].dbuf = dbuf;
 		vb->planes[plane].mem_priv = mem_priv;
@@ -1192,6 +1471,8 @@ static void __enqueue_in_driver(struct vb2_buffer *vb)
 	for (plane = 0; plane < vb->num_planes; ++plane)
 		call_memop(q, prepare, vb->planes[plane].mem_priv);
 
+	__vb2_publish_fences(vb);
+
 	q->ops->buf_queue(vb);
 }
 
@@ -1211,6 +1492,8 @@ static int __buf_prepare(struct vb2_buffer *vb, const struct v4l2_buffer *b)
 		ret = __qbuf_dmabuf(vb, b);
 		if (ret)
 			pr_err("__qbuf_dmabuf failed w/ err: %d\n", ret);
+		else if (V4L2_TYPE_IS_OUTPUT(q->type))
+			ret = __vb2_wait_fences(vb);
 		break;
 	default:
 		WARN(1, "Invalid queue type\n");
@@ -1678,6 +1961,9 @@ static void __vb2_queue_cancel(struct vb2_queue *q)
 		struct vb2_buffer *vb = q->bufs[i];
 		int plane;
 
+		/* Don't leave consumers waiting for buffers never filled. */
+		__vb2_signal_fences(vb);
+
 		vb->state = VB2_BUF_STATE_DEQUEUED;
 
 		if (q->memory != V4L2_MEMORY_DMABUF)
@@ -2101,6 +2387,7 @@ int vb2_queue_init(struct vb2_queue *q)
 
 	INIT_LIST_HEAD(&q->queued_list);
 	INIT_LIST_HEAD(&q->done_list);
+	INIT_LIST_HEAD(&q->map_cache.lru);
 	spin_lock_init(&q->done_lock);
 	init_waitqueue_head(&q->done_wq);
 
@@ -2110,6 +2397,8 @@ int vb2_queue_init(struct vb2_queue *q)
 	if (q->buf_struct_size == 0)
 		q->buf_struct_size = sizeof(struct vb2_buffer);
 
+	q->fence_context = fence_context_alloc(1);
+
 	return 0;
 }
 EXPORT_SYMBOL_GPL(vb2_queue_init);
@@ -43,6 +43,9 @@
 #ifdef CONFIG_SENSORS_SSP_SENSORHUB
 #include "ssp_sensorhub.h"
 #endif
+#ifdef CONFIG_SENSORS_SSP_BATCH
+#include "ssp_batch.h"
+#endif
 
 #ifdef CONFIG_HAS_EARLYSUSPEND
 #undef CONFIG_HAS_EARLYSUSPEND
@@ -424,6 +427,14 @@ enum {
 	BIG_TYPE_MAX,
 };
 
+struct ssp_data;
+
+/* byte transport to the MCU, replaced by a mock in the self test */
+struct ssp_transport {
+	int (*read)(struct ssp_data *, void *, size_t);
+	int (*write)(struct ssp_data *, const void *, size_t);
+};
+
 struct ssp_data {
 	struct input_dev *acc_input_dev;
 	struct input_dev *gyro_input_dev;
@@ -436,6 +447,7 @@ struct ssp_data {
 #ifdef CONFIG_SENSORS_SSP_STM
 	struct spi_device *spi;
 #endif
+	const struct ssp_transport *xfer;
 	struct i2c_client *client;
 	struct wake_lock ssp_wake_lock;
 	struct timer_list debug_timer;
@@ -514,6 +526,9 @@ struct ssp_data {
 
 #ifdef CONFIG_SENSORS_SSP_SENSORHUB
 	struct ssp_sensorhub_data *hub_data;
+#endif
+#ifdef CONFIG_SENSORS_SSP_BATCH
+	struct ssp_batch_data *batch_data;
 #endif
 	int ap_rev;
 	int accel_position;
@@ -542,6 +557,8 @@ struct ssp_big {
 	u32 addr;
 };
 
+extern const struct ssp_transport ssp_spi_transport;
+
 void ssp_enable(struct ssp_data *, bool);
 int ssp_spi_async(struct ssp_data *, struct ssp_msg *);
 int ssp_spi_sync(struct ssp_data *, struct ssp_msg *, int);
@@ -0,0 +1,460 @@
+/*
+ *  Copyright (C) 2013, Samsung Electronics Co. Ltd. All Rights Reserved.
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ */
+
+#include <linux/fs.h>
+#include <linux/kref.h>
+#include <linux/mm.h>
+#include <linux/poll.h>
+#include <linux/vmalloc.h>
+#include "ssp.h"
+
+#define BATCH_WAKE_LOCK_TIMEOUT		(HZ / 2)
+
+#define batch_err(str, args...) \
+	pr_err("[SSP]: %s - " str, __func__, ##args)
+
+/*
+ * The producer side, ssp_batch_push() and ssp_batch_commit(), only runs
+ * from the interrupt thread through parse_dataframe(), so the rings are
+ * single producer single consumer and need no lock.  head and watermark
+ * are kept here as well as in the ring, the copies userspace can write
+ * to are never trusted.
+ *
+ * Open files hold a reference, so that the rings they may have mapped stay
+ * around after the hub is removed; their requests fail from then on.
+ */
+struct ssp_batch_data {
+	struct kref kref;
+	bool removed;			/* ssp_data is gone */
+	struct ssp_data *ssp_data;
+	struct miscdevice batch_device;
+	struct ssp_batch_ring *ring[SENSOR_MAX];
+	u32 head[SENSOR_MAX];
+	u32 watermark[SENSOR_MAX];
+	unsigned long enabled;		/* sensors reported to their ring */
+	unsigned long ready;		/* watermark reached or flushed */
+	unsigned long flushed;		/* flush requested since last poll */
+	wait_queue_head_t batch_wq;
+	struct mutex batch_mutex;	/* enable, disable, flush, removed */
+	struct wake_lock batch_wake_lock;
+};
+
+static inline u32 ssp_batch_fill(struct ssp_batch_data *batch, int sensor)
+{
+	return batch->head[sensor] - ACCESS_ONCE(batch->ring[sensor]->tail);
+}
+
+bool ssp_batch_push(struct ssp_data *data, int sensor,
+	struct sensor_value *value)
+{
+	struct ssp_batch_data *batch = data->batch_data;
+	struct ssp_batch_ring *ring;
+	struct ssp_batch_sample *sample;
+	u32 head;
+
+	BUILD_BUG_ON(offsetof(struct sensor_value, timestamp) >
+		SSP_BATCH_SAMPLE_DATA);
+	BUILD_BUG_ON(SENSOR_MAX > BITS_PER_LONG);
+
+	if (!batch || !test_bit(sensor, &batch->enabled))
+		return false;
+
+	ring = batch->ring[sensor];
+	head = batch->head[sensor];
+
+	if (ssp_batch_fill(batch, sensor) >= SSP_BATCH_RING_SAMPLES) {
+		ring->dropped++;
+		return true;
+	}
+
+	/* the reader is done with the slot before it moved tail past it */
+	smp_mb();
+
+	sample = &ring->samples[head % SSP_BATCH_RING_SAMPLES];
+	sample->timestamp = value->timestamp;
+	memcpy(sample->data, value, offsetof(struct sensor_value, timestamp));
+
+	batch->head[sensor] = head + 1;
+	return true;
+}
+
+void ssp_batch_commit(struct ssp_data *data)
+{
+	struct ssp_batch_data *batch = data->batch_data;
+	bool wakeup = false;
+	int sensor;
+
+	if (!batch)
+		return;
+
+	for_each_set_bit(sensor, &batch->enabled, SENSOR_MAX) {
+		struct ssp_batch_ring *ring = batch->ring[sensor];
+
+		if (ring->head == batch->head[sensor])
+			continue;
+
+		/* samples are written before the reader can see them */
+		smp_wmb();
+		ring->head = batch->head[sensor];
+
+		if ((ssp_batch_fill(batch, sensor) >= batch->watermark[sensor] ||
+			test_bit(sensor, &batch->flushed)) &&
+			!test_and_set_bit(sensor, &batch->ready))
+			wakeup = true;
+	}
+
+	if (wakeup) {
+		wake_lock_timeout(&batch->batch_wake_lock,
+			BATCH_WAKE_LOCK_TIMEOUT);
+		wake_up_interruptible(&batch->batch_wq);
+	}
+}
+
+/*
+ * A sensor stays ready until its reader drained it below the watermark,
+ * a flush makes it ready once.  The bit is cleared before the ring is
+ * looked at, so that a commit in between either sees it cleared and
+ * wakes up, or is seen here.
+ */
+static bool __ssp_batch_ready(struct ssp_batch_data *batch)
+{
+	int sensor;
+
+	for_each_set_bit(sensor, &batch->ready, SENSOR_MAX) {
+		clear_bit(sensor, &batch->ready);
+		smp_mb__after_clear_bit();
+
+		if (!test_bit(sensor, &batch->enabled))
+			continue;
+
+		if (test_and_clear_bit(sensor, &batch->flushed) ||
+			ssp_batch_fill(batch, sensor) >=
+				batch->watermark[sensor])
+			set_bit(sensor, &batch->ready);
+	}
+
+	return batch->ready != 0;
+}
+
+bool ssp_batch_ready(struct ssp_data *data)
+{
+	return __ssp_batch_ready(data->batch_data);
+}
+
+static int __ssp_batch_enable(struct ssp_batch_data *batch, u32 sensor,
+	u32 watermark)
+{
+	struct ssp_batch_ring *ring;
+	int ret = 0;
+
+	if (sensor >= SENSOR_MAX || watermark > SSP_BATCH_RING_SAMPLES)
+		return -EINVAL;
+	if (!watermark)
+		watermark = SSP_BATCH_RING_SAMPLES / 2;
+
+	mutex_lock(&batch->batch_mutex);
+
+	if (batch->removed) {
+		ret = -ENODEV;
+		goto exit;
+	}
+
+	if (test_bit(sensor, &batch->enabled)) {
+		ret = -EBUSY;
+		goto exit;
+	}
+
+	/* rings stay allocated until removal, they may still be mapped */
+	ring = batch->ring[sensor];
+	if (!ring) {
+		ring = vmalloc_user(SSP_BATCH_MAP_SIZE);
+		if (!ring) {
+			ret = -ENOMEM;
+			goto exit;
+		}
+		batch->ring[sensor] = ring;
+	}
+
+	ring->head = 0;
+	ring->tail = 0;
+	ring->size = SSP_BATCH_RING_SAMPLES;
+	ring->watermark = watermark;
+	ring->dropped = 0;
+	ring->sensor = sensor;
+	batch->head[sensor] = 0;
+	batch->watermark[sensor] = watermark;
+
+	/* the ring is set up before the interrupt thread fills it */
+	smp_mb__before_clear_bit();
+	set_bit(sensor, &batch->enabled);
+exit:
+	mutex_unlock(&batch->batch_mutex);
+	return ret;
+}
+
+int ssp_batch_enable(struct ssp_data *data, u32 sensor, u32 watermark)
+{
+	return __ssp_batch_enable(data->batch_data, sensor, watermark);
+}
+
+static void __ssp_batch_disable(struct ssp_batch_data *batch, u32 sensor)
+{
+	if (sensor >= SENSOR_MAX)
+		return;
+
+	mutex_lock(&batch->batch_mutex);
+	clear_bit(sensor, &batch->enabled);
+	clear_bit(sensor, &batch->ready);
+	clear_bit(sensor, &batch->flushed);
+	mutex_unlock(&batch->batch_mutex);
+}
+
+void ssp_batch_disable(struct ssp_data *data, u32 sensor)
+{
+	__ssp_batch_disable(data->batch_data, sensor);
+}
+
+struct ssp_batch_ring *ssp_batch_get_ring(struct ssp_data *data, u32 sensor)
+{
+	if (sensor >= SENSOR_MAX)
+		return NULL;
+
+	return data->batch_data->ring[sensor];
+}
+
+/* have the hub send its FIFO and make the ring ready even below watermark */
+static int ssp_batch_flush(struct ssp_batch_data *batch, u32 sensor)
+{
+	struct ssp_data *data;
+	int ret = 0;
+
+	if (sensor >= SENSOR_MAX)
+		return -EINVAL;
+
+	mutex_lock(&batch->batch_mutex);
+	data = batch->ssp_data;
+
+	if (batch->removed) {
+		ret = -ENODEV;
+		goto exit;
+	}
+
+	if (!test_bit(sensor, &batch->enabled) ||
+		!(atomic_read(&data->aSensorEnable) & (1 << sensor))) {
+		ret = -EINVAL;
+		goto exit;
+	}
+
+	if (flush(data, sensor) < 0) {
+		batch_err("flush(%u) err\n", sensor);
+		ret = -EIO;
+		goto exit;
+	}
+
+	set_bit(sensor, &batch->flushed);
+	set_bit(sensor, &batch->ready);
+	wake_up_interruptible(&batch->batch_wq);
+exit:
+	mutex_unlock(&batch->batch_mutex);
+	return ret;
+}
+
+static long ssp_batch_ioctl(struct file *file, unsigned int cmd,
+				unsigned long arg)
+{
+	struct ssp_batch_data *batch
+		= container_of(file->private_data,
+			struct ssp_batch_data, batch_device);
+	void __user *argp = (void __user *)arg;
+	struct ssp_batch_config config;
+	u32 sensor;
+
+	switch (cmd) {
+	case SSP_BATCH_IOCTL_ENABLE:
+		if (copy_from_user(&config, argp, sizeof(config)))
+			return -EFAULT;
+		return __ssp_batch_enable(batch, config.sensor,
+			config.watermark);
+
+	case SSP_BATCH_IOCTL_DISABLE:
+		if (get_user(sensor, (u32 __user *)argp))
+			return -EFAULT;
+		__ssp_batch_disable(batch, sensor);
+		return 0;
+
+	case SSP_BATCH_IOCTL_FLUSH:
+		if (get_user(sensor, (u32 __user *)argp))
+			return -EFAULT;
+		return ssp_batch_flush(batch, sensor);
+
+	default:
+		batch_err("ioctl cmd err(%d)\n", cmd);
+		return -EINVAL;
+	}
+}
+
+static unsigned int ssp_batch_poll(struct file *file, poll_table *wait)
+{
+	struct ssp_batch_data *batch
+		= container_of(file->private_data,
+			struct ssp_batch_data, batch_device);
+
+	poll_wait(file, &batch->batch_wq, wait);
+
+	if (ACCESS_ONCE(batch->removed))
+		return POLLERR | POLLHUP;
+
+	return __ssp_batch_ready(batch) ? POLLIN | POLLRDNORM : 0;
+}
+
+static int ssp_batch_mmap(struct file *file, struct vm_area_struct *vma)
+{
+	struct ssp_batch_data *batch
+		= container_of(file->private_data,
+			struct ssp_batch_data, batch_device);
+	unsigned long pages = SSP_BATCH_MAP_SIZE >> PAGE_SHIFT;
+	unsigned long sensor = vma->vm_pgoff / pages;
+	int ret;
+
+	if (vma->vm_pgoff % pages || sensor >= SENSOR_MAX ||
+		vma->vm_end - vma->vm_start > SSP_BATCH_MAP_SIZE)
+		return -EINVAL;
+
+	mutex_lock(&batch->batch_mutex);
+	if (batch->ring[sensor] && !batch->removed)
+		ret = remap_vmalloc_range(vma, batch->ring[sensor], 0);
+	else
+		ret = -ENODEV;
+	mutex_unlock(&batch->batch_mutex);
+
+	return ret;
+}
+
+static void ssp_batch_free(struct kref *kref)
+{
+	struct ssp_batch_data *batch
+		= container_of(kref, struct ssp_batch_data, kref);
+	int sensor;
+
+	for (sensor = 0; sensor < SENSOR_MAX; sensor++)
+		vfree(batch->ring[sensor]);
+	wake_lock_destroy(&batch->batch_wake_lock);
+	mutex_destroy(&batch->batch_mutex);
+	kfree(batch);
+}
+
+/* misc_open() calls this under misc_mtx, so misc_deregister() waits for it */
+static int ssp_batch_open(struct inode *inode, struct file *file)
+{
+	struct ssp_batch_data *batch
+		= container_of(file->private_data,
+			struct ssp_batch_data, batch_device);
+
+	kref_get(&batch->kref);
+	return nonseekable_open(inode, file);
+}
+
+static int ssp_batch_release(struct inode *inode, struct file *file)
+{
+	struct ssp_batch_data *batch
+		= container_of(file->private_data,
+			struct ssp_batch_data, batch_device);
+
+	kref_put(&batch->kref, ssp_batch_free);
+	return 0;
+}
+
+static const struct file_operations ssp_batch_fops = {
+	.owner = THIS_MODULE,
+	.open = ssp_batch_open,
+	.release = ssp_batch_release,
+	.unlocked_ioctl = ssp_batch_ioctl,
+	.poll = ssp_batch_poll,
+	.mmap = ssp_batch_mmap,
+	.llseek = no_llseek,
+};
+
+int ssp_batch_create(struct ssp_data *data)
+{
+	struct ssp_batch_data *batch;
+
+	batch = kzalloc(sizeof(*batch), GFP_KERNEL);
+	if (!batch) {
+		batch_err("allocate memory for batch data err\n");
+		return -ENOMEM;
+	}
+
+	kref_init(&batch->kref);
+	batch->ssp_data = data;
+	init_waitqueue_head(&batch->batch_wq);
+	mutex_init(&batch->batch_mutex);
+	wake_lock_init(&batch->batch_wake_lock, WAKE_LOCK_SUSPEND,
+		"ssp_batch_wake_lock");
+
+	data->batch_data = batch;
+	return 0;
+}
+
+/* detach the batch data from @data, files still open keep it around */
+void ssp_batch_destroy(struct ssp_data *data)
+{
+	struct ssp_batch_data *batch = data->batch_data;
+
+	if (!batch)
+		return;
+
+	data->batch_data = NULL;
+
+	mutex_lock(&batch->batch_mutex);
+	batch->removed = true;
+	batch->enabled = 0;
+	batch->ssp_data = NULL;
+	mutex_unlock(&batch->batch_mutex);
+	wake_up_interruptible(&batch->batch_wq);
+
+	kref_put(&batch->kref, ssp_batch_free);
+}
+
+int ssp_batch_initialize(struct ssp_data *data)
+{
+	struct ssp_batch_data *batch;
+	int ret;
+
+	ret = ssp_batch_create(data);
+	if (ret < 0)
+		return ret;
+
+	batch = data->batch_data;
+	batch->batch_device.minor = MISC_DYNAMIC_MINOR;
+	batch->batch_device.name = "ssp_batch";
+	batch->batch_device.fops = &ssp_batch_fops;
+
+	ret = misc_register(&batch->batch_device);
+	if (ret < 0) {
+		batch_err("register batch misc device err(%d)\n", ret);
+		ssp_batch_destroy(data);
+	}
+
+	return ret;
+}
+
+void ssp_batch_remove(struct ssp_data *data)
+{
+	if (!data->batch_data)
+		return;
+
+	misc_deregister(&data->batch_data->batch_device);
+	ssp_batch_destroy(data);
+}
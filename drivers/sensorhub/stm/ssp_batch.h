@@ -0,0 +1,96 @@
+/*
+ *  Copyright (C) 2013, Samsung Electronics Co. Ltd. All Rights Reserved.
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ */
+
+#ifndef __SSP_BATCH_H__
+#define __SSP_BATCH_H__
+
+#include <linux/ioctl.h>
+#include <linux/types.h>
+
+/*
+ * Batched delivery of sensor samples.
+ *
+ * A sensor switched to batching with SSP_BATCH_IOCTL_ENABLE stops
+ * reporting through its input device; the samples the hub sends are
+ * stored in a ring of that sensor instead, which the reader maps from
+ * /dev/ssp_batch at offset sensor * SSP_BATCH_MAP_SIZE.  The kernel
+ * publishes head once per hub data frame and only moves it, the reader
+ * only moves tail; both count samples and never wrap, the slot of a
+ * sample is its count modulo size.  A full ring drops the new samples
+ * and counts them in dropped.
+ *
+ * poll() returns POLLIN once a ring holds watermark samples, or after
+ * SSP_BATCH_IOCTL_FLUSH made the hub send what its FIFO held.  How long
+ * the hub itself batches is still set through the batch latency of the
+ * sensor delay.
+ */
+#define SSP_BATCH_MAP_SIZE		(64 * 1024)
+#define SSP_BATCH_SAMPLE_DATA		56
+
+struct ssp_batch_sample {
+	__u64 timestamp;			/* ns, as in the input events */
+	__u8 data[SSP_BATCH_SAMPLE_DATA];	/* sensor_value payload */
+};
+
+struct ssp_batch_ring {
+	/* written by the kernel */
+	__u32 head;
+	__u32 size;
+	__u32 watermark;
+	__u32 dropped;
+	__u32 sensor;
+	__u32 reserved0[11];
+
+	/* written by the reader */
+	__u32 tail;
+	__u32 reserved1[15];
+
+	struct ssp_batch_sample samples[0];
+};
+
+#define SSP_BATCH_RING_SAMPLES						\
+	((SSP_BATCH_MAP_SIZE - sizeof(struct ssp_batch_ring)) /		\
+		sizeof(struct ssp_batch_sample))
+
+struct ssp_batch_config {
+	__u32 sensor;
+	__u32 watermark;	/* 0 for half of the ring */
+};
+
+#define SSP_BATCH_IOCTL_MAGIC		'B'
+#define SSP_BATCH_IOCTL_ENABLE		_IOW(SSP_BATCH_IOCTL_MAGIC, 1, \
+						struct ssp_batch_config)
+#define SSP_BATCH_IOCTL_DISABLE		_IOW(SSP_BATCH_IOCTL_MAGIC, 2, __u32)
+#define SSP_BATCH_IOCTL_FLUSH		_IOW(SSP_BATCH_IOCTL_MAGIC, 3, __u32)
+
+#ifdef __KERNEL__
+struct ssp_data;
+struct ssp_batch_data;
+struct sensor_value;
+
+bool ssp_batch_push(struct ssp_data *data, int sensor,
+	struct sensor_value *value);
+void ssp_batch_commit(struct ssp_data *data);
+int ssp_batch_enable(struct ssp_data *data, u32 sensor, u32 watermark);
+void ssp_batch_disable(struct ssp_data *data, u32 sensor);
+struct ssp_batch_ring *ssp_batch_get_ring(struct ssp_data *data, u32 sensor);
+bool ssp_batch_ready(struct ssp_data *data);
+int ssp_batch_create(struct ssp_data *data);
+void ssp_batch_destroy(struct ssp_data *data);
+int ssp_batch_initialize(struct ssp_data *data);
+void ssp_batch_remove(struct ssp_data *data);
+#endif
+
+#endif
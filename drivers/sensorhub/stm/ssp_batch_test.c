@@ -0,0 +1,329 @@
+/*
+ *  Copyright (C) 2013, Samsung Electronics Co. Ltd. All Rights Reserved.
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ */
+
+/*
+ * Self test of the dataframe parser and of batched delivery.  The hub is
+ * replaced by a mock transport that plays back HUB2AP_WRITE messages the
+ * test composed, and select_irq_msg() is run as the interrupt thread
+ * would, so no MCU or SPI bus is needed.
+ */
+
+#include "ssp.h"
+
+#define MSG2AP_INST_BYPASS_DATA		0x37
+#define MOCK_BUF_SIZE			(DATA_PACKET_SIZE + 4)
+#define TEST_FRAME_SAMPLES		40
+
+struct ssp_mock {
+	u8 buf[MOCK_BUF_SIZE];
+	int len;
+	int pos;
+	int writes;
+};
+
+static struct ssp_mock mock;
+
+static int ssp_mock_read(struct ssp_data *data, void *buf, size_t len)
+{
+	if (mock.pos + len > mock.len)
+		return -EIO;
+
+	memcpy(buf, mock.buf + mock.pos, len);
+	mock.pos += len;
+	return 0;
+}
+
+static int ssp_mock_write(struct ssp_data *data, const void *buf, size_t len)
+{
+	mock.writes++;
+	return 0;
+}
+
+static const struct ssp_transport ssp_mock_transport = {
+	.read = ssp_mock_read,
+	.write = ssp_mock_write,
+};
+
+/* queue the header and the frame the hub sends with an interrupt */
+static u8 *mock_begin(void)
+{
+	u16 options = HUB2AP_WRITE;
+
+	mock.len = 4;
+	mock.pos = 0;
+	memcpy(mock.buf, &options, 2);
+	return mock.buf + mock.len;
+}
+
+static void mock_end(u8 *end)
+{
+	u16 length = end - (mock.buf + 4);
+
+	memcpy(mock.buf + 2, &length, 2);
+	mock.len = end - mock.buf;
+}
+
+static u8 *mock_sample(u8 *p, u8 sensor, s16 x, s16 y, s16 z, s32 ts_ms)
+{
+	*p++ = MSG2AP_INST_BYPASS_DATA;
+	*p++ = sensor;
+	memcpy(p, &x, 2);
+	memcpy(p + 2, &y, 2);
+	memcpy(p + 4, &z, 2);
+	memcpy(p + 6, &ts_ms, 4);
+	return p + 10;
+}
+
+/* one interrupt carrying count accelerometer samples starting at n */
+static int mock_irq(struct ssp_data *data, int n, int count)
+{
+	int iRet, i;
+	u8 *p = mock_begin();
+
+	for (i = n; i < n + count; i++)
+		p = mock_sample(p, ACCELEROMETER_SENSOR, i, -i, 2 * i, i);
+	mock_end(p);
+
+	iRet = select_irq_msg(data);
+	if (iRet != SUCCESS || mock.pos != mock.len) {
+		pr_err("[SSP]: %s - irq %d failed %d, read %d/%d\n",
+			__func__, n, iRet, mock.pos, mock.len);
+		return -EIO;
+	}
+
+	return 0;
+}
+
+static int check_samples(struct ssp_batch_ring *ring, u32 from, u32 to,
+	u64 base)
+{
+	struct ssp_batch_sample *sample;
+	struct sensor_value value;
+	u32 i;
+
+	for (i = from; i != to; i++) {
+		sample = &ring->samples[i % ring->size];
+		memcpy(&value, sample->data,
+			offsetof(struct sensor_value, timestamp));
+		if (value.x != (s16)i || value.y != (s16)-i ||
+			value.z != (s16)(2 * i) ||
+			sample->timestamp != base + (u64)i * 1000000) {
+			pr_err("[SSP]: %s - sample %u is %d %d %d %llu\n",
+				__func__, i, value.x, value.y, value.z,
+				sample->timestamp);
+			return -EINVAL;
+		}
+	}
+
+	return 0;
+}
+
+static int test_batch_enable(struct ssp_data *data)
+{
+	int iRet;
+
+	if (ssp_batch_enable(data, SENSOR_MAX, 0) != -EINVAL) {
+		pr_err("[SSP]: %s - invalid sensor accepted\n", __func__);
+		return -EINVAL;
+	}
+
+	if (ssp_batch_enable(data, ACCELEROMETER_SENSOR,
+		SSP_BATCH_RING_SAMPLES + 1) != -EINVAL) {
+		pr_err("[SSP]: %s - watermark above ring accepted\n",
+			__func__);
+		return -EINVAL;
+	}
+
+	iRet = ssp_batch_enable(data, ACCELEROMETER_SENSOR,
+		TEST_FRAME_SAMPLES * 2);
+	if (iRet < 0) {
+		pr_err("[SSP]: %s - enable failed %d\n", __func__, iRet);
+		return iRet;
+	}
+
+	if (ssp_batch_enable(data, ACCELEROMETER_SENSOR, 0) != -EBUSY) {
+		pr_err("[SSP]: %s - enabled twice\n", __func__);
+		return -EINVAL;
+	}
+
+	return 0;
+}
+
+static int test_batch(struct ssp_data *data)
+{
+	struct ssp_batch_ring *ring;
+	u64 base;
+	u32 n = 0;
+	int iRet;
+
+	iRet = test_batch_enable(data);
+	if (iRet < 0)
+		return iRet;
+
+	ring = ssp_batch_get_ring(data, ACCELEROMETER_SENSOR);
+	if (ring == NULL || ring->size != SSP_BATCH_RING_SAMPLES) {
+		pr_err("[SSP]: %s - no ring\n", __func__);
+		return -EINVAL;
+	}
+
+	/* parse_dataframe() moves the timestamp base after every frame */
+	data->bTimeSyncing = false;
+	base = data->timestamp;
+
+	/* below the watermark, published but not ready */
+	iRet = mock_irq(data, n, TEST_FRAME_SAMPLES);
+	if (iRet < 0)
+		return iRet;
+	n += TEST_FRAME_SAMPLES;
+	if (ring->head != n || ssp_batch_ready(data)) {
+		pr_err("[SSP]: %s - head %u, ready below watermark\n",
+			__func__, ring->head);
+		return -EINVAL;
+	}
+
+	/* the second frame reaches it */
+	iRet = mock_irq(data, n, TEST_FRAME_SAMPLES);
+	if (iRet < 0)
+		return iRet;
+	n += TEST_FRAME_SAMPLES;
+	if (ring->head != n || !ssp_batch_ready(data)) {
+		pr_err("[SSP]: %s - head %u, not ready at watermark\n",
+			__func__, ring->head);
+		return -EINVAL;
+	}
+
+	iRet = check_samples(ring, 0, n, base);
+	if (iRet < 0)
+		return iRet;
+
+	/* reading half of it goes back below the watermark */
+	ring->tail = TEST_FRAME_SAMPLES;
+	if (ssp_batch_ready(data)) {
+		pr_err("[SSP]: %s - ready after read\n", __func__);
+		return -EINVAL;
+	}
+	ring->tail = n;
+
+	/* fill up past the end, the overflow is dropped and counted */
+	while (n + TEST_FRAME_SAMPLES <= ring->tail + ring->size) {
+		iRet = mock_irq(data, n, TEST_FRAME_SAMPLES);
+		if (iRet < 0)
+			return iRet;
+		n += TEST_FRAME_SAMPLES;
+	}
+
+	iRet = mock_irq(data, n, TEST_FRAME_SAMPLES);
+	if (iRet < 0)
+		return iRet;
+	if (ring->head != ring->tail + ring->size ||
+		ring->dropped != n + TEST_FRAME_SAMPLES -
+			(ring->tail + ring->size) ||
+		!ssp_batch_ready(data)) {
+		pr_err("[SSP]: %s - overflow head %u, dropped %u\n",
+			__func__, ring->head, ring->dropped);
+		return -EINVAL;
+	}
+
+	iRet = check_samples(ring, ring->tail, ring->head, base);
+	if (iRet < 0)
+		return iRet;
+
+	/* a reader scribbling over head cannot move the kernel's */
+	ring->head = 0;
+	ring->tail = ring->tail + ring->size;
+	n = ring->tail;
+	iRet = mock_irq(data, n, 1);
+	if (iRet < 0)
+		return iRet;
+	if (ring->head != n + 1) {
+		pr_err("[SSP]: %s - head %u after scribble\n",
+			__func__, ring->head);
+		return -EINVAL;
+	}
+
+	/* disabled sensors go back to their input device */
+	ssp_batch_disable(data, ACCELEROMETER_SENSOR);
+	if (ssp_batch_ready(data) || ring->head != n + 1) {
+		pr_err("[SSP]: %s - head %u after disable\n",
+			__func__, ring->head);
+		return -EINVAL;
+	}
+
+	return 0;
+}
+
+static int test_parse_errors(struct ssp_data *data)
+{
+	u8 *p;
+
+	/* unknown sensor */
+	p = mock_begin();
+	*p++ = MSG2AP_INST_BYPASS_DATA;
+	*p++ = SENSOR_MAX;
+	mock_end(p);
+	if (select_irq_msg(data) != SUCCESS) {
+		pr_err("[SSP]: %s - unknown sensor not skipped\n", __func__);
+		return -EINVAL;
+	}
+
+	/* short read from the bus */
+	mock_begin();
+	mock_end(mock_sample(mock.buf + 4, ACCELEROMETER_SENSOR, 0, 0, 0, 0));
+	mock.len -= 4;
+	if (select_irq_msg(data) != ERROR) {
+		pr_err("[SSP]: %s - short read not reported\n", __func__);
+		return -EINVAL;
+	}
+
+	return 0;
+}
+
+static int __init ssp_batch_test_init(void)
+{
+	struct ssp_data *data;
+	int iRet;
+
+	data = kzalloc(sizeof(*data), GFP_KERNEL);
+	if (data == NULL)
+		return -ENOMEM;
+
+	data->xfer = &ssp_mock_transport;
+	data->timestamp = 1000000000ULL;
+	mutex_init(&data->pending_mutex);
+	INIT_LIST_HEAD(&data->pending_list);
+	initialize_function_pointer(data);
+
+	iRet = ssp_batch_create(data);
+	if (iRet < 0)
+		goto exit;
+
+	iRet = test_batch(data);
+	if (iRet == 0)
+		iRet = test_parse_errors(data);
+	if (iRet < 0)
+		pr_err("[SSP]: %s - batch self test failed %d\n",
+			__func__, iRet);
+
+	ssp_batch_destroy(data);
+	iRet = 0;
+exit:
+	mutex_destroy(&data->pending_mutex);
+	kfree(data);
+	return iRet;
+}
+module_init(ssp_batch_test_init);
+
+MODULE_DESCRIPTION("Seamless Sensor Platform(SSP) batch self test");
+MODULE_LICENSE("GPL");
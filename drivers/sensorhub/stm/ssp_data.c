@@ -147,6 +147,10 @@ int parse_dataframe(struct ssp_data *data, char *pchRcvDataFrame, int iLength)
 					&iDataIdx, &sensorsdata);
 			get_timestamp(data, pchRcvDataFrame, &iDataIdx,
 					&sensorsdata);
+#ifdef CONFIG_SENSORS_SSP_BATCH
+			if (ssp_batch_push(data, iSensorData, &sensorsdata))
+				break;
+#endif
 			data->report_sensor_data[iSensorData](data,
 					&sensorsdata);
 			break;
@@ -187,6 +191,11 @@ int parse_dataframe(struct ssp_data *data, char *pchRcvDataFrame, int iLength)
 	if (data->bTimeSyncing)
 		data->timestamp = ts.tv_sec * 1000000000ULL + ts.tv_nsec;
 
+#ifdef CONFIG_SENSORS_SSP_BATCH
+	/* the whole frame becomes visible to the readers at once */
+	ssp_batch_commit(data);
+#endif
+
 	return SUCCESS;
 }
 
@@ -295,6 +295,7 @@ static int ssp_probe(struct spi_device *spi)
 	data->bProbeIsDone = false;
 	data->fw_dl_state = FW_DL_STATE_NONE;
 	data->spi = spi;
+	data->xfer = &ssp_spi_transport;
 	spi_set_drvdata(spi, data);
 
 #ifdef CONFIG_SENSORS_SSP_STM
@@ -361,6 +362,13 @@ static int ssp_probe(struct spi_device *spi)
 	}
 #endif
 
+#ifdef CONFIG_SENSORS_SSP_BATCH
+	iRet = ssp_batch_initialize(data);
+	if (iRet < 0)
+		pr_err("[SSP]: %s - ssp_batch_initialize err(%d)\n",
+			__func__, iRet);
+#endif
+
 	ssp_enable(data, true);
 	/* check boot loader binary */
 	data->fw_dl_state = check_fwbl(data);
@@ -409,6 +417,9 @@ static int ssp_probe(struct spi_device *spi)
 	goto exit;
 
 err_read_reg:
+#ifdef CONFIG_SENSORS_SSP_BATCH
+	ssp_batch_remove(data);
+#endif
 err_symlink_create:
 	remove_sysfs(data);
 err_sysfs_create:
@@ -474,6 +485,9 @@ static void ssp_shutdown(struct spi_device *spi)
 #ifdef CONFIG_SENSORS_SSP_SENSORHUB
 	ssp_sensorhub_remove(data);
 #endif
+#ifdef CONFIG_SENSORS_SSP_BATCH
+	ssp_batch_remove(data);
+#endif
 
 	del_timer_sync(&data->debug_timer);
 	cancel_work_sync(&data->work_debug);
@@ -18,6 +18,22 @@
 #define RECEIVEBUFFERSIZE	12
 #define DEBUG_SHOW_DATA	0
 
+static int ssp_spi_read_buf(struct ssp_data *data, void *buf, size_t len)
+{
+	return spi_read(data->spi, buf, len);
+}
+
+static int ssp_spi_write_buf(struct ssp_data *data, const void *buf,
+	size_t len)
+{
+	return spi_write(data->spi, buf, len);
+}
+
+const struct ssp_transport ssp_spi_transport = {
+	.read = ssp_spi_read_buf,
+	.write = ssp_spi_write_buf,
+};
+
 static void clean_msg(struct ssp_msg *msg)
 {
 	if (msg->free_buffer)
@@ -51,7 +67,7 @@ static int do_transfer(struct ssp_data *data, struct ssp_msg *msg,
 		}
 	}
 
-	status = spi_write(data->spi, msg, 9) >= 0;
+	status = data->xfer->write(data, msg, 9) >= 0;
 	if (status == 0) {
 		pr_err("[SSP]: %s spi_write fail!!\n", __func__);
 		gpio_set_value_cansleep(data->ap_int, 1);
@@ -146,7 +162,7 @@ int select_irq_msg(struct ssp_data *data)
 	char* buffer;
 	char chTempBuf[4] = { -1 };
 
-	iRet = spi_read(data->spi, chTempBuf, sizeof(chTempBuf));
+	iRet = data->xfer->read(data, chTempBuf, sizeof(chTempBuf));
 	if (iRet < 0) {
 		pr_err("[SSP]: %s spi_read fail!!\n", __func__);
 		return ERROR;
@@ -181,9 +197,9 @@ int select_irq_msg(struct ssp_data *data)
 			} /* For dead msg, make a temporary buffer to read. */
 
 			if (msg_type == AP2HUB_READ)
-				iRet = spi_read(data->spi, msg->buffer, msg->length);
+				iRet = data->xfer->read(data, msg->buffer, msg->length);
 			if (msg_type == AP2HUB_WRITE) {
-				iRet = spi_write(data->spi, msg->buffer, msg->length);
+				iRet = data->xfer->write(data, msg->buffer, msg->length);
 				if (msg_options & AP2HUB_RETURN) {
 					msg->options = AP2HUB_READ | AP2HUB_RETURN;
 					msg->length = 1;
@@ -210,7 +226,7 @@ exit:
 			iRet = -ENOMEM;
 			break;
 		}
-		iRet = spi_read(data->spi, buffer, chLength);
+		iRet = data->xfer->read(data, buffer, chLength);
 		if (iRet < 0)
 			pr_err("[SSP] %s spi_read fail\n", __func__);
 		else
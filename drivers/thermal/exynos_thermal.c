@@ -36,6 +36,7 @@
 #include <linux/err.h>
 #include <linux/platform_data/exynos_thermal.h>
 #include <linux/thermal.h>
+#include <linux/thermal_ipa.h>
 #include <linux/cpufreq.h>
 #include <linux/cpu_cooling.h>
 #include <linux/of.h>
@@ -611,6 +612,9 @@ static int exynos_register_thermal(struct thermal_sensor_conf *sensor_conf)
 #ifdef CONFIG_ARM_EXYNOS_MP_CPUFREQ
 	struct freq_clip_table *tab_ptr_kfc;
 #endif
+#ifdef CONFIG_CPU_THERMAL_IPA
+	struct ipa_params ipa_params = { 0 };
+#endif
 
 	if (!sensor_conf || !sensor_conf->read_temperature) {
 		pr_err("Temperature sensor not initialised\n");
@@ -671,6 +675,24 @@ static int exynos_register_thermal(struct thermal_sensor_conf *sensor_conf)
 	}
 	th_zone->mode = THERMAL_DEVICE_ENABLED;
 
+#ifdef CONFIG_CPU_THERMAL_IPA
+	/*
+	 * Capping starts at the monitor trip and holds the zone at the warn
+	 * trip; the panic trip and the TMU notifiers stay as the backstop.
+	 */
+	ipa_params.switch_on_temp =
+		sensor_conf->trip_data.trip_val[GET_TRIP(MONITOR_ZONE)] * MCELSIUS;
+	ipa_params.control_temp =
+		sensor_conf->trip_data.trip_val[GET_TRIP(WARN_ZONE)] * MCELSIUS;
+	ipa_params.sustainable_power = IPA_SUSTAINABLE_POWER;
+
+	ret = thermal_ipa_bind(th_zone->therm_dev, &ipa_params);
+	if (ret)
+		pr_err("Failed to bind power allocator: %d\n", ret);
+	else
+		thermal_zone_device_update(th_zone->therm_dev);
+#endif
+
 	pr_info("Exynos: Kernel Thermal management registered\n");
 
 	return 0;
@@ -692,6 +714,11 @@ static void exynos_unregister_thermal(void)
 	}
 #endif
 
+#ifdef CONFIG_CPU_THERMAL_IPA
+	if (th_zone && !IS_ERR_OR_NULL(th_zone->therm_dev))
+		thermal_ipa_unbind(th_zone->therm_dev);
+#endif
+
 	if (th_zone && th_zone->therm_dev)
 		thermal_zone_device_unregister(th_zone->therm_dev);
 
@@ -0,0 +1,428 @@
+/*
+ * drivers/thermal/thermal_ipa.c
+ *
+ * Intelligent Power Allocation for the thermal framework
+ *
+ * Copyright (c) 2013 Samsung Electronics Co., Ltd.
+ *		http://www.samsung.com
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ */
+
+/*
+ * Instead of stepping each cooling device through a fixed table at every
+ * trip, a zone bound here is held at its control temperature by a PID
+ * controller whose output is a power budget.  Every period the budget is
+ * shared between the power actors in proportion to the power each would
+ * draw uncapped, scaled by its weight, and what an actor cannot use is
+ * handed to the ones that still have headroom.  Actors turn their grant
+ * into an operating point through their own power model.
+ */
+
+#define pr_fmt(fmt) "thermal_ipa: " fmt
+
+#include <linux/err.h>
+#include <linux/kernel.h>
+#include <linux/module.h>
+#include <linux/mutex.h>
+#include <linux/slab.h>
+#include <linux/thermal.h>
+#include <linux/thermal_ipa.h>
+
+#define CREATE_TRACE_POINTS
+#include <trace/events/thermal_ipa.h>
+
+#define int_to_frac(x)		((s64)(x) << IPA_FRAC_BITS)
+#define frac_to_int(x)		((s32)((x) >> IPA_FRAC_BITS))
+
+struct thermal_ipa {
+	struct thermal_zone_device *tz;
+	struct ipa_params params;
+	bool controlling;
+	s64 err_integral;	/* mC, summed over the periods */
+	s32 prev_err;
+	s32 p, i, d;		/* last terms, in mW, for the trace */
+};
+
+/* protects the actors and the state of the bound zone */
+static DEFINE_MUTEX(ipa_lock);
+static LIST_HEAD(ipa_actors);
+static struct thermal_ipa *ipa_zone;
+
+int ipa_register_actor(struct ipa_actor *actor)
+{
+	if (!actor->ops || !actor->ops->get_requested_power ||
+	    !actor->ops->get_max_power || !actor->ops->set_power)
+		return -EINVAL;
+
+	if (!actor->weight)
+		actor->weight = IPA_WEIGHT_ONE;
+
+	mutex_lock(&ipa_lock);
+	actor->requested = 0;
+	actor->max = 0;
+	actor->granted = 0;
+	list_add_tail(&actor->node, &ipa_actors);
+	mutex_unlock(&ipa_lock);
+
+	pr_info("%s registered\n", actor->name);
+	return 0;
+}
+EXPORT_SYMBOL(ipa_register_actor);
+
+/* The owner drops whatever cap the actor still holds */
+void ipa_unregister_actor(struct ipa_actor *actor)
+{
+	mutex_lock(&ipa_lock);
+	list_del(&actor->node);
+	mutex_unlock(&ipa_lock);
+}
+EXPORT_SYMBOL(ipa_unregister_actor);
+
+static void ipa_set_default_gains(struct ipa_params *params)
+{
+	s32 range = params->control_temp - params->switch_on_temp;
+
+	if (range <= 0)
+		range = 1;
+
+	if (!params->k_po)
+		params->k_po = int_to_frac(params->sustainable_power) / range;
+	if (!params->k_pu)
+		params->k_pu = int_to_frac(2 * params->sustainable_power) / range;
+	if (!params->k_i)
+		params->k_i = int_to_frac(10) / 1000;
+}
+
+static bool ipa_params_valid(const struct ipa_params *params)
+{
+	return params->control_temp > params->switch_on_temp &&
+		params->sustainable_power && params->k_po >= 0 &&
+		params->k_pu >= 0 && params->k_i >= 0 && params->k_d >= 0 &&
+		params->integral_cutoff >= 0;
+}
+
+/*
+ * Take @params for the bound zone, called with ipa_lock held.  The
+ * proportional gains follow the temperature range and the sustainable
+ * power, so they are derived again when one of those changes.
+ */
+static int ipa_set_params(struct thermal_ipa *ipa, struct ipa_params *params)
+{
+	if (!ipa_params_valid(params))
+		return -EINVAL;
+
+	if (params->switch_on_temp != ipa->params.switch_on_temp ||
+	    params->control_temp != ipa->params.control_temp ||
+	    params->sustainable_power != ipa->params.sustainable_power) {
+		params->k_po = 0;
+		params->k_pu = 0;
+		ipa_set_default_gains(params);
+	}
+
+	ipa->params = *params;
+	return 0;
+}
+
+/*
+ * PID on the distance to the control temperature.  The output is added to
+ * the sustainable power; the integral is bounded so that on its own it can
+ * neither double nor cancel the sustainable power.
+ */
+static u32 ipa_pid(struct thermal_ipa *ipa, unsigned long temp, u32 max_power)
+{
+	struct ipa_params *params = &ipa->params;
+	s32 err = (s32)params->control_temp - (s32)temp;
+	s64 p, i, d, next, power;
+
+	p = (s64)(err < 0 ? params->k_pu : params->k_po) * err;
+
+	i = (s64)params->k_i * ipa->err_integral;
+	if (err < params->integral_cutoff) {
+		next = i + (s64)params->k_i * err;
+		if (abs64(next) < int_to_frac(params->sustainable_power)) {
+			i = next;
+			ipa->err_integral += err;
+		}
+	}
+
+	d = (s64)params->k_d * (err - ipa->prev_err);
+	ipa->prev_err = err;
+
+	ipa->p = frac_to_int(p);
+	ipa->i = frac_to_int(i);
+	ipa->d = frac_to_int(d);
+
+	power = params->sustainable_power + frac_to_int(p + i + d);
+	return clamp_t(s64, power, 0, max_power);
+}
+
+/*
+ * Share @budget out in proportion to the weighted requests, then hand what
+ * the actors capped at their maximum could not take to the others, in
+ * proportion to the headroom they have left.
+ */
+static u32 ipa_divvy(u32 budget)
+{
+	struct ipa_actor *actor;
+	u64 total_weighted = 0;
+	u32 extra = 0, total_headroom = 0, total_granted = 0;
+
+	list_for_each_entry(actor, &ipa_actors, node)
+		total_weighted += actor->weighted;
+
+	list_for_each_entry(actor, &ipa_actors, node) {
+		if (total_weighted)
+			actor->granted = div64_u64((u64)budget * actor->weighted,
+						   total_weighted);
+		else
+			actor->granted = 0;
+
+		if (actor->granted > actor->max) {
+			extra += actor->granted - actor->max;
+			actor->granted = actor->max;
+		}
+		total_headroom += actor->max - actor->granted;
+	}
+
+	if (!total_weighted)
+		extra = budget;
+
+	list_for_each_entry(actor, &ipa_actors, node) {
+		if (extra && total_headroom)
+			actor->granted += div_u64((u64)extra *
+					(actor->max - actor->granted),
+					total_headroom);
+
+		actor->ops->set_power(actor, actor->granted);
+		total_granted += actor->granted;
+
+		trace_thermal_ipa_actor(actor->name, actor->requested,
+				actor->max, actor->granted);
+	}
+
+	return total_granted;
+}
+
+static void ipa_release(struct thermal_ipa *ipa)
+{
+	struct ipa_actor *actor;
+
+	list_for_each_entry(actor, &ipa_actors, node) {
+		actor->granted = actor->ops->get_max_power(actor);
+		actor->ops->set_power(actor, actor->granted);
+	}
+
+	ipa->controlling = false;
+	ipa->err_integral = 0;
+	ipa->prev_err = 0;
+}
+
+/*
+ * Called by thermal_zone_device_update() with the zone locked, in place of
+ * the active and passive trips.  Returns whether the zone is being capped,
+ * so that it is polled at its passive interval.
+ */
+bool thermal_ipa_control(struct thermal_zone_device *tz, unsigned long temp)
+{
+	struct thermal_ipa *ipa = tz->ipa;
+	struct ipa_actor *actor;
+	u32 total_requested = 0, max_power = 0, budget, granted;
+
+	mutex_lock(&ipa_lock);
+
+	if (temp < ipa->params.switch_on_temp) {
+		if (ipa->controlling)
+			ipa_release(ipa);
+		mutex_unlock(&ipa_lock);
+		return false;
+	}
+
+	ipa->controlling = true;
+
+	list_for_each_entry(actor, &ipa_actors, node) {
+		actor->requested = actor->ops->get_requested_power(actor);
+		actor->max = actor->ops->get_max_power(actor);
+		actor->weighted = div_u64((u64)actor->requested * actor->weight,
+					  IPA_WEIGHT_ONE);
+
+		total_requested += actor->requested;
+		max_power += actor->max;
+	}
+
+	budget = ipa_pid(ipa, temp, max_power);
+	granted = ipa_divvy(budget);
+
+	trace_thermal_ipa_allocate(tz->id, temp,
+			(s32)ipa->params.control_temp - (s32)temp,
+			ipa->p, ipa->i, ipa->d, budget, total_requested, granted);
+
+	mutex_unlock(&ipa_lock);
+	return true;
+}
+
+#define to_ipa(_dev) \
+	(container_of(_dev, struct thermal_zone_device, device)->ipa)
+
+#define IPA_PARAM_ATTR(_name, _max)					\
+static ssize_t _name##_show(struct device *dev,				\
+		struct device_attribute *attr, char *buf)		\
+{									\
+	return snprintf(buf, PAGE_SIZE, "%ld\n",			\
+			(long)to_ipa(dev)->params._name);		\
+}									\
+									\
+static ssize_t _name##_store(struct device *dev,			\
+		struct device_attribute *attr, const char *buf,		\
+		size_t count)						\
+{									\
+	struct thermal_ipa *ipa = to_ipa(dev);				\
+	struct ipa_params params;					\
+	long val;							\
+	int ret;							\
+									\
+	if (kstrtol(buf, 10, &val) || val < 0 || val > (_max))		\
+		return -EINVAL;						\
+									\
+	mutex_lock(&ipa_lock);						\
+	params = ipa->params;						\
+	params._name = val;						\
+	ret = ipa_set_params(ipa, &params);				\
+	mutex_unlock(&ipa_lock);					\
+									\
+	return ret ? ret : count;					\
+}									\
+static DEVICE_ATTR(_name, S_IRUGO | S_IWUSR, _name##_show, _name##_store)
+
+IPA_PARAM_ATTR(switch_on_temp, LONG_MAX);
+IPA_PARAM_ATTR(control_temp, LONG_MAX);
+IPA_PARAM_ATTR(sustainable_power, LONG_MAX);
+IPA_PARAM_ATTR(k_po, INT_MAX);
+IPA_PARAM_ATTR(k_pu, INT_MAX);
+IPA_PARAM_ATTR(k_i, INT_MAX);
+IPA_PARAM_ATTR(k_d, INT_MAX);
+IPA_PARAM_ATTR(integral_cutoff, INT_MAX);
+
+static ssize_t actors_show(struct device *dev, struct device_attribute *attr,
+		char *buf)
+{
+	struct ipa_actor *actor;
+	ssize_t len;
+
+	len = snprintf(buf, PAGE_SIZE, "%-12s %6s %9s %9s %9s\n", "actor",
+			"weight", "requested", "max", "granted");
+
+	mutex_lock(&ipa_lock);
+	list_for_each_entry(actor, &ipa_actors, node)
+		len += snprintf(buf + len, PAGE_SIZE - len,
+				"%-12s %6u %9u %9u %9u\n", actor->name,
+				actor->weight, actor->requested, actor->max,
+				actor->granted);
+	mutex_unlock(&ipa_lock);
+
+	return len;
+}
+static DEVICE_ATTR(actors, S_IRUGO, actors_show, NULL);
+
+static struct attribute *ipa_attrs[] = {
+	&dev_attr_switch_on_temp.attr,
+	&dev_attr_control_temp.attr,
+	&dev_attr_sustainable_power.attr,
+	&dev_attr_k_po.attr,
+	&dev_attr_k_pu.attr,
+	&dev_attr_k_i.attr,
+	&dev_attr_k_d.attr,
+	&dev_attr_integral_cutoff.attr,
+	&dev_attr_actors.attr,
+	NULL,
+};
+
+static struct attribute_group ipa_attr_group = {
+	.name = "ipa",
+	.attrs = ipa_attrs,
+};
+
+/*
+ * Hand the active and passive trips of @tz to the power allocator.  Only
+ * one zone can be bound, the actors heat a single die.
+ */
+int thermal_ipa_bind(struct thermal_zone_device *tz,
+		const struct ipa_params *params)
+{
+	struct thermal_ipa *ipa;
+	int ret;
+
+	if (!ipa_params_valid(params))
+		return -EINVAL;
+
+	ipa = kzalloc(sizeof(*ipa), GFP_KERNEL);
+	if (!ipa)
+		return -ENOMEM;
+
+	ipa->tz = tz;
+	ipa->params = *params;
+	ipa_set_default_gains(&ipa->params);
+
+	mutex_lock(&ipa_lock);
+	if (ipa_zone) {
+		mutex_unlock(&ipa_lock);
+		kfree(ipa);
+		return -EBUSY;
+	}
+	ipa_zone = ipa;
+	mutex_unlock(&ipa_lock);
+
+	mutex_lock(&tz->lock);
+	tz->ipa = ipa;
+	mutex_unlock(&tz->lock);
+
+	ret = sysfs_create_group(&tz->device.kobj, &ipa_attr_group);
+	if (ret)
+		goto err_unbind;
+
+	pr_info("%s: switch on %lu mC, control %lu mC, sustainable %u mW\n",
+		tz->type, params->switch_on_temp, params->control_temp,
+		params->sustainable_power);
+
+	return 0;
+
+err_unbind:
+	mutex_lock(&tz->lock);
+	tz->ipa = NULL;
+	mutex_unlock(&tz->lock);
+
+	mutex_lock(&ipa_lock);
+	if (ipa->controlling)
+		ipa_release(ipa);
+	ipa_zone = NULL;
+	mutex_unlock(&ipa_lock);
+
+	kfree(ipa);
+	return ret;
+}
+EXPORT_SYMBOL(thermal_ipa_bind);
+
+void thermal_ipa_unbind(struct thermal_zone_device *tz)
+{
+	struct thermal_ipa *ipa = tz->ipa;
+
+	if (!ipa)
+		return;
+
+	sysfs_remove_group(&tz->device.kobj, &ipa_attr_group);
+
+	mutex_lock(&tz->lock);
+	tz->ipa = NULL;
+	mutex_unlock(&tz->lock);
+
+	mutex_lock(&ipa_lock);
+	if (ipa->controlling)
+		ipa_release(ipa);
+	ipa_zone = NULL;
+	mutex_unlock(&ipa_lock);
+
+	kfree(ipa);
+}
+EXPORT_SYMBOL(thermal_ipa_unbind);
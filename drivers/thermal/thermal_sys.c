@@ -32,6 +32,7 @@
 #include <linux/kdev_t.h>
 #include <linux/idr.h>
 #include <linux/thermal.h>
+#include <linux/thermal_ipa.h>
 #include <linux/spinlock.h>
 #include <linux/reboot.h>
 #include <net/netlink.h>
@@ -462,6 +463,41 @@ passive_show(struct device *dev, struct device_attribute *attr,
 	return snprintf(buf, PAGE_SIZE, "%d\n", tz->forced_passive);
 }
 
+#ifdef CONFIG_THERMAL_EMULATION
+/*
+ * Feed the zone a temperature of our own, in millicelsius, so that trips
+ * and cooling can be driven from userspace.  0 goes back to the sensor.
+ */
+static ssize_t
+emul_temp_store(struct device *dev, struct device_attribute *attr,
+		const char *buf, size_t count)
+{
+	struct thermal_zone_device *tz = to_thermal_zone(dev);
+	unsigned long temperature;
+
+	if (kstrtoul(buf, 10, &temperature))
+		return -EINVAL;
+
+	mutex_lock(&tz->lock);
+	tz->emul_temperature = temperature;
+	mutex_unlock(&tz->lock);
+
+	thermal_zone_device_update(tz);
+
+	return count;
+}
+
+static ssize_t
+emul_temp_show(struct device *dev, struct device_attribute *attr, char *buf)
+{
+	struct thermal_zone_device *tz = to_thermal_zone(dev);
+
+	return snprintf(buf, PAGE_SIZE, "%lu\n", tz->emul_temperature);
+}
+static DEVICE_ATTR(emul_temp, S_IRUGO | S_IWUSR, emul_temp_show,
+		emul_temp_store);
+#endif
+
 static DEVICE_ATTR(type, 0444, type_show, NULL);
 static DEVICE_ATTR(temp, 0444, temp_show, NULL);
 static DEVICE_ATTR(mode, 0644, mode_show, mode_store);
@@ -831,6 +867,38 @@ static void thermal_zone_device_set_polling(struct thermal_zone_device *tz,
 				      msecs_to_jiffies(delay));
 }
 
+/*
+ * The sensor reading, or the emulated temperature when one is set.  The
+ * sensor still wins once it reaches the critical trip, emulation must not
+ * hide a real overheat.
+ */
+static int thermal_zone_get_temp(struct thermal_zone_device *tz, long *temp)
+{
+	unsigned long sensor_temp;
+	int ret;
+#ifdef CONFIG_THERMAL_EMULATION
+	unsigned long crit_temp;
+#endif
+
+	ret = tz->ops->get_temp(tz, &sensor_temp);
+	if (ret)
+		return ret;
+
+	*temp = sensor_temp;
+
+#ifdef CONFIG_THERMAL_EMULATION
+	if (!tz->emul_temperature)
+		return 0;
+
+	if (tz->ops->get_crit_temp && !tz->ops->get_crit_temp(tz, &crit_temp) &&
+	    sensor_temp >= crit_temp)
+		return 0;
+
+	*temp = tz->emul_temperature;
+#endif
+	return 0;
+}
+
 static void thermal_zone_device_passive(struct thermal_zone_device *tz,
 					int temp, int trip_temp, int trip)
 {
@@ -1169,7 +1237,7 @@ void thermal_zone_device_update(struct thermal_zone_device *tz)
 
 	mutex_lock(&tz->lock);
 
-	if (tz->ops->get_temp(tz, &temp)) {
+	if (thermal_zone_get_temp(tz, &temp)) {
 		/* get_temp failed - retry it later */
 		pr_warn("failed to read out thermal zone %d\n", tz->id);
 		goto leave;
@@ -1179,6 +1247,13 @@ void thermal_zone_device_update(struct thermal_zone_device *tz)
 		tz->ops->get_trip_type(tz, count, &trip_type);
 		tz->ops->get_trip_temp(tz, count, &trip_temp);
 
+#ifdef CONFIG_CPU_THERMAL_IPA
+		/* the power allocator does all of the cooling */
+		if (tz->ipa && (trip_type == THERMAL_TRIP_ACTIVE ||
+				trip_type == THERMAL_TRIP_PASSIVE))
+			continue;
+#endif
+
 		switch (trip_type) {
 		case THERMAL_TRIP_CRITICAL:
 			if (temp >= trip_temp) {
@@ -1226,6 +1301,11 @@ void thermal_zone_device_update(struct thermal_zone_device *tz)
 		}
 	}
 
+#ifdef CONFIG_CPU_THERMAL_IPA
+	if (tz->ipa)
+		tz->passive = thermal_ipa_control(tz, temp);
+	else
+#endif
 	if (tz->forced_passive)
 		thermal_zone_device_passive(tz, temp, tz->forced_passive,
 					    THERMAL_TRIPS_NONE);
@@ -1432,6 +1512,12 @@ struct thermal_zone_device *thermal_zone_device_register(char *type,
 	if (result)
 		goto unregister;
 
+#ifdef CONFIG_THERMAL_EMULATION
+	result = device_create_file(&tz->device, &dev_attr_emul_temp);
+	if (result)
+		goto unregister;
+#endif
+
 	if (ops->get_mode) {
 		result = device_create_file(&tz->device, &dev_attr_mode);
 		if (result)
@@ -1531,6 +1617,9 @@ void thermal_zone_device_unregister(struct thermal_zone_device *tz)
 	if (tz->type[0])
 		device_remove_file(&tz->device, &dev_attr_type);
 	device_remove_file(&tz->device, &dev_attr_temp);
+#ifdef CONFIG_THERMAL_EMULATION
+	device_remove_file(&tz->device, &dev_attr_emul_temp);
+#endif
 	device_remove_file(&tz->device, &dev_attr_trip_freq);
 	device_remove_file(&tz->device, &dev_attr_oneshot_trip_freq);
 	device_remove_file(&tz->device, &dev_attr_trip_temp);
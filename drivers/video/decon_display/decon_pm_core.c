@@ -188,6 +188,12 @@ void disp_debug_power_info(void)
 		ktime_to_ns(dispdrv->decon_driver.sfb->vsync_info.timestamp),
 		frame_done_count,
 		te_count);
+#ifdef CONFIG_ION_EXYNOS
+	pm_info("updates pending: %d, presented: %u, dropped: %u",
+		dispdrv->decon_driver.sfb->update_regs_pending,
+		dispdrv->decon_driver.sfb->update_stats.presented,
+		dispdrv->decon_driver.sfb->update_stats.dropped);
+#endif
 }
 
 void disp_pm_gate_lock(struct display_driver *dispdrv, bool increase)
@@ -172,6 +172,30 @@ struct s3c_reg_data {
 	struct s3c_dma_buf_data	dma_buf_data[S3C_FB_MAX_WIN];
 	unsigned int		bandwidth;
 	u32			win_overlap_cnt;
+	ktime_t			queued;
+	/* release fences signaled once on screen, > 1 after coalescing */
+	int			retire_cnt;
+};
+
+/* configs queued for the update thread before the oldest is dropped */
+#define S3C_FB_MAX_PENDING_UPDATES	3
+
+/**
+ * struct s3c_fb_update_stats - window update queue statistics
+ * @presented: configs that reached the screen
+ * @dropped: configs superseded by a later one before reaching the screen
+ * @max_pending: deepest the queue has been
+ * @latency_tot_us: sum of the set_win_config to vsync time of @presented
+ * @latency_max_us: worst of them
+ * @latency_last_us: latest of them
+ */
+struct s3c_fb_update_stats {
+	u32			presented;
+	u32			dropped;
+	int			max_pending;
+	u64			latency_tot_us;
+	u32			latency_max_us;
+	u32			latency_last_us;
 };
 #endif
 
@@ -281,6 +305,8 @@ struct s3c_fb {
 	struct ion_client	*fb_ion_client;
 
 	struct list_head	update_regs_list;
+	int			update_regs_pending;
+	struct s3c_fb_update_stats update_stats;
 	struct mutex		update_regs_list_lock;
 	struct kthread_worker	update_regs_worker;
 	struct task_struct	*update_regs_thread;
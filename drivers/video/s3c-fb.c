@@ -27,6 +27,7 @@
 #include <linux/delay.h>
 #include <linux/kthread.h>
 #include <linux/irq.h>
+#include <linux/math64.h>
 
 #if defined(CONFIG_FB_EXYNOS_FIMD_MC) || defined(CONFIG_FB_EXYNOS_FIMD_MC_WB)
 #include <media/v4l2-subdev.h>
@@ -1956,6 +1957,32 @@ err_invalid:
 	return ret;
 }
 
+/*
+ * Drop a queued config that a later one supersedes before it reached the
+ * screen.  Its release fence is signaled together with the later config's.
+ * Called with update_regs_list_lock held, regs must not be the last entry.
+ */
+static void s3c_fb_drop_regs(struct s3c_fb *sfb, struct s3c_reg_data *regs)
+{
+	struct s3c_reg_data *next = list_entry(regs->list.next,
+			struct s3c_reg_data, list);
+	int i;
+
+	list_del(&regs->list);
+	sfb->update_regs_pending--;
+	sfb->update_stats.dropped++;
+	next->retire_cnt += regs->retire_cnt;
+
+	for (i = 0; i < sfb->variant.nr_windows; i++)
+		if (!sfb->windows[i]->local)
+			s3c_fb_free_dma_buf(sfb, &regs->dma_buf_data[i]);
+
+#ifdef CONFIG_FB_HIBERNATION_DISPLAY
+	disp_pm_gate_lock(get_display_driver(), false);
+#endif
+	kfree(regs);
+}
+
 static int s3c_fb_set_win_config(struct s3c_fb *sfb,
 		struct s3c_fb_win_config_data *win_data)
 {
@@ -2075,6 +2102,9 @@ static int s3c_fb_set_win_config(struct s3c_fb *sfb,
 #ifdef CONFIG_FB_HIBERNATION_DISPLAY
 		disp_pm_gate_lock(get_display_driver(), true);
 #endif
+		regs->queued = ktime_get();
+		regs->retire_cnt = 1;
+
 		mutex_lock(&sfb->update_regs_list_lock);
 		sfb->timeline_max++;
 		pt = sw_sync_pt_create(sfb->timeline, sfb->timeline_max);
@@ -2082,6 +2112,14 @@ static int s3c_fb_set_win_config(struct s3c_fb *sfb,
 		sync_fence_install(fence, fd);
 		win_data->fence = fd;
 		list_add_tail(&regs->list, &sfb->update_regs_list);
+		sfb->update_regs_pending++;
+		if (sfb->update_regs_pending > S3C_FB_MAX_PENDING_UPDATES)
+			s3c_fb_drop_regs(sfb, list_first_entry(
+				&sfb->update_regs_list, struct s3c_reg_data,
+				list));
+		sfb->update_stats.max_pending = max(
+				sfb->update_stats.max_pending,
+				sfb->update_regs_pending);
 		mutex_unlock(&sfb->update_regs_list_lock);
 		queue_kthread_work(&sfb->update_regs_worker,
 					&sfb->update_regs_work);
@@ -2190,6 +2228,26 @@ static void s3c_fd_fence_wait(struct s3c_fb *sfb, struct sync_fence *fence)
 		dev_warn(sfb->dev, "error waiting on fence: %d\n", err);
 }
 
+/* regs reached the screen at the last vsync */
+static void s3c_fb_account_present(struct s3c_fb *sfb,
+		struct s3c_reg_data *regs)
+{
+	struct s3c_fb_update_stats *stats = &sfb->update_stats;
+	ktime_t present = sfb->vsync_info.timestamp;
+	u32 latency;
+
+	if (ktime_to_ns(present) < ktime_to_ns(regs->queued))
+		present = ktime_get();
+	latency = (u32)ktime_us_delta(present, regs->queued);
+
+	mutex_lock(&sfb->update_regs_list_lock);
+	stats->presented++;
+	stats->latency_tot_us += latency;
+	stats->latency_max_us = max(stats->latency_max_us, latency);
+	stats->latency_last_us = latency;
+	mutex_unlock(&sfb->update_regs_list_lock);
+}
+
 static void s3c_fb_update_regs(struct s3c_fb *sfb, struct s3c_reg_data *regs)
 {
 	struct s3c_dma_buf_data old_dma_bufs[S3C_FB_MAX_WIN];
@@ -2274,7 +2332,10 @@ static void s3c_fb_update_regs(struct s3c_fb *sfb, struct s3c_reg_data *regs)
 			s3c_fb_free_dma_buf(sfb, &old_dma_bufs[i]);
 
 	disp_pm_runtime_put_sync(dispdrv);
-	sw_sync_timeline_inc(sfb->timeline, 1);
+	sw_sync_timeline_inc(sfb->timeline, regs->retire_cnt);
+
+	if (!wait_for_vsync)
+		s3c_fb_account_present(sfb, regs);
 
 #if defined(CONFIG_FIMD_USE_BUS_DEVFREQ)
 #if !defined(CONFIG_ARM_EXYNOS3250_BUS_DEVFREQ) || !defined(CONFIG_LCD_MIPI_NT35510)
@@ -2296,24 +2357,60 @@ static void s3c_fb_update_regs(struct s3c_fb *sfb, struct s3c_reg_data *regs)
 #endif
 }
 
-static void s3c_fb_update_regs_handler(struct kthread_work *work)
+static bool s3c_fb_regs_ready(struct s3c_fb *sfb, struct s3c_reg_data *regs)
 {
-	struct s3c_fb *sfb =
-			container_of(work, struct s3c_fb, update_regs_work);
-	struct s3c_reg_data *data, *next;
-	struct list_head saved_list;
+	struct sync_fence *fence;
+	int i;
+
+	for (i = 0; i < sfb->variant.nr_windows; i++) {
+		fence = regs->dma_buf_data[i].fence;
+		if (fence && !fence->status)
+			return false;
+	}
+
+	return true;
+}
+
+/*
+ * Take the next config off the queue.  A config followed by one whose
+ * buffers are already rendered is dropped: it could only be on screen for
+ * the frame that the later one would otherwise wait for.
+ */
+static struct s3c_reg_data *s3c_fb_next_regs(struct s3c_fb *sfb)
+{
+	struct s3c_reg_data *regs = NULL;
 
 	mutex_lock(&sfb->update_regs_list_lock);
-	saved_list = sfb->update_regs_list;
-	list_replace_init(&sfb->update_regs_list, &saved_list);
+	while (!list_empty(&sfb->update_regs_list)) {
+		regs = list_first_entry(&sfb->update_regs_list,
+				struct s3c_reg_data, list);
+		if (list_is_last(&regs->list, &sfb->update_regs_list) ||
+		    !s3c_fb_regs_ready(sfb, list_entry(regs->list.next,
+				struct s3c_reg_data, list)))
+			break;
+		s3c_fb_drop_regs(sfb, regs);
+		regs = NULL;
+	}
+	if (regs) {
+		list_del(&regs->list);
+		sfb->update_regs_pending--;
+	}
 	mutex_unlock(&sfb->update_regs_list_lock);
 
-	list_for_each_entry_safe(data, next, &saved_list, list) {
+	return regs;
+}
+
+static void s3c_fb_update_regs_handler(struct kthread_work *work)
+{
+	struct s3c_fb *sfb =
+			container_of(work, struct s3c_fb, update_regs_work);
+	struct s3c_reg_data *data;
+
+	while ((data = s3c_fb_next_regs(sfb)) != NULL) {
 		s3c_fb_update_regs(sfb, data);
 #ifdef CONFIG_FB_HIBERNATION_DISPLAY
 		disp_pm_gate_lock(get_display_driver(), false);
 #endif
-		list_del(&data->list);
 		kfree(data);
 	}
 }
@@ -3542,6 +3639,10 @@ static int s3c_fb_debugfs_show(struct seq_file *f, void *offset)
 	struct s3c_fb *sfb = f->private;
 	struct s3c_fb_debug *debug_data = kzalloc(sizeof(struct s3c_fb_debug),
 			GFP_KERNEL);
+#ifdef CONFIG_ION_EXYNOS
+	struct s3c_fb_update_stats stats;
+	int pending;
+#endif
 
 	if (!debug_data) {
 		seq_printf(f, "kmalloc() failed; can't generate file\n");
@@ -3576,6 +3677,21 @@ static int s3c_fb_debugfs_show(struct seq_file *f, void *offset)
 		}
 	}
 
+#ifdef CONFIG_ION_EXYNOS
+	mutex_lock(&sfb->update_regs_list_lock);
+	stats = sfb->update_stats;
+	pending = sfb->update_regs_pending;
+	mutex_unlock(&sfb->update_regs_list_lock);
+
+	seq_printf(f, "%u updates presented, %u dropped, %d pending (max %d)\n",
+			stats.presented, stats.dropped, pending,
+			stats.max_pending);
+	seq_printf(f, "present latency: avg %u us, max %u us, last %u us\n",
+			stats.presented ? (u32)div_u64(stats.latency_tot_us,
+					stats.presented) : 0,
+			stats.latency_max_us, stats.latency_last_us);
+#endif
+
 	kfree(debug_data);
 	return 0;
 }
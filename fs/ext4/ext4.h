@@ -33,6 +33,8 @@
 #include <linux/compat.h>
 #endif
 
+#include "fast_commit.h"
+
 /*
  * The fourth extended filesystem constants/structures
  */
@@ -908,6 +910,13 @@ struct ext4_inode_info {
 	 */
 	tid_t i_sync_tid;
 	tid_t i_datasync_tid;
+
+	/*
+	 * Last transaction in which the inode was changed in a way a fast
+	 * commit cannot describe, and why.  Under sbi->s_fc_lock.
+	 */
+	tid_t i_fc_ineligible_tid;
+	int i_fc_ineligible_reason;
 };
 
 /*
@@ -951,6 +960,7 @@ struct ext4_inode_info {
 #define EXT4_MOUNT_DIOREAD_NOLOCK	0x400000 /* Enable support for dio read nolocking */
 #define EXT4_MOUNT_JOURNAL_CHECKSUM	0x800000 /* Journal checksums */
 #define EXT4_MOUNT_JOURNAL_ASYNC_COMMIT	0x1000000 /* Journal Async Commit */
+#define EXT4_MOUNT_FAST_COMMIT		0x2000000 /* fsync by fast commits */
 #define EXT4_MOUNT_MBLK_IO_SUBMIT	0x4000000 /* multi-block io submits */
 #define EXT4_MOUNT_DELALLOC		0x8000000 /* Delalloc support */
 #define EXT4_MOUNT_DATA_ERR_ABORT	0x10000000 /* Abort on file data write */
@@ -1178,6 +1188,10 @@ struct ext4_sb_info {
 
 	/* Journaling */
 	struct journal_s *s_journal;
+	spinlock_t s_fc_lock;			/* ineligible marks, stats */
+	tid_t s_fc_ineligible_tid;		/* as i_fc_ineligible_tid, */
+	int s_fc_ineligible_reason;		/* for the whole fs */
+	struct ext4_fc_stats s_fc_stats;
 	struct list_head s_orphan;
 	struct mutex s_orphan_lock;
 	unsigned long s_resize_flags;		/* Flags indicating if there
@@ -1218,10 +1232,14 @@ struct ext4_sb_info {
 	unsigned int s_mb_stats;
 	unsigned int s_mb_order2_reqs;
 	unsigned int s_mb_group_prealloc;
+	unsigned int s_mb_optimize_scan;
 	unsigned int s_max_writeback_mb_bump;
-	/* where last allocation was done - for stream allocation */
-	unsigned long s_mb_last_group;
-	unsigned long s_mb_last_start;
+	/* where last allocation was done - for stream allocation, by inode */
+	ext4_group_t *s_mb_last_groups;
+	unsigned int s_mb_nr_global_goals;
+	/* initialized groups, by the order of their largest free extent */
+	struct list_head *s_mb_largest_free_orders;
+	rwlock_t *s_mb_largest_free_orders_locks;
 
 	/* stats for buddy allocator */
 	atomic_t s_bal_reqs;	/* number of reqs with len > 1 */
@@ -1231,6 +1249,11 @@ struct ext4_sb_info {
 	atomic_t s_bal_goals;	/* goal hits */
 	atomic_t s_bal_breaks;	/* too long searches */
 	atomic_t s_bal_2orders;	/* 2^order hits */
+	atomic_t s_bal_groups_scanned;	/* groups looked at */
+	atomic_t s_bal_cr_hits[4];	/* allocations found, by criteria */
+	atomic_t s_bal_cr0_list_hits;	/* cr 0 groups found on order lists */
+	atomic_t s_bal_cr0_list_misses;	/* ... and orders with none to try */
+	atomic_t s_bal_busy_skipped;	/* groups passed over as locked */
 	spinlock_t s_bal_lock;
 	unsigned long s_mb_buddies_generated;
 	unsigned long long s_mb_generation_time;
@@ -1838,6 +1861,15 @@ extern int ext4_htree_store_dirent(struct file *dir_file, __u32 hash,
 				    struct ext4_dir_entry_2 *dirent);
 extern void ext4_htree_free_dir_info(struct dir_private_info *p);
 
+/* fast_commit.c */
+extern void ext4_fc_mark_ineligible(handle_t *handle, struct inode *inode,
+				    int reason);
+extern void ext4_fc_mark_fs_ineligible(handle_t *handle,
+				       struct super_block *sb, int reason);
+extern int ext4_fc_commit(struct inode *inode, int datasync);
+extern int ext4_fc_replay(journal_t *journal, tid_t tid);
+extern const struct file_operations ext4_fc_info_fops;
+
 /* fsync.c */
 extern int ext4_sync_file(struct file *, loff_t, loff_t, int);
 extern int ext4_flush_completed_IO(struct inode *);
@@ -2161,7 +2193,9 @@ struct ext4_group_info {
 	ext4_grpblk_t	bb_free;	/* total free blocks */
 	ext4_grpblk_t	bb_fragments;	/* nr of freespace fragments */
 	ext4_grpblk_t	bb_largest_free_order;/* order of largest frag in BG */
+	ext4_group_t	bb_group;	/* group number */
 	struct          list_head bb_prealloc_list;
+	struct          list_head bb_largest_free_order_node;
 #ifdef DOUBLE_CHECK
 	void            *bb_bitmap;
 #endif
@@ -2223,6 +2257,21 @@ static inline void ext4_lock_group(struct super_block *sb, ext4_group_t group)
 	}
 }
 
+/*
+ * Takes the group lock only if nobody holds it, for the allocator to try
+ * another group instead of waiting.  Returns nonzero if it was taken.
+ */
+static inline int ext4_try_lock_group(struct super_block *sb,
+				      ext4_group_t group)
+{
+	if (spin_trylock(ext4_group_lock_ptr(sb, group))) {
+		atomic_add_unless(&EXT4_SB(sb)->s_lock_busy, -1, 0);
+		return 1;
+	}
+	atomic_add_unless(&EXT4_SB(sb)->s_lock_busy, 1, EXT4_MAX_CONTENTION);
+	return 0;
+}
+
 static inline void ext4_unlock_group(struct super_block *sb,
 					ext4_group_t group)
 {
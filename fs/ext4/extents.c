@@ -121,6 +121,8 @@ static int __ext4_ext_dirty(const char *where, unsigned int line,
 	int err;
 	if (path->p_bh) {
 		/* path points to block */
+		ext4_fc_mark_ineligible(handle, inode,
+					EXT4_FC_REASON_EXTENT_TREE);
 		err = __ext4_handle_dirty_metadata(where, line, handle,
 						   inode, path->p_bh);
 	} else {
@@ -844,6 +846,8 @@ static int ext4_ext_split(handle_t *handle, struct inode *inode,
 	ext4_fsblk_t *ablocks = NULL; /* array of allocated blocks */
 	int err = 0;
 
+	ext4_fc_mark_ineligible(handle, inode, EXT4_FC_REASON_EXTENT_TREE);
+
 	/* make decision: where to split? */
 	/* FIXME: now decision is simplest: at current extent */
 
@@ -1077,6 +1081,8 @@ static int ext4_ext_grow_indepth(handle_t *handle, struct inode *inode,
 	ext4_fsblk_t newblock;
 	int err = 0;
 
+	ext4_fc_mark_ineligible(handle, inode, EXT4_FC_REASON_EXTENT_TREE);
+
 	newblock = ext4_ext_new_meta_block(handle, inode, NULL,
 		newext, &err, flags);
 	if (newblock == 0)
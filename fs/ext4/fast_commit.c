@@ -0,0 +1,545 @@
+/*
+ * fs/ext4/fast_commit.c
+ *
+ * Fast commits for fsync
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ */
+
+/*
+ * fsync normally commits the whole running transaction: every metadata
+ * block it touched goes to the journal along with the descriptor and
+ * commit blocks.  When all fsync needs from that transaction is a regular
+ * file that was written to, grown or overwritten within the extents its
+ * inode holds, one block describes it: the on-disk inode and the extents
+ * of its root.  That block goes to the fast commit area of the journal
+ * and the transaction is committed later as usual.
+ *
+ * After a crash, recovery hands over the records of the transaction that
+ * did not make it to the log.  The inode images are written back to the
+ * inode table and the blocks of the extents are marked in use, both of
+ * which can be done again should recovery itself be interrupted.  Nothing
+ * else of that transaction survives, as it would not have without fsync.
+ *
+ * A change that cannot be replayed that way - namespace, xattrs, orphans,
+ * freed blocks, extent tree blocks - marks its inode, or the whole fs, as
+ * ineligible for the running transaction.  An fsync of it is then a full
+ * commit until that transaction is in the log.
+ */
+
+#include <linux/fs.h>
+#include <linux/crc32.h>
+#include <linux/ktime.h>
+#include <linux/pagemap.h>
+#include <linux/quotaops.h>
+#include <linux/seq_file.h>
+#include "ext4.h"
+#include "ext4_jbd2.h"
+#include "ext4_extents.h"
+
+/* A depth 0 extent tree lives in the inode */
+#define EXT4_FC_MAX_RANGES	4
+
+#define EXT4_FC_BLOCK_SIZE(isize)					\
+	(7 * sizeof(struct ext4_fc_tl) + sizeof(struct ext4_fc_head) +	\
+	 sizeof(struct ext4_fc_inode) + (isize) +			\
+	 EXT4_FC_MAX_RANGES * sizeof(struct ext4_fc_add_range) +	\
+	 sizeof(struct ext4_fc_tail))
+
+static const char *ext4_fc_reason_str[EXT4_FC_REASON_MAX] = {
+	[EXT4_FC_REASON_NAMESPACE]	= "namespace",
+	[EXT4_FC_REASON_XATTR]		= "xattr",
+	[EXT4_FC_REASON_ORPHAN]		= "orphan",
+	[EXT4_FC_REASON_FREED_BLOCKS]	= "freed_blocks",
+	[EXT4_FC_REASON_EXTENT_TREE]	= "extent_tree",
+	[EXT4_FC_REASON_SWAP_EXTENTS]	= "swap_extents",
+	[EXT4_FC_REASON_RESIZE]		= "resize",
+	[EXT4_FC_REASON_INODE_LOAD]	= "inode_load",
+	[EXT4_FC_REASON_NOT_SUPPORTED]	= "not_supported",
+};
+
+/*
+ * Handles only ever belong to the running transaction, so the last mark
+ * is the one of the newest transaction.
+ */
+void ext4_fc_mark_ineligible(handle_t *handle, struct inode *inode,
+			     int reason)
+{
+	struct ext4_sb_info *sbi = EXT4_SB(inode->i_sb);
+	struct ext4_inode_info *ei = EXT4_I(inode);
+
+	if (!test_opt(inode->i_sb, FAST_COMMIT) || !ext4_handle_valid(handle))
+		return;
+
+	spin_lock(&sbi->s_fc_lock);
+	ei->i_fc_ineligible_tid = handle->h_transaction->t_tid;
+	ei->i_fc_ineligible_reason = reason;
+	spin_unlock(&sbi->s_fc_lock);
+}
+
+void ext4_fc_mark_fs_ineligible(handle_t *handle, struct super_block *sb,
+				int reason)
+{
+	struct ext4_sb_info *sbi = EXT4_SB(sb);
+
+	if (!test_opt(sb, FAST_COMMIT) || !ext4_handle_valid(handle))
+		return;
+
+	spin_lock(&sbi->s_fc_lock);
+	sbi->s_fc_ineligible_tid = handle->h_transaction->t_tid;
+	sbi->s_fc_ineligible_reason = reason;
+	spin_unlock(&sbi->s_fc_lock);
+}
+
+/* Returns why @inode cannot be fast committed in @tid, or -1 */
+static int ext4_fc_ineligible(struct inode *inode, tid_t tid)
+{
+	struct super_block *sb = inode->i_sb;
+	struct ext4_sb_info *sbi = EXT4_SB(sb);
+	struct ext4_inode_info *ei = EXT4_I(inode);
+	int reason = -1;
+
+	if (!S_ISREG(inode->i_mode) ||
+	    !ext4_test_inode_flag(inode, EXT4_INODE_EXTENTS) ||
+	    EXT4_HAS_RO_COMPAT_FEATURE(sb, EXT4_FEATURE_RO_COMPAT_BIGALLOC) ||
+	    sb_any_quota_loaded(sb) ||
+	    EXT4_FC_BLOCK_SIZE(EXT4_INODE_SIZE(sb)) > sb->s_blocksize)
+		return EXT4_FC_REASON_NOT_SUPPORTED;
+
+	spin_lock(&sbi->s_fc_lock);
+	if (sbi->s_fc_ineligible_tid == tid)
+		reason = sbi->s_fc_ineligible_reason;
+	else if (ei->i_fc_ineligible_tid == tid)
+		reason = ei->i_fc_ineligible_reason;
+	spin_unlock(&sbi->s_fc_lock);
+
+	return reason;
+}
+
+static u8 *ext4_fc_put_tl(u8 *dst, int tag, int len)
+{
+	struct ext4_fc_tl tl;
+
+	tl.fc_tag = cpu_to_le16(tag);
+	tl.fc_len = cpu_to_le16(len);
+	memcpy(dst, &tl, sizeof(tl));
+
+	return dst + sizeof(tl);
+}
+
+static u8 *ext4_fc_put(u8 *dst, int tag, const void *val, int len)
+{
+	dst = ext4_fc_put_tl(dst, tag, len);
+	memcpy(dst, val, len);
+
+	return dst + len;
+}
+
+/*
+ * Fill @buf with the records of @inode.  Its data has been written; if
+ * more of it is dirty or under I/O now, the extents copied could point to
+ * blocks not written yet and it is left to the full commit, which orders
+ * the data.
+ */
+static int ext4_fc_write_inode(struct inode *inode, tid_t tid, u8 *buf)
+{
+	struct super_block *sb = inode->i_sb;
+	struct ext4_inode_info *ei = EXT4_I(inode);
+	int isize = EXT4_INODE_SIZE(sb);
+	__le32 ino = cpu_to_le32(inode->i_ino);
+	struct ext4_fc_head head;
+	struct ext4_fc_add_range range;
+	struct ext4_fc_tail tail;
+	struct ext4_extent_header *eh;
+	struct ext4_extent *ex;
+	struct ext4_iloc iloc;
+	u8 *dst = buf, *raw;
+	int i, ret;
+
+	ret = ext4_get_inode_loc(inode, &iloc);
+	if (ret)
+		return ret;
+
+	head.fc_features = 0;
+	head.fc_tid = cpu_to_le32(tid);
+	dst = ext4_fc_put(dst, EXT4_FC_TAG_HEAD, &head, sizeof(head));
+
+	dst = ext4_fc_put_tl(dst, EXT4_FC_TAG_INODE, sizeof(ino) + isize);
+	memcpy(dst, &ino, sizeof(ino));
+	raw = dst + sizeof(ino);
+	down_read(&ei->i_data_sem);
+	memcpy(raw, ext4_raw_inode(&iloc), isize);
+	up_read(&ei->i_data_sem);
+	brelse(iloc.bh);
+	dst = raw + isize;
+
+	/* the blocks of a deeper tree are unchanged, see __ext4_ext_dirty() */
+	eh = (struct ext4_extent_header *)((struct ext4_inode *)raw)->i_block;
+	if (eh->eh_magic == EXT4_EXT_MAGIC && eh->eh_depth == 0) {
+		ex = EXT_FIRST_EXTENT(eh);
+		for (i = 0; i < le16_to_cpu(eh->eh_entries) &&
+			    i < EXT4_FC_MAX_RANGES; i++, ex++) {
+			range.fc_ino = ino;
+			memcpy(range.fc_ex, ex, sizeof(range.fc_ex));
+			dst = ext4_fc_put(dst, EXT4_FC_TAG_ADD_RANGE, &range,
+					  sizeof(range));
+		}
+	}
+
+	if (mapping_tagged(inode->i_mapping, PAGECACHE_TAG_DIRTY) ||
+	    mapping_tagged(inode->i_mapping, PAGECACHE_TAG_WRITEBACK) ||
+	    !list_empty(&ei->i_completed_io_list))
+		return -EBUSY;
+
+	tail.fc_tid = cpu_to_le32(tid);
+	dst = ext4_fc_put_tl(dst, EXT4_FC_TAG_TAIL, sizeof(tail));
+	memcpy(dst, &tail.fc_tid, sizeof(tail.fc_tid));
+	tail.fc_crc = cpu_to_le32(crc32_be(~0, buf,
+			dst + offsetof(struct ext4_fc_tail, fc_crc) - buf));
+	memcpy(dst, &tail, sizeof(tail));
+
+	return 0;
+}
+
+/**
+ * ext4_fc_commit() - make the metadata fsync needs durable by a fast commit
+ * @inode: inode being synced
+ * @datasync: only sync essential metadata if true
+ *
+ * Called by ext4_sync_file() with i_mutex held.  Returns 0 once done, 1
+ * when fsync has to wait for the commit of the transaction instead, or a
+ * negative error from writing out the data.
+ */
+int ext4_fc_commit(struct inode *inode, int datasync)
+{
+	struct super_block *sb = inode->i_sb;
+	struct ext4_sb_info *sbi = EXT4_SB(sb);
+	struct ext4_inode_info *ei = EXT4_I(inode);
+	journal_t *journal = sbi->s_journal;
+	struct buffer_head *bh;
+	ktime_t start;
+	tid_t tid;
+	int reason, ret;
+
+	/* the whole file, the extents recorded must only point to its data */
+	ret = filemap_write_and_wait(inode->i_mapping);
+	if (ret)
+		return ret;
+	ret = ext4_flush_completed_IO(inode);
+	if (ret < 0)
+		return ret;
+
+	tid = datasync ? ei->i_datasync_tid : ei->i_sync_tid;
+	ret = jbd2_fc_begin_commit(journal, tid);
+	if (ret == -EALREADY)
+		return 1;
+	if (ret)
+		goto fallback;
+
+	start = ktime_get();
+
+	reason = ext4_fc_ineligible(inode, tid);
+	if (reason >= 0) {
+		jbd2_fc_end_commit_fallback(journal);
+		spin_lock(&sbi->s_fc_lock);
+		sbi->s_fc_stats.fc_ineligible[reason]++;
+		spin_unlock(&sbi->s_fc_lock);
+		return 1;
+	}
+
+	bh = jbd2_fc_get_buf(journal);
+	if (IS_ERR(bh))
+		goto out_fallback;
+	if (ext4_fc_write_inode(inode, tid, bh->b_data))
+		goto out_fallback;
+	if (jbd2_fc_end_commit(journal))
+		goto fallback;
+
+	spin_lock(&sbi->s_fc_lock);
+	sbi->s_fc_stats.fc_commits++;
+	sbi->s_fc_stats.fc_blocks++;
+	sbi->s_fc_stats.fc_time_ns += ktime_to_ns(ktime_sub(ktime_get(),
+							    start));
+	spin_unlock(&sbi->s_fc_lock);
+	return 0;
+
+out_fallback:
+	jbd2_fc_end_commit_fallback(journal);
+fallback:
+	spin_lock(&sbi->s_fc_lock);
+	sbi->s_fc_stats.fc_fallbacks++;
+	spin_unlock(&sbi->s_fc_lock);
+	return 1;
+}
+
+/*
+ * Replay
+ */
+
+/* Whether @buf is a complete, intact block of records of @tid */
+static int ext4_fc_check_block(struct super_block *sb, u8 *buf, tid_t tid)
+{
+	u8 *pos = buf, *end = buf + sb->s_blocksize, *val;
+	struct ext4_fc_head head;
+	struct ext4_fc_tail tail;
+	struct ext4_fc_tl tl;
+	int len;
+
+	while (pos + sizeof(tl) <= end) {
+		memcpy(&tl, pos, sizeof(tl));
+		val = pos + sizeof(tl);
+		len = le16_to_cpu(tl.fc_len);
+		if (val + len > end)
+			return 0;
+
+		switch (le16_to_cpu(tl.fc_tag)) {
+		case EXT4_FC_TAG_HEAD:
+			if (pos != buf || len != sizeof(head))
+				return 0;
+			memcpy(&head, val, sizeof(head));
+			if (le32_to_cpu(head.fc_tid) != tid)
+				return 0;
+			break;
+		case EXT4_FC_TAG_TAIL:
+			if (pos == buf || len != sizeof(tail))
+				return 0;
+			memcpy(&tail, val, sizeof(tail));
+			return le32_to_cpu(tail.fc_tid) == tid &&
+			       le32_to_cpu(tail.fc_crc) == crc32_be(~0, buf,
+				val + offsetof(struct ext4_fc_tail, fc_crc) - buf);
+		case EXT4_FC_TAG_INODE:
+		case EXT4_FC_TAG_ADD_RANGE:
+			if (pos == buf)
+				return 0;
+			break;
+		default:
+			return 0;
+		}
+		pos = val + len;
+	}
+
+	return 0;
+}
+
+static int ext4_fc_replay_inode(struct super_block *sb, u8 *val, int len)
+{
+	int isize = EXT4_INODE_SIZE(sb);
+	struct ext4_group_desc *gdp;
+	struct buffer_head *bh;
+	unsigned long ino, offset;
+	ext4_fsblk_t block;
+	__le32 fc_ino;
+
+	memcpy(&fc_ino, val, sizeof(fc_ino));
+	ino = le32_to_cpu(fc_ino);
+	if (len != sizeof(fc_ino) + isize || ino < EXT4_FIRST_INO(sb) ||
+	    ino > le32_to_cpu(EXT4_SB(sb)->s_es->s_inodes_count))
+		return -EIO;
+
+	gdp = ext4_get_group_desc(sb, (ino - 1) / EXT4_INODES_PER_GROUP(sb),
+				  NULL);
+	if (!gdp)
+		return -EIO;
+
+	offset = ((ino - 1) % EXT4_INODES_PER_GROUP(sb)) * isize;
+	block = ext4_inode_table(sb, gdp) + offset / sb->s_blocksize;
+	bh = sb_bread(sb, block);
+	if (!bh)
+		return -EIO;
+
+	lock_buffer(bh);
+	memcpy(bh->b_data + offset % sb->s_blocksize, val + sizeof(fc_ino),
+	       isize);
+	unlock_buffer(bh);
+	mark_buffer_dirty(bh);
+	brelse(bh);
+
+	return 0;
+}
+
+/*
+ * Mark the blocks of an extent in use.  Only the bits that were clear
+ * count against the free blocks, so replaying twice is harmless.  The
+ * percpu counters are computed from the groups later in the mount.
+ */
+static int ext4_fc_replay_range(struct super_block *sb, u8 *val, int len)
+{
+	struct ext4_sb_info *sbi = EXT4_SB(sb);
+	struct ext4_fc_add_range range;
+	struct buffer_head *bitmap_bh, *gd_bh;
+	struct ext4_group_desc *gdp;
+	struct ext4_extent ex;
+	ext4_fsblk_t block;
+	ext4_group_t group;
+	ext4_grpblk_t bit;
+	unsigned int count, set, i;
+
+	if (len != sizeof(range))
+		return -EIO;
+	memcpy(&range, val, sizeof(range));
+	memcpy(&ex, range.fc_ex, sizeof(ex));
+
+	block = ext4_ext_pblock(&ex);
+	len = ext4_ext_get_actual_len(&ex);
+	if (!len || block < le32_to_cpu(sbi->s_es->s_first_data_block) ||
+	    block + len > ext4_blocks_count(sbi->s_es))
+		return -EIO;
+
+	while (len) {
+		ext4_get_group_no_and_offset(sb, block, &group, &bit);
+		count = min_t(unsigned int, len,
+			      EXT4_BLOCKS_PER_GROUP(sb) - bit);
+
+		bitmap_bh = ext4_read_block_bitmap(sb, group);
+		if (!bitmap_bh)
+			return -EIO;
+		gdp = ext4_get_group_desc(sb, group, &gd_bh);
+		if (!gdp) {
+			brelse(bitmap_bh);
+			return -EIO;
+		}
+
+		set = 0;
+		ext4_lock_group(sb, group);
+		for (i = 0; i < count; i++)
+			if (!ext4_test_and_set_bit(bit + i, bitmap_bh->b_data))
+				set++;
+		if (set) {
+			gdp->bg_flags &= cpu_to_le16(~EXT4_BG_BLOCK_UNINIT);
+			ext4_free_group_clusters_set(sb, gdp,
+				ext4_free_group_clusters(sb, gdp) - set);
+			gdp->bg_checksum = ext4_group_desc_csum(sbi, group, gdp);
+		}
+		ext4_unlock_group(sb, group);
+
+		if (set) {
+			if (sbi->s_log_groups_per_flex)
+				atomic64_sub(set, &sbi->s_flex_groups[
+					ext4_flex_group(sbi, group)].free_clusters);
+			mark_buffer_dirty(bitmap_bh);
+			mark_buffer_dirty(gd_bh);
+		}
+		brelse(bitmap_bh);
+
+		block += count;
+		len -= count;
+	}
+
+	return 0;
+}
+
+static int ext4_fc_replay_block(struct super_block *sb, u8 *buf)
+{
+	struct ext4_fc_tl tl;
+	u8 *pos = buf, *val;
+	int len, ret;
+
+	for (;;) {
+		memcpy(&tl, pos, sizeof(tl));
+		val = pos + sizeof(tl);
+		len = le16_to_cpu(tl.fc_len);
+
+		switch (le16_to_cpu(tl.fc_tag)) {
+		case EXT4_FC_TAG_INODE:
+			ret = ext4_fc_replay_inode(sb, val, len);
+			break;
+		case EXT4_FC_TAG_ADD_RANGE:
+			ret = ext4_fc_replay_range(sb, val, len);
+			break;
+		case EXT4_FC_TAG_TAIL:
+			return 0;
+		default:
+			ret = 0;
+		}
+		if (ret)
+			return ret;
+		pos = val + len;
+	}
+}
+
+/*
+ * j_fc_replay_callback, called by jbd2 recovery before it flushes the fs.
+ * The area is read until the first block that is not an intact block of
+ * @tid: a fast commit is only done once all of its block is on disk.
+ */
+int ext4_fc_replay(journal_t *journal, tid_t tid)
+{
+	struct super_block *sb = journal->j_private;
+	struct buffer_head *bh;
+	int off, ret;
+
+	for (off = 0; ; off++) {
+		ret = jbd2_fc_read_block(journal, off, &bh);
+		if (ret == -ENOENT) {
+			ret = 0;
+			break;
+		}
+		if (ret)
+			break;
+
+		if (!ext4_fc_check_block(sb, bh->b_data, tid)) {
+			brelse(bh);
+			break;
+		}
+		ret = ext4_fc_replay_block(sb, bh->b_data);
+		brelse(bh);
+		if (ret)
+			break;
+	}
+
+	if (ret) {
+		ext4_msg(sb, KERN_ERR, "error %d replaying fast commit "
+			 "block %d of transaction %u", ret, off, tid);
+		return ret;
+	}
+
+	if (off)
+		ext4_msg(sb, KERN_INFO, "replayed %d fast commit blocks of "
+			 "transaction %u", off, tid);
+	EXT4_SB(sb)->s_fc_stats.fc_replayed = off;
+
+	return 0;
+}
+
+static int ext4_fc_info_show(struct seq_file *seq, void *v)
+{
+	struct super_block *sb = seq->private;
+	struct ext4_sb_info *sbi = EXT4_SB(sb);
+	struct ext4_fc_stats stats;
+	int i;
+
+	spin_lock(&sbi->s_fc_lock);
+	stats = sbi->s_fc_stats;
+	spin_unlock(&sbi->s_fc_lock);
+
+	seq_printf(seq, "fast_commit: %s\n",
+		   test_opt(sb, FAST_COMMIT) ? "on" : "off");
+	seq_printf(seq, "commits: %lu\n", stats.fc_commits);
+	seq_printf(seq, "fallbacks: %lu\n", stats.fc_fallbacks);
+	seq_printf(seq, "blocks: %lu\n", stats.fc_blocks);
+	seq_printf(seq, "avg_commit_time_us: %llu\n", stats.fc_commits ?
+		   div64_u64(stats.fc_time_ns,
+			     (u64)stats.fc_commits * NSEC_PER_USEC) : 0);
+	seq_printf(seq, "replayed: %lu\n", stats.fc_replayed);
+	seq_printf(seq, "ineligible:\n");
+	for (i = 0; i < EXT4_FC_REASON_MAX; i++)
+		seq_printf(seq, "  %s: %lu\n", ext4_fc_reason_str[i],
+			   stats.fc_ineligible[i]);
+
+	return 0;
+}
+
+static int ext4_fc_info_open(struct inode *inode, struct file *file)
+{
+	return single_open(file, ext4_fc_info_show, PDE(inode)->data);
+}
+
+const struct file_operations ext4_fc_info_fops = {
+	.owner = THIS_MODULE,
+	.open = ext4_fc_info_open,
+	.read = seq_read,
+	.llseek = seq_lseek,
+	.release = single_release,
+};
@@ -0,0 +1,81 @@
+/*
+ * fs/ext4/fast_commit.h
+ *
+ * Fast commits: the records ext4 keeps in the fast commit area of the
+ * journal, see fast_commit.c
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ */
+
+#ifndef _EXT4_FAST_COMMIT_H
+#define _EXT4_FAST_COMMIT_H
+
+/*
+ * A fast commit is one block of records, each a tag and the length of the
+ * value that follows.  The block starts with a head and ends with a tail.
+ * The tags keep the numbering of the upstream format, of which only the
+ * ones below are used.
+ */
+#define EXT4_FC_TAG_ADD_RANGE		0x0001
+#define EXT4_FC_TAG_INODE		0x0006
+#define EXT4_FC_TAG_TAIL		0x0008
+#define EXT4_FC_TAG_HEAD		0x0009
+
+struct ext4_fc_tl {
+	__le16 fc_tag;
+	__le16 fc_len;
+};
+
+/* Value of EXT4_FC_TAG_HEAD, the transaction the records belong to */
+struct ext4_fc_head {
+	__le32 fc_features;
+	__le32 fc_tid;
+};
+
+/* Value of EXT4_FC_TAG_ADD_RANGE, an extent the inode maps */
+struct ext4_fc_add_range {
+	__le32 fc_ino;
+	__u8 fc_ex[12];
+};
+
+/* Value of EXT4_FC_TAG_INODE, followed by the on-disk inode */
+struct ext4_fc_inode {
+	__le32 fc_ino;
+	__u8 fc_raw_inode[0];
+};
+
+/* Value of EXT4_FC_TAG_TAIL, crc32_be of the block up to fc_crc */
+struct ext4_fc_tail {
+	__le32 fc_tid;
+	__le32 fc_crc;
+};
+
+/*
+ * Why a change cannot be described by a fast commit.  An fsync of an inode
+ * changed that way falls back to a full commit of the transaction.
+ */
+enum {
+	EXT4_FC_REASON_NAMESPACE,	/* link, unlink, rename, create */
+	EXT4_FC_REASON_XATTR,
+	EXT4_FC_REASON_ORPHAN,
+	EXT4_FC_REASON_FREED_BLOCKS,
+	EXT4_FC_REASON_EXTENT_TREE,	/* changes outside of the root */
+	EXT4_FC_REASON_SWAP_EXTENTS,	/* migrate, defrag */
+	EXT4_FC_REASON_RESIZE,
+	EXT4_FC_REASON_INODE_LOAD,	/* earlier marks may have been lost */
+	EXT4_FC_REASON_NOT_SUPPORTED,	/* not an extent mapped regular file */
+	EXT4_FC_REASON_MAX
+};
+
+struct ext4_fc_stats {
+	unsigned long fc_commits;
+	unsigned long fc_fallbacks;	/* eligible, but the commit failed */
+	unsigned long fc_ineligible[EXT4_FC_REASON_MAX];
+	unsigned long fc_blocks;
+	u64 fc_time_ns;			/* spent in fast commits */
+	unsigned long fc_replayed;	/* blocks, at the last mount */
+};
+
+#endif /* _EXT4_FAST_COMMIT_H */
@@ -256,6 +256,12 @@ int ext4_sync_file(struct file *file, loff_t start, loff_t end, int datasync)
 		goto out;
 	}
 
+	if (test_opt(inode->i_sb, FAST_COMMIT)) {
+		ret = ext4_fc_commit(inode, datasync);
+		if (ret <= 0)
+			goto out;
+	}
+
 	commit_tid = datasync ? ei->i_datasync_tid : ei->i_sync_tid;
 	if (journal->j_flags & JBD2_BARRIER &&
 	    !jbd2_trans_will_send_data_barrier(journal, commit_tid))
@@ -3748,6 +3748,9 @@ struct inode *ext4_iget(struct super_block *sb, unsigned long ino)
 		read_unlock(&journal->j_state_lock);
 		ei->i_sync_tid = tid;
 		ei->i_datasync_tid = tid;
+		/* what marked it in this transaction went with the old inode */
+		ei->i_fc_ineligible_tid = tid;
+		ei->i_fc_ineligible_reason = EXT4_FC_REASON_INODE_LOAD;
 	}
 
 	if (EXT4_INODE_SIZE(inode->i_sb) > EXT4_GOOD_OLD_INODE_SIZE) {
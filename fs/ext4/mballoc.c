@@ -684,23 +684,40 @@ static void ext4_mb_mark_free_simple(struct super_block *sb,
 
 /*
  * Cache the order of the largest free extent we have available in this block
- * group.
+ * group, and move the group to the list of that order.  Called with the
+ * group locked.
  */
 static void
 mb_set_largest_free_order(struct super_block *sb, struct ext4_group_info *grp)
 {
+	struct ext4_sb_info *sbi = EXT4_SB(sb);
 	int i;
-	int bits;
-
-	grp->bb_largest_free_order = -1; /* uninit */
+	int order = -1; /* uninit */
 
-	bits = sb->s_blocksize_bits + 1;
-	for (i = bits; i >= 0; i--) {
+	for (i = MB_NUM_ORDERS(sb) - 1; i >= 0; i--) {
 		if (grp->bb_counters[i] > 0) {
-			grp->bb_largest_free_order = i;
+			order = i;
 			break;
 		}
 	}
+
+	if (order == grp->bb_largest_free_order)
+		return;
+
+	if (grp->bb_largest_free_order >= 0) {
+		write_lock(&sbi->s_mb_largest_free_orders_locks[
+					grp->bb_largest_free_order]);
+		list_del_init(&grp->bb_largest_free_order_node);
+		write_unlock(&sbi->s_mb_largest_free_orders_locks[
+					grp->bb_largest_free_order]);
+	}
+	grp->bb_largest_free_order = order;
+	if (order >= 0) {
+		write_lock(&sbi->s_mb_largest_free_orders_locks[order]);
+		list_add_tail(&grp->bb_largest_free_order_node,
+			      &sbi->s_mb_largest_free_orders[order]);
+		write_unlock(&sbi->s_mb_largest_free_orders_locks[order]);
+	}
 }
 
 static noinline_for_stack
@@ -1513,12 +1530,15 @@ static void ext4_mb_use_best_found(struct ext4_allocation_context *ac,
 	get_page(ac->ac_bitmap_page);
 	ac->ac_buddy_page = e4b->bd_buddy_page;
 	get_page(ac->ac_buddy_page);
-	/* store last allocated for subsequent stream allocation */
+	/*
+	 * store last allocated for subsequent stream allocation, in the slot
+	 * of the inode: writers of different files don't share a goal, nor
+	 * a lock around it
+	 */
 	if (ac->ac_flags & EXT4_MB_STREAM_ALLOC) {
-		spin_lock(&sbi->s_md_lock);
-		sbi->s_mb_last_group = ac->ac_f_ex.fe_group;
-		sbi->s_mb_last_start = ac->ac_f_ex.fe_start;
-		spin_unlock(&sbi->s_md_lock);
+		int hash = ac->ac_inode->i_ino % sbi->s_mb_nr_global_goals;
+
+		ACCESS_ONCE(sbi->s_mb_last_groups[hash]) = ac->ac_f_ex.fe_group;
 	}
 }
 
@@ -1916,6 +1936,126 @@ static int ext4_mb_good_group(struct ext4_allocation_context *ac,
 	return 0;
 }
 
+/*
+ * Looks at @group for the request.  In the first two criteria a group that
+ * somebody else has locked is passed over rather than waited for: parallel
+ * writers spread over the groups that are good enough instead of queueing
+ * on one of them.  The later criteria wait, they are the last resort.
+ */
+static int ext4_mb_scan_group(struct ext4_allocation_context *ac,
+			      ext4_group_t group, int cr)
+{
+	struct super_block *sb = ac->ac_sb;
+	struct ext4_sb_info *sbi = EXT4_SB(sb);
+	struct ext4_buddy e4b;
+	int err;
+
+	/* This now checks without needing the buddy page */
+	if (!ext4_mb_good_group(ac, group, cr))
+		return 0;
+
+	err = ext4_mb_load_buddy(sb, group, &e4b);
+	if (err)
+		return err;
+
+	if (cr < 2) {
+		if (!ext4_try_lock_group(sb, group)) {
+			if (sbi->s_mb_stats)
+				atomic_inc(&sbi->s_bal_busy_skipped);
+			ext4_mb_unload_buddy(&e4b);
+			return 0;
+		}
+	} else
+		ext4_lock_group(sb, group);
+
+	/*
+	 * We need to check again after locking the
+	 * block group
+	 */
+	if (!ext4_mb_good_group(ac, group, cr)) {
+		ext4_unlock_group(sb, group);
+		ext4_mb_unload_buddy(&e4b);
+		return 0;
+	}
+
+	ac->ac_groups_scanned++;
+	if (cr == 0)
+		ext4_mb_simple_scan_group(ac, &e4b);
+	else if (cr == 1 && sbi->s_stripe &&
+			!(ac->ac_g_ex.fe_len % sbi->s_stripe))
+		ext4_mb_scan_aligned(ac, &e4b);
+	else
+		ext4_mb_complex_scan_group(ac, &e4b);
+
+	ext4_unlock_group(sb, group);
+	ext4_mb_unload_buddy(&e4b);
+
+	return 0;
+}
+
+/*
+ * cr 0 without walking all the groups.  A few groups from the goal on are
+ * tried first, to stay close to it; after them only the groups on the
+ * lists of orders ac_2order and up can have the extent, the smallest order
+ * is tried first.  Groups not initialized yet are on no list, the linear
+ * scan of the next criteria gets to them.
+ */
+static int ext4_mb_scan_order_lists(struct ext4_allocation_context *ac,
+				    ext4_group_t ngroups)
+{
+	struct super_block *sb = ac->ac_sb;
+	struct ext4_sb_info *sbi = EXT4_SB(sb);
+	int flex_size = ext4_flex_bg_size(sbi);
+	struct ext4_group_info *grp;
+	ext4_group_t group, i;
+	int order, err;
+
+	group = ac->ac_g_ex.fe_group;
+	for (i = 0; i < ngroups && i < MB_DEFAULT_LINEAR_LIMIT; group++, i++) {
+		if (group >= ngroups)
+			group = 0;
+
+		err = ext4_mb_scan_group(ac, group, 0);
+		if (err || ac->ac_status != AC_STATUS_CONTINUE)
+			return err;
+	}
+
+	for (order = ac->ac_2order; order < MB_NUM_ORDERS(sb); order++) {
+		group = ngroups;
+
+		read_lock(&sbi->s_mb_largest_free_orders_locks[order]);
+		list_for_each_entry(grp, &sbi->s_mb_largest_free_orders[order],
+				    bb_largest_free_order_node) {
+			if (grp->bb_group >= ngroups)
+				continue;
+			/* Avoid using the first bg of a flexgroup for data files */
+			if ((ac->ac_flags & EXT4_MB_HINT_DATA) &&
+			    (flex_size >= EXT4_FLEX_SIZE_DIR_ALLOC_SCHEME) &&
+			    ((grp->bb_group % flex_size) == 0))
+				continue;
+			/* leave it to whoever is allocating from it */
+			if (spin_is_locked(ext4_group_lock_ptr(sb, grp->bb_group)))
+				continue;
+			group = grp->bb_group;
+			break;
+		}
+		read_unlock(&sbi->s_mb_largest_free_orders_locks[order]);
+
+		if (group == ngroups)
+			continue;
+
+		if (sbi->s_mb_stats)
+			atomic_inc(&sbi->s_bal_cr0_list_hits);
+		err = ext4_mb_scan_group(ac, group, 0);
+		if (err || ac->ac_status != AC_STATUS_CONTINUE)
+			return err;
+	}
+
+	if (sbi->s_mb_stats)
+		atomic_inc(&sbi->s_bal_cr0_list_misses);
+	return 0;
+}
+
 static noinline_for_stack int
 ext4_mb_regular_allocator(struct ext4_allocation_context *ac)
 {
@@ -1963,13 +2103,13 @@ ext4_mb_regular_allocator(struct ext4_allocation_context *ac)
 			ac->ac_2order = i - 1;
 	}
 
-	/* if stream allocation is enabled, use global goal */
+	/* if stream allocation is enabled, use the goal of the inode */
 	if (ac->ac_flags & EXT4_MB_STREAM_ALLOC) {
-		/* TBD: may be hot point */
-		spin_lock(&sbi->s_md_lock);
-		ac->ac_g_ex.fe_group = sbi->s_mb_last_group;
-		ac->ac_g_ex.fe_start = sbi->s_mb_last_start;
-		spin_unlock(&sbi->s_md_lock);
+		int hash = ac->ac_inode->i_ino % sbi->s_mb_nr_global_goals;
+
+		ac->ac_g_ex.fe_group = ACCESS_ONCE(sbi->s_mb_last_groups[hash]);
+		/* a group, not where in it */
+		ac->ac_g_ex.fe_start = -1;
 	}
 
 	/* Let's just scan groups to find more-less suitable blocks */
@@ -1981,6 +2121,14 @@ ext4_mb_regular_allocator(struct ext4_allocation_context *ac)
 repeat:
 	for (; cr < 4 && ac->ac_status == AC_STATUS_CONTINUE; cr++) {
 		ac->ac_criteria = cr;
+
+		if (cr == 0 && sbi->s_mb_optimize_scan) {
+			err = ext4_mb_scan_order_lists(ac, ngroups);
+			if (err)
+				goto out;
+			continue;
+		}
+
 		/*
 		 * searching for the right group start
 		 * from the goal value specified
@@ -1995,38 +2143,10 @@ repeat:
 			if (group >= ngroups)
 				group = 0;
 
-			/* This now checks without needing the buddy page */
-			if (!ext4_mb_good_group(ac, group, cr))
-				continue;
-
-			err = ext4_mb_load_buddy(sb, group, &e4b);
+			err = ext4_mb_scan_group(ac, group, cr);
 			if (err)
 				goto out;
 
-			ext4_lock_group(sb, group);
-
-			/*
-			 * We need to check again after locking the
-			 * block group
-			 */
-			if (!ext4_mb_good_group(ac, group, cr)) {
-				ext4_unlock_group(sb, group);
-				ext4_mb_unload_buddy(&e4b);
-				continue;
-			}
-
-			ac->ac_groups_scanned++;
-			if (cr == 0)
-				ext4_mb_simple_scan_group(ac, &e4b);
-			else if (cr == 1 && sbi->s_stripe &&
-					!(ac->ac_g_ex.fe_len % sbi->s_stripe))
-				ext4_mb_scan_aligned(ac, &e4b);
-			else
-				ext4_mb_complex_scan_group(ac, &e4b);
-
-			ext4_unlock_group(sb, group);
-			ext4_mb_unload_buddy(&e4b);
-
 			if (ac->ac_status != AC_STATUS_CONTINUE)
 				break;
 		}
@@ -2160,6 +2280,64 @@ static const struct file_operations ext4_mb_seq_groups_fops = {
 	.release	= seq_release,
 };
 
+/* The counters kept while /sys/fs/ext4/<partition>/mb_stats is set */
+static int ext4_mb_seq_stats_show(struct seq_file *seq, void *v)
+{
+	struct super_block *sb = seq->private;
+	struct ext4_sb_info *sbi = EXT4_SB(sb);
+	int cr;
+
+	seq_printf(seq, "mballoc:\n");
+	if (!sbi->s_mb_stats) {
+		seq_printf(seq, "\tmb stats collection turned off.\n");
+		seq_printf(seq, "\tTo enable, write \"1\" to sysfs file "
+			   "mb_stats.\n");
+		return 0;
+	}
+	seq_printf(seq, "\treqs: %u\n", atomic_read(&sbi->s_bal_reqs));
+	seq_printf(seq, "\tsuccess: %u\n", atomic_read(&sbi->s_bal_success));
+	seq_printf(seq, "\tallocated: %u\n",
+		   atomic_read(&sbi->s_bal_allocated));
+	seq_printf(seq, "\tgroups_scanned: %u\n",
+		   atomic_read(&sbi->s_bal_groups_scanned));
+	for (cr = 0; cr < 4; cr++)
+		seq_printf(seq, "\tcr%d_hits: %u\n", cr,
+			   atomic_read(&sbi->s_bal_cr_hits[cr]));
+	seq_printf(seq, "\toptimize_scan: %u\n", sbi->s_mb_optimize_scan);
+	seq_printf(seq, "\tcr0_list_hits: %u\n",
+		   atomic_read(&sbi->s_bal_cr0_list_hits));
+	seq_printf(seq, "\tcr0_list_misses: %u\n",
+		   atomic_read(&sbi->s_bal_cr0_list_misses));
+	seq_printf(seq, "\tbusy_groups_skipped: %u\n",
+		   atomic_read(&sbi->s_bal_busy_skipped));
+	seq_printf(seq, "\textents_scanned: %u\n",
+		   atomic_read(&sbi->s_bal_ex_scanned));
+	seq_printf(seq, "\tgoal_hits: %u\n", atomic_read(&sbi->s_bal_goals));
+	seq_printf(seq, "\t2^n_hits: %u\n", atomic_read(&sbi->s_bal_2orders));
+	seq_printf(seq, "\tbreaks: %u\n", atomic_read(&sbi->s_bal_breaks));
+	seq_printf(seq, "\tlost: %u\n", atomic_read(&sbi->s_mb_lost_chunks));
+	seq_printf(seq, "\tbuddies_generated: %lu\n",
+		   sbi->s_mb_buddies_generated);
+	seq_printf(seq, "\tpreallocated: %u\n",
+		   atomic_read(&sbi->s_mb_preallocated));
+	seq_printf(seq, "\tdiscarded: %u\n",
+		   atomic_read(&sbi->s_mb_discarded));
+	return 0;
+}
+
+static int ext4_mb_seq_stats_open(struct inode *inode, struct file *file)
+{
+	return single_open(file, ext4_mb_seq_stats_show, PDE(inode)->data);
+}
+
+static const struct file_operations ext4_mb_seq_stats_fops = {
+	.owner		= THIS_MODULE,
+	.open		= ext4_mb_seq_stats_open,
+	.read		= seq_read,
+	.llseek		= seq_lseek,
+	.release	= single_release,
+};
+
 static struct kmem_cache *get_groupinfo_cache(int blocksize_bits)
 {
 	int cache_index = blocksize_bits - EXT4_MIN_BLOCK_LOG_SIZE;
@@ -2223,9 +2401,11 @@ int ext4_mb_add_groupinfo(struct super_block *sb, ext4_group_t group,
 	}
 
 	INIT_LIST_HEAD(&meta_group_info[i]->bb_prealloc_list);
+	INIT_LIST_HEAD(&meta_group_info[i]->bb_largest_free_order_node);
 	init_rwsem(&meta_group_info[i]->alloc_sem);
 	meta_group_info[i]->bb_free_root = RB_ROOT;
 	meta_group_info[i]->bb_largest_free_order = -1;  /* uninit */
+	meta_group_info[i]->bb_group = group;
 
 #ifdef DOUBLE_CHECK
 	{
@@ -2437,6 +2617,8 @@ int ext4_mb_init(struct super_block *sb, int needs_recovery)
 	sbi->s_mb_stats = MB_DEFAULT_STATS;
 	sbi->s_mb_stream_request = MB_DEFAULT_STREAM_THRESHOLD;
 	sbi->s_mb_order2_reqs = MB_DEFAULT_ORDER2_REQS;
+	sbi->s_mb_optimize_scan = ext4_get_groups_count(sb) >=
+					MB_DEFAULT_LINEAR_SCAN_THRESHOLD;
 	/*
 	 * The default group preallocation is 512, which for 4k block
 	 * sizes translates to 2 megabytes.  However for bigalloc file
@@ -2478,17 +2660,46 @@ int ext4_mb_init(struct super_block *sb, int needs_recovery)
 		spin_lock_init(&lg->lg_prealloc_lock);
 	}
 
+	sbi->s_mb_largest_free_orders = kmalloc(MB_NUM_ORDERS(sb) *
+			sizeof(*sbi->s_mb_largest_free_orders), GFP_KERNEL);
+	sbi->s_mb_largest_free_orders_locks = kmalloc(MB_NUM_ORDERS(sb) *
+			sizeof(*sbi->s_mb_largest_free_orders_locks), GFP_KERNEL);
+	/* one stream goal per cpu that can be writing */
+	sbi->s_mb_nr_global_goals = num_possible_cpus();
+	sbi->s_mb_last_groups = kcalloc(sbi->s_mb_nr_global_goals,
+			sizeof(*sbi->s_mb_last_groups), GFP_KERNEL);
+	if (sbi->s_mb_largest_free_orders == NULL ||
+	    sbi->s_mb_largest_free_orders_locks == NULL ||
+	    sbi->s_mb_last_groups == NULL) {
+		ret = -ENOMEM;
+		goto out_free_lists;
+	}
+	for (i = 0; i < MB_NUM_ORDERS(sb); i++) {
+		INIT_LIST_HEAD(&sbi->s_mb_largest_free_orders[i]);
+		rwlock_init(&sbi->s_mb_largest_free_orders_locks[i]);
+	}
+
 	/* init file for buddy data */
 	ret = ext4_mb_init_backend(sb);
 	if (ret != 0)
-		goto out_free_locality_groups;
+		goto out_free_lists;
 
-	if (sbi->s_proc)
+	if (sbi->s_proc) {
 		proc_create_data("mb_groups", S_IRUGO, sbi->s_proc,
 				 &ext4_mb_seq_groups_fops, sb);
+		proc_create_data("mb_stats", S_IRUGO, sbi->s_proc,
+				 &ext4_mb_seq_stats_fops, sb);
+	}
 
 	return 0;
 
+out_free_lists:
+	kfree(sbi->s_mb_last_groups);
+	sbi->s_mb_last_groups = NULL;
+	kfree(sbi->s_mb_largest_free_orders_locks);
+	sbi->s_mb_largest_free_orders_locks = NULL;
+	kfree(sbi->s_mb_largest_free_orders);
+	sbi->s_mb_largest_free_orders = NULL;
 out_free_locality_groups:
 	free_percpu(sbi->s_locality_groups);
 	sbi->s_locality_groups = NULL;
@@ -2529,8 +2740,10 @@ int ext4_mb_release(struct super_block *sb)
 	struct ext4_sb_info *sbi = EXT4_SB(sb);
 	struct kmem_cache *cachep = get_groupinfo_cache(sb->s_blocksize_bits);
 
-	if (sbi->s_proc)
+	if (sbi->s_proc) {
+		remove_proc_entry("mb_stats", sbi->s_proc);
 		remove_proc_entry("mb_groups", sbi->s_proc);
+	}
 
 	if (sbi->s_group_info) {
 		for (i = 0; i < ngroups; i++) {
@@ -2550,6 +2763,9 @@ int ext4_mb_release(struct super_block *sb)
 			kfree(sbi->s_group_info[i]);
 		ext4_kvfree(sbi->s_group_info);
 	}
+	kfree(sbi->s_mb_last_groups);
+	kfree(sbi->s_mb_largest_free_orders_locks);
+	kfree(sbi->s_mb_largest_free_orders);
 	kfree(sbi->s_mb_offsets);
 	kfree(sbi->s_mb_maxs);
 	if (sbi->s_buddy_cache)
@@ -3067,6 +3283,11 @@ static void ext4_mb_collect_stats(struct ext4_allocation_context *ac)
 			atomic_inc(&sbi->s_bal_goals);
 		if (ac->ac_found > sbi->s_mb_max_to_scan)
 			atomic_inc(&sbi->s_bal_breaks);
+		atomic_add(ac->ac_groups_scanned, &sbi->s_bal_groups_scanned);
+		/* found by the group scan, not the goal or a preallocation */
+		if (ac->ac_status == AC_STATUS_FOUND && ac->ac_groups_scanned &&
+		    ac->ac_criteria < 4)
+			atomic_inc(&sbi->s_bal_cr_hits[ac->ac_criteria]);
 	}
 
 	if (ac->ac_op == EXT4_MB_HISTORY_ALLOC)
@@ -4522,6 +4743,8 @@ void ext4_free_blocks(handle_t *handle, struct inode *inode,
 	ext4_debug("freeing block %llu\n", block);
 	trace_ext4_free_blocks(inode, block, count, flags);
 
+	ext4_fc_mark_ineligible(handle, inode, EXT4_FC_REASON_FREED_BLOCKS);
+
 	if (flags & EXT4_FREE_BLOCKS_FORGET) {
 		struct buffer_head *tbh = bh;
 		int i;
@@ -4548,6 +4771,10 @@ void ext4_free_blocks(handle_t *handle, struct inode *inode,
 	 */
 	if (!ext4_should_writeback_data(inode))
 		flags |= EXT4_FREE_BLOCKS_METADATA;
+	else if (!(flags & EXT4_FREE_BLOCKS_METADATA))
+		/* a fast commit of the next owner would cross-link them */
+		ext4_fc_mark_fs_ineligible(handle, sb,
+					   EXT4_FC_REASON_FREED_BLOCKS);
 
 	/*
 	 * If the extent to be freed does not begin on a cluster
@@ -94,6 +94,23 @@ extern u8 mb_enable_debug;
  */
 #define MB_DEFAULT_GROUP_PREALLOC	512
 
+/*
+ * the groups are kept on lists by the order of their largest free extent,
+ * for the cr 0 scan to go straight to the ones that can do.  It is turned
+ * on for filesystems with at least this many groups, the tunable is
+ * /sys/fs/ext4/<partition>/mb_optimize_scan
+ */
+#define MB_DEFAULT_LINEAR_SCAN_THRESHOLD	16
+
+/*
+ * groups from the goal on tried before the lists, to keep allocations
+ * close to the goal
+ */
+#define MB_DEFAULT_LINEAR_LIMIT		4
+
+/* orders of the buddy, bb_counters[] and the lists are that long */
+#define MB_NUM_ORDERS(sb)		((sb)->s_blocksize_bits + 2)
+
 
 struct ext4_free_data {
 	/* MUST be the first member */
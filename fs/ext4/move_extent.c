@@ -783,6 +783,9 @@ move_extent_per_page(struct file *o_filp, struct inode *donor_inode,
 		*err = PTR_ERR(handle);
 		return 0;
 	}
+	ext4_fc_mark_ineligible(handle, orig_inode, EXT4_FC_REASON_SWAP_EXTENTS);
+	ext4_fc_mark_ineligible(handle, donor_inode,
+				EXT4_FC_REASON_SWAP_EXTENTS);
 
 	if (segment_eq(get_fs(), KERNEL_DS))
 		w_flags |= AOP_FLAG_UNINTERRUPTIBLE;
@@ -1556,6 +1556,7 @@ static int ext4_add_entry(handle_t *handle, struct dentry *dentry,
 	blocksize = sb->s_blocksize;
 	if (!dentry->d_name.len)
 		return -EINVAL;
+	ext4_fc_mark_ineligible(handle, inode, EXT4_FC_REASON_NAMESPACE);
 	if (is_dx(dir)) {
 		retval = ext4_dx_add_entry(handle, dentry, inode);
 		if (!retval || (retval != ERR_BAD_DX_DIR))
@@ -2077,6 +2078,8 @@ int ext4_orphan_add(handle_t *handle, struct inode *inode)
 	if (!ext4_handle_valid(handle))
 		return 0;
 
+	ext4_fc_mark_ineligible(handle, inode, EXT4_FC_REASON_ORPHAN);
+
 	mutex_lock(&EXT4_SB(sb)->s_orphan_lock);
 	if (!list_empty(&EXT4_I(inode)->i_orphan))
 		goto out_unlock;
@@ -2153,6 +2156,8 @@ int ext4_orphan_del(handle_t *handle, struct inode *inode)
 	    !(EXT4_SB(inode->i_sb)->s_mount_state & EXT4_ORPHAN_FS))
 		return 0;
 
+	ext4_fc_mark_ineligible(handle, inode, EXT4_FC_REASON_ORPHAN);
+
 	mutex_lock(&EXT4_SB(inode->i_sb)->s_orphan_lock);
 	if (list_empty(&ei->i_orphan))
 		goto out;
@@ -2323,6 +2328,7 @@ static int ext4_unlink(struct inode *dir, struct dentry *dentry)
 	retval = ext4_delete_entry(handle, dir, de, bh);
 	if (retval)
 		goto end_unlink;
+	ext4_fc_mark_ineligible(handle, inode, EXT4_FC_REASON_NAMESPACE);
 	dir->i_ctime = dir->i_mtime = ext4_current_time(dir);
 	ext4_update_dx_flag(dir);
 	ext4_mark_inode_dirty(handle, dir);
@@ -2537,6 +2543,10 @@ static int ext4_rename(struct inode *old_dir, struct dentry *old_dentry,
 		goto end_rename;
 
 	new_inode = new_dentry->d_inode;
+	ext4_fc_mark_ineligible(handle, old_inode, EXT4_FC_REASON_NAMESPACE);
+	if (new_inode)
+		ext4_fc_mark_ineligible(handle, new_inode,
+					EXT4_FC_REASON_NAMESPACE);
 #ifdef CONFIG_SDCARD_FS_CI_SEARCH
 	new_bh = ext4_find_entry(new_dir, &new_dentry->d_name, &new_de, NULL);
 #else
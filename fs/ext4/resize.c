@@ -1276,6 +1276,7 @@ static int ext4_flex_group_add(struct super_block *sb,
 		err = PTR_ERR(handle);
 		goto exit;
 	}
+	ext4_fc_mark_fs_ineligible(handle, sb, EXT4_FC_REASON_RESIZE);
 
 	err = ext4_journal_get_write_access(handle, sbi->s_sbh);
 	if (err)
@@ -1478,6 +1479,7 @@ static int ext4_group_extend_no_check(struct super_block *sb,
 		ext4_warning(sb, "error %d on journal start", err);
 		return err;
 	}
+	ext4_fc_mark_fs_ineligible(handle, sb, EXT4_FC_REASON_RESIZE);
 
 	err = ext4_journal_get_write_access(handle, EXT4_SB(sb)->s_sbh);
 	if (err) {
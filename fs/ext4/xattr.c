@@ -996,6 +996,7 @@ ext4_xattr_set_handle(handle_t *handle, struct inode *inode, int name_index,
 	error = ext4_reserve_inode_write(handle, inode, &is.iloc);
 	if (error)
 		goto cleanup;
+	ext4_fc_mark_ineligible(handle, inode, EXT4_FC_REASON_XATTR);
 
 	if (ext4_test_inode_state(inode, EXT4_STATE_NEW)) {
 		struct ext4_inode *raw_inode = ext4_raw_inode(&is.iloc);
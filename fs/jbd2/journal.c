@@ -42,6 +42,7 @@
 #include <linux/log2.h>
 #include <linux/vmalloc.h>
 #include <linux/backing-dev.h>
+#include <linux/blkdev.h>
 #include <linux/bitops.h>
 #include <linux/ratelimit.h>
 
@@ -661,6 +662,274 @@ int jbd2_log_wait_commit(journal_t *journal, tid_t tid)
 	return err;
 }
 
+/*
+ * Fast commits
+ *
+ * With JBD2_FEATURE_INCOMPAT_FAST_COMMIT the last s_num_fc_blks blocks of
+ * the journal are kept out of the log and lent to the client fs.  For an
+ * fsync it writes there a compact record of the changes that fsync needs
+ * instead of committing the whole running transaction.  The records all
+ * belong to the running transaction: the area fills up from its start
+ * until that transaction is committed, then starts over.  jbd2 never looks
+ * into them, recovery only tells the client which transaction the records
+ * it may replay belong to through j_fc_replay_callback.
+ */
+
+static unsigned int jbd2_fc_area_blocks(journal_superblock_t *sb)
+{
+	if (sb->s_num_fc_blks)
+		return be32_to_cpu(sb->s_num_fc_blks);
+	return JBD2_DEFAULT_FAST_COMMIT_BLOCKS;
+}
+
+static int jbd2_fc_alloc(journal_t *journal)
+{
+	unsigned int blocks = jbd2_fc_area_blocks(journal->j_superblock);
+
+	if (!journal->j_fc_wbuf) {
+		journal->j_fc_wbuf = kcalloc(blocks, sizeof(struct buffer_head *),
+					     GFP_KERNEL);
+		if (!journal->j_fc_wbuf)
+			return -ENOMEM;
+	}
+	journal->j_fc_wbufsize = blocks;
+	return 0;
+}
+
+static void jbd2_fc_done(journal_t *journal)
+{
+	write_lock(&journal->j_state_lock);
+	journal->j_flags &= ~JBD2_FAST_COMMIT_ONGOING;
+	write_unlock(&journal->j_state_lock);
+	wake_up(&journal->j_fc_wait);
+}
+
+/**
+ * int jbd2_fc_begin_commit() - start a fast commit
+ * @journal: Journal to write to.
+ * @tid: transaction holding the changes to be recorded
+ *
+ * Returns -EALREADY if @tid has been committed already, and another error
+ * when the records cannot be written now; the caller then has to wait for
+ * the commit of @tid instead.  A commit of the transaction before @tid is
+ * waited for.  Fast commits are serialised, and the commit of @tid is held
+ * off until jbd2_fc_end_commit() or jbd2_fc_end_commit_fallback().
+ */
+int jbd2_fc_begin_commit(journal_t *journal, tid_t tid)
+{
+	transaction_t *committing;
+	tid_t wait_tid;
+	DEFINE_WAIT(wait);
+
+	if (!JBD2_HAS_INCOMPAT_FEATURE(journal, JBD2_FEATURE_INCOMPAT_FAST_COMMIT) ||
+	    !journal->j_fc_wbuf)
+		return -EOPNOTSUPP;
+
+	write_lock(&journal->j_state_lock);
+	for (;;) {
+		if (is_journal_aborted(journal)) {
+			write_unlock(&journal->j_state_lock);
+			return -EIO;
+		}
+		if (tid_geq(journal->j_commit_sequence, tid)) {
+			write_unlock(&journal->j_state_lock);
+			return -EALREADY;
+		}
+
+		/* records of @tid only make sense once the one before is in */
+		committing = journal->j_committing_transaction;
+		if (committing && committing->t_tid != tid) {
+			wait_tid = committing->t_tid;
+			write_unlock(&journal->j_state_lock);
+			jbd2_log_wait_commit(journal, wait_tid);
+			write_lock(&journal->j_state_lock);
+			continue;
+		}
+
+		/*
+		 * Leave it to the full commit when @tid is already on its way
+		 * or the superblock still says the log is empty, in which case
+		 * recovery would not look at the records.
+		 */
+		if (!journal->j_running_transaction ||
+		    journal->j_running_transaction->t_tid != tid ||
+		    tid_geq(journal->j_commit_request, tid) ||
+		    (journal->j_flags & (JBD2_FULL_COMMIT_ONGOING |
+					 JBD2_FLUSHED))) {
+			write_unlock(&journal->j_state_lock);
+			return -EAGAIN;
+		}
+
+		if (!(journal->j_flags & JBD2_FAST_COMMIT_ONGOING))
+			break;
+
+		prepare_to_wait(&journal->j_fc_wait, &wait,
+				TASK_UNINTERRUPTIBLE);
+		write_unlock(&journal->j_state_lock);
+		schedule();
+		finish_wait(&journal->j_fc_wait, &wait);
+		write_lock(&journal->j_state_lock);
+	}
+
+	if (journal->j_fc_off >= journal->j_fc_wbufsize) {
+		write_unlock(&journal->j_state_lock);
+		return -ENOSPC;
+	}
+
+	journal->j_flags |= JBD2_FAST_COMMIT_ONGOING;
+	journal->j_fc_batch = journal->j_fc_off;
+	write_unlock(&journal->j_state_lock);
+
+	return 0;
+}
+EXPORT_SYMBOL(jbd2_fc_begin_commit);
+
+/**
+ * struct buffer_head *jbd2_fc_get_buf() - next block of the fast commit area
+ * @journal: Journal to write to.
+ *
+ * The block comes zeroed and is written by jbd2_fc_end_commit().  Returns
+ * ERR_PTR(-ENOSPC) once the area is full.
+ */
+struct buffer_head *jbd2_fc_get_buf(journal_t *journal)
+{
+	struct buffer_head *bh;
+	unsigned long long blocknr;
+	int err;
+
+	if (journal->j_fc_off >= journal->j_fc_wbufsize)
+		return ERR_PTR(-ENOSPC);
+
+	err = jbd2_journal_bmap(journal, journal->j_fc_first + journal->j_fc_off,
+				&blocknr);
+	if (err)
+		return ERR_PTR(err);
+
+	bh = __getblk(journal->j_dev, blocknr, journal->j_blocksize);
+	if (!bh)
+		return ERR_PTR(-ENOMEM);
+	lock_buffer(bh);
+	memset(bh->b_data, 0, journal->j_blocksize);
+	set_buffer_uptodate(bh);
+	unlock_buffer(bh);
+
+	journal->j_fc_wbuf[journal->j_fc_off++] = bh;
+	return bh;
+}
+EXPORT_SYMBOL(jbd2_fc_get_buf);
+
+static void jbd2_fc_submit_buf(struct buffer_head *bh, int write_op)
+{
+	lock_buffer(bh);
+	clear_buffer_dirty(bh);
+	set_buffer_uptodate(bh);
+	bh->b_end_io = end_buffer_write_sync;
+	get_bh(bh);
+	submit_bh(write_op, bh);
+}
+
+/**
+ * int jbd2_fc_end_commit() - write out a fast commit
+ * @journal: Journal to write to.
+ *
+ * Writes the blocks taken since jbd2_fc_begin_commit() and waits for them.
+ * The last one goes out with a cache flush ahead of it and FUA, so that it
+ * is only on disk after the others and whatever the caller wrote to the fs
+ * before.  After an I/O error the area is not used again until the next
+ * commit, the records behind a torn one would not be replayed.
+ */
+int jbd2_fc_end_commit(journal_t *journal)
+{
+	int first = journal->j_fc_batch, last = journal->j_fc_off - 1;
+	int write_op = WRITE_SYNC;
+	struct buffer_head *bh;
+	int i, err = 0;
+
+	if (journal->j_flags & JBD2_BARRIER) {
+		write_op = WRITE_FLUSH_FUA;
+		if (journal->j_fs_dev != journal->j_dev)
+			blkdev_issue_flush(journal->j_fs_dev, GFP_NOFS, NULL);
+	}
+
+	for (i = first; i < last; i++)
+		jbd2_fc_submit_buf(journal->j_fc_wbuf[i], WRITE_SYNC);
+	for (i = first; i < last; i++)
+		wait_on_buffer(journal->j_fc_wbuf[i]);
+	if (last >= first) {
+		jbd2_fc_submit_buf(journal->j_fc_wbuf[last], write_op);
+		wait_on_buffer(journal->j_fc_wbuf[last]);
+	}
+
+	for (i = first; i <= last; i++) {
+		bh = journal->j_fc_wbuf[i];
+		if (unlikely(!buffer_uptodate(bh)))
+			err = -EIO;
+		brelse(bh);
+		journal->j_fc_wbuf[i] = NULL;
+	}
+
+	if (err) {
+		printk(KERN_ERR "JBD2: I/O error writing fast commit "
+		       "on %s\n", journal->j_devname);
+		journal->j_fc_off = journal->j_fc_wbufsize;
+	}
+
+	jbd2_fc_done(journal);
+	return err;
+}
+EXPORT_SYMBOL(jbd2_fc_end_commit);
+
+/**
+ * void jbd2_fc_end_commit_fallback() - give up on a fast commit
+ * @journal: Journal to act on.
+ *
+ * Nothing taken since jbd2_fc_begin_commit() has been written, the blocks
+ * are handed back.  The caller goes on with a full commit.
+ */
+void jbd2_fc_end_commit_fallback(journal_t *journal)
+{
+	int i;
+
+	for (i = journal->j_fc_batch; i < journal->j_fc_off; i++) {
+		brelse(journal->j_fc_wbuf[i]);
+		journal->j_fc_wbuf[i] = NULL;
+	}
+	journal->j_fc_off = journal->j_fc_batch;
+
+	jbd2_fc_done(journal);
+}
+EXPORT_SYMBOL(jbd2_fc_end_commit_fallback);
+
+/**
+ * int jbd2_fc_read_block() - read a block of the fast commit area
+ * @journal: Journal to read from.
+ * @off: block of the area
+ * @bhp: where to return the buffer
+ *
+ * For j_fc_replay_callback.  Returns -ENOENT past the end of the area.
+ */
+int jbd2_fc_read_block(journal_t *journal, int off, struct buffer_head **bhp)
+{
+	unsigned long long blocknr;
+	struct buffer_head *bh;
+	int err;
+
+	if (off >= journal->j_fc_wbufsize)
+		return -ENOENT;
+
+	err = jbd2_journal_bmap(journal, journal->j_fc_first + off, &blocknr);
+	if (err)
+		return err;
+
+	bh = __bread(journal->j_dev, blocknr, journal->j_blocksize);
+	if (!bh)
+		return -EIO;
+
+	*bhp = bh;
+	return 0;
+}
+EXPORT_SYMBOL(jbd2_fc_read_block);
+
 /*
  * Log buffer allocation routines:
  */
@@ -985,6 +1254,7 @@ static journal_t * journal_init_common (void)
 	init_waitqueue_head(&journal->j_wait_checkpoint);
 	init_waitqueue_head(&journal->j_wait_commit);
 	init_waitqueue_head(&journal->j_wait_updates);
+	init_waitqueue_head(&journal->j_fc_wait);
 	mutex_init(&journal->j_barrier);
 	mutex_init(&journal->j_checkpoint_mutex);
 	spin_lock_init(&journal->j_revoke_lock);
@@ -1183,6 +1453,8 @@ static int journal_reset(journal_t *journal)
 
 	first = be32_to_cpu(sb->s_first);
 	last = be32_to_cpu(sb->s_maxlen);
+	if (JBD2_HAS_INCOMPAT_FEATURE(journal, JBD2_FEATURE_INCOMPAT_FAST_COMMIT))
+		last -= jbd2_fc_area_blocks(sb);
 	if (first + JBD2_MIN_JOURNAL_BLOCKS > last + 1) {
 		printk(KERN_ERR "JBD2: Journal too short (blocks %llu-%llu).\n",
 		       first, last);
@@ -1192,6 +1464,8 @@ static int journal_reset(journal_t *journal)
 
 	journal->j_first = first;
 	journal->j_last = last;
+	journal->j_fc_first = last;
+	journal->j_fc_off = 0;
 
 	journal->j_head = first;
 	journal->j_tail = first;
@@ -1419,6 +1693,15 @@ static int journal_get_superblock(journal_t *journal)
 		goto out;
 	}
 
+	if (JBD2_HAS_INCOMPAT_FEATURE(journal, JBD2_FEATURE_INCOMPAT_FAST_COMMIT) &&
+	    be32_to_cpu(sb->s_first) + JBD2_MIN_JOURNAL_BLOCKS +
+	    jbd2_fc_area_blocks(sb) > journal->j_maxlen) {
+		printk(KERN_WARNING
+			"JBD2: Fast commit area of %u blocks too large\n",
+			jbd2_fc_area_blocks(sb));
+		goto out;
+	}
+
 	return 0;
 
 out:
@@ -1446,6 +1729,9 @@ static int load_superblock(journal_t *journal)
 	journal->j_tail = be32_to_cpu(sb->s_start);
 	journal->j_first = be32_to_cpu(sb->s_first);
 	journal->j_last = be32_to_cpu(sb->s_maxlen);
+	if (JBD2_HAS_INCOMPAT_FEATURE(journal, JBD2_FEATURE_INCOMPAT_FAST_COMMIT))
+		journal->j_last -= jbd2_fc_area_blocks(sb);
+	journal->j_fc_first = journal->j_last;
 	journal->j_errno = be32_to_cpu(sb->s_errno);
 
 	return 0;
@@ -1491,6 +1777,12 @@ int jbd2_journal_load(journal_t *journal)
 	if (err)
 		return err;
 
+	if (JBD2_HAS_INCOMPAT_FEATURE(journal, JBD2_FEATURE_INCOMPAT_FAST_COMMIT)) {
+		err = jbd2_fc_alloc(journal);
+		if (err)
+			return err;
+	}
+
 	/* Let the recovery code check whether it needs to recover any
 	 * data from the journal. */
 	if (jbd2_journal_recover(journal))
@@ -1571,6 +1863,7 @@ int jbd2_journal_destroy(journal_t *journal)
 	if (journal->j_revoke)
 		jbd2_journal_destroy_revoke(journal);
 	kfree(journal->j_wbuf);
+	kfree(journal->j_fc_wbuf);
 	kfree(journal);
 
 	return err;
@@ -1656,6 +1949,65 @@ int jbd2_journal_check_available_features (journal_t *journal, unsigned long com
  *
  */
 
+/*
+ * Take the fast commit area out of the log or give it back.  That moves the
+ * end of the log, so it is only done while the log is empty, right after
+ * the journal is loaded, and the superblock goes out at once: recovery has
+ * to wrap around where the log was written.
+ */
+static int jbd2_fc_switch(journal_t *journal, int on)
+{
+	journal_superblock_t *sb = journal->j_superblock;
+	unsigned long last = be32_to_cpu(sb->s_maxlen);
+	int err;
+
+	if (on) {
+		if (journal->j_first + JBD2_MIN_JOURNAL_BLOCKS +
+		    jbd2_fc_area_blocks(sb) > last)
+			return -ENOSPC;
+		err = jbd2_fc_alloc(journal);
+		if (err)
+			return err;
+		last -= jbd2_fc_area_blocks(sb);
+	}
+
+	mutex_lock(&journal->j_checkpoint_mutex);
+	write_lock(&journal->j_state_lock);
+	if (journal->j_running_transaction ||
+	    journal->j_committing_transaction ||
+	    journal->j_head != journal->j_first ||
+	    journal->j_tail != journal->j_first) {
+		write_unlock(&journal->j_state_lock);
+		mutex_unlock(&journal->j_checkpoint_mutex);
+		err = -EBUSY;
+		goto out;
+	}
+
+	journal->j_last = last;
+	journal->j_free = last - journal->j_first;
+	journal->j_fc_first = last;
+	journal->j_fc_off = 0;
+	if (on)
+		sb->s_feature_incompat |=
+			cpu_to_be32(JBD2_FEATURE_INCOMPAT_FAST_COMMIT);
+	else
+		sb->s_feature_incompat &=
+			~cpu_to_be32(JBD2_FEATURE_INCOMPAT_FAST_COMMIT);
+	write_unlock(&journal->j_state_lock);
+
+	jbd2_write_superblock(journal, WRITE_FUA);
+	mutex_unlock(&journal->j_checkpoint_mutex);
+	err = 0;
+out:
+	/* the buffer array only stays while the area is in use */
+	if ((on && err) || (!on && !err)) {
+		kfree(journal->j_fc_wbuf);
+		journal->j_fc_wbuf = NULL;
+		journal->j_fc_wbufsize = 0;
+	}
+	return err;
+}
+
 int jbd2_journal_set_features (journal_t *journal, unsigned long compat,
 			  unsigned long ro, unsigned long incompat)
 {
@@ -1670,6 +2022,12 @@ int jbd2_journal_set_features (journal_t *journal, unsigned long compat,
 	jbd_debug(1, "Setting new features 0x%lx/0x%lx/0x%lx\n",
 		  compat, ro, incompat);
 
+	if ((incompat & JBD2_FEATURE_INCOMPAT_FAST_COMMIT) &&
+	    !JBD2_HAS_INCOMPAT_FEATURE(journal,
+				       JBD2_FEATURE_INCOMPAT_FAST_COMMIT) &&
+	    jbd2_fc_switch(journal, 1))
+		return 0;
+
 	sb = journal->j_superblock;
 
 	sb->s_feature_compat    |= cpu_to_be32(compat);
@@ -1698,6 +2056,15 @@ void jbd2_journal_clear_features(journal_t *journal, unsigned long compat,
 	jbd_debug(1, "Clear features 0x%lx/0x%lx/0x%lx\n",
 		  compat, ro, incompat);
 
+	if ((incompat & JBD2_FEATURE_INCOMPAT_FAST_COMMIT) &&
+	    JBD2_HAS_INCOMPAT_FEATURE(journal,
+				      JBD2_FEATURE_INCOMPAT_FAST_COMMIT) &&
+	    jbd2_fc_switch(journal, 0)) {
+		printk(KERN_WARNING "JBD2: log of %s not empty, fast commit "
+		       "area kept\n", journal->j_devname);
+		incompat &= ~JBD2_FEATURE_INCOMPAT_FAST_COMMIT;
+	}
+
 	sb = journal->j_superblock;
 
 	sb->s_feature_compat    &= ~cpu_to_be32(compat);
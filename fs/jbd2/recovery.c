@@ -258,6 +258,16 @@ int jbd2_journal_recover(journal_t *journal)
 	jbd_debug(1, "JBD2: Replayed %d and revoked %d/%d blocks\n",
 		  info.nr_replays, info.nr_revoke_hits, info.nr_revokes);
 
+	/*
+	 * The client replays the fast commit records of the transaction that
+	 * did not make it, ahead of the flush below.  They cannot be taken
+	 * for records of a later transaction, that one gets the next ID.
+	 */
+	if (!err && journal->j_fc_replay_callback &&
+	    JBD2_HAS_INCOMPAT_FEATURE(journal, JBD2_FEATURE_INCOMPAT_FAST_COMMIT))
+		err = journal->j_fc_replay_callback(journal,
+						    info.end_transaction);
+
 	/* Restart the log at the next transaction ID, thus invalidating
 	 * any existing commit records in the log. */
 	journal->j_transaction_sequence = ++info.end_transaction;
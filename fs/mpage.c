@@ -368,26 +368,34 @@ mpage_readpages(struct address_space *mapping, struct list_head *pages,
 {
 	struct bio *bio = NULL;
 	unsigned page_idx;
+	unsigned nr;
 	sector_t last_block_in_bio = 0;
 	struct buffer_head map_bh;
 	unsigned long first_logical_block = 0;
 
 	map_bh.b_state = 0;
 	map_bh.b_size = 0;
-	for (page_idx = 0; page_idx < nr_pages; page_idx++) {
-		struct page *page = list_entry(pages->prev, struct page, lru);
-
-		prefetchw(&page->flags);
-		list_del(&page->lru);
-		if (!add_to_page_cache_lru(page, mapping,
-					page->index, GFP_KERNEL)) {
-			bio = do_mpage_readpage(bio, page,
-					nr_pages - page_idx,
+	for (page_idx = 0; page_idx < nr_pages; page_idx += nr) {
+		struct page *batch[PAGE_CACHE_BATCH];
+		unsigned i;
+
+		nr = min_t(unsigned, nr_pages - page_idx, PAGE_CACHE_BATCH);
+		for (i = 0; i < nr; i++) {
+			batch[i] = list_entry(pages->prev, struct page, lru);
+			prefetchw(&batch[i]->flags);
+			list_del(&batch[i]->lru);
+		}
+		add_to_page_cache_lru_batch(batch, nr, mapping, GFP_KERNEL);
+		for (i = 0; i < nr; i++) {
+			if (!batch[i])
+				continue;
+			bio = do_mpage_readpage(bio, batch[i],
+					nr_pages - page_idx - i,
 					&last_block_in_bio, &map_bh,
 					&first_logical_block,
 					get_block);
+			page_cache_release(batch[i]);
 		}
-		page_cache_release(page);
 	}
 	BUG_ON(!list_empty(pages));
 	if (bio)
@@ -94,6 +94,26 @@ struct drm_exynos_gem_info {
 	uint64_t size;
 };
 
+/**
+ * A structure for wrapping user space memory in a gem object.
+ *
+ * The pages of the memory region are pinned for the life time of the gem
+ * object and mapped to the device, so the memory region can be used by
+ * dma without copying.
+ *
+ * @userptr: user space address of the memory region, page aligned.
+ * @size: size of the memory region, page aligned.
+ * @flags: cache attribute of the memory region, EXYNOS_BO_CACHABLE or not.
+ * @handle: returned a handle to created gem object.
+ *	- this handle will be set by gem module of kernel side.
+ */
+struct drm_exynos_gem_userptr {
+	uint64_t userptr;
+	uint64_t size;
+	unsigned int flags;
+	unsigned int handle;
+};
+
 /**
  * A structure for user connection request of virtual display.
  *
@@ -354,11 +374,18 @@ enum drm_exynos_ipp_dithering {
 	IPP_DITHERING_MAX,
 };
 
-/* define of ipp operation type */
+/*
+ * define of ipp operation type
+ *
+ * IPP_PIPELINED is for m2m commands with IPP_EVENT_DRIVEN: queued jobs are
+ * started back to back from the completion of the previous one, without
+ * setting up the hardware again, and buffers can carry fences.
+ */
 enum drm_exynos_ipp_type {
 	IPP_SYNC_WORK = 0x0,
 	IPP_EVENT_DRIVEN = 0x1,
-	IPP_TYPE_MAX = 0x2,
+	IPP_PIPELINED = 0x2,
+	IPP_TYPE_MAX = 0x4,
 };
 
 /**
@@ -395,6 +422,19 @@ enum drm_exynos_ipp_buf_type {
 	IPP_BUF_DEQUEUE,
 };
 
+/* flags of buffer enqueue, for IPP_PIPELINED m2m commands only. */
+enum drm_exynos_ipp_buf_flags {
+	/* @fence is a fence to wait for before the buffer is used. */
+	IPP_BUF_FLAG_IN_FENCE		= 1 << 0,
+	/*
+	 * return in @fence a fence signaled once the job writing to this
+	 * destination buffer is done.
+	 */
+	IPP_BUF_FLAG_OUT_FENCE		= 1 << 1,
+	IPP_BUF_FLAG_MASK		= IPP_BUF_FLAG_IN_FENCE |
+						IPP_BUF_FLAG_OUT_FENCE,
+};
+
 /**
  * A structure for ipp buffer operations.
  *
@@ -404,6 +444,8 @@ enum drm_exynos_ipp_buf_type {
  * @buf_id: id of buffer.
  * @handle: Y, Cb, Cr each planar handle.
  * @user_data: user data.
+ * @flags: IPP_BUF_FLAG_* flags.
+ * @fence: fence fd, see enum drm_exynos_ipp_buf_flags.
  */
 struct drm_exynos_ipp_queue_buf {
 	enum drm_exynos_ops_id	ops_id;
@@ -413,6 +455,8 @@ struct drm_exynos_ipp_queue_buf {
 	__u32	handle[EXYNOS_DRM_PLANAR_MAX];
 	__u32	reserved;
 	__u64	user_data;
+	__u32	flags;
+	__s32	fence;
 };
 
 enum drm_exynos_ipp_ctrl {
@@ -433,11 +477,74 @@ struct drm_exynos_ipp_cmd_ctrl {
 	__u32	prop_id;
 	enum drm_exynos_ipp_ctrl	ctrl;
 };
+
+/**
+ * A structure for the new state of a plane in an atomic commit.
+ *
+ * @plane_id: id of the plane to update.
+ * @fb_id: id of the framebuffer to show, 0 disables the plane.
+ * @crtc_x, @crtc_y, @crtc_w, @crtc_h: destination rectangle on the crtc.
+ * @src_x, @src_y, @src_w, @src_h: source rectangle in the framebuffer,
+ *	in 16.16 fixed point like drm_mode_set_plane.
+ */
+struct drm_exynos_atomic_plane {
+	__u32	plane_id;
+	__u32	fb_id;
+	__s32	crtc_x;
+	__s32	crtc_y;
+	__u32	crtc_w;
+	__u32	crtc_h;
+	__u32	src_x;
+	__u32	src_y;
+	__u32	src_w;
+	__u32	src_h;
+};
+
+/* indicate atomic commit flags. */
+enum e_drm_exynos_atomic_flags {
+	/* only check the new state, don't apply it. */
+	EXYNOS_DRM_ATOMIC_TEST_ONLY	= 1 << 0,
+	/* return before the commit is applied, -EBUSY if one is pending. */
+	EXYNOS_DRM_ATOMIC_NONBLOCK	= 1 << 1,
+	/* send a DRM_EVENT_FLIP_COMPLETE event once the commit is shown. */
+	EXYNOS_DRM_ATOMIC_EVENT		= 1 << 2,
+	/* return a sync fence signaled once the commit is shown. */
+	EXYNOS_DRM_ATOMIC_OUT_FENCE	= 1 << 3,
+	EXYNOS_DRM_ATOMIC_FLAGS_MASK	= EXYNOS_DRM_ATOMIC_TEST_ONLY |
+						EXYNOS_DRM_ATOMIC_NONBLOCK |
+						EXYNOS_DRM_ATOMIC_EVENT |
+						EXYNOS_DRM_ATOMIC_OUT_FENCE,
+};
+
+/**
+ * A structure for atomic commit of several planes of a crtc.
+ *
+ * All planes are updated together at the same vblank, and the buffers of
+ * the framebuffers are waited for in the kernel before that.
+ *
+ * @crtc_id: id of the crtc the planes are shown on.
+ * @flags: EXYNOS_DRM_ATOMIC_* flags.
+ * @count_planes: number of entries of @planes.
+ * @out_fence: returned fd of the fence signaled once the commit is shown,
+ *	or -1.
+ * @planes: user pointer to array of struct drm_exynos_atomic_plane.
+ * @user_data: user data passed back with the event.
+ */
+struct drm_exynos_atomic_commit {
+	__u32	crtc_id;
+	__u32	flags;
+	__u32	count_planes;
+	__s32	out_fence;
+	__u64	planes;
+	__u64	user_data;
+};
 #define DRM_EXYNOS_GEM_CREATE		0x00
 #define DRM_EXYNOS_GEM_MAP_OFFSET	0x01
 #define DRM_EXYNOS_GEM_MMAP		0x02
 #define DRM_EXYNOS_GEM_GET		0x04
+#define DRM_EXYNOS_GEM_USERPTR		0x05
 #define DRM_EXYNOS_VIDI_CONNECTION	0x07
+#define DRM_EXYNOS_ATOMIC_COMMIT	0x08
 
 /* temporary ioctl command. */
 #define DRM_EXYNOS_GEM_CACHE_OP		0x12
@@ -460,12 +567,18 @@ struct drm_exynos_ipp_cmd_ctrl {
 #define DRM_IOCTL_EXYNOS_GEM_GET	DRM_IOWR(DRM_COMMAND_BASE + \
 		DRM_EXYNOS_GEM_GET,	struct drm_exynos_gem_info)
 
+#define DRM_IOCTL_EXYNOS_GEM_USERPTR	DRM_IOWR(DRM_COMMAND_BASE + \
+		DRM_EXYNOS_GEM_USERPTR, struct drm_exynos_gem_userptr)
+
 #define DRM_IOCTL_EXYNOS_GEM_CACHE_OP	DRM_IOWR(DRM_COMMAND_BASE + \
 		DRM_EXYNOS_GEM_CACHE_OP, struct drm_exynos_gem_cache_op)
 
 #define DRM_IOCTL_EXYNOS_VIDI_CONNECTION	DRM_IOWR(DRM_COMMAND_BASE + \
 		DRM_EXYNOS_VIDI_CONNECTION, struct drm_exynos_vidi_connection)
 
+#define DRM_IOCTL_EXYNOS_ATOMIC_COMMIT	DRM_IOWR(DRM_COMMAND_BASE + \
+		DRM_EXYNOS_ATOMIC_COMMIT, struct drm_exynos_atomic_commit)
+
 #define DRM_IOCTL_EXYNOS_IPP_GET_PROPERTY	DRM_IOWR(DRM_COMMAND_BASE + \
 		DRM_EXYNOS_IPP_GET_PROPERTY, struct drm_exynos_ipp_prop_list)
 #define DRM_IOCTL_EXYNOS_IPP_SET_PROPERTY	DRM_IOWR(DRM_COMMAND_BASE + \
@@ -478,13 +591,17 @@ struct drm_exynos_ipp_cmd_ctrl {
 /* EXYNOS specific events */
 #define DRM_EXYNOS_IPP_EVENT		0x80000001
 
+/*
+ * @error: 0, or a negative error code if the job of the buffers could not
+ *	be run. only set for IPP_PIPELINED commands.
+ */
 struct drm_exynos_ipp_event {
 	struct drm_event	base;
 	__u64			user_data;
 	__u32			tv_sec;
 	__u32			tv_usec;
 	__u32			prop_id;
-	__u32			reserved;
+	__s32			error;
 	__u32			buf_id[EXYNOS_DRM_OPS_MAX];
 };
 
@@ -30,6 +30,7 @@
 #include <linux/list.h>
 #include <linux/dma-mapping.h>
 #include <linux/fs.h>
+#include <linux/reservation.h>
 
 struct device;
 struct dma_buf;
@@ -113,6 +114,8 @@ struct dma_buf_ops {
  * @ops: dma_buf_ops associated with this buffer object.
  * @priv: exporter specific private data for this buffer object.
  * @sync: sync object linked to this dma-buf
+ * @resv: reservation object holding the fences of the jobs accessing the
+ *	buffer, for implicit synchronization between devices.
  */
 struct dma_buf {
 	size_t size;
@@ -126,6 +129,7 @@ struct dma_buf {
 	void *priv;
 	void *priv_sgx;
 	void *sync;
+	struct reservation_object resv;
 };
 
 /**
@@ -148,6 +152,19 @@ struct dma_buf_attachment {
 	void *importer_priv;
 };
 
+/**
+ * struct dma_buf_fence_waiter - asynchronous wait for a dma-buf's producer
+ * @cb: fence callback, internal.
+ * @func: called once the exclusive fence is signaled. Can be called from
+ *	irq context.
+ * @priv: consumer specific data.
+ */
+struct dma_buf_fence_waiter {
+	struct fence_cb cb;
+	void (*func)(struct dma_buf_fence_waiter *waiter);
+	void *priv;
+};
+
 struct dma_buf_info {
 	unsigned long	size;
 	unsigned int	fence_supported;
@@ -224,6 +241,13 @@ void *dma_buf_vmap(struct dma_buf *);
 void dma_buf_vunmap(struct dma_buf *, void *vaddr);
 
 int is_dma_buf_file(struct file *);
+
+void dma_buf_set_excl_fence(struct dma_buf *dmabuf, struct fence *fence);
+struct fence *dma_buf_get_excl_fence(struct dma_buf *dmabuf);
+long dma_buf_wait_excl_fence(struct dma_buf *dmabuf, bool intr,
+			     signed long timeout);
+int dma_buf_wait_excl_fence_async(struct dma_buf *dmabuf,
+				  struct dma_buf_fence_waiter *waiter);
 #else
 
 static inline struct dma_buf_attachment *dma_buf_attach(struct dma_buf *dmabuf,
@@ -320,6 +344,28 @@ static inline void *dma_buf_vmap(struct dma_buf *dmabuf)
 static inline void dma_buf_vunmap(struct dma_buf *dmabuf, void *vaddr)
 {
 }
+
+static inline void dma_buf_set_excl_fence(struct dma_buf *dmabuf,
+					  struct fence *fence)
+{
+}
+
+static inline struct fence *dma_buf_get_excl_fence(struct dma_buf *dmabuf)
+{
+	return NULL;
+}
+
+static inline long dma_buf_wait_excl_fence(struct dma_buf *dmabuf, bool intr,
+					   signed long timeout)
+{
+	return timeout;
+}
+
+static inline int dma_buf_wait_excl_fence_async(struct dma_buf *dmabuf,
+					struct dma_buf_fence_waiter *waiter)
+{
+	return -ENOENT;
+}
 #endif /* CONFIG_DMA_SHARED_BUFFER */
 
 #endif /* __DMA_BUF_H__ */
@@ -29,6 +29,19 @@ enum dmabuf_sync_status {
 	DMABUF_SYNC_LOCKED,
 };
 
+/*
+ * Cache state of a dmabuf.
+ *
+ * @DMABUF_SYNC_CPU_DIRTY: CPU has written to the buffer since the last
+ *			cache clean.
+ * @DMABUF_SYNC_DEV_DIRTY: A device has written to the buffer since the last
+ *			cache invalidate.
+ */
+enum dmabuf_sync_cache_state {
+	DMABUF_SYNC_CPU_DIRTY	= 1 << 0,
+	DMABUF_SYNC_DEV_DIRTY	= 1 << 1,
+};
+
 /*
  * A structure for dmabuf_sync_reservation.
  *
@@ -62,6 +75,14 @@ enum dmabuf_sync_status {
  *	DMA_BUF_ACCESS_R | DMA_BUF_ACCESS_DMA -> DMA access for read.
  *	DMA_BUF_ACCESS_W | DMA_BUF_ACCESS_DMA -> DMA access for write.
  * @locked: Indicate whether a dmabuf object has been locked or not.
+ * @shared: Indicate that the current lock holder is a reader so that
+ *	other readers can join it instead of waiting for the lock.
+ * @write_waiters: The number of writers waiting for the lock. Readers
+ *	don't join a shared lock while a writer is waiting so that
+ *	writers are not starved.
+ * @cache_state: Which side may hold data the other side can't see yet.
+ *	DMABUF_SYNC_CPU_DIRTY -> CPU wrote, clean before DMA access.
+ *	DMABUF_SYNC_DEV_DIRTY -> DMA wrote, invalidate before CPU access.
  *
  */
 struct dmabuf_sync_reservation {
@@ -74,6 +95,9 @@ struct dmabuf_sync_reservation {
 	atomic_t		shared_cnt;
 	unsigned int		accessed_type;
 	unsigned int		locked;
+	unsigned int		shared;
+	unsigned int		write_waiters;
+	unsigned int		cache_state;
 #ifdef CONFIG_DMABUF_SYNC_PROFILE
 	void			*vma;
 	unsigned int		dirty;
@@ -75,6 +75,11 @@ extern void jbd2_free(void *ptr, size_t size);
 
 #define JBD2_MIN_JOURNAL_BLOCKS 1024
 
+/*
+ * Size of the fast commit area when the journal superblock does not give one.
+ */
+#define JBD2_DEFAULT_FAST_COMMIT_BLOCKS 256
+
 #ifdef __KERNEL__
 
 /**
@@ -241,7 +246,11 @@ typedef struct journal_superblock_s
 	__be32	s_max_trans_data;	/* Limit of data blocks per trans. */
 
 /* 0x0050 */
-	__u32	s_padding[44];
+	__u32	s_padding2;
+	__be32	s_num_fc_blks;		/* Blocks of the fast commit area */
+
+/* 0x0058 */
+	__u32	s_padding[42];
 
 /* 0x0100 */
 	__u8	s_users[16*48];		/* ids of all fs'es sharing the log */
@@ -263,13 +272,15 @@ typedef struct journal_superblock_s
 #define JBD2_FEATURE_INCOMPAT_REVOKE		0x00000001
 #define JBD2_FEATURE_INCOMPAT_64BIT		0x00000002
 #define JBD2_FEATURE_INCOMPAT_ASYNC_COMMIT	0x00000004
+#define JBD2_FEATURE_INCOMPAT_FAST_COMMIT	0x00000020
 
 /* Features known to this kernel version: */
 #define JBD2_KNOWN_COMPAT_FEATURES	JBD2_FEATURE_COMPAT_CHECKSUM
 #define JBD2_KNOWN_ROCOMPAT_FEATURES	0
 #define JBD2_KNOWN_INCOMPAT_FEATURES	(JBD2_FEATURE_INCOMPAT_REVOKE | \
 					JBD2_FEATURE_INCOMPAT_64BIT | \
-					JBD2_FEATURE_INCOMPAT_ASYNC_COMMIT)
+					JBD2_FEATURE_INCOMPAT_ASYNC_COMMIT | \
+					JBD2_FEATURE_INCOMPAT_FAST_COMMIT)
 
 #ifdef __KERNEL__
 
@@ -706,6 +717,14 @@ jbd2_time_diff(unsigned long start, unsigned long end)
  * @j_wbuf: array of buffer_heads for jbd2_journal_commit_transaction
  * @j_wbufsize: maximum number of buffer_heads allowed in j_wbuf, the
  *	number that will fit in j_blocksize
+ * @j_fc_first: first block of the fast commit area, equal to @j_last
+ * @j_fc_off: number of fast commit blocks used by the running transaction
+ * @j_fc_batch: first of the blocks taken by the fast commit being written
+ * @j_fc_wbuf: buffer_heads of the fast commit area handed out since the last
+ *	full commit, @j_fc_wbufsize of them
+ * @j_fc_wait: Wait queue for a fast commit or a full commit to finish
+ * @j_fc_replay_callback: called by recovery to replay the fast commit
+ *	records of the given transaction, the one after the last replayed
  * @j_last_sync_writer: most recent pid which did a synchronous write
  * @j_history: Buffer storing the transactions statistics history
  * @j_history_max: Maximum number of transactions in the statistics history
@@ -911,6 +930,21 @@ struct journal_s
 	struct buffer_head	**j_wbuf;
 	int			j_wbufsize;
 
+	/*
+	 * Fast commit area at the end of the journal, see journal.c.
+	 * [j_state_lock] for j_fc_off, owned by the fast commit in progress
+	 * otherwise.
+	 */
+	unsigned long		j_fc_first;
+	int			j_fc_off;
+	int			j_fc_batch;
+	struct buffer_head	**j_fc_wbuf;
+	int			j_fc_wbufsize;
+	wait_queue_head_t	j_fc_wait;
+
+	/* Replays the fast commit area, see recovery.c */
+	int			(*j_fc_replay_callback)(journal_t *, tid_t);
+
 	/*
 	 * this is the pid of hte last person to run a synchronous operation
 	 * through the journal
@@ -964,6 +998,10 @@ struct journal_s
 #define JBD2_ABORT_ON_SYNCDATA_ERR	0x040	/* Abort the journal on file
 						 * data write error in ordered
 						 * mode */
+#define JBD2_FAST_COMMIT_ONGOING	0x080	/* A fast commit is being
+						 * written */
+#define JBD2_FULL_COMMIT_ONGOING	0x100	/* The commit thread is at
+						 * work */
 
 /*
  * Function declarations for the journaling transaction and buffer
@@ -1191,6 +1229,13 @@ int jbd2_log_wait_commit(journal_t *journal, tid_t tid);
 int jbd2_log_do_checkpoint(journal_t *journal);
 int jbd2_trans_will_send_data_barrier(journal_t *journal, tid_t tid);
 
+/* Fast commits, see journal.c */
+int jbd2_fc_begin_commit(journal_t *journal, tid_t tid);
+struct buffer_head *jbd2_fc_get_buf(journal_t *journal);
+int jbd2_fc_end_commit(journal_t *journal);
+void jbd2_fc_end_commit_fallback(journal_t *journal);
+int jbd2_fc_read_block(journal_t *journal, int off, struct buffer_head **bhp);
+
 void __jbd2_log_wait_for_space(journal_t *journal);
 extern void __jbd2_journal_drop_transaction(journal_t *, transaction_t *);
 extern int jbd2_cleanup_journal_tail(journal_t *);
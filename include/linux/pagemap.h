@@ -456,6 +456,13 @@ int add_to_page_cache_locked(struct page *page, struct address_space *mapping,
 				pgoff_t index, gfp_t gfp_mask);
 int add_to_page_cache_lru(struct page *page, struct address_space *mapping,
 				pgoff_t index, gfp_t gfp_mask);
+unsigned add_to_page_cache_lru_batch(struct page **pages, unsigned nr_pages,
+				struct address_space *mapping, gfp_t gfp_mask);
+
+/*
+ * Number of readahead pages handed to add_to_page_cache_lru_batch() at once.
+ */
+#define PAGE_CACHE_BATCH	32
 extern void delete_from_page_cache(struct page *page);
 extern void __delete_from_page_cache(struct page *page);
 int replace_page_cache_page(struct page *old, struct page *new, gfp_t gfp_mask);
@@ -40,6 +40,7 @@
 #define _LINUX_RESERVATION_H
 
 #include <linux/mutex.h>
+#include <linux/slab.h>
 #include <linux/fence.h>
 
 extern struct ww_class reservation_ww_class;
@@ -72,7 +73,13 @@ reservation_object_fini(struct reservation_object *obj)
 	for (i = 0; i < obj->fence_shared_count; ++i)
 		fence_put(obj->fence_shared[i]);
 
+	kfree(obj->fence_shared);
+
 	ww_mutex_destroy(&obj->lock);
 }
 
+void reservation_object_add_excl_fence(struct reservation_object *obj,
+				       struct fence *fence);
+struct fence *reservation_object_get_excl(struct reservation_object *obj);
+
 #endif /* _LINUX_RESERVATION_H */
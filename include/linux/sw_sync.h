@@ -27,6 +27,11 @@ struct sw_sync_timeline {
 	struct	sync_timeline	obj;
 
 	u32			value;
+
+	/* the values in (error_from, error_to] signaled with error */
+	u32			error_from;
+	u32			error_to;
+	int			error;
 };
 
 struct sw_sync_pt {
@@ -37,6 +42,7 @@ struct sw_sync_pt {
 
 struct sw_sync_timeline *sw_sync_timeline_create(const char *name);
 void sw_sync_timeline_inc(struct sw_sync_timeline *obj, u32 inc);
+void sw_sync_timeline_fail(struct sw_sync_timeline *obj, u32 inc, int error);
 
 struct sync_pt *sw_sync_pt_create(struct sw_sync_timeline *obj, u32 value);
 
@@ -49,6 +49,9 @@ struct sync_fence;
  *			  to userspace by SYNC_IOC_FENCE_INFO.
  * @timeline_value_str: fill str with the value of the sync_timeline's counter
  * @pt_value_str:	fill str with the value of the sync_pt
+ * @ordered:		sync_pts on this timeline signal in @compare order;
+ *			  lets sync_timeline_signal() stop at the first
+ *			  sync_pt which has not signaled
  */
 struct sync_timeline_ops {
 	const char *driver_name;
@@ -84,6 +87,9 @@ struct sync_timeline_ops {
 
 	/* optional */
 	void (*pt_value_str)(struct sync_pt *pt, char *str, int size);
+
+	/* optional */
+	bool ordered;
 };
 
 /**
@@ -95,7 +101,8 @@ struct sync_timeline_ops {
  * @child_list_head:	list of children sync_pts for this sync_timeline
  * @child_list_lock:	lock protecting @child_list_head, destroyed, and
  *			  sync_pt.status
- * @active_list_head:	list of active (unsignaled/errored) sync_pts
+ * @active_list_head:	list of active (unsignaled/errored) sync_pts, in
+ *			  signaling order if ops->ordered is set
  * @sync_timeline_list:	membership in global sync_timeline_list
  */
 struct sync_timeline {
@@ -112,7 +119,9 @@ struct sync_timeline {
 	struct list_head	active_list_head;
 	spinlock_t		active_list_lock;
 
+#ifdef CONFIG_SYNC_DEBUG
 	struct list_head	sync_timeline_list;
+#endif
 };
 
 /**
@@ -148,8 +157,8 @@ struct sync_pt {
  * @file:		file representing this fence
  * @kref:		referenace count on fence.
  * @name:		name of sync_fence.  Useful for debugging
- * @pt_list_head:	list of sync_pts in ths fence.  immutable once fence
- *			  is created
+ * @pt_list_head:	list of sync_pts in ths fence, sorted by parent
+ *			  timeline.  immutable once fence is created
  * @waiter_list_head:	list of asynchronous waiters on this fence
  * @waiter_list_lock:	lock protecting @waiter_list_head and @status
  * @status:		1: signaled, 0:active, <0: error
@@ -171,7 +180,9 @@ struct sync_fence {
 
 	wait_queue_head_t	wq;
 
+#ifdef CONFIG_SYNC_DEBUG
 	struct list_head	sync_fence_list;
+#endif
 };
 
 struct sync_fence_waiter;
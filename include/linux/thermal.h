@@ -31,6 +31,7 @@
 
 struct thermal_zone_device;
 struct thermal_cooling_device;
+struct thermal_ipa;
 
 enum thermal_device_mode {
 	THERMAL_DEVICE_DISABLED = 0,
@@ -128,6 +129,12 @@ struct thermal_zone_device {
 	struct mutex lock;	/* protect cooling devices list */
 	struct list_head node;
 	struct delayed_work poll_queue;
+#ifdef CONFIG_THERMAL_EMULATION
+	unsigned long emul_temperature;	/* 0 when the sensor is used */
+#endif
+#ifdef CONFIG_CPU_THERMAL_IPA
+	struct thermal_ipa *ipa;	/* power allocator owning the trips */
+#endif
 };
 /* Adding event notification support elements */
 #define THERMAL_GENL_FAMILY_NAME                "thermal_event"
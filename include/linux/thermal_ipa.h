@@ -0,0 +1,122 @@
+/*
+ * include/linux/thermal_ipa.h
+ *
+ * Intelligent Power Allocation for the thermal framework
+ *
+ * Copyright (c) 2013 Samsung Electronics Co., Ltd.
+ *		http://www.samsung.com
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ */
+
+#ifndef __THERMAL_IPA_H__
+#define __THERMAL_IPA_H__
+
+#include <linux/list.h>
+#include <linux/math64.h>
+#include <linux/types.h>
+
+struct thermal_zone_device;
+struct ipa_actor;
+
+/*
+ * A power actor is a device heating the zone whose power can be capped,
+ * a CPU cluster, the GPU or the memory interface.  All powers are in mW.
+ *
+ * @get_requested_power: what the device would draw over the last period
+ *	if it was not capped, from its power model and its load
+ * @get_max_power: what it draws flat out at its highest operating point
+ * @set_power: cap the device so that at its current load it draws no more
+ *	than the given power.  The device keeps its lowest operating point
+ *	whatever the power, and at get_max_power or above drops the cap.
+ */
+struct ipa_actor_ops {
+	u32 (*get_requested_power)(struct ipa_actor *actor);
+	u32 (*get_max_power)(struct ipa_actor *actor);
+	int (*set_power)(struct ipa_actor *actor, u32 power);
+};
+
+/*
+ * @name: shown in the trace and in ipa_actors
+ * @ops: see above
+ * @weight: share of the budget relative to the other actors when all of
+ *	them ask for more than is available, IPA_WEIGHT_ONE for an equal share
+ */
+struct ipa_actor {
+	const char *name;
+	const struct ipa_actor_ops *ops;
+	u32 weight;
+
+	/* owned by the allocator */
+	struct list_head node;
+	u32 requested;
+	u32 max;
+	u32 weighted;
+	u32 granted;
+};
+
+#define IPA_WEIGHT_ONE		256
+
+/*
+ * Controller settings of a zone.  Temperatures are in millicelsius, powers
+ * in mW and the gains in mW per millicelsius, with IPA_FRAC_BITS fractional
+ * bits.  k_po, k_pu and k_i left at zero are derived from the sustainable
+ * power and the distance between the two temperatures.
+ *
+ * @switch_on_temp: the allocator starts capping above this
+ * @control_temp: the temperature the zone is held at
+ * @sustainable_power: what the zone dissipates at control_temp
+ * @k_po: proportional gain while below control_temp
+ * @k_pu: proportional gain while above control_temp
+ * @k_i: integral gain
+ * @k_d: derivative gain, on the change of the error over one period
+ * @integral_cutoff: the error is only integrated below this, in mC
+ */
+struct ipa_params {
+	unsigned long switch_on_temp;
+	unsigned long control_temp;
+	u32 sustainable_power;
+	s32 k_po;
+	s32 k_pu;
+	s32 k_i;
+	s32 k_d;
+	s32 integral_cutoff;
+};
+
+#define IPA_FRAC_BITS		10
+
+/*
+ * Dynamic power of a CMOS block, P = C * V^2 * f, in mW.  @coeff is C in
+ * uW/(MHz.V^2), @freq is in kHz and @uvolt in uV as the DVFS tables here
+ * keep them.
+ */
+static inline u32 ipa_dynamic_power(u32 coeff, u32 freq, u32 uvolt)
+{
+	u64 mv = uvolt / 1000;
+
+	return (u32)div_u64((u64)coeff * (freq / 1000) * mv * mv,
+			    1000000000);
+}
+
+#ifdef CONFIG_CPU_THERMAL_IPA
+int ipa_register_actor(struct ipa_actor *actor);
+void ipa_unregister_actor(struct ipa_actor *actor);
+
+int thermal_ipa_bind(struct thermal_zone_device *tz,
+		const struct ipa_params *params);
+void thermal_ipa_unbind(struct thermal_zone_device *tz);
+bool thermal_ipa_control(struct thermal_zone_device *tz, unsigned long temp);
+#else
+static inline int ipa_register_actor(struct ipa_actor *actor)
+{
+	return 0;
+}
+
+static inline void ipa_unregister_actor(struct ipa_actor *actor)
+{
+}
+#endif
+
+#endif /* __THERMAL_IPA_H__ */
@@ -274,6 +274,15 @@ enum v4l2_mpeg_video_h264_hierarchical_coding_type {
 					(V4L2_CID_MPEG_MFC_BASE + 49)
 #define V4L2_CID_MPEG_VIDEO_QOS_RATIO				\
 					(V4L2_CID_MPEG_MFC_BASE + 50)
+#define V4L2_CID_MPEG_VIDEO_SCHED_PRIORITY			\
+					(V4L2_CID_MPEG_MFC_BASE + 51)
+enum v4l2_mpeg_mfc_sched_priority {
+	V4L2_MPEG_MFC_SCHED_PRIO_REALTIME	= 0,
+	V4L2_MPEG_MFC_SCHED_PRIO_NORMAL		= 1,
+	V4L2_MPEG_MFC_SCHED_PRIO_BACKGROUND	= 2,
+};
+#define V4L2_CID_MPEG_VIDEO_FRAME_DEADLINE			\
+					(V4L2_CID_MPEG_MFC_BASE + 52)
 
 /* CIDs for VP8 encoding. Number gaps are for compatibility */
 #define V4L2_CID_MPEG_MFC70_VIDEO_VP8_VERSION			\
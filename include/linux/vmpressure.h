@@ -1,13 +1,37 @@
 #ifndef __LINUX_VMPRESSURE_H
 #define __LINUX_VMPRESSURE_H
 
+#include <linux/atomic.h>
 #include <linux/mutex.h>
+#include <linux/spinlock.h>
 #include <linux/list.h>
 #include <linux/workqueue.h>
 #include <linux/gfp.h>
 #include <linux/types.h>
 #include <linux/cgroup.h>
 
+/*
+ * Time-based memory pressure: how long at least one task of a group was
+ * stalled on memory (direct reclaim, reading from swap, dirty throttling).
+ * Entering and leaving a stall is lockless; only folding the running
+ * averages takes the lock, once per period.
+ */
+struct vmpressure_stall {
+	/* The number of tasks currently stalled. */
+	atomic_t nr_stalled;
+	/* When nr_stalled last went from zero to non-zero, in ns. */
+	atomic64_t stall_start;
+	/* Stall time accumulated by completed stalls, in ns. */
+	atomic64_t total;
+	/* The lock protects the averaging state below. */
+	spinlock_t avg_lock;
+	/* Start of the current averaging period and total at that time. */
+	u64 period_start;
+	u64 period_total;
+	/* Running 10s, 60s and 300s averages, in FIXED_1 percent. */
+	unsigned long avg[3];
+};
+
 struct vmpressure {
 	unsigned long scanned;
 	unsigned long reclaimed;
@@ -20,9 +44,19 @@ struct vmpressure {
 	struct mutex events_lock;
 
 	struct work_struct work;
+
+	struct vmpressure_stall stall;
 };
 
 struct mem_cgroup;
+struct seq_file;
+
+/* Stall accounting is there with or without memory cgroups */
+extern void vmpressure_stall_init(struct vmpressure_stall *st);
+extern void vmpressure_stall_show(struct seq_file *m,
+				  struct vmpressure_stall *st);
+extern struct mem_cgroup *vmpressure_stall_enter(void);
+extern void vmpressure_stall_leave(struct mem_cgroup *memcg);
 
 #ifdef CONFIG_CGROUP_MEM_RES_CTLR
 extern void vmpressure(gfp_t gfp, struct mem_cgroup *memcg,
@@ -38,6 +72,8 @@ extern int vmpressure_register_event(struct cgroup *cg, struct cftype *cft,
 				     const char *args);
 extern void vmpressure_unregister_event(struct cgroup *cg, struct cftype *cft,
 					struct eventfd_ctx *eventfd);
+extern int vmpressure_stall_read(struct cgroup *cg, struct cftype *cft,
+				 struct seq_file *m);
 #else
 static inline void vmpressure(gfp_t gfp, struct mem_cgroup *memcg,
 			      unsigned long scanned, unsigned long reclaimed) {}
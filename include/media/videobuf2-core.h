@@ -110,6 +110,24 @@ struct vb2_plane {
 	void			*mem_priv;
 	struct dma_buf		*dbuf;
 	unsigned int		dbuf_mapped;
+	struct fence		*fence;
+};
+
+/**
+ * struct vb2_map_cache - USERPTR/DMABUF plane memory kept acquired after
+ * the buffer it was acquired for moved on to other memory
+ * @lru:	cached planes, least recently released first
+ * @count:	number of cached planes
+ * @hits:	planes acquired from the cache
+ * @misses:	planes acquired from the allocator
+ * @evictions:	planes released from the cache to stay below the cap
+ */
+struct vb2_map_cache {
+	struct list_head	lru;
+	unsigned int		count;
+	unsigned long		hits;
+	unsigned long		misses;
+	unsigned long		evictions;
 };
 
 /**
@@ -310,6 +328,11 @@ struct vb2_ops {
  * @alloc_ctx:	memory type/allocator-specific contexts for each plane
  * @streaming:	current streaming state
  * @fileio:	file io emulator internal data, used only if emulator is active
+ * @fence_context: fence context of the fences published on the dma-bufs of
+ *		capture buffers while the driver fills them
+ * @fence_seqno: sequence number of the last published fence
+ * @map_cache:	attachments and mappings of USERPTR/DMABUF planes, reused
+ *		when the same memory is queued again at any buffer index
  */
 struct vb2_queue {
 	const char			*name;
@@ -343,6 +366,11 @@ struct vb2_queue {
 
 	struct sw_sync_timeline		*timeline;
 	u32				timeline_max;
+
+	unsigned int			fence_context;
+	unsigned int			fence_seqno;
+
+	struct vb2_map_cache		map_cache;
 };
 
 void *vb2_plane_vaddr(struct vb2_buffer *vb, unsigned int plane_no);
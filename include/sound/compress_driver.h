@@ -29,6 +29,7 @@
 #include <linux/sched.h>
 #include <sound/compress_offload.h>
 #include <sound/asound.h>
+#include <sound/core.h>
 #include <sound/pcm.h>
 
 struct snd_compr_ops;
@@ -70,6 +71,9 @@ struct snd_compr_runtime {
  * @runtime: pointer to runtime structure
  * @device: device pointer
  * @direction: stream direction, playback/recording
+ * @metadata_set: metadata set flag, true when set
+ * @next_track: has userspace signalled next track transition, true when set
+ * @partial_drain: undergoing partial drain for the stream, true when set
  * @private_data: pointer to DSP private data
  */
 struct snd_compr_stream {
@@ -78,6 +82,9 @@ struct snd_compr_stream {
 	struct snd_compr_runtime *runtime;
 	struct snd_compr *device;
 	enum snd_compr_direction direction;
+	bool metadata_set;
+	bool next_track;
+	bool partial_drain;
 	void *private_data;
 };
 
@@ -91,8 +98,12 @@ struct snd_compr_stream {
  * This can be called in during stream creation only to set codec params
  * and the stream properties
  * @get_params: retrieve the codec parameters, mandatory
- * @trigger: Trigger operations like start, pause, resume, drain, stop.
- * This callback is mandatory
+ * @set_metadata: Set the metadata of the track being written, Optional
+ * Needed for gapless playback; a stream without it cannot use next track
+ * @get_metadata: retrieve the metadata, Optional
+ * @trigger: Trigger operations like start, pause, resume, drain, stop,
+ * next track and partial drain.  Both drains are completed with
+ * snd_compr_drain_notify().  This callback is mandatory
  * @pointer: Retrieve current h/w pointer information. Mandatory
  * @copy: Copy the compressed data to/from userspace, Optional
  * Can't be implemented if DSP supports mmap
@@ -109,6 +120,10 @@ struct snd_compr_ops {
 			struct snd_compr_params *params);
 	int (*get_params)(struct snd_compr_stream *stream,
 			struct snd_codec *params);
+	int (*set_metadata)(struct snd_compr_stream *stream,
+			struct snd_compr_metadata *metadata);
+	int (*get_metadata)(struct snd_compr_stream *stream,
+			struct snd_compr_metadata *metadata);
 	int (*trigger)(struct snd_compr_stream *stream, int cmd);
 	int (*pointer)(struct snd_compr_stream *stream,
 			struct snd_compr_tstamp *tstamp);
@@ -164,4 +179,25 @@ static inline void snd_compr_fragment_elapsed(struct snd_compr_stream *stream)
 	wake_up(&stream->runtime->sleep);
 }
 
+/*
+ * Drain completion: the driver calls snd_compr_drain_notify() once the data
+ * of a drain has been played, or for a partial drain once the data of the
+ * current track has been consumed.  A drained stream goes back to SETUP, a
+ * partially drained one keeps running into the next track.
+ */
+static inline void snd_compr_drain_notify(struct snd_compr_stream *stream)
+{
+	if (snd_BUG_ON(!stream))
+		return;
+
+	if (stream->partial_drain) {
+		stream->runtime->state = SNDRV_PCM_STATE_RUNNING;
+		stream->partial_drain = false;
+	} else {
+		stream->runtime->state = SNDRV_PCM_STATE_SETUP;
+	}
+
+	wake_up(&stream->runtime->sleep);
+}
+
 #endif
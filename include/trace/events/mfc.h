@@ -0,0 +1,61 @@
+#undef TRACE_SYSTEM
+#define TRACE_SYSTEM mfc
+
+#if !defined(_TRACE_MFC_H) || defined(TRACE_HEADER_MULTI_READ)
+#define _TRACE_MFC_H
+
+#include <linux/types.h>
+#include <linux/tracepoint.h>
+
+/*
+ * A change of the bus/CPU frequency request of the codec.  level is the
+ * QoS table step plus one, 0 when the request is dropped; load is the
+ * measured macroblock rate it was chosen for.
+ */
+TRACE_EVENT(mfc_qos,
+
+	TP_PROTO(int level, int prev_level, unsigned int load,
+			unsigned int mb_rate, unsigned int kbps,
+			unsigned int freq_mfc, unsigned int freq_int,
+			unsigned int freq_mif),
+
+	TP_ARGS(level, prev_level, load, mb_rate, kbps,
+			freq_mfc, freq_int, freq_mif),
+
+	TP_STRUCT__entry(
+		__field(int,		level)
+		__field(int,		prev_level)
+		__field(unsigned int,	load)
+		__field(unsigned int,	mb_rate)
+		__field(unsigned int,	kbps)
+		__field(unsigned int,	freq_mfc)
+		__field(unsigned int,	freq_int)
+		__field(unsigned int,	freq_mif)
+	),
+
+	TP_fast_assign(
+		__entry->level = level;
+		__entry->prev_level = prev_level;
+		__entry->load = load;
+		__entry->mb_rate = mb_rate;
+		__entry->kbps = kbps;
+		__entry->freq_mfc = freq_mfc;
+		__entry->freq_int = freq_int;
+		__entry->freq_mif = freq_mif;
+	),
+
+	TP_printk("level=%d prev=%d load=%u mb/s=%u kbps=%u mfc=%u int=%u mif=%u",
+		__entry->level,
+		__entry->prev_level,
+		__entry->load,
+		__entry->mb_rate,
+		__entry->kbps,
+		__entry->freq_mfc,
+		__entry->freq_int,
+		__entry->freq_mif)
+);
+
+#endif /* _TRACE_MFC_H */
+
+/* This part must be outside protection */
+#include <trace/define_trace.h>
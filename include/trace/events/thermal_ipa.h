@@ -0,0 +1,83 @@
+#undef TRACE_SYSTEM
+#define TRACE_SYSTEM thermal_ipa
+
+#if !defined(_TRACE_THERMAL_IPA_H) || defined(TRACE_HEADER_MULTI_READ)
+#define _TRACE_THERMAL_IPA_H
+
+#include <linux/types.h>
+#include <linux/tracepoint.h>
+
+TRACE_EVENT(thermal_ipa_allocate,
+
+	TP_PROTO(int tz_id, unsigned long temp, s32 err, s32 p, s32 i, s32 d,
+		 u32 budget, u32 requested, u32 granted),
+
+	TP_ARGS(tz_id, temp, err, p, i, d, budget, requested, granted),
+
+	TP_STRUCT__entry(
+		__field(int,		tz_id)
+		__field(unsigned long,	temp)
+		__field(s32,		err)
+		__field(s32,		p)
+		__field(s32,		i)
+		__field(s32,		d)
+		__field(u32,		budget)
+		__field(u32,		requested)
+		__field(u32,		granted)
+	),
+
+	TP_fast_assign(
+		__entry->tz_id = tz_id;
+		__entry->temp = temp;
+		__entry->err = err;
+		__entry->p = p;
+		__entry->i = i;
+		__entry->d = d;
+		__entry->budget = budget;
+		__entry->requested = requested;
+		__entry->granted = granted;
+	),
+
+	TP_printk("thermal_zone_id=%d temp=%lu err=%d p=%d i=%d d=%d budget=%u requested=%u granted=%u",
+		__entry->tz_id,
+		__entry->temp,
+		__entry->err,
+		__entry->p,
+		__entry->i,
+		__entry->d,
+		__entry->budget,
+		__entry->requested,
+		__entry->granted)
+);
+
+TRACE_EVENT(thermal_ipa_actor,
+
+	TP_PROTO(const char *name, u32 requested, u32 max, u32 granted),
+
+	TP_ARGS(name, requested, max, granted),
+
+	TP_STRUCT__entry(
+		__string(	name,		name)
+		__field(u32,	requested)
+		__field(u32,	max)
+		__field(u32,	granted)
+	),
+
+	TP_fast_assign(
+		__assign_str(name, name);
+		__entry->requested = requested;
+		__entry->max = max;
+		__entry->granted = granted;
+	),
+
+	TP_printk("actor=%s requested=%u max=%u granted=%u",
+		__get_str(name),
+		__entry->requested,
+		__entry->max,
+		__entry->granted)
+);
+
+#endif /* _TRACE_THERMAL_IPA_H */
+
+/* This part must be outside protection */
+#include <trace/define_trace.h>
@@ -492,6 +492,117 @@ int add_to_page_cache_lru(struct page *page, struct address_space *mapping,
 }
 EXPORT_SYMBOL_GPL(add_to_page_cache_lru);
 
+/**
+ * add_to_page_cache_lru_batch - add a run of new pages to the pagecache
+ * @pages:	newly allocated pages, ->index set and in ascending order
+ * @nr_pages:	number of entries in @pages
+ * @mapping:	the address_space to add them to
+ * @gfp_mask:	page allocation mode
+ *
+ * Like add_to_page_cache_lru() on each page, but the radix-tree preload and
+ * the mapping's tree_lock are taken once per radix-tree leaf rather than
+ * once per page, and the pages reach the LRU through a private pagevec.
+ *
+ * Pages which were added are left locked with the caller's reference held.
+ * Pages which could not be added are released and their slot in @pages is
+ * set to NULL.  Returns the number of pages added.
+ */
+unsigned add_to_page_cache_lru_batch(struct page **pages, unsigned nr_pages,
+				struct address_space *mapping, gfp_t gfp_mask)
+{
+	struct pagevec lru_pvec;
+	unsigned added = 0;
+	unsigned i, j, k;
+
+	pagevec_init(&lru_pvec, 0);
+	for (i = 0; i < nr_pages; i = j) {
+		unsigned long leaf = pages[i]->index >> RADIX_TREE_MAP_SHIFT;
+		int error;
+
+		/*
+		 * Only the first insertion into a leaf can need new nodes,
+		 * so one preload covers every page sharing that leaf.
+		 */
+		for (j = i + 1; j < nr_pages; j++)
+			if ((pages[j]->index >> RADIX_TREE_MAP_SHIFT) != leaf)
+				break;
+
+		for (k = i; k < j; k++) {
+			struct page *page = pages[k];
+
+			VM_BUG_ON(PageSwapBacked(page));
+			__set_page_locked(page);
+			error = mem_cgroup_cache_charge(page, current->mm,
+						gfp_mask & GFP_RECLAIM_MASK);
+			if (error) {
+				__clear_page_locked(page);
+				page_cache_release(page);
+				pages[k] = NULL;
+			}
+		}
+
+		error = radix_tree_preload(gfp_mask & ~__GFP_HIGHMEM);
+		if (error) {
+			for (k = i; k < j; k++) {
+				struct page *page = pages[k];
+
+				if (!page)
+					continue;
+				mem_cgroup_uncharge_cache_page(page);
+				__clear_page_locked(page);
+				page_cache_release(page);
+				pages[k] = NULL;
+			}
+			continue;
+		}
+
+		spin_lock_irq(&mapping->tree_lock);
+		for (k = i; k < j; k++) {
+			struct page *page = pages[k];
+
+			if (!page)
+				continue;
+			page_cache_get(page);
+			page->mapping = mapping;
+			error = radix_tree_insert(&mapping->page_tree,
+						  page->index, page);
+			if (likely(!error)) {
+				mapping->nrpages++;
+				__inc_zone_page_state(page, NR_FILE_PAGES);
+			} else {
+				/* Leave page->index set: truncation relies upon it */
+				page->mapping = NULL;
+			}
+		}
+		spin_unlock_irq(&mapping->tree_lock);
+		radix_tree_preload_end();
+
+		for (k = i; k < j; k++) {
+			struct page *page = pages[k];
+
+			if (!page)
+				continue;
+			if (unlikely(!page->mapping)) {
+				mem_cgroup_uncharge_cache_page(page);
+				page_cache_release(page);
+				__clear_page_locked(page);
+				page_cache_release(page);
+				pages[k] = NULL;
+				continue;
+			}
+			ClearPageActive(page);
+			page_cache_get(page);
+			if (!pagevec_add(&lru_pvec, page))
+				__pagevec_lru_add_file(&lru_pvec);
+			added++;
+		}
+	}
+	pagevec_lru_add_file(&lru_pvec);
+
+	return added;
+}
+EXPORT_SYMBOL_GPL(add_to_page_cache_lru_batch);
+
 #ifdef CONFIG_NUMA
 struct page *__page_cache_alloc(gfp_t gfp)
 {
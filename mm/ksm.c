@@ -36,6 +36,7 @@
 #include <linux/hash.h>
 #include <linux/freezer.h>
 #include <linux/oom.h>
+#include <linux/math64.h>
 
 #include <asm/tlbflush.h>
 #include "internal.h"
@@ -129,6 +130,8 @@ struct stable_node {
  * @mm: the memory structure this rmap_item is pointing into
  * @address: the virtual address this rmap_item tracks (+ flags in low bits)
  * @oldchecksum: previous checksum of the page at that virtual address
+ * @volatility: how many consecutive scans found the checksum changed
+ * @skip_scans: number of upcoming scans which will pass over this item
  * @node: rb node of this rmap_item in the unstable tree
  * @head: pointer to stable_node heading this list in the stable tree
  * @hlist: link into hlist of rmap_items hanging off that stable_node
@@ -139,6 +142,8 @@ struct rmap_item {
 	struct mm_struct *mm;
 	unsigned long address;		/* + low bits used for flags below */
 	unsigned int oldchecksum;	/* when unstable */
+	unsigned char volatility;	/* when unstable */
+	unsigned char skip_scans;	/* when unstable */
 	union {
 		struct rb_node node;	/* when node of unstable tree */
 		struct {		/* when listed from stable tree */
@@ -189,6 +194,55 @@ static unsigned int ksm_thread_pages_to_scan = 100;
 /* Milliseconds ksmd should sleep between batches */
 static unsigned int ksm_thread_sleep_millisecs = 20;
 
+/* Whether to merge zero-filled pages with the shared zero page */
+static bool ksm_use_zero_pages __read_mostly;
+
+/* Checksum of an empty (zero-filled) page */
+static unsigned int zero_checksum __read_mostly;
+
+/* Whether to back off from pages whose checksum keeps changing */
+static bool ksm_volatile_skip __read_mostly;
+
+/*
+ * A page must be seen changing on this many consecutive scans before we
+ * start skipping it; each further change doubles the number of full scans
+ * skipped, up to 1 << KSM_VOLATILE_SHIFT_MAX.
+ */
+#define KSM_VOLATILE_THRESHOLD	2
+#define KSM_VOLATILE_SHIFT_MAX	4
+
+/* Whether ksmd should adapt its batch size to the achieved merge rate */
+static bool ksm_auto_scan;
+
+/* Batch size currently used by ksmd when ksm_auto_scan is set */
+static unsigned int ksm_auto_pages_to_scan = 100;
+
+/*
+ * Per mille of scanned pages which must be merged during a full scan for
+ * the auto-scan batch size to grow; a scan without merges shrinks it.
+ */
+#define KSM_AUTO_SCAN_GROW	10
+#define KSM_AUTO_SCAN_MIN	16
+
+/* The number of pages ksmd has scanned */
+static unsigned long ksm_pages_scanned;
+
+/* The number of pages passed over as volatile */
+static unsigned long ksm_pages_skipped;
+
+/* The number of pages freed by merging, including zero pages */
+static unsigned long ksm_pages_merged;
+
+/* The number of pages merged with the shared zero page */
+static unsigned long ksm_zero_pages_merged;
+
+/* CPU time spent by ksmd scanning, in nanoseconds */
+static u64 ksm_scan_cpu_ns;
+
+/* Snapshots of the counters above at the start of the current full scan */
+static unsigned long ksm_scan_start_scanned;
+static unsigned long ksm_scan_start_merged;
+
 #define KSM_RUN_STOP	0
 #define KSM_RUN_MERGE	1
 #define KSM_RUN_UNMERGE	2
@@ -773,6 +827,7 @@ static int replace_page(struct vm_area_struct *vma, struct page *page,
 	pud_t *pud;
 	pmd_t *pmd;
 	pte_t *ptep;
+	pte_t newpte;
 	spinlock_t *ptl;
 	unsigned long addr;
 	int err = -EFAULT;
@@ -800,12 +855,27 @@ static int replace_page(struct vm_area_struct *vma, struct page *page,
 		goto out;
 	}
 
-	get_page(kpage);
-	page_add_anon_rmap(kpage, vma, addr);
+	/*
+	 * The zero page is neither refcounted nor rmapped: map it just as
+	 * do_anonymous_page() would for a read fault.
+	 */
+	if (kpage != ZERO_PAGE(addr)) {
+		get_page(kpage);
+		page_add_anon_rmap(kpage, vma, addr);
+		newpte = mk_pte(kpage, vma->vm_page_prot);
+	} else {
+		newpte = pte_mkspecial(pfn_pte(page_to_pfn(kpage),
+					       vma->vm_page_prot));
+		/*
+		 * Nothing accounts the zero page at unmap, so drop the
+		 * count of the anonymous page it replaces here.
+		 */
+		dec_mm_counter(mm, MM_ANONPAGES);
+	}
 
 	flush_cache_page(vma, addr, pte_pfn(*ptep));
 	ptep_clear_flush(vma, addr, ptep);
-	set_pte_at_notify(mm, addr, ptep, mk_pte(kpage, vma->vm_page_prot));
+	set_pte_at_notify(mm, addr, ptep, newpte);
 
 	page_remove_rmap(page);
 	if (!page_mapped(page))
@@ -850,6 +920,7 @@ static int page_trans_compound_anon_split(struct page *page)
  * @vma: the vma that holds the pte pointing to page
  * @page: the PageAnon page that we want to replace with kpage
  * @kpage: the PageKsm page that we want to map instead of page,
+ *         the zero page when page is known to be empty,
  *         or NULL the first time when we want to use page as kpage.
  *
  * This function returns 0 if the pages were merged, -EFAULT otherwise.
@@ -1163,6 +1234,48 @@ static void stable_tree_append(struct rmap_item *rmap_item,
 		ksm_pages_shared++;
 }
 
+/*
+ * rmap_item_changed - note that the page's checksum changed since last scan.
+ *
+ * A page which keeps changing will not be merged any time soon, and just
+ * costs us a checksum on every pass: once it has been seen changing often
+ * enough, have ksm_do_scan() pass over it for an exponentially growing
+ * number of full scans.
+ */
+static void rmap_item_changed(struct rmap_item *rmap_item)
+{
+	unsigned int shift;
+
+	if (rmap_item->volatility < KSM_VOLATILE_THRESHOLD +
+				    KSM_VOLATILE_SHIFT_MAX)
+		rmap_item->volatility++;
+
+	if (!ksm_volatile_skip ||
+	    rmap_item->volatility < KSM_VOLATILE_THRESHOLD)
+		return;
+
+	shift = rmap_item->volatility - KSM_VOLATILE_THRESHOLD;
+	rmap_item->skip_scans = 1 << shift;
+}
+
+/*
+ * should_skip_rmap_item - check whether a volatile page may be passed over
+ * on this scan.  Pages already in the stable tree are never skipped.
+ */
+static bool should_skip_rmap_item(struct page *page,
+				  struct rmap_item *rmap_item)
+{
+	if (!ksm_volatile_skip || !rmap_item->skip_scans)
+		return false;
+	if (PageKsm(page))
+		return false;
+
+	rmap_item->skip_scans--;
+	remove_rmap_item_from_tree(rmap_item);
+	ksm_pages_skipped++;
+	return true;
+}
+
 /*
  * cmp_and_merge_page - first see if page can be merged into the stable tree;
  * if not, compare checksum to previous and if it's the same, see if page can
@@ -1174,9 +1287,11 @@ static void stable_tree_append(struct rmap_item *rmap_item,
  */
 static void cmp_and_merge_page(struct page *page, struct rmap_item *rmap_item)
 {
+	struct mm_struct *mm = rmap_item->mm;
 	struct rmap_item *tree_rmap_item;
 	struct page *tree_page = NULL;
 	struct stable_node *stable_node;
+	struct vm_area_struct *vma;
 	struct page *kpage;
 	unsigned int checksum;
 	int err;
@@ -1195,6 +1310,7 @@ static void cmp_and_merge_page(struct page *page, struct rmap_item *rmap_item)
 			lock_page(kpage);
 			stable_tree_append(rmap_item, page_stable_node(kpage));
 			unlock_page(kpage);
+			ksm_pages_merged++;
 		}
 		put_page(kpage);
 		return;
@@ -1209,8 +1325,32 @@ static void cmp_and_merge_page(struct page *page, struct rmap_item *rmap_item)
 	checksum = calc_checksum(page);
 	if (rmap_item->oldchecksum != checksum) {
 		rmap_item->oldchecksum = checksum;
+		rmap_item_changed(rmap_item);
 		return;
 	}
+	rmap_item->volatility = 0;
+
+	/*
+	 * Same checksum as an empty page: try to map the shared zero page
+	 * in its place, without involving either tree.  If the page turns
+	 * out not to be empty after all, carry on as for any other page.
+	 */
+	if (ksm_use_zero_pages && checksum == zero_checksum) {
+		err = -EFAULT;
+		down_read(&mm->mmap_sem);
+		if (!ksm_test_exit(mm)) {
+			vma = find_mergeable_vma(mm, rmap_item->address);
+			if (vma && !(vma->vm_flags & VM_LOCKED))
+				err = try_to_merge_one_page(vma, page,
+					ZERO_PAGE(rmap_item->address));
+		}
+		up_read(&mm->mmap_sem);
+		if (!err) {
+			ksm_zero_pages_merged++;
+			ksm_pages_merged++;
+			return;
+		}
+	}
 
 	tree_rmap_item =
 		unstable_tree_search_insert(rmap_item, page, &tree_page);
@@ -1231,6 +1371,7 @@ static void cmp_and_merge_page(struct page *page, struct rmap_item *rmap_item)
 			if (stable_node) {
 				stable_tree_append(tree_rmap_item, stable_node);
 				stable_tree_append(rmap_item, stable_node);
+				ksm_pages_merged++;
 			}
 			unlock_page(kpage);
 
@@ -1276,6 +1417,37 @@ static struct rmap_item *get_next_rmap_item(struct mm_slot *mm_slot,
 	return rmap_item;
 }
 
+/*
+ * ksm_auto_scan_update - adapt ksmd's batch size at the end of a full scan.
+ *
+ * When a full scan merged a worthwhile share of the pages it looked at,
+ * there is more to be gained by scanning faster; when it merged nothing,
+ * back off to save CPU.  The batch never exceeds pages_to_scan.
+ */
+static void ksm_auto_scan_update(void)
+{
+	unsigned long scanned = ksm_pages_scanned - ksm_scan_start_scanned;
+	unsigned long merged = ksm_pages_merged - ksm_scan_start_merged;
+	unsigned int nr_pages = ksm_auto_pages_to_scan;
+	unsigned int min_pages;
+
+	ksm_scan_start_scanned = ksm_pages_scanned;
+	ksm_scan_start_merged = ksm_pages_merged;
+
+	if (!ksm_auto_scan || !scanned)
+		return;
+
+	min_pages = min_t(unsigned int, KSM_AUTO_SCAN_MIN,
+			  ksm_thread_pages_to_scan);
+	if (merged * 1000 >= scanned * KSM_AUTO_SCAN_GROW)
+		nr_pages *= 2;
+	else if (!merged)
+		nr_pages /= 2;
+
+	ksm_auto_pages_to_scan = clamp_t(unsigned int, nr_pages, min_pages,
+					 ksm_thread_pages_to_scan);
+}
+
 static struct rmap_item *scan_get_next_rmap_item(struct page **page)
 {
 	struct mm_struct *mm;
@@ -1404,6 +1576,7 @@ next_mm:
 		goto next_mm;
 
 	ksm_scan.seqnr++;
+	ksm_auto_scan_update();
 	return NULL;
 }
 
@@ -1421,7 +1594,9 @@ static void ksm_do_scan(unsigned int scan_npages)
 		rmap_item = scan_get_next_rmap_item(&page);
 		if (!rmap_item)
 			return;
-		if (!PageKsm(page) || !in_stable_tree(rmap_item))
+		ksm_pages_scanned++;
+		if ((!PageKsm(page) || !in_stable_tree(rmap_item)) &&
+		    !should_skip_rmap_item(page, rmap_item))
 			cmp_and_merge_page(page, rmap_item);
 		put_page(page);
 	}
@@ -1439,8 +1614,13 @@ static int ksm_scan_thread(void *nothing)
 
 	while (!kthread_should_stop()) {
 		mutex_lock(&ksm_thread_mutex);
-		if (ksmd_should_run())
-			ksm_do_scan(ksm_thread_pages_to_scan);
+		if (ksmd_should_run()) {
+			u64 start = task_sched_runtime(current);
+
+			ksm_do_scan(ksm_auto_scan ? ksm_auto_pages_to_scan :
+				    ksm_thread_pages_to_scan);
+			ksm_scan_cpu_ns += task_sched_runtime(current) - start;
+		}
 		mutex_unlock(&ksm_thread_mutex);
 
 		try_to_freeze();
@@ -1971,6 +2151,135 @@ static ssize_t full_scans_show(struct kobject *kobj,
 }
 KSM_ATTR_RO(full_scans);
 
+static ssize_t use_zero_pages_show(struct kobject *kobj,
+				   struct kobj_attribute *attr, char *buf)
+{
+	return sprintf(buf, "%u\n", ksm_use_zero_pages);
+}
+
+static ssize_t use_zero_pages_store(struct kobject *kobj,
+				    struct kobj_attribute *attr,
+				    const char *buf, size_t count)
+{
+	int err;
+	unsigned long value;
+
+	err = strict_strtoul(buf, 10, &value);
+	if (err || value > 1)
+		return -EINVAL;
+
+	ksm_use_zero_pages = value;
+
+	return count;
+}
+KSM_ATTR(use_zero_pages);
+
+static ssize_t volatile_skip_show(struct kobject *kobj,
+				  struct kobj_attribute *attr, char *buf)
+{
+	return sprintf(buf, "%u\n", ksm_volatile_skip);
+}
+
+static ssize_t volatile_skip_store(struct kobject *kobj,
+				   struct kobj_attribute *attr,
+				   const char *buf, size_t count)
+{
+	int err;
+	unsigned long value;
+
+	err = strict_strtoul(buf, 10, &value);
+	if (err || value > 1)
+		return -EINVAL;
+
+	ksm_volatile_skip = value;
+
+	return count;
+}
+KSM_ATTR(volatile_skip);
+
+static ssize_t auto_scan_show(struct kobject *kobj,
+			      struct kobj_attribute *attr, char *buf)
+{
+	return sprintf(buf, "%u\n", ksm_auto_scan);
+}
+
+static ssize_t auto_scan_store(struct kobject *kobj,
+			       struct kobj_attribute *attr,
+			       const char *buf, size_t count)
+{
+	int err;
+	unsigned long value;
+
+	err = strict_strtoul(buf, 10, &value);
+	if (err || value > 1)
+		return -EINVAL;
+
+	mutex_lock(&ksm_thread_mutex);
+	if (value && !ksm_auto_scan)
+		ksm_auto_pages_to_scan = ksm_thread_pages_to_scan;
+	ksm_auto_scan = value;
+	mutex_unlock(&ksm_thread_mutex);
+
+	return count;
+}
+KSM_ATTR(auto_scan);
+
+static ssize_t auto_pages_to_scan_show(struct kobject *kobj,
+				       struct kobj_attribute *attr, char *buf)
+{
+	return sprintf(buf, "%u\n", ksm_auto_scan ? ksm_auto_pages_to_scan :
+				     ksm_thread_pages_to_scan);
+}
+KSM_ATTR_RO(auto_pages_to_scan);
+
+static ssize_t pages_scanned_show(struct kobject *kobj,
+				  struct kobj_attribute *attr, char *buf)
+{
+	return sprintf(buf, "%lu\n", ksm_pages_scanned);
+}
+KSM_ATTR_RO(pages_scanned);
+
+static ssize_t pages_skipped_show(struct kobject *kobj,
+				  struct kobj_attribute *attr, char *buf)
+{
+	return sprintf(buf, "%lu\n", ksm_pages_skipped);
+}
+KSM_ATTR_RO(pages_skipped);
+
+static ssize_t pages_merged_show(struct kobject *kobj,
+				 struct kobj_attribute *attr, char *buf)
+{
+	return sprintf(buf, "%lu\n", ksm_pages_merged);
+}
+KSM_ATTR_RO(pages_merged);
+
+static ssize_t zero_pages_merged_show(struct kobject *kobj,
+				      struct kobj_attribute *attr, char *buf)
+{
+	return sprintf(buf, "%lu\n", ksm_zero_pages_merged);
+}
+KSM_ATTR_RO(zero_pages_merged);
+
+static ssize_t scan_cpu_msecs_show(struct kobject *kobj,
+				   struct kobj_attribute *attr, char *buf)
+{
+	return sprintf(buf, "%llu\n",
+		       div_u64(ksm_scan_cpu_ns, NSEC_PER_MSEC));
+}
+KSM_ATTR_RO(scan_cpu_msecs);
+
+static ssize_t merges_per_cpu_sec_show(struct kobject *kobj,
+				       struct kobj_attribute *attr, char *buf)
+{
+	u64 msecs = div_u64(ksm_scan_cpu_ns, NSEC_PER_MSEC);
+	u64 rate = 0;
+
+	if (msecs)
+		rate = div64_u64((u64)ksm_pages_merged * MSEC_PER_SEC, msecs);
+	return sprintf(buf, "%llu\n", rate);
+}
+KSM_ATTR_RO(merges_per_cpu_sec);
+
 static struct attribute *ksm_attrs[] = {
 	&sleep_millisecs_attr.attr,
 	&pages_to_scan_attr.attr,
@@ -1980,6 +2289,16 @@ static struct attribute *ksm_attrs[] = {
 	&pages_unshared_attr.attr,
 	&pages_volatile_attr.attr,
 	&full_scans_attr.attr,
+	&use_zero_pages_attr.attr,
+	&volatile_skip_attr.attr,
+	&auto_scan_attr.attr,
+	&auto_pages_to_scan_attr.attr,
+	&pages_scanned_attr.attr,
+	&pages_skipped_attr.attr,
+	&pages_merged_attr.attr,
+	&zero_pages_merged_attr.attr,
+	&scan_cpu_msecs_attr.attr,
+	&merges_per_cpu_sec_attr.attr,
 	NULL,
 };
 
@@ -1994,6 +2313,8 @@ static int __init ksm_init(void)
 	struct task_struct *ksm_thread;
 	int err;
 
+	zero_checksum = calc_checksum(ZERO_PAGE(0));
+
 	err = ksm_slab_init();
 	if (err)
 		goto out;
@@ -1544,6 +1544,7 @@ static unsigned long mem_cgroup_reclaim(struct mem_cgroup *memcg,
 					gfp_t gfp_mask,
 					unsigned long flags)
 {
+	struct mem_cgroup *stall_memcg = NULL;
 	unsigned long total = 0;
 	bool noswap = false;
 	int loop;
@@ -1553,6 +1554,10 @@ static unsigned long mem_cgroup_reclaim(struct mem_cgroup *memcg,
 	if (!(flags & MEM_CGROUP_RECLAIM_SHRINK) && memcg->memsw_is_minimum)
 		noswap = true;
 
+	/* Limit shrinking is requested by userspace, not a stall */
+	if (!(flags & MEM_CGROUP_RECLAIM_SHRINK))
+		stall_memcg = vmpressure_stall_enter();
+
 	for (loop = 0; loop < MEM_CGROUP_MAX_RECLAIM_LOOPS; loop++) {
 		if (loop)
 			drain_all_stock_async(memcg);
@@ -1573,6 +1578,9 @@ static unsigned long mem_cgroup_reclaim(struct mem_cgroup *memcg,
 		if (loop && !total)
 			break;
 	}
+
+	if (!(flags & MEM_CGROUP_RECLAIM_SHRINK))
+		vmpressure_stall_leave(stall_memcg);
 	return total;
 }
 
@@ -4757,6 +4765,10 @@ static struct cftype mem_cgroup_files[] = {
 		.register_event = vmpressure_register_event,
 		.unregister_event = vmpressure_unregister_event,
 	},
+	{
+		.name = "pressure_stall",
+		.read_seq_string = vmpressure_stall_read,
+	},
 #ifdef CONFIG_NUMA
 	{
 		.name = "numa_stat",
@@ -52,6 +52,7 @@
 #include <linux/init.h>
 #include <linux/writeback.h>
 #include <linux/memcontrol.h>
+#include <linux/vmpressure.h>
 #include <linux/mmu_notifier.h>
 #include <linux/kallsyms.h>
 #include <linux/swapops.h>
@@ -2942,6 +2943,8 @@ static int do_swap_page(struct mm_struct *mm, struct vm_area_struct *vma,
 	pte_t pte;
 	int locked;
 	struct mem_cgroup *ptr;
+	struct mem_cgroup *stall_memcg = NULL;
+	bool stalled = false;
 	int exclusive = 0;
 	int ret = 0;
 
@@ -2963,6 +2966,9 @@ static int do_swap_page(struct mm_struct *mm, struct vm_area_struct *vma,
 	delayacct_set_flag(DELAYACCT_PF_SWAPIN);
 	page = lookup_swap_cache(entry);
 	if (!page) {
+		/* A swap cache hit is no stall, reading from swap is */
+		stall_memcg = vmpressure_stall_enter();
+		stalled = true;
 		grab_swap_token(mm); /* Contend for token _before_ read-in */
 		page = swapin_readahead(entry,
 					GFP_HIGHUSER_MOVABLE, vma, address);
@@ -2975,6 +2981,7 @@ static int do_swap_page(struct mm_struct *mm, struct vm_area_struct *vma,
 			if (likely(pte_same(*page_table, orig_pte)))
 				ret = VM_FAULT_OOM;
 			delayacct_clear_flag(DELAYACCT_PF_SWAPIN);
+			vmpressure_stall_leave(stall_memcg);
 			goto unlock;
 		}
 
@@ -2994,6 +3001,8 @@ static int do_swap_page(struct mm_struct *mm, struct vm_area_struct *vma,
 
 	locked = lock_page_or_retry(page, mm, flags);
 	delayacct_clear_flag(DELAYACCT_PF_SWAPIN);
+	if (stalled)
+		vmpressure_stall_leave(stall_memcg);
 	if (!locked) {
 		ret |= VM_FAULT_RETRY;
 		goto out_release;
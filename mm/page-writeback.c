@@ -34,6 +34,7 @@
 #include <linux/syscalls.h>
 #include <linux/buffer_head.h> /* __set_page_dirty_buffers */
 #include <linux/pagevec.h>
+#include <linux/vmpressure.h>
 #include <trace/events/writeback.h>
 
 /*
@@ -1194,6 +1195,7 @@ static void balance_dirty_pages(struct address_space *mapping,
 	unsigned long dirty_ratelimit;
 	unsigned long pos_ratio;
 	struct backing_dev_info *bdi = mapping->backing_dev_info;
+	struct mem_cgroup *stall_memcg;
 	unsigned long start_time = jiffies;
 
 	for (;;) {
@@ -1342,8 +1344,10 @@ pause:
 					  period,
 					  pause,
 					  start_time);
+		stall_memcg = vmpressure_stall_enter();
 		__set_current_state(TASK_KILLABLE);
 		io_schedule_timeout(pause);
+		vmpressure_stall_leave(stall_memcg);
 
 		current->dirty_paused_when = now + pause;
 		current->nr_dirtied = 0;
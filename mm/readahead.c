@@ -111,6 +111,7 @@ static int read_pages(struct address_space *mapping, struct file *filp,
 {
 	struct blk_plug plug;
 	unsigned page_idx;
+	unsigned nr;
 	int ret;
 
 	blk_start_plug(&plug);
@@ -122,14 +123,22 @@ static int read_pages(struct address_space *mapping, struct file *filp,
 		goto out;
 	}
 
-	for (page_idx = 0; page_idx < nr_pages; page_idx++) {
-		struct page *page = list_to_page(pages);
-		list_del(&page->lru);
-		if (!add_to_page_cache_lru(page, mapping,
-					page->index, GFP_KERNEL)) {
-			mapping->a_ops->readpage(filp, page);
+	for (page_idx = 0; page_idx < nr_pages; page_idx += nr) {
+		struct page *batch[PAGE_CACHE_BATCH];
+		unsigned i;
+
+		nr = min_t(unsigned, nr_pages - page_idx, PAGE_CACHE_BATCH);
+		for (i = 0; i < nr; i++) {
+			batch[i] = list_to_page(pages);
+			list_del(&batch[i]->lru);
+		}
+		add_to_page_cache_lru_batch(batch, nr, mapping, GFP_KERNEL);
+		for (i = 0; i < nr; i++) {
+			if (!batch[i])
+				continue;
+			mapping->a_ops->readpage(filp, batch[i]);
+			page_cache_release(batch[i]);
 		}
-		page_cache_release(page);
 	}
 	ret = 0;
 
@@ -139,6 +148,48 @@ out:
 	return ret;
 }
 
+/*
+ * Largest allocation order ra_alloc_pages() will try: readahead pages are
+ * carved out of order-RA_ALLOC_ORDER blocks when the window allows, so the
+ * page allocator is entered once per block rather than once per page.
+ */
+#define RA_ALLOC_ORDER	3
+
+/*
+ * ra_alloc_pages - allocate up to @nr_pages pages for readahead into @pages
+ *
+ * Opportunistically takes one higher-order block and splits it, falling
+ * back to a single order-0 page when that fails: readahead must never push
+ * the allocator into reclaim or compaction for the sake of batching.
+ *
+ * Returns the number of pages allocated, 0 on failure.
+ */
+static unsigned ra_alloc_pages(struct address_space *mapping,
+			       struct page **pages, unsigned nr_pages)
+{
+	unsigned order = min_t(unsigned, RA_ALLOC_ORDER, ilog2(nr_pages));
+	struct page *page;
+	unsigned i;
+
+	if (order) {
+		page = alloc_pages(mapping_gfp_mask(mapping) | __GFP_COLD |
+				   __GFP_NORETRY | __GFP_NOWARN |
+				   __GFP_NOMEMALLOC, order);
+		if (page) {
+			split_page(page, order);
+			for (i = 0; i < (1U << order); i++)
+				pages[i] = page + i;
+			return 1U << order;
+		}
+	}
+
+	page = page_cache_alloc_readahead(mapping);
+	if (!page)
+		return 0;
+	pages[0] = page;
+	return 1;
+}
+
 /*
  * __do_page_cache_readahead() actually reads a chunk of disk.  It allocates all
  * the pages first, then submits them all for I/O. This avoids the very bad
@@ -154,6 +205,8 @@ __do_page_cache_readahead(struct address_space *mapping, struct file *filp,
 {
 	struct inode *inode = mapping->host;
 	struct page *page;
+	struct page *spare[1 << RA_ALLOC_ORDER];
+	unsigned nr_spare = 0;
 	unsigned long end_index;	/* The last page we want to read */
 	LIST_HEAD(page_pool);
 	int page_idx;
@@ -180,9 +233,15 @@ __do_page_cache_readahead(struct address_space *mapping, struct file *filp,
 		if (page)
 			continue;
 
-		page = page_cache_alloc_readahead(mapping);
-		if (!page)
-			break;
+		if (!nr_spare) {
+			unsigned long nr = min(nr_to_read - page_idx,
+					       end_index - page_offset + 1);
+
+			nr_spare = ra_alloc_pages(mapping, spare, nr);
+			if (!nr_spare)
+				break;
+		}
+		page = spare[--nr_spare];
 		page->index = page_offset;
 		list_add(&page->lru, &page_pool);
 		if (page_idx == nr_to_read - lookahead_size)
@@ -190,6 +249,10 @@ __do_page_cache_readahead(struct address_space *mapping, struct file *filp,
 		ret++;
 	}
 
+	/* Pages left over when the window ran into already cached pages */
+	while (nr_spare)
+		page_cache_release(spare[--nr_spare]);
+
 	/*
 	 * Now start the IO.  We ignore I/O errors - if the page is not
 	 * uptodate then the caller will launch readpage again, and
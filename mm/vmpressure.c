@@ -22,6 +22,7 @@
 #include <linux/eventfd.h>
 #include <linux/swap.h>
 #include <linux/printk.h>
+#include <linux/seq_file.h>
 #include <linux/vmpressure.h>
 
 /*
@@ -359,6 +360,25 @@ void vmpressure_unregister_event(struct cgroup *cg, struct cftype *cft,
 	mutex_unlock(&vmpr->events_lock);
 }
 
+/**
+ * vmpressure_stall_read() - Show a cgroup's memory stall averages
+ * @cg:		cgroup to report on
+ * @cft:	cgroup control files handle
+ * @m:		seq_file to print into
+ *
+ * Prints the share of time at least one task of @cg was stalled on memory
+ * over the last 10, 60 and 300 seconds, and the total stall time in us.
+ *
+ * This function should not be used directly, just pass it to (struct
+ * cftype).read_seq_string.
+ */
+int vmpressure_stall_read(struct cgroup *cg, struct cftype *cft,
+			  struct seq_file *m)
+{
+	vmpressure_stall_show(m, &cg_to_vmpressure(cg)->stall);
+	return 0;
+}
+
 /**
  * vmpressure_init() - Initialize vmpressure control structure
  * @vmpr:	Structure to be initialized
@@ -372,4 +392,5 @@ void vmpressure_init(struct vmpressure *vmpr)
 	mutex_init(&vmpr->events_lock);
 	INIT_LIST_HEAD(&vmpr->events);
 	INIT_WORK(&vmpr->work, vmpressure_work_fn);
+	vmpressure_stall_init(&vmpr->stall);
 }
@@ -0,0 +1,247 @@
+/*
+ * Memory stall accounting
+ *
+ * The time during which at least one task waited on memory: in direct
+ * reclaim, reading a page back from swap or throttled on dirty memory.
+ * It is kept for the whole system in /proc/pressure/memory and, with
+ * memory cgroups, for each group in memory.pressure_stall.
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 2 as published
+ * by the Free Software Foundation.
+ */
+
+#include <linux/fs.h>
+#include <linux/init.h>
+#include <linux/kernel.h>
+#include <linux/ktime.h>
+#include <linux/math64.h>
+#include <linux/memcontrol.h>
+#include <linux/proc_fs.h>
+#include <linux/sched.h>
+#include <linux/seq_file.h>
+#include <linux/vmpressure.h>
+
+/*
+ * Stall time is folded into running averages once per period, the same
+ * way the scheduler maintains the load average.  The decay factors are
+ * 1/exp(period/10s), 1/exp(period/60s) and 1/exp(period/300s) in FIXED_1
+ * fixed point.  Groups nobody looked at for longer than
+ * VMSTALL_MAX_PERIODS periods have effectively forgotten their history.
+ */
+#define VMSTALL_PERIOD		(2 * NSEC_PER_SEC)
+#define VMSTALL_MAX_PERIODS	600
+static const unsigned long vmstall_exp[] = { 1677, 1981, 2034 };
+
+#define LOAD_INT(x) ((x) >> FSHIFT)
+#define LOAD_FRAC(x) LOAD_INT(((x) & (FIXED_1-1)) * 100)
+
+/* Stall accounting of the whole system, whether or not memcg is enabled */
+static struct vmpressure_stall system_stall = {
+	.nr_stalled = ATOMIC_INIT(0),
+	.stall_start = ATOMIC64_INIT(0),
+	.total = ATOMIC64_INIT(0),
+	.avg_lock = __SPIN_LOCK_UNLOCKED(system_stall.avg_lock),
+};
+
+static u64 vmstall_total(struct vmpressure_stall *st, u64 now)
+{
+	u64 total = atomic64_read(&st->total);
+	u64 start = atomic64_read(&st->stall_start);
+
+	/* The stall in progress, if any; @start may be racing with us */
+	if (atomic_read(&st->nr_stalled) && now > start)
+		total += now - start;
+	return total;
+}
+
+/* Called with st->avg_lock held */
+static void vmstall_update_avgs(struct vmpressure_stall *st, u64 now)
+{
+	u64 elapsed = now - st->period_start;
+	unsigned long periods;
+	unsigned long sample;
+	u64 total;
+	int i;
+
+	if (elapsed < VMSTALL_PERIOD)
+		return;
+
+	/* Share of the elapsed time spent stalled, in FIXED_1 percent */
+	total = vmstall_total(st, now);
+	if (total < st->period_total)
+		total = st->period_total;
+	sample = div64_u64((total - st->period_total) * 100,
+			   elapsed >> FSHIFT);
+	sample = min(sample, 100UL * FIXED_1);
+
+	periods = min_t(u64, div64_u64(elapsed, VMSTALL_PERIOD),
+			VMSTALL_MAX_PERIODS);
+	for (i = 0; i < ARRAY_SIZE(vmstall_exp); i++) {
+		unsigned long avg = st->avg[i];
+		unsigned long n;
+
+		for (n = 0; n < periods; n++) {
+			avg = avg * vmstall_exp[i] +
+			      sample * (FIXED_1 - vmstall_exp[i]);
+			avg >>= FSHIFT;
+		}
+		st->avg[i] = avg;
+	}
+
+	st->period_start = now;
+	st->period_total = total;
+}
+
+/*
+ * Only the task taking nr_stalled from zero sets stall_start, and only the
+ * one taking it back to zero adds the stall to the total.  stall_start is
+ * read before the decrement: until then the count keeps any other task
+ * from starting a new stall under us.
+ */
+static void vmstall_change(struct vmpressure_stall *st, bool enter, u64 now)
+{
+	u64 start;
+
+	if (enter) {
+		if (atomic_inc_return(&st->nr_stalled) == 1)
+			atomic64_set(&st->stall_start, now);
+	} else {
+		start = atomic64_read(&st->stall_start);
+		if (atomic_dec_and_test(&st->nr_stalled) && now > start)
+			atomic64_add(now - start, &st->total);
+	}
+
+	/* Whoever comes first after a period folds it, nobody waits */
+	if (now - ACCESS_ONCE(st->period_start) >= VMSTALL_PERIOD &&
+	    spin_trylock(&st->avg_lock)) {
+		vmstall_update_avgs(st, now);
+		spin_unlock(&st->avg_lock);
+	}
+}
+
+static void vmstall_account(struct mem_cgroup *memcg, bool enter)
+{
+	u64 now = ktime_to_ns(ktime_get());
+
+	vmstall_change(&system_stall, enter, now);
+#ifdef CONFIG_CGROUP_MEM_RES_CTLR
+	for (; memcg; memcg = parent_mem_cgroup(memcg))
+		vmstall_change(&memcg_to_vmpressure(memcg)->stall, enter, now);
+#endif
+}
+
+/**
+ * vmpressure_stall_enter() - Mark the current task as stalled on memory
+ *
+ * This function should be called when a task is about to wait for memory
+ * to become available: direct reclaim, reading a page back from swap, or
+ * being throttled on dirty memory.  The time until the matching
+ * vmpressure_stall_leave() is accounted to the system and to the task's
+ * memory cgroup and its ancestors.
+ *
+ * Returns the memory cgroup to pass to vmpressure_stall_leave().
+ */
+struct mem_cgroup *vmpressure_stall_enter(void)
+{
+	struct mem_cgroup *memcg = NULL;
+
+#ifdef CONFIG_CGROUP_MEM_RES_CTLR
+	if (!mem_cgroup_disabled())
+		memcg = try_get_mem_cgroup_from_mm(current->mm);
+#endif
+	vmstall_account(memcg, true);
+
+	return memcg;
+}
+
+/**
+ * vmpressure_stall_leave() - Mark the end of a memory stall
+ * @memcg:	memory cgroup returned by vmpressure_stall_enter()
+ *
+ * This function does not return any value.
+ */
+void vmpressure_stall_leave(struct mem_cgroup *memcg)
+{
+	vmstall_account(memcg, false);
+#ifdef CONFIG_CGROUP_MEM_RES_CTLR
+	if (memcg)
+		css_put(vmpressure_to_css(memcg_to_vmpressure(memcg)));
+#endif
+}
+
+/**
+ * vmpressure_stall_show() - Print stall averages
+ * @m:		seq_file to print into
+ * @st:		stall accounting to report on
+ *
+ * Prints the share of time at least one task was stalled on memory over
+ * the last 10, 60 and 300 seconds, and the total stall time in us.
+ */
+void vmpressure_stall_show(struct seq_file *m, struct vmpressure_stall *st)
+{
+	u64 now = ktime_to_ns(ktime_get());
+	unsigned long avg[ARRAY_SIZE(vmstall_exp)];
+	u64 total;
+
+	spin_lock(&st->avg_lock);
+	vmstall_update_avgs(st, now);
+	memcpy(avg, st->avg, sizeof(avg));
+	spin_unlock(&st->avg_lock);
+	total = vmstall_total(st, now);
+
+	seq_printf(m, "some avg10=%lu.%02lu avg60=%lu.%02lu avg300=%lu.%02lu "
+		   "total=%llu\n",
+		   LOAD_INT(avg[0]), LOAD_FRAC(avg[0]),
+		   LOAD_INT(avg[1]), LOAD_FRAC(avg[1]),
+		   LOAD_INT(avg[2]), LOAD_FRAC(avg[2]),
+		   div_u64(total, NSEC_PER_USEC));
+}
+
+/**
+ * vmpressure_stall_init() - Initialize stall accounting
+ * @st:		Structure to be initialized
+ */
+void vmpressure_stall_init(struct vmpressure_stall *st)
+{
+	atomic_set(&st->nr_stalled, 0);
+	atomic64_set(&st->stall_start, 0);
+	atomic64_set(&st->total, 0);
+	spin_lock_init(&st->avg_lock);
+	st->period_start = ktime_to_ns(ktime_get());
+	st->period_total = 0;
+	memset(st->avg, 0, sizeof(st->avg));
+}
+
+static int vmstall_proc_show(struct seq_file *m, void *v)
+{
+	vmpressure_stall_show(m, &system_stall);
+	return 0;
+}
+
+static int vmstall_proc_open(struct inode *inode, struct file *file)
+{
+	return single_open(file, vmstall_proc_show, NULL);
+}
+
+static const struct file_operations vmstall_proc_fops = {
+	.open		= vmstall_proc_open,
+	.read		= seq_read,
+	.llseek		= seq_lseek,
+	.release	= single_release,
+};
+
+static int __init vmstall_init(void)
+{
+	struct proc_dir_entry *dir;
+
+	system_stall.period_start = ktime_to_ns(ktime_get());
+
+	dir = proc_mkdir("pressure", NULL);
+	if (!dir)
+		return -ENOMEM;
+	if (!proc_create("memory", S_IRUGO, dir, &vmstall_proc_fops))
+		return -ENOMEM;
+	return 0;
+}
+module_init(vmstall_init);
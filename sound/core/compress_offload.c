@@ -66,7 +66,9 @@ struct snd_compr_file {
  * SNDRV_PCM_STATE_RUNNING: When stream has been started and is
  *	decoding/encoding and rendering/capturing data.
  * SNDRV_PCM_STATE_DRAINING: When stream is draining current data. This is done
- *	by calling SNDRV_COMPRESS_DRAIN.
+ *	by calling SNDRV_COMPRESS_DRAIN, or SNDRV_COMPRESS_PARTIAL_DRAIN for
+ *	the data of the current track; the driver ends it with
+ *	snd_compr_drain_notify().
  * SNDRV_PCM_STATE_PAUSED: When stream is paused. This is done by calling
  *	SNDRV_COMPRESS_PAUSE. It can be stopped or resumed by calling
  *	SNDRV_COMPRESS_STOP or SNDRV_COMPRESS_RESUME respectively.
@@ -133,7 +135,7 @@ static int snd_compr_open(struct inode *inode, struct file *f)
 		kfree(data);
 	}
 	snd_card_unref(compr->card);
-	return 0;
+	return ret;
 }
 
 static int snd_compr_free(struct inode *inode, struct file *f)
@@ -341,11 +343,8 @@ static unsigned int snd_compr_poll(struct file *f, poll_table *wait)
 	/* check if we have at least one fragment to fill */
 	switch (stream->runtime->state) {
 	case SNDRV_PCM_STATE_DRAINING:
-		/* stream has been woken up after drain is complete
-		 * draining done so set stream state to stopped
-		 */
+		/* the drain ioctl is waiting for snd_compr_drain_notify() */
 		retval = snd_compr_get_poll(stream);
-		stream->runtime->state = SNDRV_PCM_STATE_SETUP;
 		break;
 	case SNDRV_PCM_STATE_RUNNING:
 	case SNDRV_PCM_STATE_PREPARED:
@@ -490,6 +489,47 @@ out:
 	return retval;
 }
 
+static int
+snd_compr_set_metadata(struct snd_compr_stream *stream, unsigned long arg)
+{
+	struct snd_compr_metadata metadata;
+	int retval;
+
+	if (!stream->ops->set_metadata)
+		return -ENXIO;
+
+	if (copy_from_user(&metadata, (void __user *)arg, sizeof(metadata)))
+		return -EFAULT;
+
+	retval = stream->ops->set_metadata(stream, &metadata);
+	if (!retval)
+		stream->metadata_set = true;
+
+	return retval;
+}
+
+static int
+snd_compr_get_metadata(struct snd_compr_stream *stream, unsigned long arg)
+{
+	struct snd_compr_metadata metadata;
+	int retval;
+
+	if (!stream->ops->get_metadata)
+		return -ENXIO;
+
+	if (copy_from_user(&metadata, (void __user *)arg, sizeof(metadata)))
+		return -EFAULT;
+
+	retval = stream->ops->get_metadata(stream, &metadata);
+	if (retval)
+		return retval;
+
+	if (copy_to_user((void __user *)arg, &metadata, sizeof(metadata)))
+		return -EFAULT;
+
+	return 0;
+}
+
 static inline int
 snd_compr_tstamp(struct snd_compr_stream *stream, unsigned long arg)
 {
@@ -547,24 +587,104 @@ static int snd_compr_stop(struct snd_compr_stream *stream)
 		return -EPERM;
 	retval = stream->ops->trigger(stream, SNDRV_PCM_TRIGGER_STOP);
 	if (!retval) {
+		/* everything written is dropped, start over from empty */
 		stream->runtime->state = SNDRV_PCM_STATE_SETUP;
+		stream->runtime->app_pointer = 0;
+		stream->runtime->hw_pointer = 0;
+		stream->runtime->total_bytes_available = 0;
+		stream->runtime->total_bytes_transferred = 0;
+		stream->metadata_set = false;
+		stream->next_track = false;
+		stream->partial_drain = false;
 		wake_up(&stream->runtime->sleep);
 	}
 	return retval;
 }
 
+/*
+ * Called with the device lock held and the stream already in DRAINING,
+ * which is set before the trigger so that a driver completing the drain
+ * from its trigger callback cannot be overwritten.  The lock is dropped
+ * while waiting so that the stream can still be stopped.
+ */
+static int snd_compress_wait_for_drain(struct snd_compr_stream *stream)
+{
+	int ret;
+
+	mutex_unlock(&stream->device->lock);
+	ret = wait_event_interruptible(stream->runtime->sleep,
+			stream->runtime->state != SNDRV_PCM_STATE_DRAINING);
+	if (ret == -ERESTARTSYS)
+		pr_debug("wait aborted by a signal\n");
+	mutex_lock(&stream->device->lock);
+
+	wake_up(&stream->runtime->sleep);
+	return ret;
+}
+
 static int snd_compr_drain(struct snd_compr_stream *stream)
 {
+	snd_pcm_state_t state = stream->runtime->state;
 	int retval;
 
-	if (stream->runtime->state == SNDRV_PCM_STATE_PREPARED ||
-			stream->runtime->state == SNDRV_PCM_STATE_SETUP)
+	if (state == SNDRV_PCM_STATE_PREPARED ||
+			state == SNDRV_PCM_STATE_SETUP ||
+			state == SNDRV_PCM_STATE_DRAINING)
 		return -EPERM;
+
+	stream->runtime->state = SNDRV_PCM_STATE_DRAINING;
 	retval = stream->ops->trigger(stream, SND_COMPR_TRIGGER_DRAIN);
-	if (!retval) {
-		stream->runtime->state = SNDRV_PCM_STATE_DRAINING;
-		wake_up(&stream->runtime->sleep);
+	if (retval) {
+		stream->runtime->state = state;
+		return retval;
 	}
+
+	return snd_compress_wait_for_drain(stream);
+}
+
+static int snd_compr_next_track(struct snd_compr_stream *stream)
+{
+	int retval;
+
+	/* only a running stream can transition to next track */
+	if (stream->runtime->state != SNDRV_PCM_STATE_RUNNING)
+		return -EPERM;
+
+	/* gapless needs the metadata of the current track */
+	if (!stream->metadata_set)
+		return -EPERM;
+
+	retval = stream->ops->trigger(stream, SND_COMPR_TRIGGER_NEXT_TRACK);
+	if (retval)
+		return retval;
+
+	stream->metadata_set = false;
+	stream->next_track = true;
+	return 0;
+}
+
+static int snd_compr_partial_drain(struct snd_compr_stream *stream)
+{
+	int retval;
+
+	if (stream->runtime->state != SNDRV_PCM_STATE_RUNNING)
+		return -EPERM;
+
+	/* the track to drain ends where next track was signalled */
+	if (!stream->next_track)
+		return -EPERM;
+
+	stream->runtime->state = SNDRV_PCM_STATE_DRAINING;
+	stream->partial_drain = true;
+	retval = stream->ops->trigger(stream, SND_COMPR_TRIGGER_PARTIAL_DRAIN);
+	if (retval) {
+		stream->runtime->state = SNDRV_PCM_STATE_RUNNING;
+		stream->partial_drain = false;
+		return retval;
+	}
+
+	retval = snd_compress_wait_for_drain(stream);
+	stream->next_track = false;
 	return retval;
 }
 
@@ -582,7 +702,7 @@ static long snd_compr_ioctl(struct file *f, unsigned int cmd, unsigned long arg)
 	mutex_lock(&stream->device->lock);
 	switch (_IOC_NR(cmd)) {
 	case _IOC_NR(SNDRV_COMPRESS_IOCTL_VERSION):
-		put_user(SNDRV_COMPRESS_VERSION,
+		retval = put_user(SNDRV_COMPRESS_VERSION,
 				(int __user *)arg) ? -EFAULT : 0;
 		break;
 	case _IOC_NR(SNDRV_COMPRESS_GET_CAPS):
@@ -597,6 +717,12 @@ static long snd_compr_ioctl(struct file *f, unsigned int cmd, unsigned long arg)
 	case _IOC_NR(SNDRV_COMPRESS_GET_PARAMS):
 		retval = snd_compr_get_params(stream, arg);
 		break;
+	case _IOC_NR(SNDRV_COMPRESS_SET_METADATA):
+		retval = snd_compr_set_metadata(stream, arg);
+		break;
+	case _IOC_NR(SNDRV_COMPRESS_GET_METADATA):
+		retval = snd_compr_get_metadata(stream, arg);
+		break;
 	case _IOC_NR(SNDRV_COMPRESS_TSTAMP):
 		retval = snd_compr_tstamp(stream, arg);
 		break;
@@ -618,6 +744,12 @@ static long snd_compr_ioctl(struct file *f, unsigned int cmd, unsigned long arg)
 	case _IOC_NR(SNDRV_COMPRESS_DRAIN):
 		retval = snd_compr_drain(stream);
 		break;
+	case _IOC_NR(SNDRV_COMPRESS_NEXT_TRACK):
+		retval = snd_compr_next_track(stream);
+		break;
+	case _IOC_NR(SNDRV_COMPRESS_PARTIAL_DRAIN):
+		retval = snd_compr_partial_drain(stream);
+		break;
 	}
 	mutex_unlock(&stream->device->lock);
 	return retval;
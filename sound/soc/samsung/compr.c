@@ -0,0 +1,561 @@
+/* sound/soc/samsung/compr.c
+ *
+ * ALSA compressed offload playback for the Samsung Low Power Audio Subsystem
+ *
+ * Copyright (c) 2013 Samsung Electronics Co. Ltd.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ */
+
+#include <linux/math64.h>
+#include <linux/module.h>
+#include <linux/platform_device.h>
+#include <linux/slab.h>
+#include <linux/spinlock.h>
+
+#include <sound/core.h>
+#include <sound/compress_driver.h>
+
+#include "compr.h"
+
+#define COMPR_MIN_FRAGMENT_SIZE	(1024)
+#define COMPR_MAX_FRAGMENT_SIZE	(64 * 1024)
+#define COMPR_MIN_FRAGMENTS	(2)
+#define COMPR_MAX_FRAGMENTS	(16)
+
+#define COMPR_NO_TRACK_END	(~0ULL)
+
+struct samsung_compr_dev {
+	struct snd_card *card;
+	struct snd_compr compr;
+	const struct samsung_compr_dsp_ops *dsp;
+	struct samsung_compr *prtd;	/* the one open stream */
+};
+
+/*
+ * Gapless trimming: the first delay frames of a track are dropped as they
+ * are decoded, the last padding frames are held back until the track turns
+ * out to end there and are then dropped as well.  A track still being
+ * written thus lags padding frames behind its decoder, as it would on a
+ * DSP that cuts the padding itself.
+ */
+static u32 samsung_compr_trim(struct samsung_compr *prtd, u32 frames)
+{
+	u64 cut = (u64)prtd->cur.delay + prtd->cur.padding;
+	u64 out = 0;
+
+	prtd->track_decoded += frames;
+	if (prtd->track_decoded > cut)
+		out = prtd->track_decoded - cut;
+	if (out <= prtd->track_output)
+		return 0;
+
+	frames = out - prtd->track_output;
+	prtd->track_output = out;
+	return frames;
+}
+
+/* the decoder is past the end of the current track, move on to the next */
+static void samsung_compr_next_track(struct samsung_compr *prtd)
+{
+	prtd->cur = prtd->next;
+	memset(&prtd->next, 0, sizeof(prtd->next));
+	prtd->track_end = COMPR_NO_TRACK_END;
+	prtd->track_decoded = 0;
+	prtd->track_output = 0;
+}
+
+/* called with prtd->lock held, true when a drain has just completed */
+static bool samsung_compr_drained(struct samsung_compr *prtd)
+{
+	if (prtd->partial_draining &&
+	    prtd->track_end == COMPR_NO_TRACK_END) {
+		prtd->partial_draining = false;
+		return true;
+	}
+
+	if (prtd->draining && prtd->consumed == prtd->written &&
+	    prtd->rendered == prtd->output) {
+		prtd->draining = false;
+		return true;
+	}
+
+	return false;
+}
+
+/**
+ * samsung_compr_peek - encoded data the decoder can take next
+ * @prtd: the stream
+ * @len: returns the length of the data
+ *
+ * The data is contiguous and does not cross the end of the current track,
+ * so one call may return less than is queued.  Returns NULL when nothing
+ * is queued.
+ */
+const void *samsung_compr_peek(struct samsung_compr *prtd, size_t *len)
+{
+	struct snd_compr_runtime *runtime = prtd->stream->runtime;
+	unsigned long flags;
+	u32 offset;
+	u64 end;
+
+	spin_lock_irqsave(&prtd->lock, flags);
+	end = min(prtd->written, prtd->track_end);
+	*len = end - prtd->consumed;
+	div_u64_rem(prtd->consumed, runtime->buffer_size, &offset);
+	spin_unlock_irqrestore(&prtd->lock, flags);
+
+	if (*len > runtime->buffer_size - offset)
+		*len = runtime->buffer_size - offset;
+
+	return *len ? runtime->buffer + offset : NULL;
+}
+EXPORT_SYMBOL_GPL(samsung_compr_peek);
+
+/**
+ * samsung_compr_consumed - the decoder is done with encoded data
+ * @prtd: the stream
+ * @len: bytes from samsung_compr_peek() the decoder is done with
+ * @frames: frames they decoded to
+ *
+ * Returns how many of those frames are to be played.
+ */
+u32 samsung_compr_consumed(struct samsung_compr *prtd, size_t len, u32 frames)
+{
+	struct snd_compr_stream *stream = prtd->stream;
+	u32 fragment_size = stream->runtime->fragment_size;
+	unsigned long flags;
+	bool wake, drained;
+	u64 old;
+
+	spin_lock_irqsave(&prtd->lock, flags);
+
+	old = prtd->consumed;
+	prtd->consumed += len;
+	prtd->decoded += frames;
+
+	frames = samsung_compr_trim(prtd, frames);
+	prtd->output += frames;
+
+	if (prtd->consumed == prtd->track_end)
+		samsung_compr_next_track(prtd);
+
+	wake = !prtd->no_wake &&
+		div_u64(old, fragment_size) !=
+		div_u64(prtd->consumed, fragment_size);
+	drained = samsung_compr_drained(prtd);
+
+	spin_unlock_irqrestore(&prtd->lock, flags);
+
+	if (drained)
+		snd_compr_drain_notify(stream);
+	else if (wake)
+		snd_compr_fragment_elapsed(stream);
+
+	return frames;
+}
+EXPORT_SYMBOL_GPL(samsung_compr_consumed);
+
+/**
+ * samsung_compr_rendered - decoded frames have been played
+ * @prtd: the stream
+ * @frames: number of frames
+ */
+void samsung_compr_rendered(struct samsung_compr *prtd, u32 frames)
+{
+	unsigned long flags;
+	bool drained;
+
+	spin_lock_irqsave(&prtd->lock, flags);
+	prtd->rendered += frames;
+	drained = samsung_compr_drained(prtd);
+	spin_unlock_irqrestore(&prtd->lock, flags);
+
+	if (drained)
+		snd_compr_drain_notify(prtd->stream);
+}
+EXPORT_SYMBOL_GPL(samsung_compr_rendered);
+
+static void samsung_compr_reset(struct samsung_compr *prtd)
+{
+	unsigned long flags;
+
+	spin_lock_irqsave(&prtd->lock, flags);
+	prtd->written = 0;
+	prtd->consumed = 0;
+	prtd->draining = false;
+	prtd->partial_draining = false;
+	prtd->decoded = 0;
+	prtd->output = 0;
+	prtd->rendered = 0;
+	memset(&prtd->next, 0, sizeof(prtd->next));
+	samsung_compr_next_track(prtd);
+	spin_unlock_irqrestore(&prtd->lock, flags);
+}
+
+static int samsung_compr_open(struct snd_compr_stream *stream)
+{
+	struct samsung_compr_dev *cdev = stream->private_data;
+	struct samsung_compr *prtd;
+	int ret;
+
+	if (cdev->prtd)
+		return -EBUSY;
+
+	prtd = kzalloc(sizeof(*prtd), GFP_KERNEL);
+	if (!prtd)
+		return -ENOMEM;
+
+	prtd->stream = stream;
+	prtd->dsp = cdev->dsp;
+	spin_lock_init(&prtd->lock);
+	samsung_compr_reset(prtd);
+
+	ret = prtd->dsp->open(prtd);
+	if (ret) {
+		kfree(prtd);
+		return ret;
+	}
+
+	cdev->prtd = prtd;
+	return 0;
+}
+
+static int samsung_compr_free(struct snd_compr_stream *stream)
+{
+	struct samsung_compr_dev *cdev = stream->private_data;
+	struct samsung_compr *prtd = cdev->prtd;
+
+	/* release is not serialised against open by the core */
+	mutex_lock(&cdev->compr.lock);
+	prtd->dsp->stop(prtd);
+	prtd->dsp->close(prtd);
+	cdev->prtd = NULL;
+	mutex_unlock(&cdev->compr.lock);
+
+	kfree(prtd);
+	return 0;
+}
+
+static int samsung_compr_set_params(struct snd_compr_stream *stream,
+		struct snd_compr_params *params)
+{
+	struct samsung_compr_dev *cdev = stream->private_data;
+	struct samsung_compr *prtd = cdev->prtd;
+	struct snd_codec *codec = &params->codec;
+	unsigned int i;
+	int ret;
+
+	if (params->buffer.fragment_size < COMPR_MIN_FRAGMENT_SIZE ||
+	    params->buffer.fragment_size > COMPR_MAX_FRAGMENT_SIZE ||
+	    params->buffer.fragments < COMPR_MIN_FRAGMENTS ||
+	    params->buffer.fragments > COMPR_MAX_FRAGMENTS)
+		return -EINVAL;
+
+	for (i = 0; i < prtd->dsp->num_codecs; i++)
+		if (prtd->dsp->codecs[i] == codec->id)
+			break;
+	if (i == prtd->dsp->num_codecs)
+		return -EINVAL;
+
+	/* in Hz, as the rest of this interface counts frames */
+	if (!codec->sample_rate)
+		return -EINVAL;
+
+	ret = prtd->dsp->set_params(prtd, codec);
+	if (ret)
+		return ret;
+
+	prtd->codec = *codec;
+	prtd->rate = codec->sample_rate;
+	prtd->no_wake = params->no_wake_mode;
+	return 0;
+}
+
+static int samsung_compr_get_params(struct snd_compr_stream *stream,
+		struct snd_codec *params)
+{
+	struct samsung_compr_dev *cdev = stream->private_data;
+
+	*params = cdev->prtd->codec;
+	return 0;
+}
+
+/*
+ * Metadata describes the track being written: the next one once next track
+ * was signalled and the decoder has not reached it yet, otherwise the
+ * current one.
+ */
+static struct samsung_compr_track *
+samsung_compr_metadata_track(struct samsung_compr *prtd)
+{
+	if (prtd->track_end != COMPR_NO_TRACK_END)
+		return &prtd->next;
+	return &prtd->cur;
+}
+
+static int samsung_compr_set_metadata(struct snd_compr_stream *stream,
+		struct snd_compr_metadata *metadata)
+{
+	struct samsung_compr_dev *cdev = stream->private_data;
+	struct samsung_compr *prtd = cdev->prtd;
+	struct samsung_compr_track *track;
+	unsigned long flags;
+	int ret = 0;
+
+	spin_lock_irqsave(&prtd->lock, flags);
+	track = samsung_compr_metadata_track(prtd);
+	switch (metadata->key) {
+	case SNDRV_COMPRESS_ENCODER_DELAY:
+		track->delay = metadata->value[0];
+		break;
+	case SNDRV_COMPRESS_ENCODER_PADDING:
+		track->padding = metadata->value[0];
+		break;
+	default:
+		ret = -EINVAL;
+		break;
+	}
+	spin_unlock_irqrestore(&prtd->lock, flags);
+
+	return ret;
+}
+
+static int samsung_compr_get_metadata(struct snd_compr_stream *stream,
+		struct snd_compr_metadata *metadata)
+{
+	struct samsung_compr_dev *cdev = stream->private_data;
+	struct samsung_compr *prtd = cdev->prtd;
+	struct samsung_compr_track *track;
+	unsigned long flags;
+	int ret = 0;
+
+	spin_lock_irqsave(&prtd->lock, flags);
+	track = samsung_compr_metadata_track(prtd);
+	switch (metadata->key) {
+	case SNDRV_COMPRESS_ENCODER_DELAY:
+		metadata->value[0] = track->delay;
+		break;
+	case SNDRV_COMPRESS_ENCODER_PADDING:
+		metadata->value[0] = track->padding;
+		break;
+	default:
+		ret = -EINVAL;
+		break;
+	}
+	spin_unlock_irqrestore(&prtd->lock, flags);
+
+	return ret;
+}
+
+static int samsung_compr_trigger(struct snd_compr_stream *stream, int cmd)
+{
+	struct samsung_compr_dev *cdev = stream->private_data;
+	struct samsung_compr *prtd = cdev->prtd;
+	unsigned long flags;
+	bool drained = false;
+	int ret = 0;
+
+	switch (cmd) {
+	case SNDRV_PCM_TRIGGER_START:
+	case SNDRV_PCM_TRIGGER_PAUSE_RELEASE:
+		ret = prtd->dsp->start(prtd);
+		break;
+	case SNDRV_PCM_TRIGGER_PAUSE_PUSH:
+		prtd->dsp->pause(prtd);
+		break;
+	case SNDRV_PCM_TRIGGER_STOP:
+		prtd->dsp->stop(prtd);
+		samsung_compr_reset(prtd);
+		break;
+	case SND_COMPR_TRIGGER_NEXT_TRACK:
+		spin_lock_irqsave(&prtd->lock, flags);
+		if (prtd->track_end != COMPR_NO_TRACK_END)
+			ret = -EBUSY;
+		else if (prtd->consumed == prtd->written)
+			samsung_compr_next_track(prtd);
+		else
+			prtd->track_end = prtd->written;
+		spin_unlock_irqrestore(&prtd->lock, flags);
+		break;
+	case SND_COMPR_TRIGGER_PARTIAL_DRAIN:
+		spin_lock_irqsave(&prtd->lock, flags);
+		prtd->partial_draining = true;
+		drained = samsung_compr_drained(prtd);
+		spin_unlock_irqrestore(&prtd->lock, flags);
+		break;
+	case SND_COMPR_TRIGGER_DRAIN:
+		spin_lock_irqsave(&prtd->lock, flags);
+		prtd->partial_draining = false;
+		prtd->draining = true;
+		drained = samsung_compr_drained(prtd);
+		spin_unlock_irqrestore(&prtd->lock, flags);
+		break;
+	default:
+		ret = -EINVAL;
+		break;
+	}
+
+	if (drained)
+		snd_compr_drain_notify(stream);
+
+	return ret;
+}
+
+static int samsung_compr_pointer(struct snd_compr_stream *stream,
+		struct snd_compr_tstamp *tstamp)
+{
+	struct samsung_compr_dev *cdev = stream->private_data;
+	struct samsung_compr *prtd = cdev->prtd;
+	unsigned long flags;
+	u32 offset;
+
+	spin_lock_irqsave(&prtd->lock, flags);
+	div_u64_rem(prtd->consumed, stream->runtime->buffer_size, &offset);
+	tstamp->byte_offset = offset;
+	tstamp->copied_total = prtd->consumed;
+	tstamp->pcm_frames = prtd->decoded;
+	tstamp->pcm_io_frames = prtd->rendered;
+	tstamp->sampling_rate = prtd->rate;
+	spin_unlock_irqrestore(&prtd->lock, flags);
+
+	return 0;
+}
+
+static int samsung_compr_ack(struct snd_compr_stream *stream, size_t bytes)
+{
+	struct samsung_compr_dev *cdev = stream->private_data;
+	struct samsung_compr *prtd = cdev->prtd;
+	unsigned long flags;
+
+	spin_lock_irqsave(&prtd->lock, flags);
+	prtd->written += bytes;
+	spin_unlock_irqrestore(&prtd->lock, flags);
+
+	if (prtd->dsp->ack)
+		prtd->dsp->ack(prtd);
+
+	return 0;
+}
+
+static int samsung_compr_get_caps(struct snd_compr_stream *stream,
+		struct snd_compr_caps *caps)
+{
+	struct samsung_compr_dev *cdev = stream->private_data;
+	const struct samsung_compr_dsp_ops *dsp = cdev->dsp;
+
+	memset(caps, 0, sizeof(*caps));
+	caps->direction = SND_COMPRESS_PLAYBACK;
+	caps->min_fragment_size = COMPR_MIN_FRAGMENT_SIZE;
+	caps->max_fragment_size = COMPR_MAX_FRAGMENT_SIZE;
+	caps->min_fragments = COMPR_MIN_FRAGMENTS;
+	caps->max_fragments = COMPR_MAX_FRAGMENTS;
+	caps->num_codecs = min_t(unsigned int, dsp->num_codecs,
+				 MAX_NUM_CODECS);
+	memcpy(caps->codecs, dsp->codecs,
+	       caps->num_codecs * sizeof(caps->codecs[0]));
+
+	return 0;
+}
+
+static int samsung_compr_get_codec_caps(struct snd_compr_stream *stream,
+		struct snd_compr_codec_caps *codec)
+{
+	struct samsung_compr_dev *cdev = stream->private_data;
+
+	return cdev->dsp->get_codec_caps(cdev->prtd, codec);
+}
+
+static struct snd_compr_ops samsung_compr_ops = {
+	.open		= samsung_compr_open,
+	.free		= samsung_compr_free,
+	.set_params	= samsung_compr_set_params,
+	.get_params	= samsung_compr_get_params,
+	.set_metadata	= samsung_compr_set_metadata,
+	.get_metadata	= samsung_compr_get_metadata,
+	.trigger	= samsung_compr_trigger,
+	.pointer	= samsung_compr_pointer,
+	.ack		= samsung_compr_ack,
+	.get_caps	= samsung_compr_get_caps,
+	.get_codec_caps	= samsung_compr_get_codec_caps,
+};
+
+static int samsung_compr_probe(struct platform_device *pdev)
+{
+	struct samsung_compr_dev *cdev;
+	int ret;
+
+	cdev = devm_kzalloc(&pdev->dev, sizeof(*cdev), GFP_KERNEL);
+	if (!cdev)
+		return -ENOMEM;
+
+#ifdef CONFIG_SND_SAMSUNG_COMPR_SW
+	cdev->dsp = &samsung_compr_sw_ops;
+#endif
+	if (!cdev->dsp) {
+		dev_err(&pdev->dev, "no decoder for offload\n");
+		return -ENODEV;
+	}
+
+	ret = snd_card_create(SNDRV_DEFAULT_IDX1, "LPASSOffload",
+			      THIS_MODULE, 0, &cdev->card);
+	if (ret < 0)
+		return ret;
+
+	strlcpy(cdev->card->driver, cdev->dsp->name,
+		sizeof(cdev->card->driver));
+	strlcpy(cdev->card->shortname, "LPASS Offload",
+		sizeof(cdev->card->shortname));
+	snprintf(cdev->card->longname, sizeof(cdev->card->longname),
+		 "Samsung LPASS compressed playback (%s)", cdev->dsp->name);
+	snd_card_set_dev(cdev->card, &pdev->dev);
+
+	cdev->compr.name = "LPASS compressed playback";
+	cdev->compr.dev = &pdev->dev;
+	cdev->compr.ops = &samsung_compr_ops;
+	cdev->compr.private_data = cdev;
+
+	ret = snd_compress_new(cdev->card, 0, SND_COMPRESS_PLAYBACK,
+			       &cdev->compr);
+	if (ret < 0)
+		goto err;
+
+	ret = snd_compress_register(&cdev->compr);
+	if (ret < 0)
+		goto err;
+
+	platform_set_drvdata(pdev, cdev);
+	dev_info(&pdev->dev, "compressed playback with %s decoder\n",
+		 cdev->dsp->name);
+	return 0;
+
+err:
+	snd_card_free(cdev->card);
+	return ret;
+}
+
+static int samsung_compr_remove(struct platform_device *pdev)
+{
+	struct samsung_compr_dev *cdev = platform_get_drvdata(pdev);
+
+	/* frees the card as well */
+	snd_compress_deregister(&cdev->compr);
+	return 0;
+}
+
+static struct platform_driver samsung_compr_driver = {
+	.probe		= samsung_compr_probe,
+	.remove		= samsung_compr_remove,
+	.driver		= {
+		.name	= "samsung-compr",
+		.owner	= THIS_MODULE,
+	},
+};
+
+module_platform_driver(samsung_compr_driver);
+
+MODULE_DESCRIPTION("Samsung LPASS compressed offload playback");
+MODULE_ALIAS("platform:samsung-compr");
+MODULE_LICENSE("GPL");
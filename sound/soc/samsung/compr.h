@@ -0,0 +1,99 @@
+/* sound/soc/samsung/compr.h
+ *
+ * ALSA compressed offload playback for the Samsung Low Power Audio Subsystem
+ *
+ * Copyright (c) 2013 Samsung Electronics Co. Ltd.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ */
+
+#ifndef __SND_SOC_SAMSUNG_COMPR_H
+#define __SND_SOC_SAMSUNG_COMPR_H
+
+#include <sound/compress_driver.h>
+
+struct samsung_compr;
+
+/*
+ * The decoder behind the compressed device.  Once started it takes the
+ * encoded data in order with samsung_compr_peek() and hands back what it
+ * decoded with samsung_compr_consumed(), which answers how many of the
+ * decoded frames are to be played once the encoder delay and padding of
+ * the track are cut.  Frames leaving the output are reported with
+ * samsung_compr_rendered().  The compressed device does the ring, track
+ * and drain bookkeeping around that.  All callbacks are called in process
+ * context and may sleep.
+ *
+ * @name: shown as the driver of the offload card
+ * @codecs: codecs the decoder takes
+ * @num_codecs: entries in codecs
+ * @get_codec_caps: fill in the descriptors of one codec
+ * @open: a stream was opened
+ * @close: the stream is being closed, it is stopped already
+ * @set_params: the codec of the stream, before any data
+ * @start: start pulling data, also after a pause
+ * @stop: stop and drop what was not decoded yet; the backend must not touch
+ *	the stream any more once this returns
+ * @pause: stop pulling data but keep the decoder state
+ * @ack: more data was written
+ */
+struct samsung_compr_dsp_ops {
+	const char *name;
+	const u32 *codecs;
+	unsigned int num_codecs;
+	int (*get_codec_caps)(struct samsung_compr *prtd,
+			struct snd_compr_codec_caps *caps);
+	int (*open)(struct samsung_compr *prtd);
+	void (*close)(struct samsung_compr *prtd);
+	int (*set_params)(struct samsung_compr *prtd, struct snd_codec *codec);
+	int (*start)(struct samsung_compr *prtd);
+	void (*stop)(struct samsung_compr *prtd);
+	void (*pause)(struct samsung_compr *prtd);
+	void (*ack)(struct samsung_compr *prtd);
+};
+
+/* Gapless metadata of one track, in frames */
+struct samsung_compr_track {
+	u32 delay;
+	u32 padding;
+};
+
+struct samsung_compr {
+	struct snd_compr_stream *stream;
+	const struct samsung_compr_dsp_ops *dsp;
+	void *dsp_data;
+
+	struct snd_codec codec;
+	u32 rate;
+
+	/* all in bytes and counting from the start of the stream */
+	spinlock_t lock;
+	u64 written;
+	u64 consumed;
+	u64 track_end;		/* end of the current track, or ~0 */
+	bool draining;
+	bool partial_draining;
+	bool no_wake;
+
+	/* all in frames */
+	u64 decoded;
+	u64 output;		/* decoded and left after gapless trimming */
+	u64 rendered;
+	u64 track_decoded;
+	u64 track_output;
+	struct samsung_compr_track cur;
+	struct samsung_compr_track next;
+};
+
+const void *samsung_compr_peek(struct samsung_compr *prtd, size_t *len);
+u32 samsung_compr_consumed(struct samsung_compr *prtd, size_t len,
+		u32 frames);
+void samsung_compr_rendered(struct samsung_compr *prtd, u32 frames);
+
+#ifdef CONFIG_SND_SAMSUNG_COMPR_SW
+extern const struct samsung_compr_dsp_ops samsung_compr_sw_ops;
+#endif
+
+#endif /* __SND_SOC_SAMSUNG_COMPR_H */
@@ -0,0 +1,206 @@
+/* sound/soc/samsung/compr_sw.c
+ *
+ * Software stand-in for the LPASS offload decoder
+ *
+ * Copyright (c) 2013 Samsung Electronics Co. Ltd.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ */
+
+/*
+ * Takes linear PCM as its "encoded" format, so the frames every buffer
+ * decodes to are known exactly, and plays them into a clock running at the
+ * sample rate instead of an output.  That is enough to run the compressed
+ * device end to end - buffer flow, fragment wakeups, pause, gapless
+ * trimming and both drains - without the DSP firmware.  Like a DSP it
+ * decodes a little ahead of its output so that the next track of a gapless
+ * stream can be written while the current one still plays.
+ */
+
+#include <linux/ktime.h>
+#include <linux/math64.h>
+#include <linux/slab.h>
+#include <linux/workqueue.h>
+
+#include <sound/pcm.h>
+
+#include "compr.h"
+
+#define SW_TICK_MS		10
+#define SW_LOOKAHEAD_MS		40
+
+struct samsung_compr_sw {
+	struct samsung_compr *prtd;
+	struct delayed_work work;
+	bool running;
+
+	u32 rate;
+	u32 frame_bytes;
+	u32 carry;		/* bytes of a frame split by the ring end */
+
+	/* output clock: base frames at start, then the sample rate */
+	ktime_t start;
+	u64 base;
+	u64 played;
+	u64 queued;		/* decoded, not played yet */
+};
+
+static const u32 samsung_compr_sw_codecs[] = {
+	SND_AUDIOCODEC_PCM,
+};
+
+static void samsung_compr_sw_decode(struct samsung_compr_sw *sw)
+{
+	u64 ahead = div_u64((u64)sw->rate * SW_LOOKAHEAD_MS, MSEC_PER_SEC);
+	const void *buf;
+	size_t len;
+	u32 frames;
+
+	while (sw->queued < ahead) {
+		buf = samsung_compr_peek(sw->prtd, &len);
+		if (!buf)
+			break;
+
+		if (len > (ahead - sw->queued) * sw->frame_bytes)
+			len = (ahead - sw->queued) * sw->frame_bytes;
+
+		/* linear PCM decodes to itself */
+		frames = (sw->carry + len) / sw->frame_bytes;
+		sw->carry = (sw->carry + len) % sw->frame_bytes;
+
+		sw->queued += samsung_compr_consumed(sw->prtd, len, frames);
+	}
+}
+
+static void samsung_compr_sw_work(struct work_struct *work)
+{
+	struct samsung_compr_sw *sw = container_of(work,
+			struct samsung_compr_sw, work.work);
+	ktime_t now = ktime_get();
+	u64 due, frames;
+
+	due = sw->base + div_u64((u64)ktime_us_delta(now, sw->start) *
+				 sw->rate, USEC_PER_SEC);
+	frames = due > sw->played ? due - sw->played : 0;
+
+	if (frames > sw->queued) {
+		/* underrun, the clock waits for data */
+		frames = sw->queued;
+		sw->base = sw->played + frames;
+		sw->start = now;
+	}
+
+	if (frames) {
+		sw->played += frames;
+		sw->queued -= frames;
+		samsung_compr_rendered(sw->prtd, frames);
+	}
+
+	samsung_compr_sw_decode(sw);
+
+	if (sw->running)
+		schedule_delayed_work(&sw->work, msecs_to_jiffies(SW_TICK_MS));
+}
+
+static int samsung_compr_sw_get_codec_caps(struct samsung_compr *prtd,
+		struct snd_compr_codec_caps *caps)
+{
+	struct snd_codec_desc *desc = &caps->descriptor[0];
+
+	if (caps->codec != SND_AUDIOCODEC_PCM)
+		return -EINVAL;
+
+	memset(desc, 0, sizeof(*desc));
+	desc->max_ch = 2;
+	desc->sample_rates = SNDRV_PCM_RATE_8000_192000;
+	caps->num_descriptors = 1;
+
+	return 0;
+}
+
+static int samsung_compr_sw_open(struct samsung_compr *prtd)
+{
+	struct samsung_compr_sw *sw;
+
+	sw = kzalloc(sizeof(*sw), GFP_KERNEL);
+	if (!sw)
+		return -ENOMEM;
+
+	sw->prtd = prtd;
+	INIT_DELAYED_WORK(&sw->work, samsung_compr_sw_work);
+	prtd->dsp_data = sw;
+
+	return 0;
+}
+
+static void samsung_compr_sw_close(struct samsung_compr *prtd)
+{
+	kfree(prtd->dsp_data);
+	prtd->dsp_data = NULL;
+}
+
+/* ch_in channels of align bytes each, 16 bit when align is not given */
+static int samsung_compr_sw_set_params(struct samsung_compr *prtd,
+		struct snd_codec *codec)
+{
+	struct samsung_compr_sw *sw = prtd->dsp_data;
+	u32 width = codec->align ? codec->align : 2;
+
+	if (!codec->ch_in || codec->ch_in > 2 || width > 4)
+		return -EINVAL;
+
+	sw->rate = codec->sample_rate;
+	sw->frame_bytes = codec->ch_in * width;
+
+	return 0;
+}
+
+static int samsung_compr_sw_start(struct samsung_compr *prtd)
+{
+	struct samsung_compr_sw *sw = prtd->dsp_data;
+
+	sw->start = ktime_get();
+	sw->base = sw->played;
+	sw->running = true;
+
+	/* decode ahead before the clock moves */
+	samsung_compr_sw_decode(sw);
+	schedule_delayed_work(&sw->work, msecs_to_jiffies(SW_TICK_MS));
+
+	return 0;
+}
+
+static void samsung_compr_sw_pause(struct samsung_compr *prtd)
+{
+	struct samsung_compr_sw *sw = prtd->dsp_data;
+
+	sw->running = false;
+	cancel_delayed_work_sync(&sw->work);
+}
+
+static void samsung_compr_sw_stop(struct samsung_compr *prtd)
+{
+	struct samsung_compr_sw *sw = prtd->dsp_data;
+
+	samsung_compr_sw_pause(prtd);
+
+	sw->carry = 0;
+	sw->base = 0;
+	sw->played = 0;
+	sw->queued = 0;
+}
+
+const struct samsung_compr_dsp_ops samsung_compr_sw_ops = {
+	.name		= "swdec",
+	.codecs		= samsung_compr_sw_codecs,
+	.num_codecs	= ARRAY_SIZE(samsung_compr_sw_codecs),
+	.get_codec_caps	= samsung_compr_sw_get_codec_caps,
+	.open		= samsung_compr_sw_open,
+	.close		= samsung_compr_sw_close,
+	.set_params	= samsung_compr_sw_set_params,
+	.start		= samsung_compr_sw_start,
+	.stop		= samsung_compr_sw_stop,
+	.pause		= samsung_compr_sw_pause,
+};
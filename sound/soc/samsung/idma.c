@@ -42,7 +42,8 @@ static const struct snd_pcm_hardware idma_hardware = {
 		    SNDRV_PCM_INFO_MMAP |
 		    SNDRV_PCM_INFO_MMAP_VALID |
 		    SNDRV_PCM_INFO_PAUSE |
-		    SNDRV_PCM_INFO_RESUME,
+		    SNDRV_PCM_INFO_RESUME |
+		    SNDRV_PCM_INFO_NO_PERIOD_WAKEUP,
 	.formats = SNDRV_PCM_FMTBIT_S16_LE |
 		    SNDRV_PCM_FMTBIT_U16_LE |
 		    SNDRV_PCM_FMTBIT_S24_LE |
@@ -123,6 +124,10 @@ static void idma_getpos(dma_addr_t *res, struct snd_pcm_substream *substream)
 	if (prtd->state == ST_RUNNING)
 		trncnt = trncnt == 0 ? maxcnt - 1 : trncnt - 1;
 
+	/*
+	 * The 24 bit position stays rounded down to the period, also when
+	 * the stream runs without period wakeups.
+	 */
 	if (idma.sample_bit == 24)
 		*res = ((trncnt << 2) / prtd->periodsz) * prtd->periodsz;
 	else
@@ -157,9 +162,12 @@ static int idma_enqueue(struct snd_pcm_substream *substream)
 			I2SSIZE_TRNMSK) << I2SSIZE_SHIFT);
 	writel(val, idma.regs + I2SSIZE);
 
-	val = readl(idma.regs + I2SAHB);
-	val |= AHB_INTENLVL0;
-	writel(val, idma.regs + I2SAHB);
+	/* no level interrupt when the position is only polled */
+	if (!runtime->no_period_wakeup) {
+		val = readl(idma.regs + I2SAHB);
+		val |= AHB_INTENLVL0;
+		writel(val, idma.regs + I2SAHB);
+	}
 
 	return 0;
 }
@@ -174,7 +182,7 @@ static void idma_setcallbk(struct snd_pcm_substream *substream,
 	spin_unlock(&prtd->lock);
 }
 
-static void idma_control(int op)
+static void idma_control(int op, bool period_irq)
 {
 	u32 val = readl(idma.regs + I2SAHB);
 
@@ -182,7 +190,9 @@ static void idma_control(int op)
 
 	switch (op) {
 	case LPAM_DMA_START:
-		val |= (AHB_INTENLVL0 | AHB_DMAEN);
+		val |= AHB_DMAEN;
+		if (period_irq)
+			val |= AHB_INTENLVL0;
 		break;
 	case LPAM_DMA_STOP:
 		val &= ~(AHB_INTENLVL0 | AHB_DMAEN);
@@ -285,7 +295,7 @@ static int idma_prepare(struct snd_pcm_substream *substream)
 	prtd->pos = prtd->start;
 
 	/* flush the DMA channel */
-	idma_control(LPAM_DMA_STOP);
+	idma_control(LPAM_DMA_STOP, false);
 	idma_enqueue(substream);
 
 	return 0;
@@ -303,14 +313,15 @@ static int idma_trigger(struct snd_pcm_substream *substream, int cmd)
 	case SNDRV_PCM_TRIGGER_START:
 	case SNDRV_PCM_TRIGGER_PAUSE_RELEASE:
 		prtd->state |= ST_RUNNING;
-		idma_control(LPAM_DMA_START);
+		idma_control(LPAM_DMA_START,
+			!substream->runtime->no_period_wakeup);
 		break;
 
 	case SNDRV_PCM_TRIGGER_SUSPEND:
 	case SNDRV_PCM_TRIGGER_STOP:
 	case SNDRV_PCM_TRIGGER_PAUSE_PUSH:
 		prtd->state &= ~ST_RUNNING;
-		idma_control(LPAM_DMA_STOP);
+		idma_control(LPAM_DMA_STOP, false);
 		break;
 
 	default:
@@ -0,0 +1,224 @@
+/*
+ * fsync-bench: fsync latency and write amplification of small writes
+ *
+ * Writes -s bytes to a file -n times, each followed by fsync (fdatasync
+ * with -d), either appending or overwriting the same offsets (-o), and
+ * reports the latency of the syncs and the sectors the device holding the
+ * file wrote per sync, taken from /proc/diskstats.  Run it once on a
+ * mount with fast_commit and once without to compare the two; the fast
+ * commit counters of /proc/fs/ext4/<dev>/fc_info are shown when present.
+ * Nothing else should write to the device meanwhile.
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the Free
+ * Software Foundation; version 2.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <string.h>
+#include <getopt.h>
+#include <fcntl.h>
+#include <time.h>
+#include <sys/stat.h>
+#include <sys/sysmacros.h>
+#include <sys/types.h>
+
+static const char *opt_file = "fsync-bench.dat";
+static int opt_size = 4096;
+static int opt_count = 1000;
+static int opt_datasync;
+static int opt_overwrite;
+
+static void usage(void)
+{
+	printf(
+"fsync-bench [options]\n"
+"            -f|--file PATH             file to write (default fsync-bench.dat)\n"
+"            -s|--size BYTES            bytes per write (default 4096)\n"
+"            -n|--count N               number of writes (default 1000)\n"
+"            -d|--datasync              fdatasync instead of fsync\n"
+"            -o|--overwrite             rewrite the first write instead of\n"
+"                                       appending\n"
+"            -h|--help                  Show this usage message\n");
+}
+
+static double now(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+/* Sectors written by the block device @dev, its name in @name */
+static long long sectors_written(dev_t dev, char *name)
+{
+	unsigned int major, minor;
+	unsigned long long f[7];
+	char line[256], dname[32];
+	long long ret = -1;
+	FILE *f_stats;
+
+	f_stats = fopen("/proc/diskstats", "r");
+	if (!f_stats)
+		return -1;
+
+	while (fgets(line, sizeof(line), f_stats)) {
+		if (sscanf(line, "%u %u %31s %llu %llu %llu %llu %llu %llu %llu",
+			   &major, &minor, dname, &f[0], &f[1], &f[2], &f[3],
+			   &f[4], &f[5], &f[6]) != 10)
+			continue;
+		if (major != major(dev) || minor != minor(dev))
+			continue;
+
+		/* reads, merged, sectors, ms, writes, merged, sectors */
+		ret = f[6];
+		strcpy(name, dname);
+		break;
+	}
+	fclose(f_stats);
+
+	return ret;
+}
+
+static void show_fc_info(const char *name)
+{
+	char path[128], line[128];
+	FILE *f;
+
+	snprintf(path, sizeof(path), "/proc/fs/ext4/%s/fc_info", name);
+	f = fopen(path, "r");
+	if (!f)
+		return;
+
+	printf("%s:\n", path);
+	while (fgets(line, sizeof(line), f))
+		printf("  %s", line);
+	fclose(f);
+}
+
+static int cmp_double(const void *a, const void *b)
+{
+	double x = *(const double *)a, y = *(const double *)b;
+
+	return x < y ? -1 : x > y;
+}
+
+int main(int argc, char *argv[])
+{
+	static const struct option opts[] = {
+		{ "file",      1, NULL, 'f' },
+		{ "size",      1, NULL, 's' },
+		{ "count",     1, NULL, 'n' },
+		{ "datasync",  0, NULL, 'd' },
+		{ "overwrite", 0, NULL, 'o' },
+		{ "help",      0, NULL, 'h' },
+		{ NULL,        0, NULL, 0 }
+	};
+	long long start_sectors, end_sectors;
+	double *lat, t, total = 0;
+	char name[32] = "";
+	struct stat st;
+	char *buf;
+	int c, fd, i;
+
+	while ((c = getopt_long(argc, argv, "f:s:n:doh", opts, NULL)) != -1) {
+		switch (c) {
+		case 'f':
+			opt_file = optarg;
+			break;
+		case 's':
+			opt_size = atoi(optarg);
+			break;
+		case 'n':
+			opt_count = atoi(optarg);
+			break;
+		case 'd':
+			opt_datasync = 1;
+			break;
+		case 'o':
+			opt_overwrite = 1;
+			break;
+		case 'h':
+			usage();
+			exit(0);
+		default:
+			usage();
+			exit(1);
+		}
+	}
+
+	if (opt_size <= 0 || opt_count <= 0) {
+		usage();
+		exit(1);
+	}
+
+	buf = malloc(opt_size);
+	lat = calloc(opt_count, sizeof(*lat));
+	if (!buf || !lat) {
+		perror("malloc");
+		exit(1);
+	}
+	memset(buf, 0x5a, opt_size);
+
+	fd = open(opt_file, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+	if (fd < 0 || fstat(fd, &st)) {
+		perror(opt_file);
+		exit(1);
+	}
+
+	/* the create and the first write are not what is measured */
+	if (write(fd, buf, opt_size) != opt_size || fsync(fd)) {
+		perror("write");
+		exit(1);
+	}
+
+	start_sectors = sectors_written(st.st_dev, name);
+
+	for (i = 0; i < opt_count; i++) {
+		if (opt_overwrite && lseek(fd, 0, SEEK_SET) < 0) {
+			perror("lseek");
+			exit(1);
+		}
+		if (write(fd, buf, opt_size) != opt_size) {
+			perror("write");
+			exit(1);
+		}
+
+		t = now();
+		if (opt_datasync ? fdatasync(fd) : fsync(fd)) {
+			perror("fsync");
+			exit(1);
+		}
+		lat[i] = now() - t;
+		total += lat[i];
+	}
+
+	end_sectors = sectors_written(st.st_dev, name);
+	close(fd);
+	unlink(opt_file);
+
+	qsort(lat, opt_count, sizeof(*lat), cmp_double);
+
+	printf("%d %s of %d byte %s\n", opt_count,
+	       opt_datasync ? "fdatasyncs" : "fsyncs", opt_size,
+	       opt_overwrite ? "overwrites" : "appends");
+	printf("latency: avg %.1f us, p50 %.1f us, p99 %.1f us, max %.1f us\n",
+	       total / opt_count * 1e6, lat[opt_count / 2] * 1e6,
+	       lat[opt_count * 99 / 100] * 1e6, lat[opt_count - 1] * 1e6);
+
+	if (start_sectors >= 0 && end_sectors >= 0)
+		printf("%s: %.1f KiB written per sync, %.2fx the data\n", name,
+		       (end_sectors - start_sectors) / 2.0 / opt_count,
+		       (end_sectors - start_sectors) * 512.0 /
+		       ((double)opt_size * opt_count));
+	else
+		printf("device %u:%u not in /proc/diskstats\n",
+		       major(st.st_dev), minor(st.st_dev));
+
+	show_fc_info(name);
+
+	return 0;
+}
@@ -0,0 +1,373 @@
+/*
+ * fimg2d-test: validate fimg2d blits against a CPU reference and measure
+ * submission overhead
+ *
+ * Every round builds a batch of random solid fill, copy and src-over blits
+ * between XRGB8888/ARGB8888/RGB565 sources and an ARGB8888 destination,
+ * submits it either as one FIMG2D_BITBLT_BATCH (default) or one blocking
+ * FIMG2D_BITBLT_BLIT per blit (-s), and compares the destination with the
+ * same blits applied by the reference blitter below.  Reports time spent in
+ * the submit ioctls per blit and the completion time per batch.
+ *
+ * To run without the hardware, switch the driver to its CPU reference
+ * engine with fimg2d_drv.g2d_refblit=1 on the command line or through
+ * /sys/module/fimg2d_drv/parameters/g2d_refblit.  The hardware may round
+ * blending and RGB565 expansion differently; allow for it with -T.
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the Free
+ * Software Foundation; version 2.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <unistd.h>
+#include <string.h>
+#include <getopt.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <time.h>
+#include <sys/ioctl.h>
+#include <linux/types.h>
+#include "../../include/linux/sync.h"
+#include "../../drivers/media/video/exynos/fimg2d/fimg2d.h"
+
+#define NR_SRC	3
+
+static int opt_width = 512;
+static int opt_height = 512;
+static int opt_batch = 16;
+static int opt_rounds = 100;
+static int opt_sync;
+static int opt_tolerance;
+
+static const enum color_format src_fmt[NR_SRC] = {
+	CF_XRGB_8888, CF_ARGB_8888, CF_RGB_565,
+};
+
+static void usage(void)
+{
+	printf(
+"fimg2d-test [options]\n"
+"            -W|--width N               surface width (default 512)\n"
+"            -H|--height N              surface height (default 512)\n"
+"            -b|--batch N               blits per batch (default 16)\n"
+"            -r|--rounds N              number of rounds (default 100)\n"
+"            -s|--sync                  one blocking ioctl per blit\n"
+"            -T|--tolerance N           allowed error per channel (default 0)\n"
+"            -h|--help                  Show this usage message\n");
+}
+
+static double now(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static int bpp(enum color_format fmt)
+{
+	return fmt == CF_RGB_565 ? 2 : 4;
+}
+
+static unsigned int mul255(unsigned int a, unsigned int b)
+{
+	unsigned int t = a * b + 128;
+
+	return (t + (t >> 8)) >> 8;
+}
+
+static __u32 read_pixel(const unsigned char *p, enum color_format fmt)
+{
+	__u32 v, r, g, b;
+
+	switch (fmt) {
+	case CF_RGB_565:
+		v = *(const __u16 *)p;
+		r = (v >> 11) & 0x1f;
+		g = (v >> 5) & 0x3f;
+		b = v & 0x1f;
+		r = (r << 3) | (r >> 2);
+		g = (g << 2) | (g >> 4);
+		b = (b << 3) | (b >> 2);
+		return 0xff000000 | (r << 16) | (g << 8) | b;
+	case CF_XRGB_8888:
+		return *(const __u32 *)p | 0xff000000;
+	default:
+		return *(const __u32 *)p;
+	}
+}
+
+static __u32 src_over(__u32 s, __u32 d, unsigned int ga)
+{
+	unsigned int sa = mul255(s >> 24, ga);
+	__u32 out = 0, c;
+	int shift;
+
+	for (shift = 0; shift < 32; shift += 8) {
+		c = mul255((s >> shift) & 0xff, ga) +
+			mul255((d >> shift) & 0xff, 255 - sa);
+		out |= (c > 0xff ? 0xff : c) << shift;
+	}
+	return out;
+}
+
+/* the CPU reference: apply one blit to an ARGB8888 destination */
+static void ref_blit(struct fimg2d_blit *blt, __u32 *dst)
+{
+	struct fimg2d_rect *r = &blt->dst->rect;
+	struct fimg2d_image *src = blt->src;
+	int x, y;
+	__u32 s, *d;
+
+	for (y = r->y1; y < r->y2; y++) {
+		for (x = r->x1; x < r->x2; x++) {
+			d = dst + y * opt_width + x;
+			if (blt->op == BLIT_OP_SOLID_FILL) {
+				s = blt->param.solid_color;
+			} else {
+				const unsigned char *p;
+
+				p = (const unsigned char *)src->addr.start +
+					(src->rect.y1 + y - r->y1) * src->stride +
+					(src->rect.x1 + x - r->x1) * bpp(src->fmt);
+				s = read_pixel(p, src->fmt);
+			}
+			if (blt->op == BLIT_OP_SRC_OVER)
+				s = src_over(s, *d, blt->param.g_alpha);
+			*d = s;
+		}
+	}
+}
+
+static void random_rect(struct fimg2d_rect *r, int w, int h)
+{
+	r->x1 = rand() % opt_width;
+	r->y1 = rand() % opt_height;
+	r->x2 = r->x1 + w;
+	r->y2 = r->y1 + h;
+	if (r->x2 > opt_width) {
+		r->x1 -= r->x2 - opt_width;
+		r->x2 = opt_width;
+	}
+	if (r->y2 > opt_height) {
+		r->y1 -= r->y2 - opt_height;
+		r->y2 = opt_height;
+	}
+}
+
+static void random_blit(struct fimg2d_blit *blt, struct fimg2d_image *src,
+		struct fimg2d_image *dst, struct fimg2d_image *srcs)
+{
+	int w = 1 + rand() % opt_width;
+	int h = 1 + rand() % opt_height;
+
+	memset(blt, 0, sizeof(*blt));
+	*dst = srcs[NR_SRC];
+	random_rect(&dst->rect, w, h);
+	blt->dst = dst;
+	blt->param.g_alpha = 0xff;
+	blt->param.premult = PREMULTIPLIED;
+	blt->sync = opt_sync ? BLIT_SYNC : BLIT_ASYNC;
+
+	switch (rand() % 3) {
+	case 0:
+		blt->op = BLIT_OP_SOLID_FILL;
+		blt->param.solid_color = rand() | 0xff000000;
+		return;
+	case 1:
+		blt->op = BLIT_OP_SRC;
+		break;
+	default:
+		blt->op = BLIT_OP_SRC_OVER;
+		blt->param.g_alpha = rand() & 0xff;
+		break;
+	}
+
+	*src = srcs[rand() % NR_SRC];
+	random_rect(&src->rect, w, h);
+	blt->src = src;
+}
+
+static void init_image(struct fimg2d_image *img, enum color_format fmt)
+{
+	size_t size = (size_t)opt_width * opt_height * bpp(fmt);
+	unsigned char *buf;
+	size_t i;
+
+	buf = malloc(size);
+	if (!buf) {
+		perror("malloc");
+		exit(1);
+	}
+	for (i = 0; i < size; i++)
+		buf[i] = rand();
+
+	memset(img, 0, sizeof(*img));
+	img->width = opt_width;
+	img->height = opt_height;
+	img->stride = opt_width * bpp(fmt);
+	img->order = AX_RGB;
+	img->fmt = fmt;
+	img->addr.type = ADDR_USER;
+	img->addr.start = (unsigned long)buf;
+	img->need_cacheopr = true;
+}
+
+static unsigned long compare(const __u32 *out, const __u32 *ref)
+{
+	unsigned long bad = 0;
+	int i, shift, diff;
+
+	for (i = 0; i < opt_width * opt_height; i++) {
+		for (shift = 0; shift < 32; shift += 8) {
+			diff = (int)((out[i] >> shift) & 0xff) -
+				(int)((ref[i] >> shift) & 0xff);
+			if (abs(diff) > opt_tolerance)
+				break;
+		}
+		if (shift == 32)
+			continue;
+		if (!bad)
+			printf("mismatch at (%d,%d): %08x, expected %08x\n",
+				i % opt_width, i / opt_width, out[i], ref[i]);
+		bad++;
+	}
+	return bad;
+}
+
+int main(int argc, char *argv[])
+{
+	const struct option opts[] = {
+		{ "width",     1, NULL, 'W' },
+		{ "height",    1, NULL, 'H' },
+		{ "batch",     1, NULL, 'b' },
+		{ "rounds",    1, NULL, 'r' },
+		{ "sync",      0, NULL, 's' },
+		{ "tolerance", 1, NULL, 'T' },
+		{ "help",      0, NULL, 'h' },
+		{ NULL,        0, NULL, 0 }
+	};
+	struct fimg2d_image srcs[NR_SRC + 1];
+	struct fimg2d_image *img_src, *img_dst;
+	struct fimg2d_blit *blts;
+	double t_submit = 0, t_done = 0, t;
+	unsigned long nr_blits = 0, nr_batches = 0, bad = 0;
+	__u32 *dst, *ref;
+	int fd, c, i, r;
+
+	while ((c = getopt_long(argc, argv, "W:H:b:r:sT:h", opts, NULL)) != -1) {
+		switch (c) {
+		case 'W':
+			opt_width = atoi(optarg);
+			break;
+		case 'H':
+			opt_height = atoi(optarg);
+			break;
+		case 'b':
+			opt_batch = atoi(optarg);
+			break;
+		case 'r':
+			opt_rounds = atoi(optarg);
+			break;
+		case 's':
+			opt_sync = 1;
+			break;
+		case 'T':
+			opt_tolerance = atoi(optarg);
+			break;
+		case 'h':
+			usage();
+			exit(0);
+		default:
+			usage();
+			exit(1);
+		}
+	}
+
+	if (opt_width <= 0 || opt_height <= 0 || opt_rounds <= 0 ||
+	    opt_batch <= 0 || opt_batch > FIMG2D_MAX_BATCH) {
+		usage();
+		exit(1);
+	}
+
+	fd = open("/dev/fimg2d", O_RDWR);
+	if (fd < 0) {
+		perror("/dev/fimg2d");
+		exit(1);
+	}
+
+	srand(1);
+	for (i = 0; i < NR_SRC; i++)
+		init_image(&srcs[i], src_fmt[i]);
+	init_image(&srcs[NR_SRC], CF_ARGB_8888);
+
+	dst = (__u32 *)srcs[NR_SRC].addr.start;
+	ref = malloc((size_t)opt_width * opt_height * 4);
+	blts = calloc(opt_batch, sizeof(*blts));
+	img_src = calloc(opt_batch, sizeof(*img_src));
+	img_dst = calloc(opt_batch, sizeof(*img_dst));
+	if (!ref || !blts || !img_src || !img_dst) {
+		perror("malloc");
+		exit(1);
+	}
+	memcpy(ref, dst, (size_t)opt_width * opt_height * 4);
+
+	for (r = 0; r < opt_rounds; r++) {
+		for (i = 0; i < opt_batch; i++) {
+			blts[i].seq_no = r * opt_batch + i;
+			random_blit(&blts[i], &img_src[i], &img_dst[i], srcs);
+			ref_blit(&blts[i], ref);
+		}
+
+		if (opt_sync) {
+			t = now();
+			for (i = 0; i < opt_batch; i++) {
+				if (ioctl(fd, FIMG2D_BITBLT_BLIT, &blts[i]) < 0) {
+					perror("FIMG2D_BITBLT_BLIT");
+					exit(1);
+				}
+			}
+			t_submit += now() - t;
+			t_done += now() - t;
+		} else {
+			struct fimg2d_batch batch;
+			int timeout = -1;
+
+			batch.blt = blts;
+			batch.nr_blits = opt_batch;
+			batch.fence = -1;
+
+			t = now();
+			if (ioctl(fd, FIMG2D_BITBLT_BATCH, &batch) < 0) {
+				perror("FIMG2D_BITBLT_BATCH");
+				exit(1);
+			}
+			t_submit += now() - t;
+			if (ioctl(batch.fence, SYNC_IOC_WAIT, &timeout) < 0) {
+				perror("SYNC_IOC_WAIT");
+				exit(1);
+			}
+			t_done += now() - t;
+			close(batch.fence);
+		}
+		nr_blits += opt_batch;
+		nr_batches++;
+
+		bad += compare(dst, ref);
+		if (bad) {
+			printf("round %d: %lu pixels differ\n", r, bad);
+			break;
+		}
+	}
+
+	printf("blits:    %12lu\n", nr_blits);
+	printf("submit:   %12.2f us/blit\n", t_submit * 1e6 / nr_blits);
+	printf("done:     %12.2f us/batch\n", t_done * 1e6 / nr_batches);
+	printf("result:   %12s\n", bad ? "FAIL" : "PASS");
+
+	close(fd);
+	return bad ? 1 : 0;
+}
@@ -0,0 +1,280 @@
+/*
+ * evdev-bench: measure the event throughput of the input core and evdev
+ *
+ * A multitouch device is created through uinput and a child process
+ * writes packets to it as fast as it can (or one every -i us): every
+ * packet moves each of the -f contacts and ends with SYN_REPORT, like a
+ * touch controller reporting a frame.  The parent reads the events back
+ * from the evdev node of the device and reports the events and packets
+ * per second it received, how many times read() returned, that is how
+ * many times the reader was woken up, and how many SYN_DROPPED it saw.
+ *
+ * Run as root, with uinput loaded:
+ *
+ *	evdev-bench -p 100000 -f 5
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the Free
+ * Software Foundation; version 2.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <time.h>
+#include <errno.h>
+#include <signal.h>
+#include <getopt.h>
+#include <sys/ioctl.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+#include <linux/input.h>
+#include <linux/uinput.h>
+
+#define BENCH_NAME	"evdev-bench"
+#define MAX_FINGERS	10
+#define READ_EVENTS	256
+#define IDLE_MS		1000
+
+static int opt_packets = 100000;
+static int opt_fingers = 2;
+static int opt_interval;
+
+static void usage(void)
+{
+	printf(
+"evdev-bench [options]\n"
+"            -p|--packets N             packets to send (default 100000)\n"
+"            -f|--fingers N             contacts per packet, 1-10 (default 2)\n"
+"            -i|--interval US           delay between packets (default 0)\n"
+"            -u|--uinput PATH           uinput node (default /dev/uinput)\n"
+"            -h|--help                  Show this usage message\n");
+}
+
+static double now_s(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static int create_device(const char *path)
+{
+	struct uinput_user_dev dev;
+	int fd;
+
+	fd = open(path, O_WRONLY);
+	if (fd < 0) {
+		perror(path);
+		return -1;
+	}
+
+	memset(&dev, 0, sizeof(dev));
+	snprintf(dev.name, sizeof(dev.name), "%s-%d", BENCH_NAME, getpid());
+	dev.id.bustype = BUS_VIRTUAL;
+	dev.absmax[ABS_MT_SLOT] = MAX_FINGERS - 1;
+	dev.absmax[ABS_MT_TRACKING_ID] = 65535;
+	dev.absmax[ABS_MT_POSITION_X] = 4095;
+	dev.absmax[ABS_MT_POSITION_Y] = 4095;
+
+	if (ioctl(fd, UI_SET_EVBIT, EV_ABS) < 0 ||
+	    ioctl(fd, UI_SET_ABSBIT, ABS_MT_SLOT) < 0 ||
+	    ioctl(fd, UI_SET_ABSBIT, ABS_MT_TRACKING_ID) < 0 ||
+	    ioctl(fd, UI_SET_ABSBIT, ABS_MT_POSITION_X) < 0 ||
+	    ioctl(fd, UI_SET_ABSBIT, ABS_MT_POSITION_Y) < 0 ||
+	    write(fd, &dev, sizeof(dev)) != sizeof(dev) ||
+	    ioctl(fd, UI_DEV_CREATE) < 0) {
+		perror("uinput");
+		close(fd);
+		return -1;
+	}
+
+	return fd;
+}
+
+/* the evdev node shows up asynchronously, look it up by name */
+static int open_event_node(void)
+{
+	char want[UINPUT_MAX_NAME_SIZE], name[UINPUT_MAX_NAME_SIZE];
+	char path[32];
+	int tries, i, fd;
+
+	snprintf(want, sizeof(want), "%s-%d", BENCH_NAME, getpid());
+
+	for (tries = 0; tries < 100; tries++) {
+		for (i = 0; i < 64; i++) {
+			snprintf(path, sizeof(path), "/dev/input/event%d", i);
+			fd = open(path, O_RDONLY | O_NONBLOCK);
+			if (fd < 0)
+				continue;
+			memset(name, 0, sizeof(name));
+			if (ioctl(fd, EVIOCGNAME(sizeof(name) - 1), name) >= 0 &&
+			    !strcmp(name, want))
+				return fd;
+			close(fd);
+		}
+		usleep(10000);
+	}
+
+	fprintf(stderr, "no event node for %s\n", want);
+	return -1;
+}
+
+static void set_event(struct input_event *ev, int type, int code, int value)
+{
+	memset(ev, 0, sizeof(*ev));
+	ev->type = type;
+	ev->code = code;
+	ev->value = value;
+}
+
+static void writer(int fd)
+{
+	struct input_event pkt[MAX_FINGERS * 4 + 1];
+	int i, f, n;
+
+	for (i = 0; i < opt_packets; i++) {
+		n = 0;
+		for (f = 0; f < opt_fingers; f++) {
+			set_event(&pkt[n++], EV_ABS, ABS_MT_SLOT, f);
+			if (!i)
+				set_event(&pkt[n++], EV_ABS,
+					  ABS_MT_TRACKING_ID, f);
+			/* positions must change or the core drops them */
+			set_event(&pkt[n++], EV_ABS, ABS_MT_POSITION_X,
+				  (i + f * 100) & 4095);
+			set_event(&pkt[n++], EV_ABS, ABS_MT_POSITION_Y,
+				  (i * 3 + f * 100) & 4095);
+		}
+		set_event(&pkt[n++], EV_SYN, SYN_REPORT, 0);
+
+		if (write(fd, pkt, n * sizeof(pkt[0])) < 0) {
+			perror("write");
+			exit(1);
+		}
+		if (opt_interval)
+			usleep(opt_interval);
+	}
+	exit(0);
+}
+
+int main(int argc, char *argv[])
+{
+	const struct option opts[] = {
+		{ "packets",  1, NULL, 'p' },
+		{ "fingers",  1, NULL, 'f' },
+		{ "interval", 1, NULL, 'i' },
+		{ "uinput",   1, NULL, 'u' },
+		{ "help",     0, NULL, 'h' },
+		{ NULL,       0, NULL, 0 }
+	};
+	const char *uinput = "/dev/uinput";
+	struct input_event buf[READ_EVENTS];
+	unsigned long events = 0, packets = 0, reads = 0, dropped = 0;
+	double start = 0, end = 0;
+	struct pollfd pfd;
+	pid_t child;
+	int ufd, efd;
+	ssize_t len;
+	int c, i;
+
+	while ((c = getopt_long(argc, argv, "p:f:i:u:h", opts, NULL)) != -1) {
+		switch (c) {
+		case 'p':
+			opt_packets = atoi(optarg);
+			break;
+		case 'f':
+			opt_fingers = atoi(optarg);
+			break;
+		case 'i':
+			opt_interval = atoi(optarg);
+			break;
+		case 'u':
+			uinput = optarg;
+			break;
+		case 'h':
+			usage();
+			exit(0);
+		default:
+			usage();
+			exit(1);
+		}
+	}
+
+	if (opt_packets <= 0 || opt_fingers < 1 || opt_fingers > MAX_FINGERS ||
+	    opt_interval < 0) {
+		usage();
+		exit(1);
+	}
+
+	ufd = create_device(uinput);
+	if (ufd < 0)
+		exit(1);
+
+	efd = open_event_node();
+	if (efd < 0) {
+		ioctl(ufd, UI_DEV_DESTROY);
+		exit(1);
+	}
+
+	child = fork();
+	if (child < 0) {
+		perror("fork");
+		exit(1);
+	}
+	if (!child)
+		writer(ufd);
+
+	pfd.fd = efd;
+	pfd.events = POLLIN;
+
+	while (packets < (unsigned long)opt_packets) {
+		c = poll(&pfd, 1, IDLE_MS);
+		if (c < 0 && errno == EINTR)
+			continue;
+		if (c <= 0)
+			break;
+
+		len = read(efd, buf, sizeof(buf));
+		if (len < 0) {
+			if (errno == EAGAIN || errno == EINTR)
+				continue;
+			perror("read");
+			break;
+		}
+
+		if (!reads)
+			start = now_s();
+		end = now_s();
+		reads++;
+
+		for (i = 0; i < len / (ssize_t)sizeof(buf[0]); i++) {
+			events++;
+			if (buf[i].type != EV_SYN)
+				continue;
+			if (buf[i].code == SYN_REPORT)
+				packets++;
+			else if (buf[i].code == SYN_DROPPED)
+				dropped++;
+		}
+	}
+
+	kill(child, SIGTERM);
+	waitpid(child, NULL, 0);
+	ioctl(ufd, UI_DEV_DESTROY);
+	close(efd);
+	close(ufd);
+
+	printf("packets %lu/%d, events %lu, reads %lu, dropped %lu\n",
+	       packets, opt_packets, events, reads, dropped);
+	if (end > start)
+		printf("%.0f events/s, %.0f packets/s, %.2f reads/packet\n",
+		       events / (end - start), packets / (end - start),
+		       packets ? (double)reads / packets : 0.0);
+
+	return packets == (unsigned long)opt_packets ? 0 : 1;
+}
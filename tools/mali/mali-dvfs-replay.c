@@ -0,0 +1,399 @@
+/*
+ * mali-dvfs-replay: replay recorded Mali GP/PP job traces against the
+ * frame based DVFS policy and the utilization governor
+ *
+ * The trace is plain text, one event per line, '#' starts a comment:
+ *
+ *	<start_us> <end_us> gp|pp<N>	a job, timed at the reference clock (-c)
+ *	<time_us> vsync			a vsync wait completed (frame boundary)
+ *
+ * which is what the GP/PP start/stop and vsync events of the
+ * mali_timeline_event tracepoint reduce to.  Job durations are scaled by the
+ * clock the simulated governor picks; a job starts at its recorded time or
+ * when its core frees up, whichever is later.  The frame policy is built from
+ * the driver's own mali_kernel_frame_policy.h and maps its scale onto the
+ * step table the way the exynos4415 platform code does; the utilization
+ * governor mimics the 100ms threshold governor of the same platform.  Clock
+ * changes take effect at frame boundaries.  A frame is late when work
+ * submitted in it is still running at the next vsync.
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the Free
+ * Software Foundation; version 2.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <getopt.h>
+
+typedef uint32_t u32;
+typedef int32_t s32;
+#define MALI_STATIC_INLINE static inline
+#include "../../drivers/gpu/arm/mali400/r4p0_rel0/common/mali_kernel_frame_policy.h"
+
+#define MAX_STEPS	16
+#define MAX_UNITS	9	/* gp + up to 8 pp cores */
+#define UTIL_WINDOW_US	100000
+#define UTIL_STAY	5
+
+enum policy {
+	POLICY_FRAME,
+	POLICY_UTIL,
+};
+
+struct job {
+	int unit;
+	long long rec_start, rec_end;
+	long long start, end;
+};
+
+struct interval {
+	long long start, end;
+};
+
+/* exynos4415 4 step table */
+static unsigned int clocks[MAX_STEPS] = { 160, 266, 350, 440 };
+static unsigned int up_pct[MAX_STEPS] = { 70, 90, 90, 100 };
+static unsigned int down_pct[MAX_STEPS] = { 0, 62, 85, 85 };
+static int nr_steps = 4;
+
+static unsigned int opt_ref_clock = 440;
+static int opt_fps = 60;
+static int opt_start_step = 1;
+static int opt_verbose;
+
+static struct job *jobs;
+static int nr_jobs;
+static long long *vsyncs;
+static int nr_vsyncs;
+static struct interval *scratch;
+
+static void usage(void)
+{
+	printf(
+"mali-dvfs-replay [options] [trace]\n"
+"            -p|--policy frame|util|both  governor(s) to replay (default both)\n"
+"            -c|--ref-clock MHZ           clock the trace was recorded at (default 440)\n"
+"            -f|--clocks A,B,...          step table in MHz (default 160,266,350,440)\n"
+"            -s|--start-step N            initial step (default 1)\n"
+"            -F|--fps N                   target frame rate (default 60)\n"
+"            -v|--verbose                 print every frame\n"
+"            -h|--help                    Show this usage message\n");
+}
+
+static int cmp_job(const void *a, const void *b)
+{
+	const struct job *x = a, *y = b;
+
+	return (x->rec_start > y->rec_start) - (x->rec_start < y->rec_start);
+}
+
+static int cmp_ll(const void *a, const void *b)
+{
+	const long long *x = a, *y = b;
+
+	return (*x > *y) - (*x < *y);
+}
+
+static int cmp_interval(const void *a, const void *b)
+{
+	const struct interval *x = a, *y = b;
+
+	return (x->start > y->start) - (x->start < y->start);
+}
+
+static void *grow(void *p, int nr, size_t size)
+{
+	if (nr & (nr - 1))
+		return p;
+	p = realloc(p, (nr ? nr * 2 : 64) * size);
+	if (!p) {
+		perror("realloc");
+		exit(1);
+	}
+	return p;
+}
+
+static void read_trace(FILE *f)
+{
+	char line[256], what[16];
+	long long a, b;
+	int unit, n;
+
+	while (fgets(line, sizeof(line), f)) {
+		if (line[0] == '#' || line[0] == '\n')
+			continue;
+
+		n = sscanf(line, "%lld %lld %15s", &a, &b, what);
+		if (n == 3 && (!strcmp(what, "gp") ||
+			       (!strncmp(what, "pp", 2) &&
+				sscanf(what + 2, "%d", &unit) == 1))) {
+			unit = what[0] == 'g' ? 0 : unit + 1;
+			if (unit < 0 || unit >= MAX_UNITS || b < a) {
+				fprintf(stderr, "bad job: %s", line);
+				exit(1);
+			}
+			jobs = grow(jobs, nr_jobs, sizeof(*jobs));
+			jobs[nr_jobs].unit = unit;
+			jobs[nr_jobs].rec_start = a;
+			jobs[nr_jobs].rec_end = b;
+			nr_jobs++;
+			continue;
+		}
+
+		if (sscanf(line, "%lld %15s", &a, what) == 2 &&
+		    !strcmp(what, "vsync")) {
+			vsyncs = grow(vsyncs, nr_vsyncs, sizeof(*vsyncs));
+			vsyncs[nr_vsyncs++] = a;
+			continue;
+		}
+
+		fprintf(stderr, "cannot parse: %s", line);
+		exit(1);
+	}
+
+	qsort(jobs, nr_jobs, sizeof(*jobs), cmp_job);
+	qsort(vsyncs, nr_vsyncs, sizeof(*vsyncs), cmp_ll);
+
+	scratch = malloc((nr_jobs ? nr_jobs : 1) * sizeof(*scratch));
+	if (!scratch) {
+		perror("malloc");
+		exit(1);
+	}
+}
+
+/* GPU busy time in [from, to): union of all scheduled jobs, first..last */
+static long long busy_time(int first, int last, long long from, long long to)
+{
+	long long busy = 0, start = 0, end = 0;
+	int i, n = 0;
+
+	for (i = first; i < last; i++) {
+		if (jobs[i].end <= from || jobs[i].start >= to)
+			continue;
+		scratch[n].start = jobs[i].start > from ? jobs[i].start : from;
+		scratch[n].end = jobs[i].end < to ? jobs[i].end : to;
+		n++;
+	}
+	qsort(scratch, n, sizeof(*scratch), cmp_interval);
+
+	for (i = 0; i < n; i++) {
+		if (i == 0 || scratch[i].start > end) {
+			busy += end - start;
+			start = scratch[i].start;
+			end = scratch[i].end;
+		} else if (scratch[i].end > end) {
+			end = scratch[i].end;
+		}
+	}
+	return busy + end - start;
+}
+
+/* the same step selection as mali_gpu_frame_handler() */
+static int frame_step(int cur, u32 scale)
+{
+	unsigned int want = (clocks[cur] * scale + 255) / 256;
+	int step = cur;
+
+	if (scale > 256) {
+		while (step < nr_steps - 1 && clocks[step] < want)
+			step++;
+	} else if (scale < 256) {
+		while (step > 0 && clocks[step - 1] >= want)
+			step--;
+	}
+	return step;
+}
+
+static void replay(enum policy policy)
+{
+	struct mali_frame_policy fp;
+	long long unit_free[MAX_UNITS] = { 0 };
+	long long target = 1000000 / opt_fps;
+	long long win_start, frame_us, gpu_us, worst = 0, total = 0;
+	unsigned long long clock_us = 0;
+	unsigned long late = 0, switches = 0, frames = 0;
+	int cur = opt_start_step, level = opt_start_step, stay = UTIL_STAY;
+	int next = 0, live = 0, i, step;
+	u32 scale = 256, predicted = 0, applied;
+
+	mali_frame_policy_reset(&fp);
+	win_start = nr_vsyncs ? vsyncs[0] : 0;
+
+	for (i = 1; i < nr_vsyncs; i++) {
+		long long from = vsyncs[i - 1], to = vsyncs[i], done = 0;
+
+		/* jobs submitted during this frame run at the current clock */
+		for (; next < nr_jobs && jobs[next].rec_start < to; next++) {
+			struct job *j = &jobs[next];
+			long long dur = (j->rec_end - j->rec_start) *
+				opt_ref_clock / clocks[cur];
+
+			j->start = j->rec_start > unit_free[j->unit] ?
+				j->rec_start : unit_free[j->unit];
+			j->end = j->start + dur;
+			unit_free[j->unit] = j->end;
+			if (j->end > done)
+				done = j->end;
+		}
+		while (live < next && jobs[live].end <= from)
+			live++;
+
+		frame_us = to - from;
+		gpu_us = busy_time(live, next, from, to);
+		frames++;
+		total += frame_us;
+		clock_us += (unsigned long long)clocks[cur] * frame_us;
+		/* the frame's work did not make it to the vsync */
+		if (done > to)
+			late++;
+		if (gpu_us > worst)
+			worst = gpu_us;
+
+		step = cur;
+		if (policy == POLICY_FRAME) {
+			scale = mali_frame_policy_update(&fp, frame_us, gpu_us, target);
+			predicted = fp.predicted_us;
+			step = frame_step(cur, scale);
+			applied = clocks[step] * 256 / clocks[cur];
+			mali_frame_policy_rescale(&fp, applied);
+		} else {
+			/* the governor runs off its own timer, not off frames */
+			for (; win_start + UTIL_WINDOW_US <= to; win_start += UTIL_WINDOW_US) {
+				unsigned int util = busy_time(live, next, win_start,
+						win_start + UTIL_WINDOW_US) * 256 / UTIL_WINDOW_US;
+
+				if (util > 255 * up_pct[step] / 100 && level < nr_steps - 1)
+					level++;
+				else if (util < 255 * down_pct[step] / 100 && level > 0)
+					level--;
+
+				if (level == step) {
+					stay = UTIL_STAY;
+				} else if (level > step) {
+					step = level;
+					stay = UTIL_STAY;
+				} else if (--stay <= 0) {
+					step = level;
+					stay = UTIL_STAY;
+				}
+			}
+		}
+
+		if (opt_verbose)
+			printf("%-5s frame %6lu: %6lld us, gpu %6lld us at %3u MHz%s",
+			       policy == POLICY_FRAME ? "frame" : "util",
+			       frames, frame_us, gpu_us, clocks[cur],
+			       done > to ? " LATE" : "");
+		if (opt_verbose && policy == POLICY_FRAME)
+			printf(", predicted %u us, scale %u", predicted, scale);
+		if (opt_verbose)
+			printf("%s\n", step != cur ? " *" : "");
+
+		if (step != cur)
+			switches++;
+		cur = step;
+	}
+
+	if (!frames) {
+		printf("%-5s: no complete frames in the trace\n",
+		       policy == POLICY_FRAME ? "frame" : "util");
+		return;
+	}
+
+	printf("%-5s: frames %6lu  late %5lu (%5.1f%%)  worst %6lld us  "
+	       "avg clock %6.1f MHz  switches %lu\n",
+	       policy == POLICY_FRAME ? "frame" : "util", frames, late,
+	       100.0 * late / frames, worst, (double)clock_us / total, switches);
+}
+
+static void parse_clocks(char *arg)
+{
+	char *tok;
+
+	nr_steps = 0;
+	for (tok = strtok(arg, ","); tok; tok = strtok(NULL, ",")) {
+		if (nr_steps == MAX_STEPS || atoi(tok) <= 0) {
+			usage();
+			exit(1);
+		}
+		clocks[nr_steps] = atoi(tok);
+		/* generic thresholds for a table without its own */
+		down_pct[nr_steps] = nr_steps ? 60 : 0;
+		up_pct[nr_steps] = 90;
+		nr_steps++;
+	}
+}
+
+int main(int argc, char *argv[])
+{
+	const struct option opts[] = {
+		{ "policy",     1, NULL, 'p' },
+		{ "ref-clock",  1, NULL, 'c' },
+		{ "clocks",     1, NULL, 'f' },
+		{ "start-step", 1, NULL, 's' },
+		{ "fps",        1, NULL, 'F' },
+		{ "verbose",    0, NULL, 'v' },
+		{ "help",       0, NULL, 'h' },
+		{ NULL,         0, NULL, 0 }
+	};
+	int do_frame = 1, do_util = 1;
+	FILE *f = stdin;
+	int c;
+
+	while ((c = getopt_long(argc, argv, "p:c:f:s:F:vh", opts, NULL)) != -1) {
+		switch (c) {
+		case 'p':
+			do_frame = !strcmp(optarg, "frame") || !strcmp(optarg, "both");
+			do_util = !strcmp(optarg, "util") || !strcmp(optarg, "both");
+			break;
+		case 'c':
+			opt_ref_clock = atoi(optarg);
+			break;
+		case 'f':
+			parse_clocks(optarg);
+			break;
+		case 's':
+			opt_start_step = atoi(optarg);
+			break;
+		case 'F':
+			opt_fps = atoi(optarg);
+			break;
+		case 'v':
+			opt_verbose = 1;
+			break;
+		case 'h':
+			usage();
+			exit(0);
+		default:
+			usage();
+			exit(1);
+		}
+	}
+
+	if ((!do_frame && !do_util) || opt_fps <= 0 || !opt_ref_clock ||
+	    !nr_steps || opt_start_step < 0 || opt_start_step >= nr_steps) {
+		usage();
+		exit(1);
+	}
+
+	if (optind < argc) {
+		f = fopen(argv[optind], "r");
+		if (!f) {
+			perror(argv[optind]);
+			exit(1);
+		}
+	}
+	read_trace(f);
+	if (f != stdin)
+		fclose(f);
+
+	if (do_util)
+		replay(POLICY_UTIL);
+	if (do_frame)
+		replay(POLICY_FRAME);
+
+	return 0;
+}
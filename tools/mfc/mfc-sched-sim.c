@@ -0,0 +1,301 @@
+/*
+ * mfc-sched-sim: run the MFC context scheduling policy against a simulated
+ * codec
+ *
+ * Each stream is a context with a scheduling priority, an optional frame
+ * deadline hint and a frame source:
+ *
+ *	-s prio,period_us,interval_us,frame_us,frames
+ *
+ * A stream with an interval gets a new frame every interval_us, one that
+ * has none has all of its frames queued up front (a transcode or a
+ * thumbnail job).  The simulated hardware runs one frame at a time for
+ * frame_us, +/- the jitter given with -j.  A frame is late when it is done
+ * after its period_us from arrival; streams without a period are never
+ * late.  Like the driver, the next context is picked whenever the hardware
+ * goes idle, either by the driver's own s5p_mfc_sched.h or by the round
+ * robin it replaced.
+ *
+ * Without -s, a 60 fps playback, a 30 fps video call encoder and a
+ * background thumbnail decode are simulated.
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the Free
+ * Software Foundation; version 2.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <getopt.h>
+
+typedef uint32_t u32;
+typedef uint64_t u64;
+#include "../../drivers/media/video/exynos/mfc/s5p_mfc_sched.h"
+
+#define MAX_STREAMS	16
+
+enum policy {
+	POLICY_EDF,
+	POLICY_RR,
+};
+
+struct stream {
+	int prio;
+	u32 period_us;
+	u32 interval_us;
+	u32 frame_us;
+	int frames;
+
+	/* simulation state */
+	struct s5p_mfc_sched_entity ent;
+	int done;
+	int late;
+	u64 lat_sum;
+	u64 lat_max;
+	u64 last_done;
+};
+
+static struct stream streams[MAX_STREAMS];
+static int nr_streams;
+
+static int opt_jitter = 20;
+static unsigned int opt_seed = 1;
+static int opt_verbose;
+
+static void usage(void)
+{
+	printf(
+"mfc-sched-sim [options]\n"
+"            -s|--stream P,D,I,F,N      add a stream: priority, deadline us,\n"
+"                                       frame interval us (0 = all queued),\n"
+"                                       frame time us, number of frames\n"
+"            -p|--policy edf|rr|both    policy to simulate (default both)\n"
+"            -j|--jitter PCT            frame time jitter (default 20)\n"
+"            -S|--seed N                random seed (default 1)\n"
+"            -v|--verbose               print every dispatch\n"
+"            -h|--help                  Show this usage message\n");
+}
+
+static int add_stream(const char *arg)
+{
+	struct stream *s;
+
+	if (nr_streams == MAX_STREAMS)
+		return -1;
+
+	s = &streams[nr_streams];
+	memset(s, 0, sizeof(*s));
+	if (sscanf(arg, "%d,%u,%u,%u,%d", &s->prio, &s->period_us,
+		   &s->interval_us, &s->frame_us, &s->frames) != 5)
+		return -1;
+	if (s->prio < 0 || s->frames <= 0 || !s->frame_us)
+		return -1;
+
+	nr_streams++;
+	return 0;
+}
+
+/* arrival time of frame n of s */
+static u64 arrival(struct stream *s, int n)
+{
+	return (u64)n * s->interval_us;
+}
+
+static int runnable(struct stream *s, u64 now)
+{
+	return s->done < s->frames && arrival(s, s->done) <= now;
+}
+
+static int pick_rr(unsigned long work_bits, int prev)
+{
+	int i, n;
+
+	for (n = 1; n <= nr_streams; n++) {
+		i = (prev + n) % nr_streams;
+		if (work_bits & (1UL << i))
+			return i;
+	}
+	return -1;
+}
+
+static u32 frame_time(struct stream *s)
+{
+	int jitter = 0;
+
+	if (opt_jitter)
+		jitter = rand() % (2 * opt_jitter + 1) - opt_jitter;
+
+	return s->frame_us + (long long)s->frame_us * jitter / 100;
+}
+
+static void simulate(enum policy policy)
+{
+	struct s5p_mfc_sched_entity *ent[MAX_STREAMS];
+	unsigned long work_bits;
+	u64 now = 0, next, busy = 0;
+	int remaining = 0;
+	int prev = -1;
+	int i;
+
+	srand(opt_seed);
+	for (i = 0; i < nr_streams; i++) {
+		struct stream *s = &streams[i];
+
+		s->done = 0;
+		s->late = 0;
+		s->lat_sum = 0;
+		s->lat_max = 0;
+		s->last_done = 0;
+		memset(&s->ent, 0, sizeof(s->ent));
+		s->ent.prio = s->prio;
+		s->ent.period_us = s->period_us;
+		ent[i] = &s->ent;
+		remaining += s->frames;
+	}
+
+	while (remaining) {
+		struct stream *s;
+		u64 start, lat;
+		u32 t;
+
+		work_bits = 0;
+		next = ~0ULL;
+		for (i = 0; i < nr_streams; i++) {
+			s = &streams[i];
+			if (runnable(s, now))
+				work_bits |= 1UL << i;
+			else if (s->done < s->frames &&
+				 arrival(s, s->done) < next)
+				next = arrival(s, s->done);
+		}
+
+		if (!work_bits) {
+			/* hardware idle until the next frame arrives */
+			now = next;
+			continue;
+		}
+
+		if (policy == POLICY_EDF)
+			i = s5p_mfc_sched_pick(ent, nr_streams, work_bits,
+					       prev, now);
+		else
+			i = pick_rr(work_bits, prev < 0 ? nr_streams - 1 : prev);
+
+		s = &streams[i];
+		s5p_mfc_sched_charge(&s->ent, now);
+
+		start = now;
+		t = frame_time(s);
+		now += t;
+		busy += t;
+
+		lat = now - arrival(s, s->done);
+		s->lat_sum += lat;
+		if (lat > s->lat_max)
+			s->lat_max = lat;
+		if (s->period_us && lat > s->period_us)
+			s->late++;
+		s->last_done = now;
+
+		if (opt_verbose)
+			printf("%10llu %10llu stream %d frame %d%s\n",
+			       (unsigned long long)start,
+			       (unsigned long long)now, i, s->done,
+			       s->period_us && lat > s->period_us ?
+					" late" : "");
+
+		s->done++;
+		remaining--;
+		prev = i;
+	}
+
+	printf("policy %s: %llu us, hardware busy %llu%%\n",
+	       policy == POLICY_EDF ? "edf" : "rr",
+	       (unsigned long long)now,
+	       now ? (unsigned long long)(busy * 100 / now) : 0ULL);
+	printf("%6s %4s %9s %7s %7s %10s %10s %8s\n", "stream", "prio",
+	       "period_us", "frames", "late", "lat_avg_us", "lat_max_us",
+	       "fps");
+	for (i = 0; i < nr_streams; i++) {
+		struct stream *s = &streams[i];
+
+		printf("%6d %4d %9u %7d %7d %10llu %10llu %8.1f\n", i,
+		       s->prio, s->period_us, s->done, s->late,
+		       (unsigned long long)(s->lat_sum / s->done),
+		       (unsigned long long)s->lat_max,
+		       s->last_done ? s->done * 1e6 / s->last_done : 0.0);
+	}
+}
+
+int main(int argc, char *argv[])
+{
+	const struct option opts[] = {
+		{ "stream",  1, NULL, 's' },
+		{ "policy",  1, NULL, 'p' },
+		{ "jitter",  1, NULL, 'j' },
+		{ "seed",    1, NULL, 'S' },
+		{ "verbose", 0, NULL, 'v' },
+		{ "help",    0, NULL, 'h' },
+		{ NULL,      0, NULL, 0 }
+	};
+	int run_edf = 1, run_rr = 1;
+	int c;
+
+	while ((c = getopt_long(argc, argv, "s:p:j:S:vh", opts, NULL)) != -1) {
+		switch (c) {
+		case 's':
+			if (add_stream(optarg)) {
+				fprintf(stderr, "bad stream '%s'\n", optarg);
+				exit(1);
+			}
+			break;
+		case 'p':
+			run_edf = !strcmp(optarg, "edf") ||
+				  !strcmp(optarg, "both");
+			run_rr = !strcmp(optarg, "rr") ||
+				 !strcmp(optarg, "both");
+			if (!run_edf && !run_rr) {
+				usage();
+				exit(1);
+			}
+			break;
+		case 'j':
+			opt_jitter = atoi(optarg);
+			break;
+		case 'S':
+			opt_seed = atoi(optarg);
+			break;
+		case 'v':
+			opt_verbose = 1;
+			break;
+		case 'h':
+			usage();
+			exit(0);
+		default:
+			usage();
+			exit(1);
+		}
+	}
+
+	if (opt_jitter < 0 || opt_jitter > 100) {
+		usage();
+		exit(1);
+	}
+
+	if (!nr_streams) {
+		add_stream("0,16666,16666,7000,600");	/* 60 fps playback */
+		add_stream("0,33333,33333,6000,300");	/* 30 fps video call */
+		add_stream("2,0,0,9000,600");		/* thumbnails */
+	}
+
+	if (run_edf)
+		simulate(POLICY_EDF);
+	if (run_edf && run_rr)
+		printf("\n");
+	if (run_rr)
+		simulate(POLICY_RR);
+
+	return 0;
+}
@@ -0,0 +1,460 @@
+/*
+ * pcm-latency: measure the round trip latency of a PCM playback/capture
+ * pair and the granularity of the playback hardware pointer
+ *
+ * Silence is played with the playback buffer kept at -l frames, with a
+ * one frame pulse every half second; the time from writing a pulse until
+ * it is read back on the capture side is the round trip latency.  Without
+ * a cable from the output back to the input, run it over the loopback
+ * driver (snd-aloop), whose playback device 0 is captured on device 1;
+ * that is also what is used when no device is given.
+ *
+ * With -n the playback and capture streams are opened without period
+ * wakeups (SNDRV_PCM_HW_PARAMS_NO_PERIOD_WAKEUP), and the program wakes
+ * up every -w us to look at the buffer positions instead of waiting for
+ * a period.  That only works as well as the driver reports positions
+ * between period interrupts, which is the "hw_ptr step" in the summary.
+ *
+ * Only the kernel ALSA ioctls are used, no alsa-lib.
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the Free
+ * Software Foundation; version 2.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <time.h>
+#include <errno.h>
+#include <limits.h>
+#include <getopt.h>
+#include <sys/ioctl.h>
+#include <sound/asound.h>
+
+#define CHANNELS	2
+#define FRAME_BYTES	(CHANNELS * 2)
+#define PULSE		32767
+#define THRESHOLD	16384
+#define MAX_CARDS	32
+
+struct pcm {
+	const char *path;
+	int fd;
+	int capture;
+	unsigned int period_size;
+	unsigned int buffer_size;
+};
+
+static unsigned int opt_rate = 48000;
+static unsigned int opt_period = 256;
+static unsigned int opt_periods = 4;
+static unsigned int opt_fill;
+static unsigned int opt_wake_us;
+static int opt_count = 20;
+static int opt_no_wakeup;
+static int opt_verbose;
+
+static void usage(void)
+{
+	printf(
+"pcm-latency [options]\n"
+"            -P|--playback PATH         playback node, default the loopback\n"
+"                                       card's pcmC<n>D0p\n"
+"            -C|--capture PATH          capture node, default pcmC<n>D1c\n"
+"            -r|--rate HZ               sample rate (default 48000)\n"
+"            -p|--period FRAMES         period size (default 256)\n"
+"            -b|--periods N             periods per buffer (default 4)\n"
+"            -l|--fill FRAMES           playback fill (default 2 periods)\n"
+"            -n|--no-wakeup             no period wakeups, poll positions\n"
+"            -w|--wake US               poll interval with -n (default\n"
+"                                       a quarter period)\n"
+"            -c|--count N               pulses to measure (default 20)\n"
+"            -v|--verbose               print every pulse\n"
+"            -h|--help                  Show this usage message\n");
+}
+
+static double now_us(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec * 1e6 + ts.tv_nsec / 1e3;
+}
+
+/* card number of the loopback driver, from /proc/asound/card<n>/id */
+static int find_loopback(void)
+{
+	char path[64], id[32];
+	FILE *f;
+	int card;
+
+	for (card = 0; card < MAX_CARDS; card++) {
+		snprintf(path, sizeof(path), "/proc/asound/card%d/id", card);
+		f = fopen(path, "r");
+		if (!f)
+			continue;
+		if (fgets(id, sizeof(id), f) && !strncmp(id, "Loopback", 8)) {
+			fclose(f);
+			return card;
+		}
+		fclose(f);
+	}
+
+	return -1;
+}
+
+static struct snd_mask *param_mask(struct snd_pcm_hw_params *p, int n)
+{
+	return &p->masks[n - SNDRV_PCM_HW_PARAM_FIRST_MASK];
+}
+
+static struct snd_interval *param_interval(struct snd_pcm_hw_params *p, int n)
+{
+	return &p->intervals[n - SNDRV_PCM_HW_PARAM_FIRST_INTERVAL];
+}
+
+static void param_init(struct snd_pcm_hw_params *p)
+{
+	int n;
+
+	memset(p, 0, sizeof(*p));
+	for (n = SNDRV_PCM_HW_PARAM_FIRST_MASK;
+	     n <= SNDRV_PCM_HW_PARAM_LAST_MASK; n++)
+		memset(param_mask(p, n), 0xff, sizeof(struct snd_mask));
+	for (n = SNDRV_PCM_HW_PARAM_FIRST_INTERVAL;
+	     n <= SNDRV_PCM_HW_PARAM_LAST_INTERVAL; n++)
+		param_interval(p, n)->max = UINT_MAX;
+	p->rmask = ~0U;
+	p->info = ~0U;
+}
+
+static void param_set_mask(struct snd_pcm_hw_params *p, int n,
+			   unsigned int bit)
+{
+	struct snd_mask *m = param_mask(p, n);
+
+	memset(m, 0, sizeof(*m));
+	m->bits[bit >> 5] = 1U << (bit & 31);
+}
+
+static void param_set_int(struct snd_pcm_hw_params *p, int n,
+			  unsigned int val)
+{
+	struct snd_interval *i = param_interval(p, n);
+
+	i->min = val;
+	i->max = val;
+	i->integer = 1;
+}
+
+static int pcm_open(struct pcm *pcm)
+{
+	struct snd_pcm_hw_params hw;
+	struct snd_pcm_sw_params sw;
+	unsigned long boundary;
+
+	pcm->fd = open(pcm->path, O_RDWR | O_NONBLOCK);
+	if (pcm->fd < 0) {
+		perror(pcm->path);
+		return -1;
+	}
+
+	param_init(&hw);
+	param_set_mask(&hw, SNDRV_PCM_HW_PARAM_ACCESS,
+		       SNDRV_PCM_ACCESS_RW_INTERLEAVED);
+	param_set_mask(&hw, SNDRV_PCM_HW_PARAM_FORMAT,
+		       SNDRV_PCM_FORMAT_S16_LE);
+	param_set_mask(&hw, SNDRV_PCM_HW_PARAM_SUBFORMAT,
+		       SNDRV_PCM_SUBFORMAT_STD);
+	param_set_int(&hw, SNDRV_PCM_HW_PARAM_CHANNELS, CHANNELS);
+	param_set_int(&hw, SNDRV_PCM_HW_PARAM_RATE, opt_rate);
+	param_set_int(&hw, SNDRV_PCM_HW_PARAM_PERIOD_SIZE, opt_period);
+	param_set_int(&hw, SNDRV_PCM_HW_PARAM_PERIODS, opt_periods);
+	if (opt_no_wakeup)
+		hw.flags |= SNDRV_PCM_HW_PARAMS_NO_PERIOD_WAKEUP;
+
+	if (ioctl(pcm->fd, SNDRV_PCM_IOCTL_HW_PARAMS, &hw) < 0) {
+		fprintf(stderr, "%s: hw_params: %s\n", pcm->path,
+			strerror(errno));
+		return -1;
+	}
+	if (opt_no_wakeup && !(hw.info & SNDRV_PCM_INFO_NO_PERIOD_WAKEUP))
+		fprintf(stderr, "%s: period wakeups cannot be disabled\n",
+			pcm->path);
+
+	pcm->period_size = param_interval(&hw,
+				SNDRV_PCM_HW_PARAM_PERIOD_SIZE)->min;
+	pcm->buffer_size = param_interval(&hw,
+				SNDRV_PCM_HW_PARAM_BUFFER_SIZE)->min;
+
+	boundary = pcm->buffer_size;
+	while (boundary * 2 <= (unsigned long)LONG_MAX - pcm->buffer_size)
+		boundary *= 2;
+
+	memset(&sw, 0, sizeof(sw));
+	sw.tstamp_mode = SNDRV_PCM_TSTAMP_NONE;
+	sw.period_step = 1;
+	sw.avail_min = opt_no_wakeup ? pcm->buffer_size : pcm->period_size;
+	sw.start_threshold = boundary;	/* started by hand */
+	sw.stop_threshold = pcm->buffer_size;
+	sw.boundary = boundary;
+
+	if (ioctl(pcm->fd, SNDRV_PCM_IOCTL_SW_PARAMS, &sw) < 0) {
+		fprintf(stderr, "%s: sw_params: %s\n", pcm->path,
+			strerror(errno));
+		return -1;
+	}
+
+	if (ioctl(pcm->fd, SNDRV_PCM_IOCTL_PREPARE) < 0) {
+		fprintf(stderr, "%s: prepare: %s\n", pcm->path,
+			strerror(errno));
+		return -1;
+	}
+
+	return 0;
+}
+
+static int pcm_status(struct pcm *pcm, struct snd_pcm_status *status)
+{
+	memset(status, 0, sizeof(*status));
+	if (ioctl(pcm->fd, SNDRV_PCM_IOCTL_STATUS, status) < 0)
+		return -errno;
+	if (status->state == SNDRV_PCM_STATE_XRUN)
+		return -EPIPE;
+	return 0;
+}
+
+static long pcm_xfer(struct pcm *pcm, short *buf, unsigned long frames)
+{
+	struct snd_xferi x;
+
+	x.result = 0;
+	x.buf = buf;
+	x.frames = frames;
+
+	if (ioctl(pcm->fd, pcm->capture ? SNDRV_PCM_IOCTL_READI_FRAMES :
+		  SNDRV_PCM_IOCTL_WRITEI_FRAMES, &x) < 0)
+		return errno == EAGAIN ? 0 : -errno;
+
+	return x.result;
+}
+
+int main(int argc, char *argv[])
+{
+	const struct option opts[] = {
+		{ "playback",  1, NULL, 'P' },
+		{ "capture",   1, NULL, 'C' },
+		{ "rate",      1, NULL, 'r' },
+		{ "period",    1, NULL, 'p' },
+		{ "periods",   1, NULL, 'b' },
+		{ "fill",      1, NULL, 'l' },
+		{ "no-wakeup", 0, NULL, 'n' },
+		{ "wake",      1, NULL, 'w' },
+		{ "count",     1, NULL, 'c' },
+		{ "verbose",   0, NULL, 'v' },
+		{ "help",      0, NULL, 'h' },
+		{ NULL,        0, NULL, 0 }
+	};
+	char play_path[32], cap_path[32];
+	struct pcm play = { .capture = 0 }, cap = { .capture = 1 };
+	struct snd_pcm_status status;
+	struct pollfd pfd[2];
+	short *buf;
+	unsigned long written = 0, next_pulse, hw_ptr = 0, step = ~0UL;
+	double t_pulse = 0, lat, lat_min = 1e12, lat_max = 0, lat_sum = 0;
+	unsigned long queued = 0, wakeups = 0;
+	int measured = 0, pending = 0;
+	long n, i;
+	int c, card;
+
+	while ((c = getopt_long(argc, argv, "P:C:r:p:b:l:nw:c:vh", opts,
+				NULL)) != -1) {
+		switch (c) {
+		case 'P':
+			play.path = optarg;
+			break;
+		case 'C':
+			cap.path = optarg;
+			break;
+		case 'r':
+			opt_rate = atoi(optarg);
+			break;
+		case 'p':
+			opt_period = atoi(optarg);
+			break;
+		case 'b':
+			opt_periods = atoi(optarg);
+			break;
+		case 'l':
+			opt_fill = atoi(optarg);
+			break;
+		case 'n':
+			opt_no_wakeup = 1;
+			break;
+		case 'w':
+			opt_wake_us = atoi(optarg);
+			break;
+		case 'c':
+			opt_count = atoi(optarg);
+			break;
+		case 'v':
+			opt_verbose = 1;
+			break;
+		case 'h':
+			usage();
+			exit(0);
+		default:
+			usage();
+			exit(1);
+		}
+	}
+
+	if (!opt_rate || !opt_period || !opt_periods || opt_count <= 0) {
+		usage();
+		exit(1);
+	}
+
+	if (!play.path || !cap.path) {
+		card = find_loopback();
+		if (card < 0) {
+			fprintf(stderr, "no loopback card, load snd-aloop or "
+				"give -P and -C\n");
+			exit(1);
+		}
+		snprintf(play_path, sizeof(play_path),
+			 "/dev/snd/pcmC%dD0p", card);
+		snprintf(cap_path, sizeof(cap_path),
+			 "/dev/snd/pcmC%dD1c", card);
+		if (!play.path)
+			play.path = play_path;
+		if (!cap.path)
+			cap.path = cap_path;
+	}
+
+	if (pcm_open(&play) || pcm_open(&cap))
+		exit(1);
+
+	if (!opt_fill)
+		opt_fill = 2 * play.period_size;
+	if (opt_fill > play.buffer_size)
+		opt_fill = play.buffer_size;
+	if (!opt_wake_us)
+		opt_wake_us = 1000000ULL * play.period_size / opt_rate / 4;
+
+	buf = calloc(play.buffer_size > cap.buffer_size ?
+		     play.buffer_size : cap.buffer_size, FRAME_BYTES);
+	if (!buf) {
+		perror("calloc");
+		exit(1);
+	}
+
+	/* prefill with silence, then start both ends together */
+	if (pcm_xfer(&play, buf, opt_fill) != (long)opt_fill) {
+		fprintf(stderr, "prefill failed\n");
+		exit(1);
+	}
+	written = opt_fill;
+	next_pulse = written + opt_rate / 2;
+
+	ioctl(play.fd, SNDRV_PCM_IOCTL_LINK, cap.fd);
+	if (ioctl(cap.fd, SNDRV_PCM_IOCTL_START) < 0 && errno != EBADFD) {
+		perror("start capture");
+		exit(1);
+	}
+	ioctl(play.fd, SNDRV_PCM_IOCTL_START);
+
+	pfd[0].fd = play.fd;
+	pfd[0].events = POLLOUT;
+	pfd[1].fd = cap.fd;
+	pfd[1].events = POLLIN;
+
+	while (measured < opt_count) {
+		if (opt_no_wakeup)
+			usleep(opt_wake_us);
+		else
+			poll(pfd, 2, 1000);
+		wakeups++;
+
+		if (pcm_status(&play, &status) < 0) {
+			fprintf(stderr, "playback xrun after %d pulses\n",
+				measured);
+			break;
+		}
+		if (status.hw_ptr > hw_ptr && status.hw_ptr - hw_ptr < step)
+			step = status.hw_ptr - hw_ptr;
+		hw_ptr = status.hw_ptr;
+
+		/* top the playback buffer back up to the fill level */
+		if ((unsigned long)status.delay < opt_fill) {
+			unsigned long frames = opt_fill - status.delay;
+
+			memset(buf, 0, frames * FRAME_BYTES);
+			if (!pending && written + frames > next_pulse) {
+				i = next_pulse - written;
+				buf[i * CHANNELS] = PULSE;
+				buf[i * CHANNELS + 1] = PULSE;
+				t_pulse = now_us();
+				queued = status.delay + i;
+				pending = 1;
+			}
+			n = pcm_xfer(&play, buf, frames);
+			if (n < 0) {
+				fprintf(stderr, "write: %s\n", strerror(-n));
+				break;
+			}
+			written += n;
+			if (pending && written <= next_pulse)
+				pending = 0;	/* short write lost it */
+		}
+
+		/* drain the capture side, looking for the pulse */
+		while ((n = pcm_xfer(&cap, buf, cap.buffer_size)) > 0) {
+			for (i = 0; pending && i < n; i++) {
+				if (buf[i * CHANNELS] < THRESHOLD)
+					continue;
+
+				lat = now_us() - t_pulse;
+				if (opt_verbose)
+					printf("pulse %d: %.0f us, %lu frames "
+					       "queued\n", measured, lat,
+					       queued);
+				lat_sum += lat;
+				if (lat < lat_min)
+					lat_min = lat;
+				if (lat > lat_max)
+					lat_max = lat;
+				measured++;
+				pending = 0;
+				next_pulse = written + opt_rate / 2;
+			}
+		}
+		if (n < 0) {
+			fprintf(stderr, "capture xrun after %d pulses\n",
+				measured);
+			break;
+		}
+	}
+
+	ioctl(play.fd, SNDRV_PCM_IOCTL_DROP);
+	ioctl(cap.fd, SNDRV_PCM_IOCTL_DROP);
+	close(play.fd);
+	close(cap.fd);
+	free(buf);
+
+	printf("%s -> %s, %u Hz, period %u, buffer %u, fill %u, %s\n",
+	       play.path, cap.path, opt_rate, play.period_size,
+	       play.buffer_size, opt_fill,
+	       opt_no_wakeup ? "no period wakeups" : "period wakeups");
+	if (measured)
+		printf("latency us min %.0f avg %.0f max %.0f over %d pulses\n",
+		       lat_min, lat_sum / measured, lat_max, measured);
+	printf("hw_ptr step %lu frames, %.1f wakeups/s\n",
+	       step == ~0UL ? 0 : step,
+	       written ? wakeups * (double)opt_rate / written : 0.0);
+
+	return measured == opt_count ? 0 : 1;
+}
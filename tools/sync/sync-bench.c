@@ -0,0 +1,184 @@
+/*
+ * sync-bench: fence create/merge/signal throughput using sw_sync
+ *
+ * Needs CONFIG_SW_SYNC_USER.  Every round creates a batch of fences on a
+ * number of sw_sync timelines, merges them all into one fence the way a
+ * compositor gathers acquire fences for a frame, then advances every
+ * timeline and waits for the merged fence.  Reports fences created, merged
+ * and signaled per second.
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the Free
+ * Software Foundation; version 2.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <string.h>
+#include <getopt.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <time.h>
+#include <sys/ioctl.h>
+#include <linux/types.h>
+#include "../../include/linux/sync.h"
+#include "../../include/linux/sw_sync.h"
+
+#define MAX_TIMELINES	64
+
+static int opt_timelines = 4;
+static int opt_fences = 64;
+static int opt_rounds = 1000;
+
+static void usage(void)
+{
+	printf(
+"sync-bench [options]\n"
+"            -t|--timelines N           sw_sync timelines (default 4)\n"
+"            -f|--fences N              fences per timeline per round (default 64)\n"
+"            -r|--rounds N              number of rounds (default 1000)\n"
+"            -h|--help                  Show this usage message\n");
+}
+
+static double now(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static int create_fence(int timeline, __u32 value)
+{
+	struct sw_sync_create_fence_data data;
+
+	memset(&data, 0, sizeof(data));
+	data.value = value;
+	strcpy(data.name, "bench");
+	if (ioctl(timeline, SW_SYNC_IOC_CREATE_FENCE, &data) < 0) {
+		perror("SW_SYNC_IOC_CREATE_FENCE");
+		exit(1);
+	}
+	return data.fence;
+}
+
+static int merge_fence(int a, int b)
+{
+	struct sync_merge_data data;
+
+	memset(&data, 0, sizeof(data));
+	data.fd2 = b;
+	strcpy(data.name, "merged");
+	if (ioctl(a, SYNC_IOC_MERGE, &data) < 0) {
+		perror("SYNC_IOC_MERGE");
+		exit(1);
+	}
+	return data.fence;
+}
+
+int main(int argc, char *argv[])
+{
+	const struct option opts[] = {
+		{ "timelines", 1, NULL, 't' },
+		{ "fences",    1, NULL, 'f' },
+		{ "rounds",    1, NULL, 'r' },
+		{ "help",      0, NULL, 'h' },
+		{ NULL,        0, NULL, 0 }
+	};
+	int timelines[MAX_TIMELINES];
+	double t_create = 0, t_merge = 0, t_signal = 0, t;
+	unsigned long nr_created = 0, nr_merged = 0, nr_signaled = 0;
+	__u32 value = 0;
+	int c, i, j, r;
+
+	while ((c = getopt_long(argc, argv, "t:f:r:h", opts, NULL)) != -1) {
+		switch (c) {
+		case 't':
+			opt_timelines = atoi(optarg);
+			break;
+		case 'f':
+			opt_fences = atoi(optarg);
+			break;
+		case 'r':
+			opt_rounds = atoi(optarg);
+			break;
+		case 'h':
+			usage();
+			exit(0);
+		default:
+			usage();
+			exit(1);
+		}
+	}
+
+	if (opt_timelines <= 0 || opt_timelines > MAX_TIMELINES ||
+	    opt_fences <= 0 || opt_rounds <= 0) {
+		usage();
+		exit(1);
+	}
+
+	for (i = 0; i < opt_timelines; i++) {
+		timelines[i] = open("/dev/sw_sync", O_RDWR);
+		if (timelines[i] < 0) {
+			perror("/dev/sw_sync");
+			exit(1);
+		}
+	}
+
+	for (r = 0; r < opt_rounds; r++) {
+		int merged = -1;
+
+		for (j = 0; j < opt_fences; j++) {
+			value++;
+			for (i = 0; i < opt_timelines; i++) {
+				int fence, tmp;
+
+				t = now();
+				fence = create_fence(timelines[i], value);
+				t_create += now() - t;
+				nr_created++;
+
+				if (merged < 0) {
+					merged = fence;
+					continue;
+				}
+
+				t = now();
+				tmp = merge_fence(merged, fence);
+				t_merge += now() - t;
+				nr_merged++;
+
+				close(merged);
+				close(fence);
+				merged = tmp;
+			}
+		}
+
+		t = now();
+		for (i = 0; i < opt_timelines; i++) {
+			__u32 inc = opt_fences;
+
+			if (ioctl(timelines[i], SW_SYNC_IOC_INC, &inc) < 0) {
+				perror("SW_SYNC_IOC_INC");
+				exit(1);
+			}
+		}
+		i = -1;
+		if (ioctl(merged, SYNC_IOC_WAIT, &i) < 0) {
+			perror("SYNC_IOC_WAIT");
+			exit(1);
+		}
+		t_signal += now() - t;
+		nr_signaled += opt_fences * opt_timelines;
+		close(merged);
+	}
+
+	printf("created:  %12.0f fences/s\n", nr_created / t_create);
+	printf("merged:   %12.0f merges/s\n", nr_merged / t_merge);
+	printf("signaled: %12.0f fences/s\n", nr_signaled / t_signal);
+
+	for (i = 0; i < opt_timelines; i++)
+		close(timelines[i]);
+	return 0;
+}
@@ -0,0 +1,287 @@
+/*
+ * ipa-step: drive the power allocator of a thermal zone through a series of
+ * emulated temperatures and report what it grants
+ *
+ * Each step writes a temperature to the emul_temp attribute of the zone
+ * (CONFIG_THERMAL_EMULATION), lets the controller run for -d seconds and
+ * prints the power granted to every actor, averaged over the samples taken
+ * every -i ms from ipa/actors (CONFIG_CPU_THERMAL_IPA).  Without -t the
+ * steps are derived from the zone's own settings: below switch on, half
+ * way to the control temperature, at it and 5C over it.
+ *
+ * The check at the end is that the power granted never goes up while the
+ * zone gets hotter and that nothing is capped below switch on.  The
+ * emulated temperature is dropped again on exit.
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the Free
+ * Software Foundation; version 2.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <signal.h>
+#include <getopt.h>
+
+#define SYSFS_THERMAL	"/sys/class/thermal"
+#define MAX_ZONES	16
+#define MAX_STEPS	16
+#define MAX_ACTORS	8
+
+struct actor {
+	char name[32];
+	unsigned long max;
+	unsigned long granted;		/* summed over the samples */
+};
+
+static char zone[128];
+static int opt_seconds = 5;
+static int opt_interval_ms = 500;
+static long steps[MAX_STEPS];
+static int nr_steps;
+
+static void usage(void)
+{
+	printf(
+"ipa-step [options]\n"
+"            -z|--zone N                thermal_zoneN, default the first one\n"
+"                                       with a power allocator\n"
+"            -t|--temps C,C,...         emulated temperatures in celsius\n"
+"                                       (default derived from the zone)\n"
+"            -d|--duration S            seconds per step (default 5)\n"
+"            -i|--interval MS           sampling interval (default 500)\n"
+"            -h|--help                  Show this usage message\n");
+}
+
+static int read_long(const char *attr, long *val)
+{
+	char path[256];
+	FILE *f;
+	int ret;
+
+	snprintf(path, sizeof(path), "%s/%s", zone, attr);
+	f = fopen(path, "r");
+	if (!f)
+		return -1;
+	ret = fscanf(f, "%ld", val) == 1 ? 0 : -1;
+	fclose(f);
+
+	return ret;
+}
+
+static int write_long(const char *attr, long val)
+{
+	char path[256];
+	FILE *f;
+	int ret;
+
+	snprintf(path, sizeof(path), "%s/%s", zone, attr);
+	f = fopen(path, "w");
+	if (!f)
+		return -1;
+	ret = fprintf(f, "%ld\n", val) > 0 ? 0 : -1;
+	if (fclose(f))
+		ret = -1;
+
+	return ret;
+}
+
+static int find_zone(int id)
+{
+	char path[256];
+	int i;
+
+	for (i = 0; i < MAX_ZONES; i++) {
+		if (id >= 0 && i != id)
+			continue;
+
+		snprintf(path, sizeof(path),
+			 SYSFS_THERMAL "/thermal_zone%d/ipa/actors", i);
+		if (access(path, R_OK))
+			continue;
+
+		snprintf(zone, sizeof(zone), SYSFS_THERMAL "/thermal_zone%d", i);
+		return 0;
+	}
+
+	return -1;
+}
+
+/* Adds the granted power of every actor to @actors, returns their number */
+static int sample_actors(struct actor *actors)
+{
+	char path[256], line[128], name[32];
+	unsigned long weight, requested, max, granted;
+	int n = 0;
+	FILE *f;
+
+	snprintf(path, sizeof(path), "%s/ipa/actors", zone);
+	f = fopen(path, "r");
+	if (!f)
+		return -1;
+
+	/* header */
+	if (!fgets(line, sizeof(line), f)) {
+		fclose(f);
+		return -1;
+	}
+
+	while (n < MAX_ACTORS && fgets(line, sizeof(line), f)) {
+		if (sscanf(line, "%31s %lu %lu %lu %lu", name, &weight,
+			   &requested, &max, &granted) != 5)
+			continue;
+
+		strcpy(actors[n].name, name);
+		actors[n].max = max;
+		actors[n].granted += granted;
+		n++;
+	}
+	fclose(f);
+
+	return n;
+}
+
+static void restore(int sig)
+{
+	write_long("emul_temp", 0);
+	if (sig)
+		_exit(1);
+}
+
+static int parse_temps(char *arg)
+{
+	char *tok;
+
+	for (tok = strtok(arg, ","); tok; tok = strtok(NULL, ",")) {
+		if (nr_steps == MAX_STEPS)
+			return -1;
+		steps[nr_steps++] = atol(tok) * 1000;
+	}
+
+	return nr_steps ? 0 : -1;
+}
+
+int main(int argc, char **argv)
+{
+	static const struct option opts[] = {
+		{ "zone",     1, NULL, 'z' },
+		{ "temps",    1, NULL, 't' },
+		{ "duration", 1, NULL, 'd' },
+		{ "interval", 1, NULL, 'i' },
+		{ "help",     0, NULL, 'h' },
+		{ NULL,       0, NULL, 0 }
+	};
+	struct actor actors[MAX_ACTORS];
+	unsigned long total, max_total, prev_total = ~0UL;
+	long switch_on, control;
+	int c, id = -1, s, n = 0, a, samples, failed = 0;
+
+	while ((c = getopt_long(argc, argv, "z:t:d:i:h", opts, NULL)) != -1) {
+		switch (c) {
+		case 'z':
+			id = atoi(optarg);
+			break;
+		case 't':
+			if (parse_temps(optarg)) {
+				usage();
+				exit(1);
+			}
+			break;
+		case 'd':
+			opt_seconds = atoi(optarg);
+			break;
+		case 'i':
+			opt_interval_ms = atoi(optarg);
+			break;
+		case 'h':
+			usage();
+			exit(0);
+		default:
+			usage();
+			exit(1);
+		}
+	}
+
+	if (opt_seconds <= 0 || opt_interval_ms <= 0) {
+		usage();
+		exit(1);
+	}
+
+	if (find_zone(id)) {
+		fprintf(stderr, "no thermal zone with a power allocator\n");
+		exit(1);
+	}
+
+	if (read_long("ipa/switch_on_temp", &switch_on) ||
+	    read_long("ipa/control_temp", &control)) {
+		fprintf(stderr, "%s: cannot read the ipa settings\n", zone);
+		exit(1);
+	}
+
+	if (!nr_steps) {
+		steps[nr_steps++] = switch_on - 5000;
+		steps[nr_steps++] = (switch_on + control) / 2;
+		steps[nr_steps++] = control;
+		steps[nr_steps++] = control + 5000;
+	}
+
+	signal(SIGINT, restore);
+	signal(SIGTERM, restore);
+
+	printf("%s: switch on %ld mC, control %ld mC\n", zone, switch_on,
+	       control);
+
+	for (s = 0; s < nr_steps; s++) {
+		if (write_long("emul_temp", steps[s])) {
+			fprintf(stderr, "%s: cannot write emul_temp, is "
+				"CONFIG_THERMAL_EMULATION set?\n", zone);
+			exit(1);
+		}
+
+		memset(actors, 0, sizeof(actors));
+		samples = 0;
+
+		/* one period to settle, then sample the rest of the step */
+		usleep(opt_interval_ms * 1000);
+		for (c = 0; c < opt_seconds * 1000 / opt_interval_ms; c++) {
+			n = sample_actors(actors);
+			if (n < 0) {
+				fprintf(stderr, "%s: cannot read ipa/actors\n",
+					zone);
+				restore(0);
+				exit(1);
+			}
+			samples++;
+			usleep(opt_interval_ms * 1000);
+		}
+
+		total = 0;
+		max_total = 0;
+		printf("%6ld mC:", steps[s]);
+		for (a = 0; a < n; a++) {
+			printf(" %s %lu/%lu", actors[a].name,
+			       actors[a].granted / samples, actors[a].max);
+			total += actors[a].granted / samples;
+			max_total += actors[a].max;
+		}
+		printf(" total %lu mW\n", total);
+
+		if (steps[s] < switch_on && total < max_total) {
+			printf("FAIL: capped below switch on\n");
+			failed = 1;
+		}
+		if (s && steps[s] > steps[s - 1] && total > prev_total) {
+			printf("FAIL: more power granted at a higher "
+			       "temperature\n");
+			failed = 1;
+		}
+		prev_total = total;
+	}
+
+	restore(0);
+	printf("%s\n", failed ? "FAIL" : "PASS");
+
+	return failed;
+}